@@ -0,0 +1,173 @@
+// Generated-code benchmark: every kernel in benchmarks/codegen exists twice,
+// as Thor (name.thor) and as hand-written C (name.c) that does the same work
+// and prints the same output. Both are built with the same C compiler and
+// optimization level, run several times each, and compared by their fastest
+// run, so the ratio measures what the C emitted by CodeGenerator costs over
+// plain C. Outputs must match, or the kernel is reported as broken.
+//
+// Build with -DTHOR_BUILD_BENCHMARKS=ON and run
+//   bin/thor_codegen_bench [-O<level>] [--runs n] [--max-ratio r] [kernel...]
+// --max-ratio makes it exit with 1 when a kernel is slower than r times its C
+// twin, for use as a regression gate.
+#include "Compiler.h"
+#include "CompilerLocator.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef THOR_CODEGEN_KERNELS
+#define THOR_CODEGEN_KERNELS "benchmarks/codegen"
+#endif
+
+#ifdef _WIN32
+#define THOR_EXE ".exe"
+#else
+#define THOR_EXE ""
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::string readFile(const fs::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    return buffer.str();
+}
+
+// Seconds of wall time for one run; stdout goes to `output`
+double timeRun(const fs::path& executable, const fs::path& output) {
+    std::string command = "\"" + executable.string() + "\" > \"" + output.string() + "\"";
+#ifdef _WIN32
+    command = "\"" + command + "\"";
+#endif
+    auto start = std::chrono::steady_clock::now();
+    int status = std::system(command.c_str());
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return status == 0 ? seconds : -1;
+}
+
+// Fastest of `runs` runs, or a negative number when a run failed
+double fastestRun(const fs::path& executable, const fs::path& output, int runs) {
+    double fastest = -1;
+    for (int i = 0; i < runs; i++) {
+        double seconds = timeRun(executable, output);
+        if (seconds < 0) {
+            return -1;
+        }
+        fastest = fastest < 0 ? seconds : std::min(fastest, seconds);
+    }
+    return fastest;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string optimization = "-O2";
+    int runs = 5;
+    double maxRatio = 0;
+    std::vector<std::string> kernels;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("-O", 0) == 0) {
+            optimization = arg;
+        } else if (arg == "--runs" && i + 1 < argc) {
+            runs = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--max-ratio" && i + 1 < argc) {
+            maxRatio = std::atof(argv[++i]);
+        } else if (arg.rfind("-", 0) == 0) {
+            std::fprintf(stderr, "usage: %s [-O<level>] [--runs n] [--max-ratio r] [kernel...]\n", argv[0]);
+            return 1;
+        } else {
+            kernels.push_back(arg);
+        }
+    }
+
+    fs::path source = THOR_CODEGEN_KERNELS;
+    if (kernels.empty()) {
+        std::error_code ec;
+        for (const auto& entry : fs::directory_iterator(source, ec)) {
+            if (entry.path().extension() == ".thor" && fs::exists(fs::path(entry.path()).replace_extension(".c"))) {
+                kernels.push_back(entry.path().stem().string());
+            }
+        }
+        std::sort(kernels.begin(), kernels.end());
+    }
+    if (kernels.empty()) {
+        std::fprintf(stderr, "no kernels found in %s\n", source.string().c_str());
+        return 1;
+    }
+
+    CCompiler compiler = CompilerLocator().locate();
+    if (compiler.empty()) {
+        std::fprintf(stderr, "no C compiler found\n");
+        return 1;
+    }
+    std::error_code ec;
+    fs::path work = fs::temp_directory_path(ec) / "thor_codegen_bench";
+    fs::create_directories(work, ec);
+
+    // Both sides get the frame pointer flags Thor always compiles with
+    std::vector<std::string> flags = compiler.frameFlags();
+    flags.push_back(optimization);
+    Compiler thor;
+    thor.setCCompiler(compiler);
+    thor.setCFlags({ optimization });
+
+    std::printf("%s %s, best of %d runs\n\n", compiler.version.c_str(), optimization.c_str(), runs);
+    std::printf("%-12s %10s %10s %8s\n", "kernel", "thor s", "c s", "ratio");
+    bool failed = false;
+    double logRatios = 0;
+    int measured = 0;
+    for (const auto& kernel : kernels) {
+        fs::path thorExecutable = work / (kernel + "_thor" THOR_EXE);
+        fs::path cExecutable = work / (kernel + "_c" THOR_EXE);
+
+        Compiler::Result result = thor.compileFileToExecutable((source / (kernel + ".thor")).string(),
+                                                               thorExecutable.string());
+        for (const auto& diagnostic : result.diagnostics) {
+            std::fprintf(stderr, "%s\n", diagnostic.toString().c_str());
+        }
+        std::string command = compiler.command();
+        for (const auto& flag : flags) {
+            command += " " + flag;
+        }
+        command += " \"" + (source / (kernel + ".c")).string() + "\" -o \"" + cExecutable.string() + "\"";
+        if (!result.success || std::system(command.c_str()) != 0) {
+            std::printf("%-12s build failed\n", kernel.c_str());
+            failed = true;
+            continue;
+        }
+
+        fs::path thorOutput = work / (kernel + "_thor.out");
+        fs::path cOutput = work / (kernel + "_c.out");
+        double thorSeconds = fastestRun(thorExecutable, thorOutput, runs);
+        double cSeconds = fastestRun(cExecutable, cOutput, runs);
+        if (thorSeconds < 0 || cSeconds < 0 || readFile(thorOutput) != readFile(cOutput)) {
+            std::printf("%-12s %s\n", kernel.c_str(),
+                        thorSeconds < 0 || cSeconds < 0 ? "run failed" : "outputs differ");
+            failed = true;
+            continue;
+        }
+
+        double ratio = thorSeconds / std::max(cSeconds, 1e-6);
+        bool regressed = maxRatio > 0 && ratio > maxRatio;
+        std::printf("%-12s %10.3f %10.3f %7.2fx%s\n", kernel.c_str(), thorSeconds, cSeconds, ratio,
+                    regressed ? "  over limit" : "");
+        failed = failed || regressed;
+        logRatios += std::log(ratio);
+        measured++;
+    }
+    if (measured > 0) {
+        std::printf("\n%-12s %10s %10s %7.2fx\n", "geomean", "", "", std::exp(logRatios / measured));
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,27 @@
+#include <stdio.h>
+
+#define PALMS_PER_CUBIT 6
+#define FINGERS_PER_PALM 4
+#define FINGERS_PER_CUBIT (PALMS_PER_CUBIT * FINGERS_PER_PALM)
+
+static int to_fingers(int cubits, int palms, int fingers) {
+    return cubits * FINGERS_PER_CUBIT + palms * FINGERS_PER_PALM + fingers;
+}
+
+static void from_fingers(int total, int* cubits, int* palms, int* fingers) {
+    *cubits = total / FINGERS_PER_CUBIT;
+    total %= FINGERS_PER_CUBIT;
+    *palms = total / FINGERS_PER_PALM;
+    *fingers = total % FINGERS_PER_PALM;
+}
+
+int main(void) {
+    int cubits = 0, palms = 0, fingers = 0;
+    int checksum = 0;
+    for (int i = 0; i < 100000000; i++) {
+        from_fingers(i % 1000000, &cubits, &palms, &fingers);
+        checksum = (checksum * 31 + to_fingers(cubits, palms, fingers) + cubits) % 999983;
+    }
+    printf("%d\n", checksum);
+    return 0;
+}
@@ -0,0 +1,12 @@
+#include <stdio.h>
+
+int main(void) {
+    int total = 0;
+    char line[64];
+    for (int i = 0; i < 2000000; i++) {
+        int length = snprintf(line, sizeof(line), "record %d of %d: %d", i % 100000, 100000, (i * 7) % 1000);
+        total = (total + length) % 999983;
+    }
+    printf("%d\n", total);
+    return 0;
+}
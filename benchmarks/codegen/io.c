@@ -0,0 +1,8 @@
+#include <stdio.h>
+
+int main(void) {
+    for (int i = 0; i < 2000000; i++) {
+        printf("row %d: %d\n", i % 100000, (i * 13) % 1000);
+    }
+    return 0;
+}
@@ -0,0 +1,17 @@
+#include <stdio.h>
+
+int main(void) {
+    int checksum = 0;
+    for (int i = 0; i < 12000; i++) {
+        for (int j = 0; j < 12000; j++) {
+            if ((i ^ j) & 1) {
+                checksum += (i * j) % 7;
+            } else {
+                checksum -= (i + j) % 5;
+            }
+        }
+        checksum %= 999983;
+    }
+    printf("%d\n", checksum);
+    return 0;
+}
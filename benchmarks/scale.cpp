@@ -0,0 +1,164 @@
+// Scale benchmark: compiles machine-generated programs with very long
+// expressions and very deep nesting (lex, parse, generate C, free the AST) at
+// doubling sizes. Time and memory per term should stay flat as sizes grow, and
+// everything runs on a thread with a small stack to show that no phase
+// recurses once per nesting level. Each run is made in a child process of its
+// own, so its peak RSS is not the high-water mark of an earlier, bigger run.
+//
+// Build with -DTHOR_BUILD_BENCHMARKS=ON and run bin/thor_scale_bench [scale],
+// where scale (default 1) multiplies every size.
+#include "CodeGenerator.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr size_t STACK_SIZE = 256 * 1024;
+
+struct Shape {
+    const char* name;
+    size_t baseSize; // terms or nesting levels of the smallest run
+    std::function<std::string(size_t)> generate;
+};
+
+std::string program(const std::string& body) {
+    return "package main;\n\nfunc f(int x) -> int {\n    return x;\n}\n\n"
+           "func main() -> int {\n    int x = 1;\n" + body + "    return x;\n}\n";
+}
+
+std::string repeat(const std::string& text, size_t count) {
+    std::string result;
+    result.reserve(text.size() * count);
+    for (size_t i = 0; i < count; i++) {
+        result += text;
+    }
+    return result;
+}
+
+const std::vector<Shape> shapes = {
+    { "sum", 125000, [](size_t n) { return program("    x = x" + repeat(" + 1", n) + ";\n"); } },
+    { "assignments", 125000, [](size_t n) { return program("    " + repeat("x = ", n) + "1;\n"); } },
+    { "parentheses", 10000, [](size_t n) { return program("    x = " + repeat("(", n) + "x" + repeat(" + 1)", n) + ";\n"); } },
+    { "calls", 10000, [](size_t n) { return program("    x = " + repeat("f(", n) + "x" + repeat(")", n) + ";\n"); } },
+    { "negations", 10000, [](size_t n) { return program("    x = " + repeat("-", n) + "x;\n"); } },
+    { "blocks", 10000, [](size_t n) { return program(repeat("{\n", n) + "x = x + 1;\n" + repeat("}\n", n)); } },
+    { "ifs", 10000, [](size_t n) { return program(repeat("if (x > 0) {\n", n) + "x = x + 1;\n" + repeat("}\n", n)); } },
+};
+
+long peakMemoryKB() {
+#ifndef _WIN32
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+#else
+    return 0;
+#endif
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void measure(const Shape& shape, size_t size) {
+    std::string source = shape.generate(size);
+
+    auto start = std::chrono::steady_clock::now();
+    Lexer lexer(source);
+    Parser parser(lexer.tokenize());
+    auto program = parser.parse();
+    double parseTime = millisecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    std::string code = CodeGenerator().generate(program, {});
+    double generateTime = millisecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    program.reset();
+    double freeTime = millisecondsSince(start);
+
+    double total = parseTime + generateTime + freeTime;
+    std::printf("%-12s %9zu %10.1f %10.1f %10.1f %10.1f %10zu %12ld\n", shape.name, size,
+                parseTime, generateTime, freeTime, total * 1e6 / size, code.size(), peakMemoryKB());
+}
+
+// Runs measure() in a fresh child process (on the calling thread's small
+// stack), which starts with the parent's small footprint
+bool measureInChild(const Shape& shape, size_t size) {
+#ifndef _WIN32
+    std::fflush(stdout);
+    pid_t child = fork();
+    if (child < 0) {
+        std::fprintf(stderr, "fork failed\n");
+        return false;
+    }
+    if (child == 0) {
+        measure(shape, size);
+        std::fflush(stdout);
+        _exit(0);
+    }
+    int status = 0;
+    if (waitpid(child, &status, 0) != child || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::fprintf(stderr, "%s at size %zu failed\n", shape.name, size);
+        return false;
+    }
+#else
+    measure(shape, size);
+#endif
+    return true;
+}
+
+void run(size_t scale) {
+    std::printf("%-12s %9s %10s %10s %10s %10s %10s %12s\n",
+                "shape", "size", "parse ms", "gen ms", "free ms", "ns/term", "C bytes", "peak RSS KB");
+    for (const Shape& shape : shapes) {
+        for (size_t step = 0; step < 4; step++) {
+            if (!measureInChild(shape, shape.baseSize * scale << step)) {
+                return;
+            }
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t scale = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1;
+    if (scale == 0) {
+        std::fprintf(stderr, "usage: %s [scale]\n", argv[0]);
+        return 1;
+    }
+
+#ifndef _WIN32
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    pthread_attr_setstacksize(&attributes, STACK_SIZE);
+    pthread_t thread;
+    auto body = [](void* argument) -> void* {
+        run(*static_cast<size_t*>(argument));
+        return nullptr;
+    };
+    if (pthread_create(&thread, &attributes, body, &scale) != 0) {
+        std::fprintf(stderr, "failed to start the benchmark thread\n");
+        return 1;
+    }
+    pthread_join(thread, nullptr);
+    pthread_attr_destroy(&attributes);
+#else
+    run(scale);
+#endif
+    return 0;
+}
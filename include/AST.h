@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <memory>
 #include <vector>
 #include <string>
@@ -9,6 +10,21 @@ struct Type;
 // Base AST Node
 struct ASTNode {
     virtual ~ASTNode() = default;
+
+protected:
+    // Destroying children from their parent's destructor would recurse once per
+    // level and overflow the stack on deep trees (a million-term sum, thousands of
+    // nested blocks). Nodes hand their children to release() instead, which
+    // destroys them from a work list.
+    static void release(std::shared_ptr<ASTNode> child);
+    template <typename T>
+    static void release(std::shared_ptr<T>& child) {
+        if (child) release(std::shared_ptr<ASTNode>(std::move(child)));
+    }
+    template <typename T>
+    static void release(std::vector<std::shared_ptr<T>>& children) {
+        for (auto& child : children) release(child);
+    }
 };
 
 // Expression nodes
@@ -37,6 +53,7 @@ struct BinaryExpression : Expression {
     
     BinaryExpression(std::shared_ptr<Expression> l, const std::string& op, std::shared_ptr<Expression> r)
         : left(l), operator_(op), right(r) {}
+    ~BinaryExpression() override { release(left); release(right); }
 };
 
 struct UnaryExpression : Expression {
@@ -45,6 +62,7 @@ struct UnaryExpression : Expression {
     
     UnaryExpression(const std::string& op, std::shared_ptr<Expression> expr)
         : operator_(op), operand(expr) {}
+    ~UnaryExpression() override { release(operand); }
 };
 
 struct CallExpression : Expression {
@@ -53,6 +71,7 @@ struct CallExpression : Expression {
     
     CallExpression(std::shared_ptr<Expression> c, std::vector<std::shared_ptr<Expression>> args)
         : callee(c), arguments(args) {}
+    ~CallExpression() override { release(callee); release(arguments); }
 };
 
 struct MemberExpression : Expression {
@@ -61,6 +80,7 @@ struct MemberExpression : Expression {
     
     MemberExpression(std::shared_ptr<Expression> obj, const std::string& prop)
         : object(obj), property(prop) {}
+    ~MemberExpression() override { release(object); }
 };
 
 struct ArrayExpression : Expression {
@@ -68,6 +88,7 @@ struct ArrayExpression : Expression {
     
     ArrayExpression(std::vector<std::shared_ptr<Expression>> elems)
         : elements(elems) {}
+    ~ArrayExpression() override { release(elements); }
 };
 
 struct FormatStringExpression : Expression {
@@ -76,15 +97,24 @@ struct FormatStringExpression : Expression {
     
     FormatStringExpression(const std::string& fmt, std::vector<std::shared_ptr<Expression>> args)
         : format(fmt), arguments(args) {}
+    ~FormatStringExpression() override { release(arguments); }
 };
 
 // Statement nodes
-struct Statement : ASTNode {};
+// Positions come from the statement's first token. Top-level statements hold
+// their absolute line; nested ones hold their line relative to the top-level
+// statement around them, so IncrementalParser can move a reused declaration
+// by updating that one node. Columns are absolute.
+struct Statement : ASTNode {
+    int line = 0; // 0 for statements that did not come from source text
+    int column = 0;
+};
 
 struct ExpressionStatement : Statement {
     std::shared_ptr<Expression> expression;
     
     ExpressionStatement(std::shared_ptr<Expression> expr) : expression(expr) {}
+    ~ExpressionStatement() override { release(expression); }
 };
 
 struct VariableDeclaration : Statement {
@@ -94,6 +124,7 @@ struct VariableDeclaration : Statement {
     
     VariableDeclaration(const std::string& n, std::shared_ptr<Type> t, std::shared_ptr<Expression> init = nullptr)
         : name(n), type(t), initializer(init) {}
+    ~VariableDeclaration() override { release(initializer); }
 };
 
 struct ConstDeclaration : Statement {
@@ -103,12 +134,14 @@ struct ConstDeclaration : Statement {
     
     ConstDeclaration(const std::string& n, std::shared_ptr<Type> t, std::shared_ptr<Expression> init)
         : name(n), type(t), initializer(init) {}
+    ~ConstDeclaration() override { release(initializer); }
 };
 
 struct BlockStatement : Statement {
     std::vector<std::shared_ptr<Statement>> statements;
     
     BlockStatement(std::vector<std::shared_ptr<Statement>> stmts) : statements(stmts) {}
+    ~BlockStatement() override { release(statements); }
 };
 
 struct IfStatement : Statement {
@@ -118,6 +151,7 @@ struct IfStatement : Statement {
     
     IfStatement(std::shared_ptr<Expression> cond, std::shared_ptr<Statement> then, std::shared_ptr<Statement> els = nullptr)
         : condition(cond), thenBranch(then), elseBranch(els) {}
+    ~IfStatement() override { release(condition); release(thenBranch); release(elseBranch); }
 };
 
 struct WhileStatement : Statement {
@@ -126,38 +160,46 @@ struct WhileStatement : Statement {
     
     WhileStatement(std::shared_ptr<Expression> cond, std::shared_ptr<Statement> b)
         : condition(cond), body(b) {}
+    ~WhileStatement() override { release(condition); release(body); }
 };
 
 struct ReturnStatement : Statement {
     std::shared_ptr<Expression> value;
     
     ReturnStatement(std::shared_ptr<Expression> val = nullptr) : value(val) {}
+    ~ReturnStatement() override { release(value); }
 };
 
 // Type system
+// Types are interned: each distinct type exists exactly once, so two types are
+// the same type exactly when they are the same object (or have the same id),
+// with no structural walk. They are only made by the create functions, never
+// change, and live until the program exits.
 struct Type {
-    enum TypeKind { VOID_TYPE, INTEGER_TYPE, FLOAT_TYPE, STRING_TYPE, BOOLEAN_TYPE, ARRAY_TYPE, FUNCTION_TYPE, REFERENCE_TYPE } kind;
-    std::shared_ptr<Type> elementType; // For arrays and references
-    std::vector<std::shared_ptr<Type>> parameterTypes; // For functions
-    std::shared_ptr<Type> returnType; // For functions
-    
-    Type(TypeKind k) : kind(k) {}
-    
-    static std::shared_ptr<Type> createVoid() { return std::make_shared<Type>(VOID_TYPE); }
-    static std::shared_ptr<Type> createInt() { return std::make_shared<Type>(INTEGER_TYPE); }
-    static std::shared_ptr<Type> createFloat() { return std::make_shared<Type>(FLOAT_TYPE); }
-    static std::shared_ptr<Type> createString() { return std::make_shared<Type>(STRING_TYPE); }
-    static std::shared_ptr<Type> createBoolean() { return std::make_shared<Type>(BOOLEAN_TYPE); }
-    static std::shared_ptr<Type> createArray(std::shared_ptr<Type> elem) {
-        auto type = std::make_shared<Type>(ARRAY_TYPE);
-        type->elementType = elem;
-        return type;
-    }
-    static std::shared_ptr<Type> createReference(std::shared_ptr<Type> elem) {
-        auto type = std::make_shared<Type>(REFERENCE_TYPE);
-        type->elementType = elem;
-        return type;
-    }
+    enum TypeKind { VOID_TYPE, INTEGER_TYPE, FLOAT_TYPE, STRING_TYPE, STR_TYPE, BOOLEAN_TYPE, ARRAY_TYPE, FUNCTION_TYPE, REFERENCE_TYPE };
+    const TypeKind kind;
+    const uint32_t id; // dense, in order of first use
+    const std::shared_ptr<Type> elementType; // For arrays and references
+    const std::vector<std::shared_ptr<Type>> parameterTypes; // For functions
+    const std::shared_ptr<Type> returnType; // For functions
+    
+    static std::shared_ptr<Type> createVoid();
+    static std::shared_ptr<Type> createInt();
+    static std::shared_ptr<Type> createFloat();
+    static std::shared_ptr<Type> createString();
+    static std::shared_ptr<Type> createStr(); // a view of part of a string, not owning it
+    static std::shared_ptr<Type> createBoolean();
+    static std::shared_ptr<Type> createArray(std::shared_ptr<Type> elem);
+    static std::shared_ptr<Type> createReference(std::shared_ptr<Type> elem);
+    static std::shared_ptr<Type> createFunction(std::vector<std::shared_ptr<Type>> params, std::shared_ptr<Type> ret);
+    
+private:
+    Type(TypeKind k, uint32_t id, std::shared_ptr<Type> elem, std::vector<std::shared_ptr<Type>> params, std::shared_ptr<Type> ret)
+        : kind(k), id(id), elementType(std::move(elem)), parameterTypes(std::move(params)), returnType(std::move(ret)) {}
+    
+    // Returns the one type with these parts, creating it on first use
+    static std::shared_ptr<Type> intern(TypeKind kind, std::shared_ptr<Type> elem = nullptr,
+                                        std::vector<std::shared_ptr<Type>> params = {}, std::shared_ptr<Type> ret = nullptr);
 };
 
 struct Parameter {
@@ -176,6 +218,17 @@ struct FunctionDeclaration : Statement {
     FunctionDeclaration(const std::string& n, std::vector<Parameter> params, 
                        std::shared_ptr<Type> ret, std::shared_ptr<BlockStatement> b)
         : name(n), parameters(params), returnType(ret), body(b) {}
+    ~FunctionDeclaration() override { release(body); }
+};
+
+// A microbenchmark, `bench name { ... }`: the body is one iteration. Benches
+// are only compiled by `thor bench`; other builds leave them out.
+struct BenchDeclaration : Statement {
+    std::string name;
+    std::shared_ptr<BlockStatement> body;
+    
+    BenchDeclaration(const std::string& n, std::shared_ptr<BlockStatement> b) : name(n), body(b) {}
+    ~BenchDeclaration() override { release(body); }
 };
 
 struct PackageDeclaration : Statement {
@@ -195,6 +248,7 @@ struct Program : ASTNode {
     std::shared_ptr<PackageDeclaration> package;
     std::vector<std::shared_ptr<ImportDeclaration>> imports;
     std::vector<std::shared_ptr<Statement>> statements;
+    std::string sourcePath; // file the program was parsed from, "" if unknown
     
     Program() = default;
 };
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+#include "CompilerLocator.h"
+#include <string>
+#include <vector>
+
+struct BenchOptions {
+    std::vector<std::string> filters; // empty = every bench; otherwise names containing one of these
+    int samples = 100;                // timed batches per bench
+    double sampleTime = 2000;         // microseconds each batch should take
+    std::string outputDir = "thor-out";
+    std::string baseline;             // saved results to compare against
+    std::string save;                 // where to save this run's results
+    double threshold = 0.05;          // median slowdown that counts as a regression
+};
+
+// One bench's timings, in nanoseconds per iteration
+struct BenchResult {
+    std::string name;         // "<file>:<bench>"
+    long long iterations = 0; // per sample
+    size_t samples = 0;
+    double min = 0;
+    double median = 0, medianLow = 0, medianHigh = 0; // with a 95% confidence interval
+    double p99 = 0, p99Low = 0, p99High = 0;
+
+    // Quantiles interpolate between samples; the intervals are distribution-free,
+    // bounded by the order statistics around each quantile's rank
+    static BenchResult summarize(const std::string& name, long long iterations, std::vector<double> samples);
+};
+
+// `thor bench`: every file's bench blocks are compiled with full optimization
+// into a harness executable (see CodeGenerator::setBenchmarks), which calibrates
+// an iteration count per bench and times a number of batches of it. The runner
+// reports each bench's min, median and p99, and compares them against a saved
+// baseline: a bench regressed when its median got slower by more than the
+// threshold and the confidence intervals of the two medians do not overlap.
+class BenchRunner {
+private:
+    BenchOptions options;
+    CCompiler compiler;
+    std::vector<std::string> cFlags;
+
+    bool selected(const std::string& name) const;
+    bool runFile(const std::string& file, size_t index, std::vector<BenchResult>& results);
+
+public:
+    explicit BenchRunner(const BenchOptions& options);
+
+    // The .thor files below `root` that contain bench blocks (skipping hidden
+    // directories and `outputDir`)
+    static std::vector<std::string> discover(const std::string& root, const std::string& outputDir);
+
+    // Returns 0, or 1 when a file failed to build or run or a bench regressed
+    int run(const std::vector<std::string>& files);
+};
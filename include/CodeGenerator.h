@@ -1,10 +1,12 @@
 #pragma once
 #include "AST.h"
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 #include <sstream>
 #include <set>
+#include <unordered_set>
 
 class CodeGenerator {
 private:
@@ -12,20 +14,119 @@ private:
     int indentLevel;
     std::unordered_map<std::string, std::shared_ptr<Program>> modules;
     std::unordered_map<std::string, std::string> builtinFunctions;
+    std::unordered_set<std::string> allocatingBuiltins;
+    
+    // Runtime sections: a single-file program gets only the parts of the
+    // runtime it calls into, while the runtime of separate compilation, built
+    // once for every module, has them all
+    enum RuntimeSection : unsigned {
+        RUNTIME_FORMAT = 1 << 0, // thor_format_values() and the number formatting behind it
+        RUNTIME_STR = 1 << 1,    // the std operations on str views
+        RUNTIME_TEXT = 1 << 2,   // the text kernels and the str operations that search with them
+        RUNTIME_FS = 1 << 3,     // std.fs
+        RUNTIME_PARSE = 1 << 4,  // number parsing and the standard input tokenizer
+        RUNTIME_ALL = ~0u
+    };
+    std::unordered_map<std::string, unsigned> builtinSections; // by C name, where not 0
+    unsigned runtimeSections(const Program& program); // those the program's code can reach
     std::shared_ptr<Program> currentProgram; // Track current program being generated
     std::set<std::string> referenceParameters; // Track reference parameters in current function
+    std::unordered_set<std::string> hotPackages; // Packages called through patchable function tables
+    bool emitSafepoints = false; // Poll for hot reloads at loop back-edges
+    bool instrument = false; // Entry and exit probes in every function (see setInstrumentation)
+    const FunctionDeclaration* currentFunction = nullptr; // while generating its body
+    bool trackAllocations = false; // Allocating helpers are told their call site (see setAllocationTracking)
+    std::vector<std::string> allocationSites; // initializers of the current program's site table
+    int currentLine = 0;         // Thor line of the statement being generated
+    bool benchmarks = false;     // Bench blocks replace main() (see setBenchmarks)
+    const Program* benchProgram = nullptr; // the program whose benches are compiled
+    size_t hotModuleCount = 0;
+    
+    // Declared types, for the argument types of format expressions (see
+    // formatType) and conversions to str: locals and parameters in scope,
+    // innermost last, and the constants and function types ("name()") of the
+    // current program and, by "package.name", of the programs it can call
+    std::vector<std::pair<std::string, std::shared_ptr<Type>>> localTypes;
+    std::unordered_map<std::string, std::shared_ptr<Type>> programTypes;
+    std::unordered_map<std::string, std::shared_ptr<Type>> packageTypes;
+    void addDeclaredTypes(const Program& program, std::unordered_map<std::string, std::shared_ptr<Type>>& types,
+                          const std::string& prefix);
+    void addPackageTypes(const std::shared_ptr<Program>& program);
+    static constexpr int MAX_INDENT = 64;
+    
+    // Source mapping (see setLineDirectives)
+    std::string generatedPath;  // empty: no #line directives
+    int firstLine = 1;
+    int outputLine = 1;         // line of the generated file being written
+    bool mapped = false;        // whether the C compiler currently attributes lines to Thor source
+    std::string mappedFile;
+    int mappedOffset = 0;       // Thor line = C line + mappedOffset while mapped
+    const Statement* topLevelStatement = nullptr;
+    int lineBase = 0;           // line of topLevelStatement; nested statement lines are relative to it
+    int sourceLine(const Statement& stmt) const;
+    void mapLine(const Statement& stmt);
+    void unmapLines();
+    
+    // Expressions and statements are generated from explicit work lists rather
+    // than by recursion, so deep trees cannot overflow the native stack
+    // Tasks point into the tree and at text owned by it (or at literals), so
+    // they stay valid for as long as the walk
+    struct ExpressionTask {
+        const std::shared_ptr<Expression>* expression; // null for a piece of text
+        std::string_view text;
+        bool bare = false; // a binary expression written without its parentheses
+        
+        ExpressionTask(const std::shared_ptr<Expression>& expr, bool bare = false) : expression(&expr), bare(bare) {}
+        ExpressionTask(const char* text) : expression(nullptr), text(text) {}
+        ExpressionTask(const std::string& text) : expression(nullptr), text(text) {}
+    };
+    struct StatementTask {
+        enum Kind { STATEMENT, LINE, INDENT, DEDENT, SCOPE } kind;
+        const std::shared_ptr<Statement>* statement = nullptr;
+        const char* line = nullptr;
+        size_t locals = 0; // SCOPE: how many locals stay in scope
+        
+        StatementTask(const std::shared_ptr<Statement>& stmt) : kind(STATEMENT), statement(&stmt) {}
+        StatementTask(Kind kind, const char* line = nullptr) : kind(kind), line(line) {}
+        static StatementTask scope(size_t locals) {
+            StatementTask task(SCOPE);
+            task.locals = locals;
+            return task;
+        }
+    };
+    // Both lists run last-in first-out: a node pushes the steps that follow it in
+    // order and then calls scheduleExpressions()/scheduleStatements() with the
+    // list's size from before, which reverses them
+    std::vector<ExpressionTask> expressionTasks;
+    std::vector<StatementTask> statementTasks;
+    void schedule(std::initializer_list<ExpressionTask> steps);
+    void scheduleExpressions(size_t mark);
+    void scheduleStatements(size_t mark);
     
     void indent();
     void writeLine(const std::string& line = "");
-    void write(const std::string& text);
+    void write(std::string_view text);
     
     // Generation methods
     void generateIncludes();
-    void generateBuiltinFunctions();
+    void generateBuiltinDeclarations(unsigned sections);
+    void generateBuiltinFunctions(unsigned sections);
     void generateType(std::shared_ptr<Type> type);
     void generateExpression(std::shared_ptr<Expression> expr);
+    void generateExpressionStep(const std::shared_ptr<Expression>& expr, bool bare);
     void generateStatement(std::shared_ptr<Statement> stmt);
+    void generateStatementStep(const std::shared_ptr<Statement>& stmt);
     void generateFunction(std::shared_ptr<FunctionDeclaration> func);
+    std::string functionName(std::shared_ptr<FunctionDeclaration> func); // the C name
+    void generateFunctionSignature(std::shared_ptr<FunctionDeclaration> func);
+    void generateBench(std::shared_ptr<BenchDeclaration> bench);
+    void generateBenchMain(std::shared_ptr<Program> program);
+    void generateProfileSite(std::shared_ptr<FunctionDeclaration> func);
+    std::string profileSiteName(std::shared_ptr<FunctionDeclaration> func);
+    std::string allocationSiteTable();
+    std::string allocationSite(); // a new site at the current statement
+    void generateDeclarations(std::shared_ptr<Program> program);
+    void generateModuleTable(std::shared_ptr<Program> program);
     void generateProgram(std::shared_ptr<Program> program);
     
     // Helper methods
@@ -33,12 +134,65 @@ private:
     std::string getCTypeName(std::shared_ptr<Type> type);
     bool isFloatExpression(std::shared_ptr<Expression> expr);
     bool isStringExpression(std::shared_ptr<Expression> expr);
-    std::string generateFormatString(const std::string& format, 
-                                   const std::vector<std::shared_ptr<Expression>>& args);
+    char formatType(const std::shared_ptr<Expression>& expr); // thor_format_values() letter, 0 if unknown
+    std::shared_ptr<Type> calleeType(const CallExpression& call); // the function type, null if unknown
+    const char* viewConversion(const std::shared_ptr<Expression>& expr, const std::shared_ptr<Type>& target);
+    void generateConverted(std::shared_ptr<Expression> expr, const std::shared_ptr<Type>& target);
+    void generateFormatString(const std::string& format, 
+                              const std::vector<std::shared_ptr<Expression>>& args);
     void initializeBuiltinFunctions();
     
 public:
     CodeGenerator();
     std::string generate(std::shared_ptr<Program> program, 
                         const std::unordered_map<std::string, std::shared_ptr<Program>>& importedModules);
+    
+    // Separate compilation: the runtime and every module become their own translation unit
+    static const char* RUNTIME_HEADER;
+    std::string generateRuntimeHeader();
+    std::string generateRuntimeSource();
+    std::string generateModule(std::shared_ptr<Program> program,
+                               const std::vector<std::shared_ptr<Program>>& dependencies);
+    static bool hasDefinitions(std::shared_ptr<Program> program);
+    
+    // Hot reload: each hot package lives in its own shared object, and every call
+    // into it goes through a function table owned by the host executable
+    struct HotModule {
+        std::shared_ptr<Program> program;
+        std::string library; // path of the module's shared object
+    };
+    void setHotPackages(const std::unordered_set<std::string>& packages);
+    std::string generateHotModule(std::shared_ptr<Program> program,
+                                  const std::vector<std::shared_ptr<Program>>& dependencies);
+    std::string generateHotHost(std::shared_ptr<Program> program,
+                                const std::vector<std::shared_ptr<Program>>& dependencies,
+                                const std::vector<HotModule>& hotModules);
+    static std::string packageName(std::shared_ptr<Program> program);
+    static std::string moduleTableName(const std::string& package);
+    
+    // Source mapping: statements are preceded by #line directives naming their
+    // .thor file (Program::sourcePath) and line, so debuggers and profilers
+    // attribute the code to Thor source. Code that belongs to no statement maps
+    // back to the generated file itself, `generatedPath`, whose text starts at
+    // `firstLine` (after any lines a caller prepends). An empty path turns the
+    // directives off.
+    void setLineDirectives(const std::string& generatedPath, int firstLine = 1);
+    
+    // Instrumentation: every function with a body counts its calls and times
+    // itself through thor_prof_enter()/thor_prof_exit(), and the program reports
+    // the totals at exit. The runtime support is compiled in by THOR_INSTRUMENT,
+    // which generate() defines itself; separately compiled modules need
+    // -DTHOR_INSTRUMENT on the command line.
+    void setInstrumentation(bool enabled);
+    
+    // Allocation tracking: runtime helpers that allocate are called through
+    // their _at variants with the Thor function, file and line of the call, and
+    // the program reports peak live bytes and the sites that allocated most at
+    // exit. THOR_TRACK_ALLOCATIONS works like THOR_INSTRUMENT.
+    void setAllocationTracking(bool enabled);
+    
+    // Benchmarks: generate() compiles the bench blocks of the program it is
+    // given, and a harness that times them (see `thor bench`) replaces the
+    // program's main(). Otherwise bench blocks are left out of every build.
+    void setBenchmarks(bool enabled);
 };
\ No newline at end of file
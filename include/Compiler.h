@@ -0,0 +1,103 @@
+#pragma once
+#include "AST.h"
+#include "CompilerLocator.h"
+#include "SourceProviders.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// A problem found while compiling, located in a Thor source file (or in the
+// generated C, for C compiler messages)
+struct Diagnostic {
+    enum Severity { ERROR, WARNING, NOTE, REMARK } severity = ERROR; // REMARK: an optimizer decision
+    std::string file;
+    int line = 0; // 1-based; 0 when the problem has no position
+    int column = 0;
+    std::string message;
+
+    std::string toString() const; // "file:line:column: error: message", as C compilers print them
+};
+
+// The compiler as a library (libthor): compiles Thor source text to C, and
+// optionally on to an executable, without printing anything. Source files and
+// imported modules come from pluggable providers, so a host can compile
+// entirely from memory. Parsed modules stay cached across compilations for as
+// long as their text is unchanged, which makes compiling many small programs
+// that share imports cheap. A Compiler is not meant to be shared between
+// threads; use one per thread.
+class Compiler {
+public:
+    struct Result {
+        bool success = false;
+        std::string code; // the generated C, once code generation succeeded
+        std::vector<Diagnostic> diagnostics;
+    };
+
+private:
+    struct CachedModule {
+        std::string source;
+        std::shared_ptr<Program> program;
+    };
+
+    std::shared_ptr<FileProvider> files;
+    std::shared_ptr<ModuleProvider> modules; // null: a SearchPathModuleProvider over searchPaths
+    std::vector<std::string> searchPaths;    // empty: the directory of the file being compiled
+    std::unordered_map<std::string, CachedModule> moduleCache; // module path -> last parse
+    std::vector<std::string> cFlags;
+    bool debugInfo = false;
+    bool instrument = false;
+    bool trackAllocations = false;
+    bool benchmarks = false;
+    bool remarks = false;
+    CCompiler cCompiler;
+    bool cCompilerLocated = false;
+
+    std::shared_ptr<Program> parse(const std::string& source, const std::string& path,
+                                   std::vector<Diagnostic>& diagnostics);
+    std::shared_ptr<Program> loadModule(const ModuleProvider& provider, const ImportDeclaration& import,
+                                        const std::string& importer, std::string& path,
+                                        std::vector<Diagnostic>& diagnostics);
+    Result compile(const std::string& source, const std::string& path, const std::string& generatedPath);
+
+public:
+    // Files from disk; modules from the directory of the file being compiled,
+    // then the importer's directory
+    Compiler();
+    // Modules are looked up through `files` in `searchPaths`, or by default in
+    // the directory of the file being compiled, then in the importer's directory
+    explicit Compiler(std::shared_ptr<FileProvider> files, std::vector<std::string> searchPaths = {});
+
+    void setModuleProvider(std::shared_ptr<ModuleProvider> provider) { modules = std::move(provider); }
+    void setCFlags(const std::vector<std::string>& flags) { cFlags = flags; }
+    void setCCompiler(const CCompiler& compiler);
+    // Debug builds map the generated C back to Thor lines with #line directives,
+    // pass -g to the C compiler, and keep the C file beside the executable
+    void setDebugInfo(bool enabled) { debugInfo = enabled; }
+    // Instrumented programs count calls and time every function, and report at exit
+    void setInstrumentation(bool enabled) { instrument = enabled; }
+    // Tracked programs report peak live bytes and their top allocating sites at exit
+    void setAllocationTracking(bool enabled) { trackAllocations = enabled; }
+    // Benchmark builds compile the program's bench blocks into a timing harness (thor bench)
+    void setBenchmarks(bool enabled) { benchmarks = enabled; }
+    // Remarks builds ask the C compiler to report what it vectorized and inlined
+    // and what it could not; buildExecutable() returns those located in Thor
+    // source (through #line directives) as REMARK diagnostics. They depend on
+    // the optimization level in the C flags.
+    void setRemarks(bool enabled) { remarks = enabled; }
+
+    // `path` names the source in diagnostics; imports are also looked up next to
+    // it. `generatedPath` is where the C will be written (default: `path` with a
+    // .c extension); only debug builds refer to it.
+    Result compileToC(const std::string& source, const std::string& path = "<input>",
+                      const std::string& generatedPath = "");
+    Result compileFileToC(const std::string& path, const std::string& generatedPath = ""); // reads the file through the file provider
+
+    // Also runs the C compiler (see CompilerLocator); its messages become diagnostics
+    Result compileToExecutable(const std::string& source, const std::string& executable,
+                               const std::string& path = "<input>");
+    Result compileFileToExecutable(const std::string& path, const std::string& executable);
+    // Compiles generated C to an executable; diagnostics are appended to `result`.
+    // Debug builds write the C to `generatedPath` and keep it.
+    bool buildExecutable(Result& result, const std::string& executable, const std::string& generatedPath = "");
+};
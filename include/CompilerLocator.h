@@ -0,0 +1,48 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Everything we know about a C compiler found on this machine
+struct CCompiler {
+    std::string name;     // e.g. "gcc"
+    std::string path;     // absolute path to the binary
+    long long mtime = 0;  // binary modification time when probed
+    std::string version;  // first line of `--version`
+    bool supportsOpenMP = false;
+    bool supportsLTO = false;
+    std::vector<std::string> supportedFlags;
+    std::vector<std::string> probedFlags; // those tried, so a cache from an older thor is re-probed
+
+    bool empty() const { return path.empty(); }
+    bool supportsFlag(const std::string& flag) const;
+    std::string command() const; // quoted path, ready for a shell command line
+    // Keep frame pointers, which the sampling profiler in generated programs unwinds through
+    std::vector<std::string> frameFlags() const;
+    // Report vectorization and inlining decisions on stderr (gcc -fopt-info,
+    // clang -Rpass); empty for compilers without optimization remarks
+    std::vector<std::string> remarkFlags() const;
+};
+
+// Finds a C compiler without spawning processes. The compiler binary is
+// located by walking PATH; its version and capabilities are probed once and
+// persisted to a cache file, and only re-probed when the binary's mtime changes.
+class CompilerLocator {
+private:
+    std::string cacheFile;
+    std::vector<CCompiler> cached;
+
+    void loadCache();
+    void saveCache() const;
+    void probe(CCompiler& compiler) const;
+    bool tryFlag(const CCompiler& compiler, const std::string& flag) const;
+
+public:
+    CompilerLocator();
+    explicit CompilerLocator(const std::string& cacheFile);
+
+    static std::string findInPath(const std::string& program);
+    static std::string defaultCacheFile();
+
+    CCompiler locate();
+    CCompiler describe(const std::string& name, const std::string& path);
+};
@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Blocks until any of a set of files changes. On Linux this uses inotify on
+// the files' directories (so editors that save by renaming a temporary file
+// are still seen); elsewhere it falls back to polling modification times.
+class FileWatcher {
+private:
+    std::unordered_set<std::string> files;
+    std::unordered_map<std::string, long long> mtimes;
+#ifdef __linux__
+    int inotifyFd = -1;
+    std::unordered_map<int, std::string> directories; // watch descriptor -> directory
+#endif
+
+    static long long modificationTime(const std::string& path);
+    std::vector<std::string> pollChanges();
+
+public:
+    FileWatcher();
+    ~FileWatcher();
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Replaces the watched set; paths should be canonical
+    void watch(const std::vector<std::string>& paths);
+
+    // Waits for at least one change, then collects any further changes that
+    // arrive within the debounce window so one save triggers one rebuild
+    std::vector<std::string> waitForChanges(int debounceMs = 30);
+};
@@ -3,18 +3,28 @@
 #include <string>
 #include <unordered_map>
 #include <vector>
+#include <unordered_set>
 
 class ImportProcessor {
 private:
     std::unordered_map<std::string, std::shared_ptr<Program>> moduleCache;
     std::vector<std::string> searchPaths;
     
-    std::string resolveModulePath(const std::string& module) const;
     std::shared_ptr<Program> loadModule(const std::string& module);
+    void collectDependencies(std::shared_ptr<Program> program, std::vector<std::string>& ordered,
+                             std::unordered_set<std::string>& visited) const;
     
 public:
     ImportProcessor();
+    explicit ImportProcessor(const std::vector<std::string>& searchPaths);
     void addSearchPath(const std::string& path);
+    std::string resolveModulePath(const std::string& module) const;
+    void addModule(const std::string& module, std::shared_ptr<Program> program);
+    
+    static std::shared_ptr<Program> createBuiltinModule(const std::string& module);
+    static std::shared_ptr<Program> parseModuleFile(const std::string& filePath);
     std::shared_ptr<Program> processImports(std::shared_ptr<Program> program);
     std::unordered_map<std::string, std::shared_ptr<Program>> getLoadedModules() const;
+    std::shared_ptr<Program> getModule(const std::string& module) const;
+    std::vector<std::string> getDependencies(std::shared_ptr<Program> program) const;
 };
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+#include "AST.h"
+#include <string>
+#include <vector>
+
+// Keeps the AST of one source file in sync with edits to its text.
+// Every top-level statement (function, const, ...) is a segment that starts at
+// its first token and runs up to the next segment. An edit re-lexes and
+// re-parses only the segments it touches; all other statement nodes are reused
+// as-is, so the cost of an edit follows its size rather than the file's.
+// Edits that touch the package/import header, or whose effect leaks past the
+// touched segments (an unterminated string, a new comment swallowing the next
+// declaration, ...), fall back to parsing the whole file.
+class IncrementalParser {
+public:
+    struct Segment {
+        size_t offset; // byte offset of the statement's first token
+        int line;
+        int column;
+        std::shared_ptr<Statement> statement; // null for a segment that failed to parse
+        std::string error;
+        bool anchor; // starts with `func`, `const` or `bench` at the beginning of a line
+    };
+
+private:
+    std::string source;
+    std::shared_ptr<Program> program;
+    std::vector<Segment> segments;
+    bool valid = false; // false after a failed parse: the next edit reparses everything
+    bool recoverErrors = false;
+    size_t reparsedBytes = 0;
+
+    std::shared_ptr<Program> reparse();
+    bool reparseSegments(size_t first, size_t last, size_t removed, size_t inserted);
+    // failedAtEnd, if given, is set when a statement fails at the end of the tokens
+    bool parseSegments(class Parser& parser, bool region, std::vector<Segment>& out, bool* failedAtEnd);
+    bool firmBoundary(size_t next) const; // no recovery guesswork on either side of segments[next]
+    void rebuildProgram();
+    void throwFirstError() const;
+
+public:
+    IncrementalParser() = default;
+    // Parses the whole text; throws std::runtime_error on syntax errors
+    explicit IncrementalParser(const std::string& text);
+
+    // With error recovery (meant for editors), a declaration that does not parse
+    // becomes an error segment reaching up to the next `func` or `const` that
+    // starts a line, and later edits elsewhere stay incremental. An edit that
+    // leaves its own segments broken reparses the whole file, so errors read as
+    // in a full parse. Edits still throw while an error segment remains, but
+    // getProgram() holds every declaration that parsed.
+    // A full parse may attach the rest of the file to a broken declaration
+    // instead, so builds leave recovery off.
+    void setRecoverErrors(bool recover) { recoverErrors = recover; }
+
+    // Replaces `length` bytes at `offset` with `text` and returns the updated AST.
+    // Throws std::runtime_error if the new text does not parse; the edit is still
+    // applied and the previous AST stays available through getProgram().
+    std::shared_ptr<Program> applyEdit(size_t offset, size_t length, const std::string& text);
+
+    // Replaces the whole text, treating the differing middle part as a single edit
+    std::shared_ptr<Program> update(const std::string& text);
+
+    std::shared_ptr<Program> getProgram() const { return program; }
+    const std::string& getSource() const { return source; }
+    const std::vector<Segment>& getSegments() const { return segments; }
+    bool isValid() const { return valid; } // segments describe the current text
+    size_t lastReparsedBytes() const { return reparsedBytes; }
+};
@@ -0,0 +1,61 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Minimal JSON value used by the language server protocol.
+// Objects keep their keys in insertion order; lookups are linear, which is
+// fine for the small messages LSP exchanges.
+class Json {
+public:
+    enum Kind { NULL_VALUE, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+
+private:
+    Kind kind = NULL_VALUE;
+    bool boolean = false;
+    double number = 0;
+    std::string text;
+    std::vector<std::string> keys;
+    std::vector<Json> items; // array elements, or object values parallel to keys
+
+    static Json parseValue(const std::string& source, size_t& pos);
+    static std::string parseString(const std::string& source, size_t& pos);
+    void dumpTo(std::string& out) const;
+
+public:
+    Json() = default;
+    Json(bool value);
+    Json(int value);
+    Json(long long value);
+    Json(size_t value);
+    Json(double value);
+    Json(const char* value);
+    Json(const std::string& value);
+
+    static Json array();
+    static Json object();
+    static Json parse(const std::string& source); // throws std::runtime_error
+
+    Kind getKind() const { return kind; }
+    bool isNull() const { return kind == NULL_VALUE; }
+    bool isString() const { return kind == STRING; }
+    bool isNumber() const { return kind == NUMBER; }
+    bool isObject() const { return kind == OBJECT; }
+    bool isArray() const { return kind == ARRAY; }
+
+    bool asBool() const { return boolean; }
+    double asNumber() const { return number; }
+    long long asInt() const { return static_cast<long long>(number); }
+    const std::string& asString() const { return text; }
+
+    // Object access; a missing key reads as null
+    bool has(const std::string& key) const;
+    const Json& operator[](const std::string& key) const;
+    Json& set(const std::string& key, const Json& value);
+
+    // Array access
+    size_t size() const { return items.size(); }
+    const Json& operator[](size_t index) const { return items[index]; }
+    Json& push(const Json& value);
+
+    std::string dump() const;
+};
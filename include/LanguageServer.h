@@ -0,0 +1,119 @@
+#pragma once
+#include "IncrementalParser.h"
+#include "Json.h"
+#include "Token.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// `thor lsp`: a Language Server Protocol server on stdin/stdout.
+//
+// The calling thread only reads and frames messages. One analysis thread owns
+// the project model: every open file and every module they import, each kept
+// parsed by an IncrementalParser, plus per-file symbol tables and a reverse
+// import index. Edits are applied as they arrive, so queries always see the
+// latest text; diagnostics are debounced and recomputed on the same thread,
+// and abandoned as soon as newer messages are waiting.
+class LanguageServer {
+private:
+    struct Symbol {
+        std::string name;
+        std::string detail; // signature shown by completion
+        int kind;           // LSP CompletionItemKind
+        std::shared_ptr<Statement> statement;
+    };
+
+    // A `qualifier.member` token sequence inside one top-level statement
+    struct Reference {
+        std::string qualifier;
+        std::string member;
+        size_t offset; // of the member, relative to the statement's first token
+    };
+
+    struct Document {
+        std::string uri;
+        std::string path; // canonical
+        bool open = false;
+        IncrementalParser parser;
+        std::vector<size_t> lineStarts;
+        std::string parseError; // set while the text has syntax errors
+        int parseErrorLine = 0; // 0-based; only reported when the header does not parse
+        std::unordered_map<std::string, Symbol> symbols;        // top-level declarations by name
+        std::vector<std::shared_ptr<Statement>> indexed; // segment statements as of the last reindex
+        std::unordered_map<std::shared_ptr<Statement>, std::vector<Reference>> references;
+        std::vector<std::string> imports;
+        std::unordered_map<std::string, std::string> resolvedImports; // import -> path ("" if missing)
+        std::unordered_map<std::string, std::string> qualifiers;      // call qualifier -> path or builtin
+
+        // Broken declarations become error segments instead of hiding the whole file
+        Document() { parser.setRecoverErrors(true); }
+    };
+
+    std::unordered_map<std::string, Document> documents; // canonical path -> document
+    std::unordered_map<std::string, std::unordered_set<std::string>> importers; // path -> paths importing it
+    std::unordered_map<std::string, std::unordered_map<std::string, Symbol>> builtinModules; // qualifier -> symbols
+    std::string rootPath;
+    bool shutdownRequested = false;
+
+    // Messages from the reader thread
+    std::mutex queueMutex;
+    std::condition_variable queueReady;
+    std::deque<Json> queue;
+    std::unordered_set<std::string> cancelledRequests;
+    bool inputClosed = false;
+
+    // Debounced diagnostics
+    std::unordered_set<std::string> staleDiagnostics; // paths
+    std::chrono::steady_clock::time_point diagnosticsDue;
+
+    std::mutex outputMutex;
+
+    // Protocol
+    bool readMessage(std::string& body);
+    void send(const Json& message);
+    void respond(const Json& id, const Json& result);
+    void respondError(const Json& id, int code, const std::string& message);
+    void analysisLoop();
+    bool handle(const Json& message); // false once the server should exit
+
+    // Project model
+    Document* findDocument(const std::string& uri);
+    Document& loadDocument(const std::string& path);
+    void setText(Document& document, const std::string& text);
+    void applyChange(Document& document, const Json& change);
+    void reindex(Document& document);
+    void indexStatement(Document& document, size_t segment);
+    void unindexStatement(Document& document, const std::shared_ptr<Statement>& statement);
+    void resolveImports(Document& document);
+    std::vector<Reference> scanReferences(const Document& document, size_t segment) const;
+    void invalidate(const std::string& path);
+
+    // Positions
+    static void computeLineStarts(Document& document);
+    static size_t offsetAt(const Document& document, const Json& position);
+    static Json positionAt(const Document& document, size_t offset);
+    static Json rangeAt(const Document& document, size_t offset, size_t length);
+    static TokenStream lex(const Document& document, size_t begin, size_t end);
+    static size_t segmentStart(const Document& document, size_t offset, size_t* next = nullptr);
+
+    // Queries
+    const std::unordered_map<std::string, Symbol>* moduleSymbols(const Document& document,
+                                                                 const std::string& qualifier,
+                                                                 const Document** module);
+    Json symbolLocation(const Document& document, const Symbol& symbol);
+    Json definition(const Json& params);
+    Json completion(const Json& params);
+    Json diagnostics(const Document& document);
+    void publishDiagnostics();
+
+    static std::string uriToPath(const std::string& uri);
+    static std::string pathToUri(const std::string& path);
+
+public:
+    int run();
+};
@@ -5,26 +5,32 @@
 
 class Lexer {
 private:
-    std::string source;
+    TokenStream stream; // holds the source text while lexing
     size_t current;
-    int line;
-    int column;
     
+    Token scanToken();
     char peek(int offset = 0) const;
     char advance();
+    bool match(char expected); // consumes the next character if it is `expected`
+    void skipBlanks(); // whitespace and comments
     void skipWhitespace();
     void skipComment();
+    void recordLineBreaks(size_t at, uint64_t newlines); // newlines: bitmask of '\n' at source[at + i]
+    Token makeToken(TokenType type, size_t start) const;
     Token makeString();
     Token makeNumber();
     Token makeIdentifier();
     bool isAlpha(char c) const;
     bool isDigit(char c) const;
     bool isAlphaNumeric(char c) const;
-    TokenType getKeywordType(const std::string& text) const;
+    TokenType getKeywordType(std::string_view text) const;
     
 public:
     Lexer(const std::string& source);
-    std::vector<Token> tokenize();
+    // Lexes a slice of a larger file that starts at the given offset and position
+    Lexer(const std::string& source, size_t baseOffset, int line, int column);
+    // Lexes the whole source; the lexer is spent afterwards
+    TokenStream tokenize();
     Token nextToken();
     bool isAtEnd() const;
-};
\ No newline at end of file
+};
@@ -6,43 +6,58 @@
 
 class Parser {
 private:
-    std::vector<Token> tokens;
+    TokenStream tokens;
     size_t current;
+    size_t lineCursor = 0; // for TokenStream::position
     
-    Token& peek(int offset = 0);
-    Token& advance();
-    bool check(TokenType type);
+    const Token& peek(int offset = 0) const;
+    const Token& advance();
+    bool check(TokenType type) const;
     bool match(std::initializer_list<TokenType> types);
     bool isAtEnd() const;
     void consume(TokenType type, const std::string& message);
+    std::string value(const Token& token) const { return tokens.value(token); }
+    
+    // Expressions and statements are parsed with explicit stacks of the
+    // constructs still waiting for an operand or a nested statement, not by
+    // recursion, so nesting depth is limited by memory rather than the native stack
+    struct ExpressionFrame {
+        enum Kind { PREFIX, BINARY, GROUP, CALL, ARRAY, FORMAT } kind;
+        Token op;                         // PREFIX, BINARY
+        int precedence;                   // BINARY
+        std::shared_ptr<Expression> node; // BINARY: left operand; CALL, ARRAY, FORMAT: collects the arguments
+    };
+    struct StatementFrame {
+        enum Kind { BLOCK, IF, WHILE, FUNCTION, BENCH } kind;
+        std::shared_ptr<Statement> node; // nested statements are attached as they complete
+    };
+    std::vector<ExpressionFrame> expressionFrames;
+    std::vector<StatementFrame> statementFrames;
     
     // Parsing methods
     std::shared_ptr<Type> parseType();
     std::shared_ptr<Expression> parseExpression();
-    std::shared_ptr<Expression> parseAssignment();
-    std::shared_ptr<Expression> parseLogicalOr();
-    std::shared_ptr<Expression> parseLogicalAnd();
-    std::shared_ptr<Expression> parseEquality();
-    std::shared_ptr<Expression> parseComparison();
-    std::shared_ptr<Expression> parseTerm();
-    std::shared_ptr<Expression> parseFactor();
-    std::shared_ptr<Expression> parseUnary();
-    std::shared_ptr<Expression> parseCall();
-    std::shared_ptr<Expression> parsePrimary();
+    std::shared_ptr<Expression> parsePrimary(); // literals and identifiers
     
     std::shared_ptr<Statement> parseStatement();
+    std::shared_ptr<Statement> parseSimpleStatement(); // one that nests no statements
     std::shared_ptr<Statement> parseExpressionStatement();
     std::shared_ptr<VariableDeclaration> parseVariableDeclaration();
     std::shared_ptr<ConstDeclaration> parseConstDeclaration();
-    std::shared_ptr<BlockStatement> parseBlock();
-    std::shared_ptr<IfStatement> parseIfStatement();
-    std::shared_ptr<WhileStatement> parseWhileStatement();
     std::shared_ptr<ReturnStatement> parseReturnStatement();
-    std::shared_ptr<FunctionDeclaration> parseFunctionDeclaration();
+    std::shared_ptr<FunctionDeclaration> parseFunctionHeader(); // without the body
     std::shared_ptr<PackageDeclaration> parsePackageDeclaration();
     std::shared_ptr<ImportDeclaration> parseImportDeclaration();
     
 public:
-    Parser(std::vector<Token> tokens);
+    Parser(TokenStream tokens);
     std::shared_ptr<Program> parse();
+    
+    // Piecewise parsing, one top-level statement at a time (used by IncrementalParser)
+    void parseHeader(Program& program);
+    const Token& nextTopLevelToken() const { return peek(); } // first token of the next statement, EOF at the end
+    std::shared_ptr<Statement> parseTopLevelStatement(); // nullptr at the end
+    size_t position() const { return current; }
+    void seek(size_t position) { current = position; }
+    const TokenStream& getTokens() const { return tokens; }
 };
\ No newline at end of file
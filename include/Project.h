@@ -0,0 +1,55 @@
+#pragma once
+#include <map>
+#include <string>
+#include <vector>
+
+struct BuildProfile {
+    std::string name;
+    std::vector<std::string> cflags;
+    std::vector<std::string> ldflags;
+};
+
+struct BuildTarget {
+    std::string name;
+    std::string entry;                 // path to the entry .thor file
+    std::vector<std::string> cflags;   // applied to the entry translation unit only
+    std::vector<std::string> ldflags;
+    std::vector<std::string> libs;     // linked as -l<lib>
+    std::vector<std::string> libPaths; // searched as -L<path>
+};
+
+// A Thor project: what to build and how. Loaded from a `thor.project`
+// manifest, or assembled on the fly from files given on the command line.
+//
+//     [project]
+//     name = tools
+//     roots = lib, vendor        # module search roots
+//     cflags = -Wall
+//     output = thor-out
+//
+//     [profile.release]
+//     cflags = -O2
+//
+//     [target.grep]
+//     entry = tools/grep.thor
+//     libs = m
+//
+// Relative paths are resolved against the manifest's directory.
+struct Project {
+    static const char* MANIFEST_NAME;
+
+    std::string name;
+    std::string root = ".";
+    std::string outputDir = "thor-out";
+    std::vector<std::string> moduleRoots;
+    std::vector<std::string> cflags;
+    std::vector<std::string> ldflags;
+    std::map<std::string, BuildProfile> profiles;
+    std::vector<BuildTarget> targets;
+
+    static Project load(const std::string& manifestPath);
+    static Project fromInputs(const std::vector<std::string>& inputs);
+
+    const BuildProfile* findProfile(const std::string& profile) const;
+    const BuildTarget* findTarget(const std::string& target) const;
+};
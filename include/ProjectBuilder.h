@@ -0,0 +1,88 @@
+#pragma once
+#include "AST.h"
+#include "CompilerLocator.h"
+#include "ImportProcessor.h"
+#include "IncrementalParser.h"
+#include "Project.h"
+#include "TaskScheduler.h"
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+struct BuildOptions {
+    std::string profile;              // empty = no profile flags
+    std::vector<std::string> targets; // empty = every target in the project
+    unsigned jobs = 0;                // 0 = one per hardware thread
+    bool hotReload = false;           // packaged modules become reloadable shared objects
+    bool instrument = false;          // functions count calls and time themselves (see CodeGenerator)
+    bool trackAllocations = false;    // runtime allocations are charged to their call sites
+};
+
+// Builds the targets of a Project in two scheduled phases:
+//  1. parse: entry points and every module they transitively import are
+//     parsed in parallel, each module exactly once;
+//  2. codegen -> C compile -> link: a task DAG in which the runtime and every
+//     module are compiled once into shared objects that each target links.
+// Both phases run on a TaskScheduler, which orders ready work by critical path.
+class ProjectBuilder {
+private:
+    struct Entry {
+        const BuildTarget* target;
+        std::shared_ptr<Program> program;
+        std::vector<std::string> dependencies;
+        size_t sourceSize = 0;
+    };
+
+    Project project;
+    BuildOptions options;
+    ImportProcessor importProcessor;
+    CCompiler compiler;
+    std::vector<Entry> entries;
+    std::unordered_set<std::string> requestedModules;
+    std::unordered_map<std::string, size_t> moduleSizes;
+    std::unordered_map<std::string, std::string> modulePaths; // module -> canonical source path
+    std::mutex modulesMutex; // guards importProcessor and module bookkeeping while parsing
+    std::mutex outputMutex;
+    
+    // Incremental rebuilds only regenerate C for the units listed here
+    bool incremental = false;
+    bool parseFailed = false; // the next rebuild must start from a full parse
+    std::unordered_set<std::string> dirtyUnits;
+    std::unordered_map<std::string, IncrementalParser> documents; // canonical path -> last parsed text
+
+    std::shared_ptr<Program> parseFile(const std::string& path, size_t& size);
+
+    std::string buildDir() const;
+    std::string objectDir() const;
+    std::string objectName(const std::string& module) const;
+    std::vector<std::string> commonFlags() const;
+    std::vector<std::shared_ptr<Program>> directDependencies(std::shared_ptr<Program> program);
+
+    bool prepare();
+    bool parseAll();
+    bool parseEntry(TaskScheduler& scheduler, Entry& entry);
+    void requestImports(TaskScheduler& scheduler, std::shared_ptr<Program> program);
+    bool parseModule(TaskScheduler& scheduler, const std::string& module);
+    bool compileAndLink();
+
+    bool writeIfChanged(const std::string& path, const std::string& content) const;
+    bool isStale(const std::string& target, const std::vector<std::string>& inputs) const;
+    bool runCommand(const std::string& command);
+    void log(const std::string& message);
+
+public:
+    ProjectBuilder(const Project& project, const BuildOptions& options);
+    bool build();
+    
+    // Re-parses only the changed files, then regenerates and recompiles the
+    // changed modules and their direct importers. ASTs of every other module
+    // are kept from the previous build.
+    bool rebuild(const std::vector<std::string>& changedFiles);
+    
+    std::vector<std::string> sourceFiles();
+    std::vector<std::string> executables() const;
+    
+    static std::string canonicalPath(const std::string& path);
+};
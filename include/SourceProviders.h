@@ -0,0 +1,66 @@
+#pragma once
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Where the compiler reads source files from. Paths are used as given; a
+// provider decides what they mean.
+class FileProvider {
+public:
+    virtual ~FileProvider() = default;
+    virtual bool read(const std::string& path, std::string& contents) const = 0; // false if there is no such file
+    virtual bool isFile(const std::string& path) const = 0;
+    virtual std::vector<std::string> list(const std::string& directory) const = 0; // paths of the files directly inside
+};
+
+class DiskFileProvider : public FileProvider {
+public:
+    bool read(const std::string& path, std::string& contents) const override;
+    bool isFile(const std::string& path) const override;
+    std::vector<std::string> list(const std::string& directory) const override;
+};
+
+// Files held in memory, e.g. by a build tool or test harness. Paths are
+// compared after lexical normalization, so "./a/b.thor" and "a/b.thor" name the
+// same file, and directories exist implicitly while they contain files.
+class MemoryFileProvider : public FileProvider {
+private:
+    std::map<std::string, std::string> files; // normalized path -> contents
+
+    static std::string normalize(const std::string& path);
+
+public:
+    void add(const std::string& path, const std::string& contents);
+    void remove(const std::string& path);
+
+    bool read(const std::string& path, std::string& contents) const override;
+    bool isFile(const std::string& path) const override;
+    std::vector<std::string> list(const std::string& directory) const override;
+};
+
+// Finds the source of an imported module
+class ModuleProvider {
+public:
+    virtual ~ModuleProvider() = default;
+    // Looks up `module` as imported by the file `importer` ("" for none); on
+    // success sets the module's path (used for diagnostics and caching) and text
+    virtual bool load(const std::string& module, const std::string& importer,
+                      std::string& path, std::string& source) const = 0;
+};
+
+// The usual lookup: in each search path and then the importer's directory, try
+// `module.thor`, then `module/module.thor`, then any .thor file in `module/`
+class SearchPathModuleProvider : public ModuleProvider {
+private:
+    std::shared_ptr<FileProvider> files;
+    std::vector<std::string> searchPaths;
+
+public:
+    SearchPathModuleProvider(std::shared_ptr<FileProvider> files, const std::vector<std::string>& searchPaths);
+
+    void addSearchPath(const std::string& path) { searchPaths.push_back(path); }
+    bool resolve(const std::string& module, const std::string& importer, std::string& path) const;
+    bool load(const std::string& module, const std::string& importer,
+              std::string& path, std::string& source) const override;
+};
@@ -0,0 +1,76 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Runs a DAG of tasks on a pool of worker threads.
+//
+// Each task has an estimated cost; before running, every task is ranked by
+// the longest cost-weighted path from it to a sink (its critical path), and
+// ready tasks are always taken highest rank first. Workers keep their own
+// ready queues and steal from each other when they run dry. A failing task
+// causes all of its transitive dependents to be skipped.
+class TaskScheduler {
+public:
+    using TaskId = size_t;
+
+private:
+    struct Task {
+        std::string name;
+        double cost;
+        std::function<bool()> work;
+        std::vector<TaskId> successors;
+        size_t predecessors = 0;
+        std::atomic<size_t> remaining{0};
+        std::atomic<bool> poisoned{false}; // a predecessor failed
+        double rank = 0;
+        bool failed = false;
+    };
+
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::vector<std::pair<double, TaskId>> heap; // max-heap on rank
+    };
+
+    unsigned threadCount;
+    std::vector<std::unique_ptr<Task>> tasks;
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::mutex tasksMutex; // guards `tasks` growth while running
+    std::mutex idleMutex;
+    std::condition_variable idle;
+    std::atomic<size_t> unfinished{0};
+    std::atomic<size_t> ready{0};
+    std::atomic<bool> anyFailed{false};
+    std::atomic<unsigned> nextQueue{0};
+    bool running = false;
+
+    Task& task(TaskId id);
+    void computeRanks();
+    void push(unsigned worker, TaskId id);
+    bool pop(unsigned worker, TaskId& id);
+    bool steal(unsigned thief, TaskId& id);
+    void execute(unsigned worker, TaskId id);
+    void finish(unsigned worker, TaskId id, bool succeeded);
+    void workerLoop(unsigned worker);
+
+public:
+    explicit TaskScheduler(unsigned threads = 0);
+
+    TaskId addTask(const std::string& name, double cost, std::function<bool()> work);
+    void addDependency(TaskId before, TaskId after);
+
+    // Adds a dependency-free task while run() is in progress
+    TaskId spawn(const std::string& name, double cost, std::function<bool()> work);
+
+    // Runs every task; returns false if any task failed
+    bool run();
+
+    const std::string& taskName(TaskId id);
+    size_t size();
+};
@@ -1,8 +1,11 @@
 #pragma once
+#include <cstdint>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 
-enum class TokenType {
+enum class TokenType : uint8_t {
     // Literals
     INTEGER,
     FLOAT,
@@ -14,6 +17,7 @@ enum class TokenType {
     PACKAGE,
     IMPORT,
     FUNC,
+    BENCH,
     RETURN,
     IF,
     ELSE,
@@ -22,6 +26,7 @@ enum class TokenType {
     INT,
     FLOAT_TYPE,
     STRING_TYPE,
+    STR_TYPE,
     BOOLEAN_TYPE,
     VOID_TYPE,
     TRUE_VALUE,
@@ -37,11 +42,27 @@ enum class TokenType {
     NOT_EQUAL,
     LESS_THAN,
     GREATER_THAN,
+    LESS_EQUAL,
+    GREATER_EQUAL,
     AND,
     OR,
     NOT,
-    MODULO,
     AMPERSAND,
+    PIPE,
+    CARET,
+    TILDE,
+    SHIFT_LEFT,
+    SHIFT_RIGHT,
+    PLUS_ASSIGN,
+    MINUS_ASSIGN,
+    MULTIPLY_ASSIGN,
+    DIVIDE_ASSIGN,
+    PERCENT_ASSIGN,
+    AMPERSAND_ASSIGN,
+    PIPE_ASSIGN,
+    CARET_ASSIGN,
+    SHIFT_LEFT_ASSIGN,
+    SHIFT_RIGHT_ASSIGN,
     
     // Delimiters
     LEFT_PAREN,
@@ -55,20 +76,73 @@ enum class TokenType {
     DOT,
     COLON,
     ARROW,
-    PERCENT,
+    PERCENT, // modulo, or a format string's argument list
     
     // Special
-    NEWLINE,
     EOF_TOKEN,
-    UNKNOWN
+    UNKNOWN,
+    
+    COUNT // number of token types, for tables indexed by TokenType
 };
 
+// A token is only its kind and where it sits in the source (12 bytes); its text is
+// read back from the TokenStream, and its line/column are only computed for diagnostics
 struct Token {
     TokenType type;
-    std::string value;
+    uint32_t offset; // byte offset of the token's first character within the file
+    uint32_t length; // in bytes, including the quotes of a string literal
+};
+
+// The Lexer's output: the tokens of one source text, ending with EOF_TOKEN, plus
+// the text itself and the start offsets of its lines
+class TokenStream {
+private:
+    std::string source;
+    size_t baseOffset = 0; // file offset of source[0]
+    int firstLine = 1;
+    int firstColumn = 1;
+    std::vector<Token> tokens;
+    std::vector<uint32_t> lineStarts; // file offsets just past each '\n' in source
+
+    friend class Lexer;
+
+public:
+    const Token& operator[](size_t index) const { return tokens[index]; }
+    size_t size() const { return tokens.size(); }
+    bool empty() const { return tokens.empty(); }
+    const Token& back() const { return tokens.back(); }
+    std::vector<Token>::const_iterator begin() const { return tokens.begin(); }
+    std::vector<Token>::const_iterator end() const { return tokens.end(); }
+
+    // Drops every token from `index` on and ends the stream with EOF at `offset`
+    void truncate(size_t index, uint32_t offset);
+
+    std::string_view text(const Token& token) const {
+        return std::string_view(source).substr(token.offset - baseOffset, token.length);
+    }
+    // The text, except that string literals lose their quotes and have escapes resolved
+    std::string value(const Token& token) const;
+
+    // 1-based position of a file offset inside this stream's text
+    int line(size_t offset) const;
+    int column(size_t offset) const;
+    int line(const Token& token) const { return line(token.offset); }
+    int column(const Token& token) const { return column(token.offset); }
+    // Both at once for offsets visited mostly in increasing order, as a parser
+    // does: `cursor` (initially 0) remembers where the last lookup ended, so a
+    // lookup costs the number of lines moved rather than a binary search
+    void position(size_t offset, size_t& cursor, int& line, int& column) const;
+};
+
+// Thrown by the Lexer and Parser. what() reads "<message> at line N<context>";
+// the position and the bare message are kept apart for structured diagnostics.
+class SyntaxError : public std::runtime_error {
+public:
+    std::string message; // without the position
     int line;
     int column;
-    
-    Token(TokenType t, const std::string& v, int l, int c)
-        : type(t), value(v), line(l), column(c) {}
-};
\ No newline at end of file
+
+    SyntaxError(const std::string& message, int line, int column, const std::string& context = "")
+        : std::runtime_error(message + " at line " + std::to_string(line) + context),
+          message(message + context), line(line), column(column) {}
+};
@@ -1,2 +1,101 @@
 #include "AST.h"
-// AST implementation is mostly header-only with the class definitions
\ No newline at end of file
+#include <map>
+#include <mutex>
+// AST implementation is mostly header-only with the class definitions
+
+void ASTNode::release(std::shared_ptr<ASTNode> child) {
+    // Nodes released while the work list is being drained only queue up; the
+    // outermost call destroys them one at a time, each queueing its own children
+    thread_local std::vector<std::shared_ptr<ASTNode>> pending;
+    thread_local bool draining = false;
+    
+    pending.push_back(std::move(child));
+    if (draining) {
+        return;
+    }
+    draining = true;
+    while (!pending.empty()) {
+        std::shared_ptr<ASTNode> node = std::move(pending.back());
+        pending.pop_back();
+        node.reset(); // destroys the node if this was its last owner
+    }
+    draining = false;
+}
+
+namespace {
+
+// Interned types by their kind and the ids of their parts
+struct TypeTable {
+    std::mutex mutex;
+    std::map<std::vector<uint32_t>, std::shared_ptr<Type>> types;
+};
+
+TypeTable& typeTable() {
+    static TypeTable table; // built on first use, so types can be made during static initialization
+    return table;
+}
+
+} // namespace
+
+std::shared_ptr<Type> Type::intern(TypeKind kind, std::shared_ptr<Type> elem,
+                                   std::vector<std::shared_ptr<Type>> params, std::shared_ptr<Type> ret) {
+    std::vector<uint32_t> key{ static_cast<uint32_t>(kind) };
+    if (elem) key.push_back(elem->id);
+    if (kind == FUNCTION_TYPE) {
+        key.push_back(static_cast<uint32_t>(params.size()));
+        for (const auto& param : params) key.push_back(param->id);
+        key.push_back(ret ? ret->id : UINT32_MAX);
+    }
+    
+    TypeTable& table = typeTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    auto& type = table.types[key];
+    if (!type) {
+        uint32_t id = static_cast<uint32_t>(table.types.size() - 1);
+        type.reset(new Type(kind, id, std::move(elem), std::move(params), std::move(ret)));
+    }
+    return type;
+}
+
+// The primitive types are looked up once and then returned without locking
+std::shared_ptr<Type> Type::createVoid() {
+    static const std::shared_ptr<Type> type = intern(VOID_TYPE);
+    return type;
+}
+
+std::shared_ptr<Type> Type::createInt() {
+    static const std::shared_ptr<Type> type = intern(INTEGER_TYPE);
+    return type;
+}
+
+std::shared_ptr<Type> Type::createFloat() {
+    static const std::shared_ptr<Type> type = intern(FLOAT_TYPE);
+    return type;
+}
+
+std::shared_ptr<Type> Type::createString() {
+    static const std::shared_ptr<Type> type = intern(STRING_TYPE);
+    return type;
+}
+
+std::shared_ptr<Type> Type::createStr() {
+    static const std::shared_ptr<Type> type = intern(STR_TYPE);
+    return type;
+}
+
+std::shared_ptr<Type> Type::createBoolean() {
+    static const std::shared_ptr<Type> type = intern(BOOLEAN_TYPE);
+    return type;
+}
+
+std::shared_ptr<Type> Type::createArray(std::shared_ptr<Type> elem) {
+    return intern(ARRAY_TYPE, std::move(elem));
+}
+
+std::shared_ptr<Type> Type::createReference(std::shared_ptr<Type> elem) {
+    return intern(REFERENCE_TYPE, std::move(elem));
+}
+
+std::shared_ptr<Type> Type::createFunction(std::vector<std::shared_ptr<Type>> params, std::shared_ptr<Type> ret) {
+    return intern(FUNCTION_TYPE, nullptr, std::move(params), std::move(ret));
+}
@@ -0,0 +1,372 @@
+#include "BenchRunner.h"
+#include "Compiler.h"
+#include "Json.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+#ifdef _WIN32
+#define THOR_NULL_DEVICE "NUL"
+#else
+#define THOR_NULL_DEVICE "/dev/null"
+#endif
+
+namespace fs = std::filesystem;
+
+static const double CONFIDENCE_Z = 1.96; // 95%
+
+// Linear interpolation between the closest ranks of sorted samples
+static double quantile(const std::vector<double>& sorted, double p) {
+    double rank = p * (sorted.size() - 1);
+    size_t below = static_cast<size_t>(rank);
+    if (below + 1 >= sorted.size()) {
+        return sorted.back();
+    }
+    return sorted[below] + (rank - below) * (sorted[below + 1] - sorted[below]);
+}
+
+// The order statistics that bound quantile p with ~95% confidence: the rank of
+// the quantile in n samples is binomial(n, p), approximated as normal
+static void quantileInterval(const std::vector<double>& sorted, double p, double& low, double& high) {
+    double n = static_cast<double>(sorted.size());
+    double spread = CONFIDENCE_Z * std::sqrt(n * p * (1 - p));
+    long long lowRank = static_cast<long long>(std::floor(n * p - spread));
+    long long highRank = static_cast<long long>(std::ceil(n * p + spread));
+    lowRank = std::clamp(lowRank, 1LL, static_cast<long long>(sorted.size()));
+    highRank = std::clamp(highRank, 1LL, static_cast<long long>(sorted.size()));
+    low = sorted[lowRank - 1];
+    high = sorted[highRank - 1];
+}
+
+BenchResult BenchResult::summarize(const std::string& name, long long iterations, std::vector<double> samples) {
+    BenchResult result;
+    result.name = name;
+    result.iterations = iterations;
+    result.samples = samples.size();
+    if (samples.empty()) {
+        return result;
+    }
+    std::sort(samples.begin(), samples.end());
+    result.min = samples.front();
+    result.median = quantile(samples, 0.5);
+    result.p99 = quantile(samples, 0.99);
+    quantileInterval(samples, 0.5, result.medianLow, result.medianHigh);
+    quantileInterval(samples, 0.99, result.p99Low, result.p99High);
+    return result;
+}
+
+// Nanoseconds in the unit that suits `scale`, e.g. "1.25 us"
+static std::string formatTime(double ns, double scale) {
+    static const char* units[] = { "ns", "us", "ms", "s" };
+    int unit = 0;
+    while (unit < 3 && scale >= 1000) {
+        scale /= 1000;
+        ns /= 1000;
+        unit++;
+    }
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.3g %s", ns, units[unit]);
+    return buffer;
+}
+
+static std::string formatInterval(double low, double high, double scale) {
+    return "[" + formatTime(low, scale) + ", " + formatTime(high, scale) + "]";
+}
+
+static Json toJson(const BenchResult& result) {
+    Json entry = Json::object();
+    entry.set("name", result.name);
+    entry.set("iterations", result.iterations);
+    entry.set("samples", result.samples);
+    entry.set("min", result.min);
+    entry.set("median", result.median);
+    entry.set("medianLow", result.medianLow);
+    entry.set("medianHigh", result.medianHigh);
+    entry.set("p99", result.p99);
+    entry.set("p99Low", result.p99Low);
+    entry.set("p99High", result.p99High);
+    return entry;
+}
+
+static BenchResult fromJson(const std::string& name, const Json& entry) {
+    BenchResult result;
+    result.name = name;
+    result.iterations = entry["iterations"].asInt();
+    result.samples = static_cast<size_t>(entry["samples"].asInt());
+    result.min = entry["min"].asNumber();
+    result.median = entry["median"].asNumber();
+    result.medianLow = entry["medianLow"].asNumber();
+    result.medianHigh = entry["medianHigh"].asNumber();
+    result.p99 = entry["p99"].asNumber();
+    result.p99Low = entry["p99Low"].asNumber();
+    result.p99High = entry["p99High"].asNumber();
+    return result;
+}
+
+BenchRunner::BenchRunner(const BenchOptions& benchOptions) : options(benchOptions) {
+    compiler = CompilerLocator().locate();
+    // Full optimization, tuned for this machine: results are only compared with runs on it
+    cFlags.push_back(compiler.supportsFlag("-O3") ? "-O3" : "-O2");
+    if (compiler.supportsFlag("-march=native")) {
+        cFlags.push_back("-march=native");
+    }
+}
+
+bool BenchRunner::selected(const std::string& name) const {
+    if (options.filters.empty()) {
+        return true;
+    }
+    for (const auto& filter : options.filters) {
+        if (name.find(filter) != std::string::npos) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<std::string> BenchRunner::discover(const std::string& root, const std::string& outputDir) {
+    std::vector<std::string> files;
+    std::error_code ec;
+    fs::path output = fs::path(root) / outputDir;
+    for (auto it = fs::recursive_directory_iterator(root, ec); !ec && it != fs::recursive_directory_iterator();
+         it.increment(ec)) {
+        std::string name = it->path().filename().string();
+        std::error_code ignored;
+        if (it->is_directory(ignored)) {
+            if ((name.size() > 1 && name[0] == '.') || fs::equivalent(it->path(), output, ignored)) {
+                it.disable_recursion_pending();
+            }
+            continue;
+        }
+        if (it->path().extension() != ".thor") {
+            continue;
+        }
+        std::ifstream in(it->path(), std::ios::binary);
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        std::string source = buffer.str();
+        if (source.find("bench") == std::string::npos) {
+            continue;
+        }
+        try {
+            TokenStream tokens = Lexer(source).tokenize();
+            for (size_t i = 0; i < tokens.size(); i++) {
+                if (tokens[i].type == TokenType::BENCH) {
+                    files.push_back(it->path().lexically_normal().generic_string());
+                    break;
+                }
+            }
+        } catch (const std::exception&) {
+            // Not a Thor file we can read; `thor bench file.thor` reports why
+        }
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+bool BenchRunner::runFile(const std::string& file, size_t index, std::vector<BenchResult>& results) {
+    std::string label = fs::path(file).lexically_normal().generic_string();
+
+    // Only files with selected benches are built, and only those benches run
+    std::vector<std::string> benches;
+    bool parsed = false;
+    {
+        std::ifstream in(file, std::ios::binary);
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        try {
+            Parser parser(Lexer(buffer.str()).tokenize());
+            auto program = parser.parse();
+            for (const auto& stmt : program->statements) {
+                if (auto bench = std::dynamic_pointer_cast<BenchDeclaration>(stmt)) {
+                    if (selected(label + ":" + bench->name)) {
+                        benches.push_back(bench->name);
+                    }
+                }
+            }
+            parsed = true;
+        } catch (const std::exception&) {
+            // Compiling reports the error with its position
+        }
+    }
+    if (parsed && benches.empty()) {
+        return true;
+    }
+
+    fs::path dir = fs::path(options.outputDir) / "bench";
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    std::string stem = fs::path(file).stem().string() + "_" + std::to_string(index);
+    std::string executable = (dir / (stem + ".exe")).string();
+    std::string resultsFile = (dir / (stem + ".results")).string();
+
+    Compiler thor;
+    thor.setCCompiler(compiler);
+    thor.setCFlags(cFlags);
+    thor.setBenchmarks(true);
+    std::cout << "Compiling " << label << "..." << std::endl;
+    Compiler::Result compiled = thor.compileFileToExecutable(file, executable);
+    for (const auto& diagnostic : compiled.diagnostics) {
+        std::cerr << diagnostic.toString() << std::endl;
+    }
+    if (!compiled.success) {
+        return false;
+    }
+
+    // What the benches print would only add noise; it is discarded
+    std::string command = "\"" + executable + "\" --samples " + std::to_string(options.samples) +
+                          " --sample-time " + std::to_string(options.sampleTime) + " --results \"" + resultsFile + "\"";
+    if (!options.filters.empty()) {
+        for (const auto& bench : benches) {
+            command += " --only " + bench;
+        }
+    }
+    command += " > " THOR_NULL_DEVICE;
+#ifdef _WIN32
+    command = "\"" + command + "\""; // cmd.exe strips one pair of quotes around the whole line
+#endif
+    fs::remove(resultsFile, ec);
+    if (std::system(command.c_str()) != 0) {
+        std::cerr << "Error: " << label << ": benchmark harness failed" << std::endl;
+        return false;
+    }
+
+    std::ifstream in(resultsFile);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string name;
+        long long iterations = 0;
+        std::vector<double> samples;
+        double sample;
+        if (!(fields >> name >> iterations)) {
+            continue;
+        }
+        while (fields >> sample) {
+            samples.push_back(sample);
+        }
+        results.push_back(BenchResult::summarize(label + ":" + name, iterations, samples));
+    }
+    return true;
+}
+
+int BenchRunner::run(const std::vector<std::string>& files) {
+    if (compiler.empty()) {
+        std::cerr << "Error: No C compiler found. Please install gcc, clang, or MinGW." << std::endl;
+        return 1;
+    }
+
+    std::map<std::string, BenchResult> baseline;
+    std::string baselineCompiler;
+    if (!options.baseline.empty()) {
+        std::ifstream in(options.baseline, std::ios::binary);
+        if (!in.is_open()) {
+            std::cerr << "Error: Could not open baseline " << options.baseline << std::endl;
+            return 1;
+        }
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        try {
+            Json saved = Json::parse(buffer.str());
+            baselineCompiler = saved["compiler"].asString();
+            const Json& benches = saved["benchmarks"];
+            for (size_t i = 0; i < benches.size(); i++) {
+                std::string name = benches[i]["name"].asString();
+                baseline[name] = fromJson(name, benches[i]);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << options.baseline << ": " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    bool failed = false;
+    std::vector<BenchResult> results;
+    for (size_t i = 0; i < files.size(); i++) {
+        if (!runFile(files[i], i, results)) {
+            failed = true;
+        }
+    }
+    if (results.empty()) {
+        std::cerr << (failed ? "No benchmarks ran" : "No benchmarks found") << std::endl;
+        return 1;
+    }
+
+    if (!baselineCompiler.empty() && baselineCompiler != compiler.version) {
+        std::cout << "Note: the baseline was measured with " << baselineCompiler << std::endl;
+    }
+
+    size_t width = 5;
+    for (const auto& result : results) {
+        width = std::max(width, result.name.size());
+    }
+    char line[512];
+    snprintf(line, sizeof(line), "\n%-*s %12s  %-28s  %-28s%s", static_cast<int>(width), "bench", "min",
+             "median [95% CI]", "p99 [95% CI]", baseline.empty() ? "" : "  vs baseline");
+    std::cout << line << std::endl;
+
+    int regressions = 0;
+    for (const auto& result : results) {
+        double scale = result.median;
+        std::string median = formatTime(result.median, scale) + " " + formatInterval(result.medianLow, result.medianHigh, scale);
+        std::string p99 = formatTime(result.p99, scale) + " " + formatInterval(result.p99Low, result.p99High, scale);
+        std::string comparison;
+        if (!baseline.empty()) {
+            auto saved = baseline.find(result.name);
+            if (saved == baseline.end() || saved->second.median <= 0) {
+                comparison = "new";
+            } else {
+                const BenchResult& before = saved->second;
+                double change = result.median / before.median - 1;
+                char percent[32];
+                snprintf(percent, sizeof(percent), "%+.1f%%", change * 100);
+                comparison = percent;
+                if (change > options.threshold && result.medianLow > before.medianHigh) {
+                    comparison += " REGRESSED";
+                    regressions++;
+                } else if (change < -options.threshold && result.medianHigh < before.medianLow) {
+                    comparison += " improved";
+                } else {
+                    comparison += " (no significant change)";
+                }
+            }
+        }
+        snprintf(line, sizeof(line), "%-*s %12s  %-28s  %-28s  %s", static_cast<int>(width), result.name.c_str(),
+                 formatTime(result.min, scale).c_str(), median.c_str(), p99.c_str(), comparison.c_str());
+        std::string text = line;
+        while (!text.empty() && text.back() == ' ') {
+            text.pop_back();
+        }
+        std::cout << text << std::endl;
+    }
+
+    if (!options.save.empty()) {
+        Json saved = Json::object();
+        saved.set("compiler", compiler.version);
+        Json benches = Json::array();
+        for (const auto& result : results) {
+            benches.push(toJson(result));
+        }
+        saved.set("benchmarks", benches);
+        std::ofstream out(options.save, std::ios::binary);
+        if (!out.is_open() || !(out << saved.dump() << "\n")) {
+            std::cerr << "Error: Could not write " << options.save << std::endl;
+            return 1;
+        }
+        std::cout << "Saved results to " << options.save << std::endl;
+    }
+
+    if (regressions > 0) {
+        std::cout << regressions << " benchmark" << (regressions == 1 ? "" : "s") << " regressed by more than "
+                  << options.threshold * 100 << "%" << std::endl;
+    }
+    return failed || regressions > 0 ? 1 : 0;
+}
@@ -1,20 +1,3295 @@
 #include "CodeGenerator.h"
 #include <algorithm>
+#include <iterator>
 #include <regex>
+#include <stdexcept>
+
+const char* CodeGenerator::RUNTIME_HEADER = "thor_runtime.h";
+
+// Number formatting, emitted for programs with format expressions. Integers are written two digits at
+// a time from a table; floats and doubles as the shortest decimal that reads
+// back as the same value, found with Ryu. Format expressions whose argument
+// types are known call thor_format_values() with a type letter per argument
+// instead of going through vsnprintf.
+static const char* NUMBER_FORMAT_RUNTIME = R"RUNTIME(#include <stdint.h>
+
+// Number formatting: integers by digit pairs, floats as the shortest decimal
+// that reads back as the same value (the Ryu algorithm, Adams 2018)
+static const char thor_digit_pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+char* thor_format_int(char* out, long long value) {
+    unsigned long long magnitude = value < 0 ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+    char digits[20];
+    char* end = digits + sizeof(digits);
+    char* p = end;
+    while (magnitude >= 100) {
+        unsigned pair = (unsigned)(magnitude % 100);
+        magnitude /= 100;
+        p -= 2;
+        memcpy(p, thor_digit_pairs + 2 * pair, 2);
+    }
+    if (magnitude >= 10) {
+        p -= 2;
+        memcpy(p, thor_digit_pairs + 2 * magnitude, 2);
+    } else {
+        *--p = (char)('0' + magnitude);
+    }
+    *out = '-';
+    out += value < 0;
+    memcpy(out, p, (size_t)(end - p));
+    return out + (end - p);
+}
+
+// Generated tables: 5^i and 2^k / 5^i, scaled to 125 (double) or 61 and 59
+// (float) significant bits, for the exponents that occur
+static const uint64_t thor_double_pow5_inv[291][2] = {
+    { 0x0000000000000001u, 0x2000000000000000u }, { 0x999999999999999au, 0x1999999999999999u },
+    { 0x47ae147ae147ae15u, 0x147ae147ae147ae1u }, { 0x6c8b4395810624deu, 0x10624dd2f1a9fbe7u },
+    { 0x7a786c226809d496u, 0x1a36e2eb1c432ca5u }, { 0x61f9f01b866e43abu, 0x14f8b588e368f084u },
+    { 0xb4c7f34938583622u, 0x10c6f7a0b5ed8d36u }, { 0x87a6520ec08d236au, 0x1ad7f29abcaf4857u },
+    { 0x9fb841a566d74f88u, 0x15798ee2308c39dfu }, { 0xe62d01511f12a607u, 0x112e0be826d694b2u },
+    { 0xd6ae6881cb5109a4u, 0x1b7cdfd9d7bdbab7u }, { 0xdef1ed34a2a73aeau, 0x15fd7fe17964955fu },
+    { 0x7f27f0f6e885c8bbu, 0x119799812dea1119u }, { 0x650cb4be40d60df8u, 0x1c25c268497681c2u },
+    { 0xea70909833de7193u, 0x16849b86a12b9b01u }, { 0x21f3a6e0297ec143u, 0x1203af9ee756159bu },
+    { 0x6985d7cd0f313537u, 0x1cd2b297d889bc2bu }, { 0x2137dfd73f5a90f9u, 0x170ef54646d49689u },
+    { 0xe75fe645cc4873fau, 0x12725dd1d243aba0u }, { 0xa5663d3c7a0d865du, 0x1d83c94fb6d2ac34u },
+    { 0x511e976394d79eb1u, 0x179ca10c9242235du }, { 0xda7edf82dd794bc1u, 0x12e3b40a0e9b4f7du },
+    { 0x2a6498d1625bac68u, 0x1e392010175ee596u }, { 0xeeb6e0a781e2f053u, 0x182db34012b25144u },
+    { 0x58924d52ce4f26a9u, 0x1357c299a88ea76au }, { 0x27507bb7b07ea441u, 0x1ef2d0f5da7dd8aau },
+    { 0x52a6c95fc0655034u, 0x18c240c4aecb13bbu }, { 0x0eebd44c99eaa690u, 0x13ce9a36f23c0fc9u },
+    { 0xb17953adc3110a80u, 0x1fb0f6be50601941u }, { 0xc12ddc8b02740867u, 0x195a5efea6b34767u },
+    { 0x3424b06f3529a052u, 0x14484bfeebc29f86u }, { 0x901d59f290ee19dbu, 0x1039d66589687f9eu },
+    { 0x4cfbc31db4b0295fu, 0x19f623d5a8a73297u }, { 0x3d9635b15d59bab2u, 0x14c4e977ba1f5bacu },
+    { 0x97ab5e277de16228u, 0x109d8792fb4c4956u }, { 0xf2abc9d8c9689d0du, 0x1a95a5b7f87a0ef0u },
+    { 0x5bbca17a3aba173eu, 0x154484932d2e725au }, { 0xafca1ac82efb45cbu, 0x11039d428a8b8eaeu },
+    { 0xb2dcf7a6b1920945u, 0x1b38fb9daa78e44au }, { 0xf57d92ebc141a104u, 0x15c72fb1552d836eu },
+    { 0xc46475896767b403u, 0x116c262777579c58u }, { 0x6d6d88dbd8a5ecd2u, 0x1be03d0bf225c6f4u },
+    { 0x8abe071646eb23dbu, 0x164cfda3281e38c3u }, { 0x6efe6c11d255b649u, 0x11d7314f534b609cu },
+    { 0xb197134fb6ef8a0eu, 0x1c8b821885456760u }, { 0x27ac0f72f8bfa1a5u, 0x16d601ad376ab91au },
+    { 0xb95672c260994e1eu, 0x1244ce242c5560e1u }, { 0xf5571e03cdc21695u, 0x1d3ae36d13bbce35u },
+    { 0x2aac18030b01ababu, 0x17624f8a762fd82bu }, { 0xbbbce0026f348956u, 0x12b50c6ec4f31355u },
+    { 0x92c7ccd0b1eda889u, 0x1dee7a4ad4b81eefu }, { 0xdbd30a408e57ba07u, 0x17f1fb6f10934bf2u },
+    { 0x7ca8d50071dfc806u, 0x1327fc58da0f6ff5u }, { 0xfaa7bb33e9660cd6u, 0x1ea6608e29b24cbbu },
+    { 0x9552fc298784d711u, 0x18851a0b548ea3c9u }, { 0xaaa8c9bad2d0ac0eu, 0x139dae6f76d88307u },
+    { 0xdddadc5e1e1aace3u, 0x1f62b0b257c0d1a5u }, { 0x7e48b04b4b488a4fu, 0x191bc08eac9a4151u },
+    { 0xcb6d59d5d5d3a1d9u, 0x141633a556e1cddau }, { 0x3c577b1177dc817bu, 0x1011c2eaabe7d7e2u },
+    { 0xc6f25e825960cf2au, 0x19b604aaaca62636u }, { 0x6bf518684780a5bbu, 0x14919d5556eb51c5u },
+    { 0x232a79ed06008496u, 0x10747ddddf22a7d1u }, { 0xd1dd8fe1a3340756u, 0x1a53fc9631d10c81u },
+    { 0xa7e4731ae8f66c45u, 0x150ffd44f4a73d34u }, { 0x531d28e253f8569eu, 0x10d9976a5d52975du },
+    { 0xeb61db03b98d5762u, 0x1af5bf109550f22eu }, { 0xbc4e48cfc7a445e8u, 0x159165a6ddda5b58u },
+    { 0x6371d3d96c836b20u, 0x11411e1f17e1e2adu }, { 0x9f1c8628ad9f11cdu, 0x1b9b6364f3030448u },
+    { 0xe5b06b53be18db0bu, 0x1615e91d8f359d06u }, { 0xeaf3890fcb4715a2u, 0x11ab20e472914a6bu },
+    { 0x44b8db4c7871bc37u, 0x1c45016d841baa46u }, { 0x03c715d6c6c1635fu, 0x169d9abe03495505u },
+    { 0x3638de456bcde919u, 0x1217aefe69077737u }, { 0x56c163a2461641c1u, 0x1cf2b1970e725858u },
+    { 0xdf011c81d1ab67ceu, 0x17288e1271f51379u }, { 0x7f3416ce4155eca5u, 0x1286d80ec190dc61u },
+    { 0x6520247d3556476eu, 0x1da48ce468e7c702u }, { 0xea801d30f7783925u, 0x17b6d71d20b96c01u },
+    { 0xbb99b0f3f92cfa84u, 0x12f8ac174d612334u }, { 0x5f5c4e532847f739u, 0x1e5aacf215683854u },
+    { 0x7f7d0b75b9d32c2eu, 0x18488a5b44536043u }, { 0x9930d5f7c7dc2358u, 0x136d3b7c36a919cfu },
+    { 0x8eb4898c72f9d226u, 0x1f152bf9f10e8fb2u }, { 0x722a07a38f2e41b8u, 0x18ddbcc7f40ba628u },
+    { 0xc1bb394fa5be9afau, 0x13e497065cd61e86u }, { 0x9c5ec2190930f7f6u, 0x1fd424d6faf030d7u },
+    { 0x49e56814075a5ff8u, 0x197683df2f268d79u }, { 0x6e51201005e1e660u, 0x145ecfe5bf520ac7u },
+    { 0xf1da800cd181851au, 0x104bd984990e6f05u }, { 0x4fc400148268d4f5u, 0x1a12f5a0f4e3e4d6u },
+    { 0xd96999aa01ed772bu, 0x14dbf7b3f71cb711u }, { 0xadee1488018ac5bcu, 0x10aff95cc5b09274u },
+    { 0x497ceda668de092cu, 0x1ab328946f80ea54u }, { 0x3aca57b853e4d424u, 0x155c2076bf9a5510u },
+    { 0x623b7960431d7683u, 0x1116805effaeaa73u }, { 0x9d2bf566d1c8bd9eu, 0x1b5733cb32b110b8u },
+    { 0x7dbcc452416d647fu, 0x15df5ca28ef40d60u }, { 0xcafd69db678ab6ccu, 0x117f7d4ed8c33de6u },
+    { 0xab2f0fc572778adfu, 0x1bff2ee48e052fd7u }, { 0x88f273045b92d580u, 0x1665bf1d3e6a8cacu },
+    { 0xd3f528d049424466u, 0x11eaff4a98553d56u }, { 0xb988414d4203a0a3u, 0x1cab3210f3bb9557u },
+    { 0x6139cdd76802e6e9u, 0x16ef5b40c2fc7779u }, { 0xe761717920025254u, 0x125915cd68c9f92du },
+    { 0xa568b58e999d5086u, 0x1d5b561574765b7cu }, { 0x5120913ee14aa6d2u, 0x177c44ddf6c515fdu },
+    { 0xa74d40ff1aa21f0eu, 0x12c9d0b1923744cau }, { 0x0baece64f769cb4au, 0x1e0fb44f50586e11u },
+    { 0x3c8bd850c5ee3c3bu, 0x180c903f7379f1a7u }, { 0xca0979da37f1c9c9u, 0x133d4032c2c7f485u },
+    { 0xa9a8c2f6bfe942dbu, 0x1ec866b79e0cba6fu }, { 0x2153cf2bccba9be3u, 0x18a0522c7e709526u },
+    { 0x1aa9728970954982u, 0x13b374f06526ddb8u }, { 0xf775840f1a88759du, 0x1f8587e7083e2f8cu },
+    { 0x5f9136727ba05e17u, 0x19379fec0698260au }, { 0x1940f85b9619e4dfu, 0x142c7ff0054684d5u },
+    { 0xe100c6afab47ea4cu, 0x1023998cd1053710u }, { 0xce67a44c453fdd47u, 0x19d28f47b4d524e7u },
+    { 0xd852e9d69dccb106u, 0x14a8729fc3ddb71fu }, { 0x79dbee454b0a2738u, 0x1086c219697e2c19u },
+    { 0x295fe3a211a9d859u, 0x1a71368f0f30468fu }, { 0xbab31c81a7bb137au, 0x15275ed8d8f36ba5u },
+    { 0x6228e39aec95a92fu, 0x10ec4be0ad8f8951u }, { 0x9d0e38f7e0ef7517u, 0x1b13ac9aaf4c0ee8u },
+    { 0xb0d82d931a592a79u, 0x15a956e225d67253u }, { 0x8d79be0f4847552eu, 0x11544581b7dec1dcu },
+    { 0x158f967eda0bbb7cu, 0x1bba08cf8c979c94u }, { 0x77a611ff14d62f97u, 0x162e6d72d6dfb076u },
+    { 0xf951a7ff43de8c79u, 0x11bebdf578b2f391u }, { 0xc21c3ffed2fdad8eu, 0x1c6463225ab7ec1cu },
+    { 0x01b0333242648ad8u, 0x16b6b5b5155ff017u }, { 0x0159c28e9b83a246u, 0x122bc490dde659acu },
+    { 0xcef604175f3903a3u, 0x1d12d41afca3c2acu }, { 0x725e69ac4c2d9c83u, 0x17424348ca1c9bbdu },
+    { 0xf5185489d68ae39cu, 0x129b69070816e2fdu }, { 0xee8d540fbdab05c6u, 0x1dc574d80cf16b2fu },
+    { 0xbed77672fe226b05u, 0x17d12a4670c1228cu }, { 0xff12c528cb4ebc04u, 0x130dbb6b8d674ed6u },
+    { 0xcb513b74787df9a0u, 0x1e7c5f127bd87e24u }, { 0x090dc929f9fe614du, 0x18637f41fcad31b7u },
+    { 0xa0d7d42194cb810au, 0x1382cc34ca2427c5u }, { 0x67bfb9cf5478ce77u, 0x1f37ad21436d0c6fu },
+    { 0x1fcc94a5dd2d71f9u, 0x18f9574dcf8a7059u }, { 0x7fd6dd517dbdf4c7u, 0x13faac3e3fa1f37au },
+    { 0xffbe2ee8c92fee0bu, 0x1ff779fd329cb8c3u }, { 0x6631bf20a0f324d6u, 0x1992c7fdc216fa36u },
+    { 0xb827cc1a1a5c1d78u, 0x14756ccb01abfb5eu }, { 0x935309ae7b7ce460u, 0x105df0a267bcc918u },
+    { 0x1eeb42b0c594a099u, 0x1a2fe76a3f9474f4u }, { 0xe58902270476e6e1u, 0x14f31f8832dd2a5cu },
+    { 0xb7a0ce859d2bebe7u, 0x10c27fa028b0eeb0u }, { 0x59014a6f61dfdfd8u, 0x1ad0cc33744e4ab4u },
+    { 0xe0cdd525e7e64cadu, 0x1573d68f903ea229u }, { 0x4d7177518651d6f1u, 0x11297872d9cbb4eeu },
+    { 0x7be8bee8d6e957e8u, 0x1b758d848fac54b0u }, { 0xfcba3253df211320u, 0x15f7a46a0c89dd59u },
+    { 0x63c8284318e74280u, 0x1192e9ee706e4aaeu }, { 0x060d0d3827d86a66u, 0x1c1e43171a4a1117u },
+    { 0x6b3da42cecad21ebu, 0x167e9c127b6e7412u }, { 0x88fe1cf0bd574e56u, 0x11fee341fc585cdbu },
+    { 0x419694b462254a23u, 0x1ccb0536608d615fu }, { 0x67abaa29e81dd4e9u, 0x1708d0f84d3de77fu },
+    { 0xb95621bb2017dd87u, 0x126d73f9d764b932u }, { 0xc223692b668c95a5u, 0x1d7becc2f23ac1eau },
+    { 0xce82ba891ed6de1du, 0x179657025b6234bbu }, { 0xa53562074bdf1818u, 0x12deac01e2b4f6fcu },
+    { 0x3b889cd87964f359u, 0x1e3113363787f194u }, { 0xfc6d4a46c783f5e1u, 0x18274291c6065adcu },
+    { 0x30576e9f06032b1au, 0x13529ba7d19eaf17u }, { 0x1a257dcb3cd1de90u, 0x1eea92a61c311825u },
+    { 0x481dfe3c30a7e540u, 0x18bba884e35a79b7u }, { 0xd34b31c9c0865100u, 0x13c9539d82aec7c5u },
+    { 0x5211e942cda3b4cdu, 0x1fa885c8d117a609u }, { 0x74db21023e1c90a4u, 0x19539e3a40dfb807u },
+    { 0xf715b401cb4a0d50u, 0x1442e4fb67196005u }, { 0xf8de299b09080aa7u, 0x103583fc527ab337u },
+    { 0x8e304291a80cddd7u, 0x19ef3993b72ab859u }, { 0x3e8d020e200a4b13u, 0x14bf6142f8eef9e1u },
+    { 0x653d9b3e80083c0fu, 0x10991a9bfa58c7e7u }, { 0x6ec8f864000d2ce4u, 0x1a8e90f9908e0ca5u },
+    { 0x8bd3f9e999a423eau, 0x153eda614071a3b7u }, { 0x3ca994bae1501cbbu, 0x10ff151a99f482f9u },
+    { 0xc775bac49bb3612bu, 0x1b31bb5dc320d18eu }, { 0xd2c4956a16291a89u, 0x15c162b168e70e0bu },
+    { 0xdbd0778811ba7ba1u, 0x11678227871f3e6fu }, { 0x2c80bf401c5d929bu, 0x1bd8d03f3e9863e6u },
+    { 0xbd33cc3349e47549u, 0x16470cff6546b651u }, { 0xca8fd68f6e505dd4u, 0x11d270cc51055ea7u },
+    { 0x4419574be3b3c953u, 0x1c83e7ad4e6efdd9u }, { 0x0347790982f63aa9u, 0x16cfec8aa52597e1u },
+    { 0xcf6c60d468c4fbbau, 0x123ff06eea847980u }, { 0xe57a34870e07f92au, 0x1d331a4b10d3f59au },
+    { 0x512e906c0b399422u, 0x175c1508da432ae2u }, { 0xda8ba6bcd5c7a9b5u, 0x12b010d3e1cf5581u },
+    { 0x90df712e22d90f87u, 0x1de6815302e5559cu }, { 0xda4c5a8b4f140c6cu, 0x17eb9aa8cf1dde16u },
+    { 0xaea37ba2a5a9a38au, 0x1322e220a5b17e78u }, { 0x7dd25f6aa2a905a9u, 0x1e9e369aa2b59727u },
+    { 0x97db7f888220d154u, 0x187e92154ef7ac1fu }, { 0x797c6606ce80a777u, 0x139874ddd8c6234cu },
+    { 0x8f2d700ae4010bf1u, 0x1f5a549627a36badu }, { 0x0c2459a25000d65au, 0x191510781fb5efbeu },
+    { 0x701d1481d99a4515u, 0x1410d9f9b2f7f2feu }, { 0xc017439b147b6a77u, 0x100d7b2e28c65bfeu },
+    { 0xccf205c4ed9243f2u, 0x19af2b7d0e0a2ccau }, { 0x0a5b37d0be0e9cc2u, 0x148c22ca71a1bd6fu },
+    { 0x0848f973cb3ee3ceu, 0x10701bd527b4978cu }, { 0xda0e5bec78649fb0u, 0x1a4cf9550c5425acu },
+    { 0x7b3eaff060507fc0u, 0x150a6110d6a9b7bdu }, { 0x95cbbff380406633u, 0x10d51a73deee2c97u },
+    { 0xefac665266cd7052u, 0x1aee90b964b04758u }, { 0x2623850eb8a459dbu, 0x158ba6fab6f36c47u },
+    { 0x1e82d0d893b6ae49u, 0x113c85955f29236cu }, { 0xfd9e1af41f8ab075u, 0x1b9408eefea838acu },
+    { 0x97b1af29b2d559f7u, 0x16100725988693bdu }, { 0xac8e25baf5777b2cu, 0x11a66c1e139edc97u },
+    { 0x7a7d092b2258c513u, 0x1c3d79c9b8fe2dbfu }, { 0x61fda0ef4ead6a76u, 0x169794a160cb57ccu },
+    { 0xe7fe1a590bbdeec5u, 0x1212dd4de7091309u }, { 0xa6635d5b45fcb13au, 0x1ceafbafd80e84dcu },
+    { 0x851c4aaf6b308dc8u, 0x172262f3133ed0b0u }, { 0xd0e36ef2bc26d7d4u, 0x1281e8c275cbda26u },
+    { 0xb49f17eac6a48c86u, 0x1d9ca79d894629d7u }, { 0x2a18dfef0550706bu, 0x17b08617a104ee46u },
+    { 0x54e0b3259dd9f389u, 0x12f39e794d9d8b6bu }, { 0x87cdeb6f62f65274u, 0x1e5297287c2f4578u },
+    { 0xd30b22bf825ea85du, 0x18421286c9bf6ac6u }, { 0x0f3c1bcc684bb9e4u, 0x13680ed23aff889fu },
+    { 0x18602c7a4079296du, 0x1f0ce4839198da98u }, { 0x46b356c833942124u, 0x18d71d360e13e213u },
+    { 0x388f78a029434db6u, 0x13df4a91a4dcb4dcu }, { 0x5a7f2766a86baf8au, 0x1fcbaa82a1612160u },
+    { 0x153285ebb9efbfa2u, 0x196fbb9bb44db44du }, { 0xaa8ed189618c994eu, 0x145962e2f6a4903du },
+    { 0xeed8a7a11ad6e10cu, 0x1047824f2bb6d9cau }, { 0x7e27729b5e249b45u, 0x1a0c03b1df8af611u },
+    { 0xfe85f549181d4904u, 0x14d6695b193bf80du }, { 0xcb9e5dd4134aa0d0u, 0x10ab877c142ff9a4u },
+    { 0xdf63c9535211014du, 0x1aac0bf9b9e65c3au }, { 0x191ca10f74da6771u, 0x15566ffafb1eb02fu },
+    { 0xadb080d92a4852c1u, 0x1111f32f2f4bc025u }, { 0x15e7348eaa0d5134u, 0x1b4feb7eb212cd09u },
+    { 0xab1f5d3eee710dc4u, 0x15d98932280f0a6du }, { 0xbc1917658b8da49du, 0x117ad428200c0857u },
+    { 0x2cf4f23c127c3a94u, 0x1bf7b9d9cce00d59u }, { 0xf0c3f4fcdb969543u, 0x165fc7e170b33de0u },
+    { 0x5a365d9716121103u, 0x11e6398126f5cb1au }, { 0x9056fc24f01ce804u, 0x1ca38f350b22de90u },
+    { 0xd9df301d8ce3ecd0u, 0x16e93f5da2824ba6u }, { 0xe17f59b13d8323dau, 0x125432b14ecea2ebu },
+    { 0x68cbc2b52f38395cu, 0x1d53844ee47dd179u }, { 0x53d6355dbf602de3u, 0x177603725064a794u },
+    { 0xa9782ab165e68b1cu, 0x12c4cf8ea6b6ec76u }, { 0x0f26aab56fd744fau, 0x1e07b27dd78b13f1u },
+    { 0x3f52222abfdf6a62u, 0x18062864ac6f4327u }, { 0x65db4e88997f884eu, 0x1338205089f29c1fu },
+    { 0x6fc54a7428cc0d4au, 0x1ec033b40fea9365u }, { 0x596aa1f68709a43bu, 0x1899c2f673220f84u },
+    { 0xadeee7f86c07b696u, 0x13ae3591f5b4d936u }, { 0x497e3ff3e00c5756u, 0x1f7d228322baf524u },
+    { 0xd464fff64cd6ac45u, 0x1930e868e89590e9u }, { 0x4383fff83d7889d1u, 0x14272053ed4473eeu },
+    { 0xcf9cccc69793a174u, 0x101f4d0ff1038ff1u }, { 0x7f6147a425b90252u, 0x19cbae7fe805b31cu },
+    { 0xcc4dd2e9b7c7350fu, 0x14a2f1ffecd15c16u }, { 0x3d0b0f215fd290d9u, 0x10825b3323dab012u },
+    { 0x61ab4b689950e7c1u, 0x1a6a2b85062ab350u }, { 0x4e22a2ba1440b967u, 0x1521bc6a6b555c40u },
+    { 0x0b4ee894dd009453u, 0x10e7c9eebc4449cdu }, { 0x1217da87c800ed51u, 0x1b0c764ac6d3a948u },
+    { 0xdb46486ca000bddau, 0x15a391d56bdc876cu }, { 0x490506bd4ccd64afu, 0x114fa7ddefe39f8au },
+    { 0xa8080ac87ae23ab1u, 0x1bb2a62fe638ff43u }, { 0x5339a239fbe82ef4u, 0x162884f31e93ff69u },
+    { 0x75c7b4fb2fecf25du, 0x11ba03f5b20fff87u }, { 0x22d92191e647ea2eu, 0x1c5cd322b67fff3fu },
+    { 0xb57a8141850654f2u, 0x16b0a8e891ffff65u }, { 0xc4620101373843f5u, 0x1226ed86db3332b7u },
+    { 0x3a366801f1f39feeu, 0x1d0b15a491eb8459u }, { 0xfb5eb99b27f6198bu, 0x173c115074bc69e0u },
+    { 0x2f7efae2865e7ad6u, 0x129674405d6387e7u }, { 0xe597f7d0d6fd9156u, 0x1dbd86cd6238d971u },
+    { 0x8479930d78cadaabu, 0x17cad23de82d7ac1u }, { 0xd06142712d6f1556u, 0x1308a831868ac89au },
+    { 0x4d686a4eaf182222u, 0x1e74404f3daada91u }, { 0xa453883ef279b4e8u, 0x185d003f6488aedau },
+    { 0xe9dc6cff28615d87u, 0x137d99cc506d58aeu }, { 0xa960ae650d6895a4u, 0x1f2f5c7a1a488de4u },
+    { 0xbab3beb73ded4483u, 0x18f2b061aea07183u },
+};
+static const uint64_t thor_double_pow5[326][2] = {
+    { 0x0000000000000000u, 0x1000000000000000u }, { 0x0000000000000000u, 0x1400000000000000u },
+    { 0x0000000000000000u, 0x1900000000000000u }, { 0x0000000000000000u, 0x1f40000000000000u },
+    { 0x0000000000000000u, 0x1388000000000000u }, { 0x0000000000000000u, 0x186a000000000000u },
+    { 0x0000000000000000u, 0x1e84800000000000u }, { 0x0000000000000000u, 0x1312d00000000000u },
+    { 0x0000000000000000u, 0x17d7840000000000u }, { 0x0000000000000000u, 0x1dcd650000000000u },
+    { 0x0000000000000000u, 0x12a05f2000000000u }, { 0x0000000000000000u, 0x174876e800000000u },
+    { 0x0000000000000000u, 0x1d1a94a200000000u }, { 0x0000000000000000u, 0x12309ce540000000u },
+    { 0x0000000000000000u, 0x16bcc41e90000000u }, { 0x0000000000000000u, 0x1c6bf52634000000u },
+    { 0x0000000000000000u, 0x11c37937e0800000u }, { 0x0000000000000000u, 0x16345785d8a00000u },
+    { 0x0000000000000000u, 0x1bc16d674ec80000u }, { 0x0000000000000000u, 0x1158e460913d0000u },
+    { 0x0000000000000000u, 0x15af1d78b58c4000u }, { 0x0000000000000000u, 0x1b1ae4d6e2ef5000u },
+    { 0x0000000000000000u, 0x10f0cf064dd59200u }, { 0x0000000000000000u, 0x152d02c7e14af680u },
+    { 0x0000000000000000u, 0x1a784379d99db420u }, { 0x0000000000000000u, 0x108b2a2c28029094u },
+    { 0x0000000000000000u, 0x14adf4b7320334b9u }, { 0x4000000000000000u, 0x19d971e4fe8401e7u },
+    { 0x8800000000000000u, 0x1027e72f1f128130u }, { 0xaa00000000000000u, 0x1431e0fae6d7217cu },
+    { 0xd480000000000000u, 0x193e5939a08ce9dbu }, { 0xc9a0000000000000u, 0x1f8def8808b02452u },
+    { 0xbe04000000000000u, 0x13b8b5b5056e16b3u }, { 0xad85000000000000u, 0x18a6e32246c99c60u },
+    { 0xd8e6400000000000u, 0x1ed09bead87c0378u }, { 0x878fe80000000000u, 0x13426172c74d822bu },
+    { 0x6973e20000000000u, 0x1812f9cf7920e2b6u }, { 0x03d0da8000000000u, 0x1e17b84357691b64u },
+    { 0x8262889000000000u, 0x12ced32a16a1b11eu }, { 0x22fb2ab400000000u, 0x178287f49c4a1d66u },
+    { 0xabb9f56100000000u, 0x1d6329f1c35ca4bfu }, { 0xcb54395ca0000000u, 0x125dfa371a19e6f7u },
+    { 0xbe2947b3c8000000u, 0x16f578c4e0a060b5u }, { 0x2db399a0ba000000u, 0x1cb2d6f618c878e3u },
+    { 0xfc90400474400000u, 0x11efc659cf7d4b8du }, { 0x7bb4500591500000u, 0x166bb7f0435c9e71u },
+    { 0xdaa16406f5a40000u, 0x1c06a5ec5433c60du }, { 0xa8a4de8459868000u, 0x118427b3b4a05bc8u },
+    { 0xd2ce16256fe82000u, 0x15e531a0a1c872bau }, { 0x87819baecbe22800u, 0x1b5e7e08ca3a8f69u },
+    { 0xf4b1014d3f6d5900u, 0x111b0ec57e6499a1u }, { 0x71dd41a08f48af40u, 0x1561d276ddfdc00au },
+    { 0x0e549208b31adb10u, 0x1aba4714957d300du }, { 0x28f4db456ff0c8eau, 0x10b46c6cdd6e3e08u },
+    { 0x33321216cbecfb24u, 0x14e1878814c9cd8au }, { 0xbffe969c7ee839edu, 0x1a19e96a19fc40ecu },
+    { 0xf7ff1e21cf512434u, 0x105031e2503da893u }, { 0xf5fee5aa43256d41u, 0x14643e5ae44d12b8u },
+    { 0x337e9f14d3eec892u, 0x197d4df19d605767u }, { 0x005e46da08ea7ab6u, 0x1fdca16e04b86d41u },
+    { 0xa03aec4845928cb2u, 0x13e9e4e4c2f34448u }, { 0xc849a75a56f72fdeu, 0x18e45e1df3b0155au },
+    { 0x7a5c1130ecb4fbd6u, 0x1f1d75a5709c1ab1u }, { 0xec798abe93f11d65u, 0x13726987666190aeu },
+    { 0xa797ed6e38ed64bfu, 0x184f03e93ff9f4dau }, { 0x517de8c9c728bdefu, 0x1e62c4e38ff87211u },
+    { 0xd2eeb17e1c7976b5u, 0x12fdbb0e39fb474au }, { 0x87aa5ddda397d462u, 0x17bd29d1c87a191du },
+    { 0xe994f5550c7dc97bu, 0x1dac74463a989f64u }, { 0x11fd195527ce9dedu, 0x128bc8abe49f639fu },
+    { 0xd67c5faa71c24568u, 0x172ebad6ddc73c86u }, { 0x8c1b77950e32d6c2u, 0x1cfa698c95390ba8u },
+    { 0x57912abd28dfc639u, 0x121c81f7dd43a749u }, { 0xad75756c7317b7c8u, 0x16a3a275d494911bu },
+    { 0x98d2d2c78fdda5bau, 0x1c4c8b1349b9b562u }, { 0x9f83c3bcb9ea8794u, 0x11afd6ec0e14115du },
+    { 0x0764b4abe8652979u, 0x161bcca7119915b5u }, { 0x493de1d6e27e73d7u, 0x1ba2bfd0d5ff5b22u },
+    { 0x6dc6ad264d8f0866u, 0x1145b7e285bf98f5u }, { 0xc938586fe0f2ca80u, 0x159725db272f7f32u },
+    { 0x7b866e8bd92f7d20u, 0x1afcef51f0fb5effu }, { 0xad34051767bdae34u, 0x10de1593369d1b5fu },
+    { 0x9881065d41ad19c1u, 0x15159af804446237u }, { 0x7ea147f492186032u, 0x1a5b01b605557ac5u },
+    { 0x6f24ccf8db4f3c1fu, 0x1078e111c3556cbbu }, { 0x4aee003712230b27u, 0x14971956342ac7eau },
+    { 0xdda98044d6abcdf0u, 0x19bcdfabc13579e4u }, { 0x0a89f02b062b60b6u, 0x10160bcb58c16c2fu },
+    { 0xcd2c6c35c7b638e4u, 0x141b8ebe2ef1c73au }, { 0x8077874339a3c71du, 0x1922726dbaae3909u },
+    { 0xe0956914080cb8e4u, 0x1f6b0f092959c74bu }, { 0x6c5d61ac8507f38eu, 0x13a2e965b9d81c8fu },
+    { 0x4774ba17a649f072u, 0x188ba3bf284e23b3u }, { 0x1951e89d8fdc6c8fu, 0x1eae8caef261aca0u },
+    { 0x0fd3316279e9c3d9u, 0x132d17ed577d0be4u }, { 0x13c7fdbb186434cfu, 0x17f85de8ad5c4eddu },
+    { 0x58b9fd29de7d4203u, 0x1df67562d8b36294u }, { 0xb7743e3a2b0e4942u, 0x12ba095dc7701d9cu },
+    { 0xe5514dc8b5d1db92u, 0x17688bb5394c2503u }, { 0xdea5a13ae3465277u, 0x1d42aea2879f2e44u },
+    { 0x0b2784c4ce0bf38au, 0x1249ad2594c37cebu }, { 0xcdf165f6018ef06du, 0x16dc186ef9f45c25u },
+    { 0x416dbf7381f2ac88u, 0x1c931e8ab871732fu }, { 0x88e497a83137abd5u, 0x11dbf316b346e7fdu },
+    { 0xeb1dbd923d8596cau, 0x1652efdc6018a1fcu }, { 0x25e52cf6cce6fc7du, 0x1be7abd3781eca7cu },
+    { 0x97af3c1a40105dceu, 0x1170cb642b133e8du }, { 0xfd9b0b20d0147542u, 0x15ccfe3d35d80e30u },
+    { 0x3d01cde904199292u, 0x1b403dcc834e11bdu }, { 0x462120b1a28ffb9bu, 0x1108269fd210cb16u },
+    { 0xd7a968de0b33fa82u, 0x154a3047c694fddbu }, { 0xcd93c3158e00f923u, 0x1a9cbc59b83a3d52u },
+    { 0xc07c59ed78c09bb6u, 0x10a1f5b813246653u }, { 0xb09b7068d6f0c2a3u, 0x14ca732617ed7fe8u },
+    { 0xdcc24c830cacf34cu, 0x19fd0fef9de8dfe2u }, { 0xc9f96fd1e7ec180fu, 0x103e29f5c2b18bedu },
+    { 0x3c77cbc661e71e13u, 0x144db473335deee9u }, { 0x8b95beb7fa60e598u, 0x1961219000356aa3u },
+    { 0x6e7b2e65f8f91efeu, 0x1fb969f40042c54cu }, { 0xc50cfcffbb9bb35fu, 0x13d3e2388029bb4fu },
+    { 0xb6503c3faa82a037u, 0x18c8dac6a0342a23u }, { 0xa3e44b4f95234844u, 0x1efb1178484134acu },
+    { 0xe66eaf11bd360d2bu, 0x135ceaeb2d28c0ebu }, { 0xe00a5ad62c839075u, 0x183425a5f872f126u },
+    { 0x980cf18bb7a47493u, 0x1e412f0f768fad70u }, { 0x5f0816f752c6c8dcu, 0x12e8bd69aa19cc66u },
+    { 0xf6ca1cb527787b13u, 0x17a2ecc414a03f7fu }, { 0xf47ca3e2715699d7u, 0x1d8ba7f519c84f5fu },
+    { 0xf8cde66d86d62026u, 0x127748f9301d319bu }, { 0xf7016008e88ba830u, 0x17151b377c247e02u },
+    { 0xb4c1b80b22ae923cu, 0x1cda62055b2d9d83u }, { 0x50f91306f5ad1b65u, 0x12087d4358fc8272u },
+    { 0xe53757c8b318623fu, 0x168a9c942f3ba30eu }, { 0x9e852dbadfde7acfu, 0x1c2d43b93b0a8bd2u },
+    { 0xa3133c94cbeb0cc1u, 0x119c4a53c4e69763u }, { 0x8bd80bb9fee5cff1u, 0x16035ce8b6203d3cu },
+    { 0xaece0ea87e9f43eeu, 0x1b843422e3a84c8bu }, { 0x4d40c9294f238a75u, 0x1132a095ce492fd7u },
+    { 0x2090fb73a2ec6d12u, 0x157f48bb41db7bcdu }, { 0x68b53a508ba78856u, 0x1adf1aea12525ac0u },
+    { 0x417144725748b536u, 0x10cb70d24b7378b8u }, { 0x51cd958eed1ae283u, 0x14fe4d06de5056e6u },
+    { 0xe640faf2a8619b24u, 0x1a3de04895e46c9fu }, { 0xefe89cd7a93d00f7u, 0x1066ac2d5daec3e3u },
+    { 0xebe2c40d938c4134u, 0x14805738b51a74dcu }, { 0x26db7510f86f5181u, 0x19a06d06e2611214u },
+    { 0x9849292a9b4592f1u, 0x100444244d7cab4cu }, { 0xbe5b73754216f7adu, 0x1405552d60dbd61fu },
+    { 0xadf25052929cb598u, 0x1906aa78b912cba7u }, { 0x996ee4673743e2ffu, 0x1f485516e7577e91u },
+    { 0xffe54ec0828a6ddfu, 0x138d352e5096af1au }, { 0xbfdea270a32d0957u, 0x18708279e4bc5ae1u },
+    { 0x2fd64b0ccbf84badu, 0x1e8ca3185deb719au }, { 0x5de5eee7ff7b2f4cu, 0x1317e5ef3ab32700u },
+    { 0x755f6aa1ff59fb1fu, 0x17dddf6b095ff0c0u }, { 0x92b7454a7f3079e7u, 0x1dd55745cbb7ecf0u },
+    { 0x5bb28b4e8f7e4c30u, 0x12a5568b9f52f416u }, { 0xf29f2e22335ddf3cu, 0x174eac2e8727b11bu },
+    { 0xef46f9aac035570bu, 0x1d22573a28f19d62u }, { 0xd58c5c0ab8215667u, 0x123576845997025du },
+    { 0x4aef730d6629ac01u, 0x16c2d4256ffcc2f5u }, { 0x9dab4fd0bfb41701u, 0x1c73892ecbfbf3b2u },
+    { 0xa28b11e277d08e60u, 0x11c835bd3f7d784fu }, { 0x8b2dd65b15c4b1f9u, 0x163a432c8f5cd663u },
+    { 0x6df94bf1db35de77u, 0x1bc8d3f7b3340bfcu }, { 0xc4bbcf772901ab0au, 0x115d847ad000877du },
+    { 0x35eac354f34215cdu, 0x15b4e5998400a95du }, { 0x8365742a30129b40u, 0x1b221effe500d3b4u },
+    { 0xd21f689a5e0ba108u, 0x10f5535fef208450u }, { 0x06a742c0f58e894au, 0x1532a837eae8a565u },
+    { 0x4851137132f22b9du, 0x1a7f5245e5a2cebeu }, { 0xed32ac26bfd75b42u, 0x108f936baf85c136u },
+    { 0xa87f57306fcd3212u, 0x14b378469b673184u }, { 0xd29f2cfc8bc07e97u, 0x19e056584240fde5u },
+    { 0xa3a37c1dd7584f1eu, 0x102c35f729689eafu }, { 0x8c8c5b254d2e62e6u, 0x14374374f3c2c65bu },
+    { 0x6faf71eea079fb9fu, 0x1945145230b377f2u }, { 0x0b9b4e6a48987a87u, 0x1f965966bce055efu },
+    { 0x674111026d5f4c94u, 0x13bdf7e0360c35b5u }, { 0xc111554308b71fbau, 0x18ad75d8438f4322u },
+    { 0x7155aa93cae4e7a8u, 0x1ed8d34e547313ebu }, { 0x26d58a9c5ecf10c9u, 0x13478410f4c7ec73u },
+    { 0xf08aed437682d4fbu, 0x1819651531f9e78fu }, { 0xecada89454238a3au, 0x1e1fbe5a7e786173u },
+    { 0x73ec895cb4963664u, 0x12d3d6f88f0b3ce8u }, { 0x90e7abb3e1bbc3fdu, 0x1788ccb6b2ce0c22u },
+    { 0x352196a0da2ab4fdu, 0x1d6affe45f818f2bu }, { 0x0134fe24885ab11eu, 0x1262dfeebbb0f97bu },
+    { 0xc1823dadaa715d65u, 0x16fb97ea6a9d37d9u }, { 0x31e2cd19150db4bfu, 0x1cba7de5054485d0u },
+    { 0x1f2dc02fad2890f7u, 0x11f48eaf234ad3a2u }, { 0xa6f9303b9872b535u, 0x1671b25aec1d888au },
+    { 0x50b77c4a7e8f6282u, 0x1c0e1ef1a724eaadu }, { 0x5272adae8f199d91u, 0x1188d357087712acu },
+    { 0x670f591a32e004f6u, 0x15eb082cca94d757u }, { 0x40d32f60bf980633u, 0x1b65ca37fd3a0d2du },
+    { 0x4883fd9c77bf03e0u, 0x111f9e62fe44483cu }, { 0x5aa4fd0395aec4d8u, 0x156785fbbdd55a4bu },
+    { 0x314e3c447b1a760eu, 0x1ac1677aad4ab0deu }, { 0xded0e5aaccf089c9u, 0x10b8e0acac4eae8au },
+    { 0x96851f15802cac3bu, 0x14e718d7d7625a2du }, { 0xfc2666dae037d74au, 0x1a20df0dcd3af0b8u },
+    { 0x9d980048cc22e68eu, 0x10548b68a044d673u }, { 0x84fe005aff2ba032u, 0x1469ae42c8560c10u },
+    { 0xa63d8071bef6883eu, 0x198419d37a6b8f14u }, { 0xcfcce08e2eb42a4eu, 0x1fe52048590672d9u },
+    { 0x21e00c58dd309a70u, 0x13ef342d37a407c8u }, { 0x2a580f6f147cc10du, 0x18eb0138858d09bau },
+    { 0xb4ee134ad99bf150u, 0x1f25c186a6f04c28u }, { 0x7114cc0ec80176d2u, 0x137798f428562f99u },
+    { 0xcd59ff127a01d486u, 0x18557f31326bbb7fu }, { 0xc0b07ed7188249a8u, 0x1e6adefd7f06aa5fu },
+    { 0xd86e4f466f516e09u, 0x1302cb5e6f642a7bu }, { 0xce89e3180b25c98bu, 0x17c37e360b3d351au },
+    { 0x822c5bde0def3beeu, 0x1db45dc38e0c8261u }, { 0xf15bb96ac8b58575u, 0x1290ba9a38c7d17cu },
+    { 0x2db2a7c57ae2e6d2u, 0x1734e940c6f9c5dcu }, { 0x391f51b6d99ba086u, 0x1d022390f8b83753u },
+    { 0x03b3931248014454u, 0x1221563a9b732294u }, { 0x04a077d6da019569u, 0x16a9abc9424feb39u },
+    { 0x45c895cc9081fac3u, 0x1c5416bb92e3e607u }, { 0x8b9d5d9fda513cbau, 0x11b48e353bce6fc4u },
+    { 0xae84b507d0e58be8u, 0x1621b1c28ac20bb5u }, { 0x1a25e249c51eeee3u, 0x1baa1e332d728ea3u },
+    { 0xf057ad6e1b33554du, 0x114a52dffc679925u }, { 0x6c6d98c9a2002aa1u, 0x159ce797fb817f6fu },
+    { 0x4788fefc0a803549u, 0x1b04217dfa61df4bu }, { 0x0cb59f5d8690214eu, 0x10e294eebc7d2b8fu },
+    { 0xcfe30734e83429a1u, 0x151b3a2a6b9c7672u }, { 0x83dbc9022241340au, 0x1a6208b50683940fu },
+    { 0xb2695da15568c086u, 0x107d457124123c89u }, { 0x1f03b509aac2f0a7u, 0x149c96cd6d16cbacu },
+    { 0x26c4a24c1573acd1u, 0x19c3bc80c85c7e97u }, { 0x783ae56f8d684c03u, 0x101a55d07d39cf1eu },
+    { 0x16499ecb70c25f03u, 0x1420eb449c8842e6u }, { 0x9bdc067e4cf2f6c4u, 0x19292615c3aa539fu },
+    { 0x82d3081de02fb476u, 0x1f736f9b3494e887u }, { 0xb1c3e512ac1dd0c9u, 0x13a825c100dd1154u },
+    { 0xde34de57572544fcu, 0x18922f31411455a9u }, { 0x55c215ed2cee963bu, 0x1eb6bafd91596b14u },
+    { 0xb5994db43c151de5u, 0x133234de7ad7e2ecu }, { 0xe2ffa1214b1a655eu, 0x17fec216198ddba7u },
+    { 0xdbbf89699de0feb6u, 0x1dfe729b9ff15291u }, { 0x2957b5e202ac9f31u, 0x12bf07a143f6d39bu },
+    { 0xf3ada35a8357c6feu, 0x176ec98994f48881u }, { 0x70990c31242db8bdu, 0x1d4a7bebfa31aaa2u },
+    { 0x865fa79eb69c9376u, 0x124e8d737c5f0aa5u }, { 0xe7f791866443b854u, 0x16e230d05b76cd4eu },
+    { 0xa1f575e7fd54a669u, 0x1c9abd04725480a2u }, { 0xa53969b0fe54e801u, 0x11e0b622c774d065u },
+    { 0x0e87c41d3dea2202u, 0x1658e3ab7952047fu }, { 0xd229b5248d64aa82u, 0x1bef1c9657a6859eu },
+    { 0x435a1136d85eea91u, 0x117571ddf6c81383u }, { 0x143095848e76a536u, 0x15d2ce55747a1864u },
+    { 0x193cbae5b2144e83u, 0x1b4781ead1989e7du }, { 0x2fc5f4cf8f4cb112u, 0x110cb132c2ff630eu },
+    { 0xbbb77203731fdd56u, 0x154fdd7f73bf3bd1u }, { 0x2aa54e844fe7d4acu, 0x1aa3d4df50af0ac6u },
+    { 0xdaa75112b1f0e4ebu, 0x10a6650b926d66bbu }, { 0xd15125575e6d1e26u, 0x14cffe4e7708c06au },
+    { 0x85a56ead360865b0u, 0x1a03fde214caf085u }, { 0x7387652c41c53f8eu, 0x10427ead4cfed653u },
+    { 0x50693e7752368f71u, 0x14531e58a03e8be8u }, { 0x64838e1526c4334eu, 0x1967e5eec84e2ee2u },
+    { 0xfda4719a70754022u, 0x1fc1df6a7a61ba9au }, { 0xde86c70086494815u, 0x13d92ba28c7d14a0u },
+    { 0x162878c0a7db9a1au, 0x18cf768b2f9c59c9u }, { 0x5bb296f0d1d280a1u, 0x1f03542dfb83703bu },
+    { 0x194f9e5683239064u, 0x1362149cbd322625u }, { 0x5fa385ec23ec747eu, 0x183a99c3ec7eafaeu },
+    { 0xf78c67672ce7919du, 0x1e494034e79e5b99u }, { 0x3ab7c0a07c10bb02u, 0x12edc82110c2f940u },
+    { 0x4965b0c89b14e9c3u, 0x17a93a2954f3b790u }, { 0x5bbf1cfac1da2433u, 0x1d9388b3aa30a574u },
+    { 0xb957721cb92856a0u, 0x127c35704a5e6768u }, { 0xe7ad4ea3e7726c48u, 0x171b42cc5cf60142u },
+    { 0xa198a24ce14f075au, 0x1ce2137f74338193u }, { 0x44ff65700cd16498u, 0x120d4c2fa8a030fcu },
+    { 0x563f3ecc1005bdbeu, 0x16909f3b92c83d3bu }, { 0x2bcf0e7f14072d2eu, 0x1c34c70a777a4c8au },
+    { 0x5b61690f6c847c3du, 0x11a0fc668aac6fd6u }, { 0xf239c35347a59b4cu, 0x16093b802d578bcbu },
+    { 0xeec83428198f021fu, 0x1b8b8a6038ad6ebeu }, { 0x553d20990ff96153u, 0x1137367c236c6537u },
+    { 0x2a8c68bf53f7b9a8u, 0x1585041b2c477e85u }, { 0x752f82ef28f5a812u, 0x1ae64521f7595e26u },
+    { 0x093db1d57999890bu, 0x10cfeb353a97dad8u }, { 0x0b8d1e4ad7ffeb4eu, 0x1503e602893dd18eu },
+    { 0x8e7065dd8dffe622u, 0x1a44df832b8d45f1u }, { 0xf9063faa78bfefd5u, 0x106b0bb1fb384bb6u },
+    { 0xb747cf9516efebcau, 0x1485ce9e7a065ea4u }, { 0xe519c37a5cabe6bdu, 0x19a742461887f64du },
+    { 0xaf301a2c79eb7036u, 0x1008896bcf54f9f0u }, { 0xdafc20b798664c43u, 0x140aabc6c32a386cu },
+    { 0x11bb28e57e7fdf54u, 0x190d56b873f4c688u }, { 0x1629f31ede1fd72au, 0x1f50ac6690f1f82au },
+    { 0x4dda37f34ad3e67au, 0x13926bc01a973b1au }, { 0xe150c5f01d88e019u, 0x187706b0213d09e0u },
+    { 0x19a4f76c24eb181fu, 0x1e94c85c298c4c59u }, { 0xb0071aa39712ef13u, 0x131cfd3999f7afb7u },
+    { 0x9c08e14c7cd7aad8u, 0x17e43c8800759ba5u }, { 0x030b199f9c0d958eu, 0x1ddd4baa0093028fu },
+    { 0x61e6f003c1887d79u, 0x12aa4f4a405be199u }, { 0xba60ac04b1ea9cd7u, 0x1754e31cd072d9ffu },
+    { 0xa8f8d705de65440du, 0x1d2a1be4048f907fu }, { 0xc99b8663aaff4a88u, 0x123a516e82d9ba4fu },
+    { 0xbc0267fc95bf1d2au, 0x16c8e5ca239028e3u }, { 0xab0301fbbb2ee474u, 0x1c7b1f3cac74331cu },
+    { 0xeae1e13d54fd4ec9u, 0x11ccf385ebc89ff1u }, { 0x659a598caa3ca27bu, 0x1640306766bac7eeu },
+    { 0xff00efefd4cbcb1au, 0x1bd03c81406979e9u }, { 0x3f6095f5e4ff5ef0u, 0x116225d0c841ec32u },
+    { 0xcf38bb735e3f36acu, 0x15baaf44fa52673eu }, { 0x8306ea5035cf0457u, 0x1b295b1638e7010eu },
+    { 0x11e4527221a162b6u, 0x10f9d8ede39060a9u }, { 0x565d670eaa09bb64u, 0x15384f295c7478d3u },
+    { 0x2bf4c0d2548c2a3du, 0x1a8662f3b3919708u }, { 0x1b78f88374d79a66u, 0x1093fdd8503afe65u },
+    { 0x625736a4520d8100u, 0x14b8fd4e6449bdfeu }, { 0xfaed044d6690e140u, 0x19e73ca1fd5c2d7du },
+    { 0xbcd422b0601a8cc8u, 0x103085e53e599c6eu }, { 0x6c092b5c78212ffau, 0x143ca75e8df0038au },
+    { 0x070b763396297bf8u, 0x194bd136316c046du }, { 0x48ce53c07bb3daf6u, 0x1f9ec583bdc70588u },
+    { 0x2d80f4584d5068dau, 0x13c33b72569c6375u }, { 0x78e1316e60a48310u, 0x18b40a4eec437c52u },
+};
+static const uint64_t thor_float_pow5_inv[31] = {
+    0x0800000000000001u, 0x0666666666666667u, 0x051eb851eb851eb9u, 0x04189374bc6a7efau,
+    0x068db8bac710cb2au, 0x053e2d6238da3c22u, 0x0431bde82d7b634eu, 0x06b5fca6af2bd216u,
+    0x055e63b88c230e78u, 0x044b82fa09b5a52du, 0x06df37f675ef6eaeu, 0x057f5ff85e592558u,
+    0x0465e6604b7a8447u, 0x0709709a125da071u, 0x05a126e1a84ae6c1u, 0x0480ebe7b9d58567u,
+    0x0734aca5f6226f0bu, 0x05c3bd5191b525a3u, 0x049c97747490eae9u, 0x0760f253edb4ab0eu,
+    0x05e72843249088d8u, 0x04b8ed0283a6d3e0u, 0x078e480405d7b966u, 0x060b6cd004ac9452u,
+    0x04d5f0a66a23a9dbu, 0x07bcb43d769f762bu, 0x063090312bb2c4efu, 0x04f3a68dbc8f03f3u,
+    0x07ec3daf94180651u, 0x065697bfa9acd1dau, 0x051212ffbaf0a7e2u,
+};
+static const uint64_t thor_float_pow5[48] = {
+    0x1000000000000000u, 0x1400000000000000u, 0x1900000000000000u, 0x1f40000000000000u,
+    0x1388000000000000u, 0x186a000000000000u, 0x1e84800000000000u, 0x1312d00000000000u,
+    0x17d7840000000000u, 0x1dcd650000000000u, 0x12a05f2000000000u, 0x174876e800000000u,
+    0x1d1a94a200000000u, 0x12309ce540000000u, 0x16bcc41e90000000u, 0x1c6bf52634000000u,
+    0x11c37937e0800000u, 0x16345785d8a00000u, 0x1bc16d674ec80000u, 0x1158e460913d0000u,
+    0x15af1d78b58c4000u, 0x1b1ae4d6e2ef5000u, 0x10f0cf064dd59200u, 0x152d02c7e14af680u,
+    0x1a784379d99db420u, 0x108b2a2c28029094u, 0x14adf4b7320334b9u, 0x19d971e4fe8401e7u,
+    0x1027e72f1f128130u, 0x1431e0fae6d7217cu, 0x193e5939a08ce9dbu, 0x1f8def8808b02452u,
+    0x13b8b5b5056e16b3u, 0x18a6e32246c99c60u, 0x1ed09bead87c0378u, 0x13426172c74d822bu,
+    0x1812f9cf7920e2b6u, 0x1e17b84357691b64u, 0x12ced32a16a1b11eu, 0x178287f49c4a1d66u,
+    0x1d6329f1c35ca4bfu, 0x125dfa371a19e6f7u, 0x16f578c4e0a060b5u, 0x1cb2d6f618c878e3u,
+    0x11efc659cf7d4b8du, 0x166bb7f0435c9e71u, 0x1c06a5ec5433c60du, 0x118427b3b4a05bc8u,
+};
+
+static uint32_t thor_pow5bits(int32_t e) {
+    return (uint32_t)(((e * 1217359) >> 19) + 1);
+}
+
+static uint32_t thor_log10_pow2(int32_t e) {
+    return (uint32_t)((e * 78913) >> 18);
+}
+
+static uint32_t thor_log10_pow5(int32_t e) {
+    return (uint32_t)((e * 732923) >> 20);
+}
+
+static uint32_t thor_pow5_factor(uint64_t value) {
+    uint32_t count = 0;
+    while (value % 5 == 0) {
+        value /= 5;
+        count++;
+    }
+    return count;
+}
+
+// The high bits of m * mul (a 128-bit factor), shifted right by j >= 64
+static uint64_t thor_mul_shift64(uint64_t m, const uint64_t* mul, int32_t j) {
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 low = (unsigned __int128)m * mul[0];
+    unsigned __int128 high = (unsigned __int128)m * mul[1];
+    return (uint64_t)(((low >> 64) + high) >> (j - 64));
+#else
+    // 64x128-bit product from 32-bit halves
+    uint64_t m0 = (uint32_t)m, m1 = m >> 32;
+    uint64_t a0 = (uint32_t)mul[0], a1 = mul[0] >> 32;
+    uint64_t b0 = (uint32_t)mul[1], b1 = mul[1] >> 32;
+    uint64_t p00 = m0 * a0, p01 = m0 * a1, p10 = m1 * a0, p11 = m1 * a1;
+    uint64_t mid = (p00 >> 32) + (uint32_t)p01 + (uint32_t)p10;
+    uint64_t lowHigh = (mid >> 32) + (p01 >> 32) + (p10 >> 32) + p11; // (m * mul[0]) >> 64
+    uint64_t q00 = m0 * b0, q01 = m0 * b1, q10 = m1 * b0, q11 = m1 * b1;
+    uint64_t word0 = (q00 & 0xffffffffu) + (lowHigh & 0xffffffffu);
+    uint64_t word1 = (q00 >> 32) + (uint32_t)q01 + (uint32_t)q10 + (lowHigh >> 32) + (word0 >> 32);
+    uint64_t word2 = (word1 >> 32) + (q01 >> 32) + (q10 >> 32) + (uint32_t)q11;
+    uint64_t word3 = (word2 >> 32) + (q11 >> 32);
+    // sum = word3:word2:word1:word0 in 32-bit words; shift right by j - 64
+    uint64_t sumLow = ((word1 & 0xffffffffu) << 32) | (word0 & 0xffffffffu);
+    uint64_t sumHigh = ((word3 & 0xffffffffu) << 32) | (word2 & 0xffffffffu);
+    int32_t shift = j - 64;
+    return shift == 0 ? sumLow : (sumLow >> shift) | (sumHigh << (64 - shift));
+#endif
+}
+
+// Shortest digits and decimal exponent of a finite, positive double
+static uint64_t thor_shortest_double(uint64_t bits, int32_t* exponent) {
+    uint64_t ieeeMantissa = bits & ((1ULL << 52) - 1);
+    uint32_t ieeeExponent = (uint32_t)(bits >> 52) & 0x7ff;
+    int32_t e2;
+    uint64_t m2;
+    if (ieeeExponent == 0) {
+        e2 = 1 - 1023 - 52 - 2;
+        m2 = ieeeMantissa;
+    } else {
+        e2 = (int32_t)ieeeExponent - 1023 - 52 - 2;
+        m2 = (1ULL << 52) | ieeeMantissa;
+    }
+    int acceptBounds = (m2 & 1) == 0;
+    uint64_t mv = 4 * m2;
+    uint32_t mmShift = ieeeMantissa != 0 || ieeeExponent <= 1;
+    uint64_t vr, vp, vm;
+    int32_t e10;
+    int vmIsTrailingZeros = 0, vrIsTrailingZeros = 0;
+
+    if (e2 >= 0) {
+        uint32_t q = thor_log10_pow2(e2) - (e2 > 3);
+        int32_t k = 125 + (int32_t)thor_pow5bits((int32_t)q) - 1;
+        int32_t i = -e2 + (int32_t)q + k;
+        e10 = (int32_t)q;
+        vr = thor_mul_shift64(4 * m2, thor_double_pow5_inv[q], i);
+        vp = thor_mul_shift64(4 * m2 + 2, thor_double_pow5_inv[q], i);
+        vm = thor_mul_shift64(4 * m2 - 1 - mmShift, thor_double_pow5_inv[q], i);
+        if (q <= 21) {
+            if (mv % 5 == 0) {
+                vrIsTrailingZeros = thor_pow5_factor(mv) >= q;
+            } else if (acceptBounds) {
+                vmIsTrailingZeros = thor_pow5_factor(mv - 1 - mmShift) >= q;
+            } else {
+                vp -= thor_pow5_factor(mv + 2) >= q;
+            }
+        }
+    } else {
+        uint32_t q = thor_log10_pow5(-e2) - (-e2 > 1);
+        int32_t i = -e2 - (int32_t)q;
+        int32_t k = (int32_t)thor_pow5bits(i) - 125;
+        int32_t j = (int32_t)q - k;
+        e10 = (int32_t)q + e2;
+        vr = thor_mul_shift64(4 * m2, thor_double_pow5[i], j);
+        vp = thor_mul_shift64(4 * m2 + 2, thor_double_pow5[i], j);
+        vm = thor_mul_shift64(4 * m2 - 1 - mmShift, thor_double_pow5[i], j);
+        if (q <= 1) {
+            vrIsTrailingZeros = 1;
+            if (acceptBounds) {
+                vmIsTrailingZeros = mmShift == 1;
+            } else {
+                vp--;
+            }
+        } else if (q < 63) {
+            vrIsTrailingZeros = (mv & ((1ULL << q) - 1)) == 0;
+        }
+    }
+
+    int32_t removed = 0;
+    uint64_t output;
+    if (vmIsTrailingZeros || vrIsTrailingZeros) {
+        // Rare: the interval ends are exact, so ties need care
+        uint32_t lastRemovedDigit = 0;
+        while (vp / 10 > vm / 10) {
+            vmIsTrailingZeros &= vm % 10 == 0;
+            vrIsTrailingZeros &= lastRemovedDigit == 0;
+            lastRemovedDigit = (uint32_t)(vr % 10);
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        if (vmIsTrailingZeros) {
+            while (vm % 10 == 0) {
+                vrIsTrailingZeros &= lastRemovedDigit == 0;
+                lastRemovedDigit = (uint32_t)(vr % 10);
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+                removed++;
+            }
+        }
+        if (vrIsTrailingZeros && lastRemovedDigit == 5 && vr % 2 == 0) {
+            lastRemovedDigit = 4; // round half to even
+        }
+        output = vr + ((vr == vm && (!acceptBounds || !vmIsTrailingZeros)) || lastRemovedDigit >= 5);
+    } else {
+        int roundUp = 0;
+        if (vp / 100 > vm / 100) {
+            roundUp = vr % 100 >= 50;
+            vr /= 100;
+            vp /= 100;
+            vm /= 100;
+            removed += 2;
+        }
+        while (vp / 10 > vm / 10) {
+            roundUp = vr % 10 >= 5;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        output = vr + (vr == vm || roundUp);
+    }
+    *exponent = e10 + removed;
+    return output;
+}
+
+static uint32_t thor_mul_shift32(uint32_t m, uint64_t factor, int32_t shift) {
+    uint64_t low = (uint64_t)m * (uint32_t)factor;
+    uint64_t high = (uint64_t)m * (factor >> 32);
+    return (uint32_t)(((low >> 32) + high) >> (shift - 32));
+}
+
+// Shortest digits and decimal exponent of a finite, positive float
+static uint32_t thor_shortest_float(uint32_t bits, int32_t* exponent) {
+    uint32_t ieeeMantissa = bits & ((1u << 23) - 1);
+    uint32_t ieeeExponent = (bits >> 23) & 0xff;
+    int32_t e2;
+    uint32_t m2;
+    if (ieeeExponent == 0) {
+        e2 = 1 - 127 - 23 - 2;
+        m2 = ieeeMantissa;
+    } else {
+        e2 = (int32_t)ieeeExponent - 127 - 23 - 2;
+        m2 = (1u << 23) | ieeeMantissa;
+    }
+    int acceptBounds = (m2 & 1) == 0;
+    uint32_t mv = 4 * m2;
+    uint32_t mp = 4 * m2 + 2;
+    uint32_t mmShift = ieeeMantissa != 0 || ieeeExponent <= 1;
+    uint32_t mm = 4 * m2 - 1 - mmShift;
+    uint32_t vr, vp, vm;
+    int32_t e10;
+    int vmIsTrailingZeros = 0, vrIsTrailingZeros = 0;
+    uint32_t lastRemovedDigit = 0;
+
+    if (e2 >= 0) {
+        uint32_t q = thor_log10_pow2(e2);
+        int32_t k = 59 + (int32_t)thor_pow5bits((int32_t)q) - 1;
+        int32_t i = -e2 + (int32_t)q + k;
+        e10 = (int32_t)q;
+        vr = thor_mul_shift32(mv, thor_float_pow5_inv[q], i);
+        vp = thor_mul_shift32(mp, thor_float_pow5_inv[q], i);
+        vm = thor_mul_shift32(mm, thor_float_pow5_inv[q], i);
+        if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+            // The loop below removes no digit, but rounding needs the last one
+            int32_t l = 59 + (int32_t)thor_pow5bits((int32_t)(q - 1)) - 1;
+            lastRemovedDigit = thor_mul_shift32(mv, thor_float_pow5_inv[q - 1], -e2 + (int32_t)q - 1 + l) % 10;
+        }
+        if (q <= 9) {
+            if (mv % 5 == 0) {
+                vrIsTrailingZeros = thor_pow5_factor(mv) >= q;
+            } else if (acceptBounds) {
+                vmIsTrailingZeros = thor_pow5_factor(mm) >= q;
+            } else {
+                vp -= thor_pow5_factor(mp) >= q;
+            }
+        }
+    } else {
+        uint32_t q = thor_log10_pow5(-e2);
+        int32_t i = -e2 - (int32_t)q;
+        int32_t k = (int32_t)thor_pow5bits(i) - 61;
+        int32_t j = (int32_t)q - k;
+        e10 = (int32_t)q + e2;
+        vr = thor_mul_shift32(mv, thor_float_pow5[i], j);
+        vp = thor_mul_shift32(mp, thor_float_pow5[i], j);
+        vm = thor_mul_shift32(mm, thor_float_pow5[i], j);
+        if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+            j = (int32_t)q - 1 - ((int32_t)thor_pow5bits(i + 1) - 61);
+            lastRemovedDigit = thor_mul_shift32(mv, thor_float_pow5[i + 1], j) % 10;
+        }
+        if (q <= 1) {
+            vrIsTrailingZeros = 1;
+            if (acceptBounds) {
+                vmIsTrailingZeros = mmShift == 1;
+            } else {
+                vp--;
+            }
+        } else if (q < 31) {
+            vrIsTrailingZeros = (mv & ((1u << (q - 1)) - 1)) == 0;
+        }
+    }
+
+    int32_t removed = 0;
+    uint32_t output;
+    if (vmIsTrailingZeros || vrIsTrailingZeros) {
+        while (vp / 10 > vm / 10) {
+            vmIsTrailingZeros &= vm % 10 == 0;
+            vrIsTrailingZeros &= lastRemovedDigit == 0;
+            lastRemovedDigit = vr % 10;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        if (vmIsTrailingZeros) {
+            while (vm % 10 == 0) {
+                vrIsTrailingZeros &= lastRemovedDigit == 0;
+                lastRemovedDigit = vr % 10;
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+                removed++;
+            }
+        }
+        if (vrIsTrailingZeros && lastRemovedDigit == 5 && vr % 2 == 0) {
+            lastRemovedDigit = 4;
+        }
+        output = vr + ((vr == vm && (!acceptBounds || !vmIsTrailingZeros)) || lastRemovedDigit >= 5);
+    } else {
+        while (vp / 10 > vm / 10) {
+            lastRemovedDigit = vr % 10;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        output = vr + (vr == vm || lastRemovedDigit >= 5);
+    }
+    *exponent = e10 + removed;
+    return output;
+}
+
+// Lays out digits * 10^exponent like JavaScript numbers: plain decimals from
+// 1e-6 up to 1e21, scientific notation ("1.5e+300") outside that range
+static char* thor_format_decimal(char* out, uint64_t digits, int32_t exponent) {
+    char buffer[20];
+    int32_t count = (int32_t)(thor_format_int(buffer, (long long)digits) - buffer);
+    int32_t point = count + exponent; // digits before the decimal point
+    if (point > 0 && point <= 21) {
+        if (exponent >= 0) {
+            memcpy(out, buffer, (size_t)count);
+            memset(out + count, '0', (size_t)exponent);
+            return out + point;
+        }
+        memcpy(out, buffer, (size_t)point);
+        out[point] = '.';
+        memcpy(out + point + 1, buffer + point, (size_t)(count - point));
+        return out + count + 1;
+    }
+    if (point <= 0 && point > -6) {
+        out[0] = '0';
+        out[1] = '.';
+        memset(out + 2, '0', (size_t)-point);
+        memcpy(out + 2 - point, buffer, (size_t)count);
+        return out + 2 - point + count;
+    }
+    *out++ = buffer[0];
+    if (count > 1) {
+        *out++ = '.';
+        memcpy(out, buffer + 1, (size_t)(count - 1));
+        out += count - 1;
+    }
+    *out++ = 'e';
+    *out++ = point - 1 < 0 ? '-' : '+';
+    return thor_format_int(out, point - 1 < 0 ? 1 - point : point - 1);
+}
+
+char* thor_format_double(char* out, double value) {
+    uint64_t bits;
+    int32_t exponent;
+    memcpy(&bits, &value, sizeof(bits));
+    if (bits >> 63) {
+        *out++ = '-';
+    }
+    if (((bits >> 52) & 0x7ff) == 0x7ff) {
+        memcpy(out, (bits & ((1ULL << 52) - 1)) ? "nan" : "inf", 3);
+        return out + 3;
+    }
+    if ((bits << 1) == 0) {
+        *out = '0';
+        return out + 1;
+    }
+    uint64_t digits = thor_shortest_double(bits, &exponent);
+    return thor_format_decimal(out, digits, exponent);
+}
+
+char* thor_format_float(char* out, float value) {
+    uint32_t bits;
+    int32_t exponent;
+    memcpy(&bits, &value, sizeof(bits));
+    if (bits >> 31) {
+        *out++ = '-';
+    }
+    if (((bits >> 23) & 0xff) == 0xff) {
+        memcpy(out, (bits & ((1u << 23) - 1)) ? "nan" : "inf", 3);
+        return out + 3;
+    }
+    if ((bits << 1) == 0) {
+        *out = '0';
+        return out + 1;
+    }
+    uint32_t digits = thor_shortest_float(bits, &exponent);
+    return thor_format_decimal(out, digits, exponent);
+}
+
+// Typed formatting, which format expressions with known argument types compile
+// to: `types` has a letter for each %s in `format`, saying how the argument was
+// passed - 'i' long long, 'd' double, 'f' float (passed as double), 's' string,
+// 'v' str view, 'b' bool (passed as int). "%%" stands for a single '%'.
+size_t thor_format_length(const char* format, const char* types, va_list args) {
+    size_t length = 0;
+    for (; *format; format++) {
+        if (format[0] == '%' && (format[1] == '%' || format[1] == 's')) {
+            if (*++format == '%') {
+                length++;
+                continue;
+            }
+            switch (*types++) {
+                case 'i': (void)va_arg(args, long long); length += 20; break;
+                case 'd': case 'f': (void)va_arg(args, double); length += 25; break;
+                case 'b': (void)va_arg(args, int); length += 5; break;
+                case 'v': length += (size_t)va_arg(args, thor_str).length; break;
+                default: {
+                    const char* text = va_arg(args, const char*);
+                    length += text ? strlen(text) : 6;
+                }
+            }
+        } else {
+            length++;
+        }
+    }
+    return length;
+}
+
+// Writes the text and its terminator; returns the end of the text
+char* thor_format_write(char* out, const char* format, const char* types, va_list args) {
+    for (; *format; format++) {
+        if (format[0] == '%' && (format[1] == '%' || format[1] == 's')) {
+            if (*++format == '%') {
+                *out++ = '%';
+                continue;
+            }
+            switch (*types++) {
+                case 'i': out = thor_format_int(out, va_arg(args, long long)); break;
+                case 'd': out = thor_format_double(out, va_arg(args, double)); break;
+                case 'f': out = thor_format_float(out, (float)va_arg(args, double)); break;
+                case 'b': {
+                    const char* text = va_arg(args, int) ? "true" : "false";
+                    size_t length = strlen(text);
+                    memcpy(out, text, length);
+                    out += length;
+                    break;
+                }
+                case 'v': {
+                    thor_str view = va_arg(args, thor_str);
+                    memcpy(out, view.data, (size_t)view.length);
+                    out += view.length;
+                    break;
+                }
+                default: {
+                    const char* text = va_arg(args, const char*);
+                    size_t length;
+                    text = text ? text : "(null)";
+                    length = strlen(text);
+                    memcpy(out, text, length);
+                    out += length;
+                }
+            }
+        } else {
+            *out++ = *format;
+        }
+    }
+    *out = '\0';
+    return out;
+}
+
+char* thor_format_values(const char* format, const char* types, ...) {
+    va_list args;
+    va_start(args, types);
+    char* buffer = malloc(thor_format_length(format, types, args) + 1);
+    va_end(args);
+    va_start(args, types);
+    thor_format_write(buffer, format, types, args);
+    va_end(args);
+    return buffer;
+}
+
+#ifdef THOR_TRACK_ALLOCATIONS
+char* thor_format_values_at(thor_alloc_site* site, const char* format, const char* types, ...) {
+    va_list args;
+    va_start(args, types);
+    char* buffer = (char*)thor_alloc(site, thor_format_length(format, types, args) + 1);
+    va_end(args);
+    va_start(args, types);
+    thor_format_write(buffer, format, types, args);
+    va_end(args);
+    return buffer;
+}
+#endif
+)RUNTIME";
+
+// Text kernels for the str operations that search, emitted with them: SSE2 and
+// AVX2 versions on x86-64, picked at startup.
+static const char* TEXT_RUNTIME = R"RUNTIME(// Text kernels: a byte search, a substring search that filters candidates by
+// comparing their first and last bytes a block at a time (W. Mula, "SIMD-
+// friendly algorithms for substring searching") and a byte count. x86-64
+// builds by GCC or Clang run SSE2 versions, or AVX2 versions when CPUID
+// reports AVX2; other builds use the scalar ones. The byte search is memchr
+// with glibc, whose own memchr is vectorized and faster. No kernel reads past
+// the end of its text.
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__) && !defined(__TINYC__)
+#define THOR_TEXT_X86 1
+#include <immintrin.h>
+#if !defined(__GLIBC__)
+#define THOR_TEXT_X86_BYTE 1
+#endif
+#endif
+
+static const char* thor_text_find_byte_scalar(const char* p, size_t n, char c) {
+    return (const char*)memchr(p, c, n);
+}
+
+// Needles have at least two bytes; a single byte goes to find_byte
+static const char* thor_text_find_scalar(const char* p, size_t n, const char* needle, size_t m) {
+    if (n < m) {
+        return NULL;
+    }
+    const char* last = p + n - m;
+    while (p <= last) {
+        p = (const char*)memchr(p, needle[0], (size_t)(last - p) + 1);
+        if (!p) {
+            break;
+        }
+        if (p[m - 1] == needle[m - 1] && memcmp(p + 1, needle + 1, m - 2) == 0) {
+            return p;
+        }
+        p++;
+    }
+    return NULL;
+}
+
+static size_t thor_text_count_byte_scalar(const char* p, size_t n, char c) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++) {
+        count += p[i] == c;
+    }
+    return count;
+}
+
+#ifdef THOR_TEXT_X86
+// Texts of a block or more end with a block that overlaps the one before it
+// rather than with a scalar loop; its bits for bytes already searched are
+// cleared
+#ifdef THOR_TEXT_X86_BYTE
+static const char* thor_text_find_byte_sse2(const char* p, size_t n, char c) {
+    if (n < 16) {
+        return thor_text_find_byte_scalar(p, n, c);
+    }
+    __m128i target = _mm_set1_epi8(c);
+    for (size_t i = 0;; i += 16) {
+        size_t at = i < n - 16 ? i : n - 16;
+        __m128i block = _mm_loadu_si128((const __m128i*)(p + at));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(block, target)) >> (i - at) << (i - at);
+        if (mask) {
+            return p + at + __builtin_ctz(mask);
+        }
+        if (at == n - 16) {
+            return NULL;
+        }
+    }
+}
+#endif
+
+static const char* thor_text_find_sse2(const char* p, size_t n, const char* needle, size_t m) {
+    if (n < m + 15) {
+        return thor_text_find_scalar(p, n, needle, m);
+    }
+    __m128i first = _mm_set1_epi8(needle[0]);
+    __m128i last = _mm_set1_epi8(needle[m - 1]);
+    size_t final = n - m - 15; // the last start a block can have
+    for (size_t i = 0;; i += 16) {
+        size_t start = i < final ? i : final;
+        __m128i a = _mm_loadu_si128((const __m128i*)(p + start));
+        __m128i b = _mm_loadu_si128((const __m128i*)(p + start + m - 1));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+        for (mask = mask >> (i - start) << (i - start); mask; mask &= mask - 1) {
+            size_t at = start + (size_t)__builtin_ctz(mask);
+            if (memcmp(p + at + 1, needle + 1, m - 2) == 0) {
+                return p + at;
+            }
+        }
+        if (start == final) {
+            return NULL;
+        }
+    }
+}
+
+static size_t thor_text_count_byte_sse2(const char* p, size_t n, char c) {
+    __m128i target = _mm_set1_epi8(c);
+    size_t count = 0;
+    while (n >= 16) {
+        // Byte counters, which 255 blocks cannot overflow, summed with psadbw
+        size_t blocks = n / 16 < 255 ? n / 16 : 255;
+        __m128i counters = _mm_setzero_si128();
+        for (size_t b = 0; b < blocks; b++, p += 16) {
+            __m128i block = _mm_loadu_si128((const __m128i*)p);
+            counters = _mm_sub_epi8(counters, _mm_cmpeq_epi8(block, target));
+        }
+        __m128i sums = _mm_sad_epu8(counters, _mm_setzero_si128());
+        count += (size_t)_mm_cvtsi128_si64(sums) + (size_t)_mm_cvtsi128_si64(_mm_unpackhi_epi64(sums, sums));
+        n -= blocks * 16;
+    }
+    return count + thor_text_count_byte_scalar(p, n, c);
+}
+
+#ifdef THOR_TEXT_X86_BYTE
+__attribute__((target("avx2")))
+static const char* thor_text_find_byte_avx2(const char* p, size_t n, char c) {
+    if (n < 32) {
+        return thor_text_find_byte_sse2(p, n, c);
+    }
+    __m256i target = _mm256_set1_epi8(c);
+    for (size_t i = 0;; i += 32) {
+        size_t at = i < n - 32 ? i : n - 32;
+        __m256i block = _mm256_loadu_si256((const __m256i*)(p + at));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, target));
+        mask = mask >> (i - at) << (i - at);
+        if (mask) {
+            return p + at + __builtin_ctz(mask);
+        }
+        if (at == n - 32) {
+            return NULL;
+        }
+    }
+}
+#endif
+
+__attribute__((target("avx2")))
+static const char* thor_text_find_avx2(const char* p, size_t n, const char* needle, size_t m) {
+    if (n < m + 31) {
+        return thor_text_find_sse2(p, n, needle, m);
+    }
+    __m256i first = _mm256_set1_epi8(needle[0]);
+    __m256i last = _mm256_set1_epi8(needle[m - 1]);
+    size_t final = n - m - 31;
+    for (size_t i = 0;; i += 32) {
+        size_t start = i < final ? i : final;
+        __m256i a = _mm256_loadu_si256((const __m256i*)(p + start));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(p + start + m - 1));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last)));
+        for (mask = mask >> (i - start) << (i - start); mask; mask &= mask - 1) {
+            size_t at = start + (size_t)__builtin_ctz(mask);
+            if (memcmp(p + at + 1, needle + 1, m - 2) == 0) {
+                return p + at;
+            }
+        }
+        if (start == final) {
+            return NULL;
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+static size_t thor_text_count_byte_avx2(const char* p, size_t n, char c) {
+    __m256i target = _mm256_set1_epi8(c);
+    size_t count = 0;
+    while (n >= 32) {
+        size_t blocks = n / 32 < 255 ? n / 32 : 255;
+        __m256i counters = _mm256_setzero_si256();
+        for (size_t b = 0; b < blocks; b++, p += 32) {
+            __m256i block = _mm256_loadu_si256((const __m256i*)p);
+            counters = _mm256_sub_epi8(counters, _mm256_cmpeq_epi8(block, target));
+        }
+        __m256i sums = _mm256_sad_epu8(counters, _mm256_setzero_si256());
+        __m128i half = _mm_add_epi64(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+        count += (size_t)_mm_cvtsi128_si64(half) + (size_t)_mm_cvtsi128_si64(_mm_unpackhi_epi64(half, half));
+        n -= blocks * 32;
+    }
+    return count + thor_text_count_byte_sse2(p, n, c);
+}
+#endif
+
+static struct {
+    const char* (*find_byte)(const char* p, size_t n, char c);
+    const char* (*find)(const char* p, size_t n, const char* needle, size_t m);
+    size_t (*count_byte)(const char* p, size_t n, char c);
+} thor_text_kernels = {
+#if defined(THOR_TEXT_X86_BYTE)
+    thor_text_find_byte_sse2, thor_text_find_sse2, thor_text_count_byte_sse2
+#elif defined(THOR_TEXT_X86)
+    thor_text_find_byte_scalar, thor_text_find_sse2, thor_text_count_byte_sse2
+#else
+    thor_text_find_byte_scalar, thor_text_find_scalar, thor_text_count_byte_scalar
+#endif
+};
+
+#ifdef THOR_TEXT_X86
+__attribute__((constructor)) static void thor_text_select(void) {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+#ifdef THOR_TEXT_X86_BYTE
+        thor_text_kernels.find_byte = thor_text_find_byte_avx2;
+#endif
+        thor_text_kernels.find = thor_text_find_avx2;
+        thor_text_kernels.count_byte = thor_text_count_byte_avx2;
+    }
+}
+#endif
+)RUNTIME";
+
+// Number parsing, emitted for programs that call one of std.parse_int and
+// std.parse_float on strings, and std.read_int, std.read_float and
+// std.has_next on a tokenizer over standard input.
+static const char* NUMBER_PARSE_RUNTIME = R"RUNTIME(#include <stdint.h>
+
+// Number parsing: digits eight at a time with SWAR where eight bytes can be
+// read, and floats rounded exactly with the Eisel-Lemire algorithm (Lemire
+// 2021), falling back to strtof for the rare long inputs it cannot decide
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ || \
+    defined(_M_X64) || defined(_M_IX86) || defined(_M_ARM64)
+#define THOR_PARSE_SWAR 1
+#endif
+#include <limits.h>
+
+static const uint64_t thor_float_parse_pow5[103][2] = {
+    { 0x3f2398d747b36224u, 0xa87fea27a539e9a5u }, { 0x8eec7f0d19a03aadu, 0xd29fe4b18e88640eu },
+    { 0x1953cf68300424acu, 0x83a3eeeef9153e89u }, { 0x5fa8c3423c052dd7u, 0xa48ceaaab75a8e2bu },
+    { 0x3792f412cb06794du, 0xcdb02555653131b6u }, { 0xe2bbd88bbee40bd0u, 0x808e17555f3ebf11u },
+    { 0x5b6aceaeae9d0ec4u, 0xa0b19d2ab70e6ed6u }, { 0xf245825a5a445275u, 0xc8de047564d20a8bu },
+    { 0xeed6e2f0f0d56712u, 0xfb158592be068d2eu }, { 0x55464dd69685606bu, 0x9ced737bb6c4183du },
+    { 0xaa97e14c3c26b886u, 0xc428d05aa4751e4cu }, { 0xd53dd99f4b3066a8u, 0xf53304714d9265dfu },
+    { 0xe546a8038efe4029u, 0x993fe2c6d07b7fabu }, { 0xde98520472bdd033u, 0xbf8fdb78849a5f96u },
+    { 0x963e66858f6d4440u, 0xef73d256a5c0f77cu }, { 0xdde7001379a44aa8u, 0x95a8637627989aadu },
+    { 0x5560c018580d5d52u, 0xbb127c53b17ec159u }, { 0xaab8f01e6e10b4a6u, 0xe9d71b689dde71afu },
+    { 0xcab3961304ca70e8u, 0x9226712162ab070du }, { 0x3d607b97c5fd0d22u, 0xb6b00d69bb55c8d1u },
+    { 0x8cb89a7db77c506au, 0xe45c10c42a2b3b05u }, { 0x77f3608e92adb242u, 0x8eb98a7a9a5b04e3u },
+    { 0x55f038b237591ed3u, 0xb267ed1940f1c61cu }, { 0x6b6c46dec52f6688u, 0xdf01e85f912e37a3u },
+    { 0x2323ac4b3b3da015u, 0x8b61313bbabce2c6u }, { 0xabec975e0a0d081au, 0xae397d8aa96c1b77u },
+    { 0x96e7bd358c904a21u, 0xd9c7dced53c72255u }, { 0x7e50d64177da2e54u, 0x881cea14545c7575u },
+    { 0xdde50bd1d5d0b9e9u, 0xaa242499697392d2u }, { 0x955e4ec64b44e864u, 0xd4ad2dbfc3d07787u },
+    { 0xbd5af13bef0b113eu, 0x84ec3c97da624ab4u }, { 0xecb1ad8aeacdd58eu, 0xa6274bbdd0fadd61u },
+    { 0x67de18eda5814af2u, 0xcfb11ead453994bau }, { 0x80eacf948770ced7u, 0x81ceb32c4b43fcf4u },
+    { 0xa1258379a94d028du, 0xa2425ff75e14fc31u }, { 0x096ee45813a04330u, 0xcad2f7f5359a3b3eu },
+    { 0x8bca9d6e188853fcu, 0xfd87b5f28300ca0du }, { 0x775ea264cf55347eu, 0x9e74d1b791e07e48u },
+    { 0x95364afe032a819eu, 0xc612062576589ddau }, { 0x3a83ddbd83f52205u, 0xf79687aed3eec551u },
+    { 0xc4926a9672793543u, 0x9abe14cd44753b52u }, { 0x75b7053c0f178294u, 0xc16d9a0095928a27u },
+    { 0x5324c68b12dd6339u, 0xf1c90080baf72cb1u }, { 0xd3f6fc16ebca5e04u, 0x971da05074da7beeu },
+    { 0x88f4bb1ca6bcf585u, 0xbce5086492111aeau }, { 0x2b31e9e3d06c32e6u, 0xec1e4a7db69561a5u },
+    { 0x3aff322e62439fd0u, 0x9392ee8e921d5d07u }, { 0x09befeb9fad487c3u, 0xb877aa3236a4b449u },
+    { 0x4c2ebe687989a9b4u, 0xe69594bec44de15bu }, { 0x0f9d37014bf60a11u, 0x901d7cf73ab0acd9u },
+    { 0x538484c19ef38c95u, 0xb424dc35095cd80fu }, { 0x2865a5f206b06fbau, 0xe12e13424bb40e13u },
+    { 0xf93f87b7442e45d4u, 0x8cbccc096f5088cbu }, { 0xf78f69a51539d749u, 0xafebff0bcb24aafeu },
+    { 0xb573440e5a884d1cu, 0xdbe6fecebdedd5beu }, { 0x31680a88f8953031u, 0x89705f4136b4a597u },
+    { 0xfdc20d2b36ba7c3eu, 0xabcc77118461cefcu }, { 0x3d32907604691b4du, 0xd6bf94d5e57a42bcu },
+    { 0xa63f9a49c2c1b110u, 0x8637bd05af6c69b5u }, { 0x0fcf80dc33721d54u, 0xa7c5ac471b478423u },
+    { 0xd3c36113404ea4a9u, 0xd1b71758e219652bu }, { 0x645a1cac083126eau, 0x83126e978d4fdf3bu },
+    { 0x3d70a3d70a3d70a4u, 0xa3d70a3d70a3d70au }, { 0xcccccccccccccccdu, 0xccccccccccccccccu },
+    { 0x0000000000000000u, 0x8000000000000000u }, { 0x0000000000000000u, 0xa000000000000000u },
+    { 0x0000000000000000u, 0xc800000000000000u }, { 0x0000000000000000u, 0xfa00000000000000u },
+    { 0x0000000000000000u, 0x9c40000000000000u }, { 0x0000000000000000u, 0xc350000000000000u },
+    { 0x0000000000000000u, 0xf424000000000000u }, { 0x0000000000000000u, 0x9896800000000000u },
+    { 0x0000000000000000u, 0xbebc200000000000u }, { 0x0000000000000000u, 0xee6b280000000000u },
+    { 0x0000000000000000u, 0x9502f90000000000u }, { 0x0000000000000000u, 0xba43b74000000000u },
+    { 0x0000000000000000u, 0xe8d4a51000000000u }, { 0x0000000000000000u, 0x9184e72a00000000u },
+    { 0x0000000000000000u, 0xb5e620f480000000u }, { 0x0000000000000000u, 0xe35fa931a0000000u },
+    { 0x0000000000000000u, 0x8e1bc9bf04000000u }, { 0x0000000000000000u, 0xb1a2bc2ec5000000u },
+    { 0x0000000000000000u, 0xde0b6b3a76400000u }, { 0x0000000000000000u, 0x8ac7230489e80000u },
+    { 0x0000000000000000u, 0xad78ebc5ac620000u }, { 0x0000000000000000u, 0xd8d726b7177a8000u },
+    { 0x0000000000000000u, 0x878678326eac9000u }, { 0x0000000000000000u, 0xa968163f0a57b400u },
+    { 0x0000000000000000u, 0xd3c21bcecceda100u }, { 0x0000000000000000u, 0x84595161401484a0u },
+    { 0x0000000000000000u, 0xa56fa5b99019a5c8u }, { 0x0000000000000000u, 0xcecb8f27f4200f3au },
+    { 0x4000000000000000u, 0x813f3978f8940984u }, { 0x5000000000000000u, 0xa18f07d736b90be5u },
+    { 0xa400000000000000u, 0xc9f2c9cd04674edeu }, { 0x4d00000000000000u, 0xfc6f7c4045812296u },
+    { 0xf020000000000000u, 0x9dc5ada82b70b59du }, { 0x6c28000000000000u, 0xc5371912364ce305u },
+    { 0xc732000000000000u, 0xf684df56c3e01bc6u }, { 0x3c7f400000000000u, 0x9a130b963a6c115cu },
+    { 0x4b9f100000000000u, 0xc097ce7bc90715b3u }, { 0x1e86d40000000000u, 0xf0bdc21abb48db20u },
+    { 0x1314448000000000u, 0x96769950b50d88f4u },
+};
+
+// Whether p[0..7] are all digits (SWAR: a byte is a digit when both it and it
+// plus 6 have high nibble 3)
+static int thor_parse_eight(const char* p, uint32_t* value) {
+#ifdef THOR_PARSE_SWAR
+    uint64_t chunk;
+    memcpy(&chunk, p, 8);
+    if ((((chunk & 0xF0F0F0F0F0F0F0F0u) | (((chunk + 0x0606060606060606u) & 0xF0F0F0F0F0F0F0F0u) >> 4)) !=
+         0x3333333333333333u)) {
+        return 0;
+    }
+    chunk = (chunk & 0x0F0F0F0F0F0F0F0Fu) * 2561 >> 8;
+    chunk = (chunk & 0x00FF00FF00FF00FFu) * 6553601 >> 16;
+    *value = (uint32_t)((chunk & 0x0000FFFF0000FFFFu) * 42949672960001u >> 32);
+    return 1;
+#else
+    (void)p;
+    (void)value;
+    return 0;
+#endif
+}
+
+// Appends the run of digits at p to *value, up to 19 digits in all (*kept
+// counts them); the digits after that are counted in *extra, and *dropped is
+// set when one of them is not 0. Returns the end of the run.
+static const char* thor_parse_digits(const char* p, const char* end, uint64_t* value, int* kept, int* extra,
+                                     int* dropped) {
+    uint64_t digits = *value;
+    int count = *kept;
+    uint32_t eight;
+    while (count <= 11 && end - p >= 8 && thor_parse_eight(p, &eight)) {
+        digits = digits * 100000000u + eight;
+        count += 8;
+        p += 8;
+    }
+    for (; p < end && (unsigned)(*p - '0') < 10; p++) {
+        if (count < 19) {
+            digits = digits * 10 + (unsigned)(*p - '0');
+            count++;
+        } else {
+            (*extra)++;
+            *dropped = *dropped || *p != '0';
+        }
+    }
+    *value = digits;
+    *kept = count;
+    return p;
+}
+
+static int thor_parse_space(char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+// Parses an optionally signed decimal integer at p, saturating at the range of
+// long long; returns the end of it, or p when there is none
+static const char* thor_scan_int(const char* p, const char* end, long long* value) {
+    const char* start = p;
+    int negative = p < end && *p == '-';
+    p += p < end && (*p == '-' || *p == '+');
+    const char* digitsStart = p;
+    uint64_t magnitude = 0;
+    int overflow = 0;
+    uint32_t eight;
+    while (end - p >= 8 && magnitude < 100000000000u && thor_parse_eight(p, &eight)) {
+        magnitude = magnitude * 100000000u + eight;
+        p += 8;
+    }
+    for (; p < end && (unsigned)(*p - '0') < 10; p++) {
+        unsigned digit = (unsigned)(*p - '0');
+        overflow = overflow || magnitude > (UINT64_MAX - digit) / 10;
+        magnitude = magnitude * 10 + digit;
+    }
+    if (p == digitsStart) {
+        *value = 0;
+        return start;
+    }
+    uint64_t limit = negative ? (uint64_t)INT64_MAX + 1 : (uint64_t)INT64_MAX;
+    if (overflow || magnitude > limit) {
+        magnitude = limit;
+    }
+    *value = negative ? (long long)(0 - magnitude) : (long long)magnitude;
+    return p;
+}
+
+static uint64_t thor_mul128(uint64_t a, uint64_t b, uint64_t* high) {
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 product = (unsigned __int128)a * b;
+    *high = (uint64_t)(product >> 64);
+    return (uint64_t)product;
+#else
+    uint64_t aLow = (uint32_t)a, aHigh = a >> 32, bLow = (uint32_t)b, bHigh = b >> 32;
+    uint64_t low = aLow * bLow, middle1 = aHigh * bLow, middle2 = aLow * bHigh;
+    uint64_t middle = (low >> 32) + (uint32_t)middle1 + (uint32_t)middle2;
+    *high = aHigh * bHigh + (middle1 >> 32) + (middle2 >> 32) + (middle >> 32);
+    return (middle << 32) | (uint32_t)low;
+#endif
+}
+
+static int thor_leading_zeros(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_clzll(value);
+#else
+    int count = 0;
+    for (; !(value & 0x8000000000000000u); value <<= 1) {
+        count++;
+    }
+    return count;
+#endif
+}
+
+// The float nearest w * 10^q (w != 0), as its bits without the sign
+static uint32_t thor_float_from_decimal(uint64_t w, int32_t q) {
+    if (q < -64) {
+        return 0;
+    }
+    if (q > 38) {
+        return 0x7F800000u;
+    }
+    int lz = thor_leading_zeros(w);
+    w <<= lz;
+    const uint64_t* pow5 = thor_float_parse_pow5[q + 64];
+    uint64_t high;
+    uint64_t low = thor_mul128(w, pow5[1], &high);
+    if ((high & (UINT64_MAX >> 26)) == UINT64_MAX >> 26) {
+        // The truncated product could carry into the bits that matter
+        uint64_t secondHigh;
+        thor_mul128(w, pow5[0], &secondHigh);
+        low += secondHigh;
+        high += secondHigh > low;
+    }
+    int upperBit = (int)(high >> 63);
+    int shift = upperBit + 64 - 23 - 3;
+    uint64_t mantissa = high >> shift;
+    int32_t power2 = (int32_t)((((152170 + 65536) * q) >> 16) + 63) + upperBit - lz + 127;
+    if (power2 <= 0) {
+        // Subnormal
+        if (-power2 + 1 >= 64) {
+            return 0;
+        }
+        mantissa >>= -power2 + 1;
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+        return (uint32_t)mantissa; // carries into the exponent when it rounds up to the smallest normal
+    }
+    if (low <= 1 && q >= -17 && q <= 10 && (mantissa & 3) == 1 && (mantissa << shift) == high) {
+        // Exactly halfway: round to even
+        mantissa &= ~(uint64_t)1;
+    }
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if (mantissa >= (uint64_t)2 << 23) {
+        mantissa = (uint64_t)1 << 23;
+        power2++;
+    }
+    if (power2 >= 0xFF) {
+        return 0x7F800000u;
+    }
+    return (uint32_t)power2 << 23 | (uint32_t)(mantissa & ~((uint64_t)1 << 23));
+}
+
+static int thor_parse_word(const char* p, const char* end, const char* word) {
+    for (; *word; p++, word++) {
+        if (p == end || (*p | 0x20) != *word) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Parses a decimal float at p (digits with an optional fraction and exponent,
+// or inf, infinity or nan); returns the end of it, or p when there is none.
+// Rounding is exact. strtof, on a terminated copy of the number, decides the
+// rare numbers with more than 19 digits that Eisel-Lemire cannot.
+static const char* thor_scan_float(const char* p, const char* end, float* value) {
+    const char* start = p;
+    int negative = p < end && *p == '-';
+    p += p < end && (*p == '-' || *p == '+');
+    uint32_t bits;
+    if (thor_parse_word(p, end, "nan")) {
+        bits = 0x7FC00000u;
+        p += 3;
+    } else if (thor_parse_word(p, end, "inf")) {
+        bits = 0x7F800000u;
+        p += thor_parse_word(p, end, "infinity") ? 8 : 3;
+    } else {
+        // w * 10^q, with w holding the first 19 significant digits
+        uint64_t w = 0;
+        int32_t q = 0;
+        int kept = 0, extra = 0, dropped = 0;
+        const char* digits = p;
+        while (p < end && *p == '0') {
+            p++;
+        }
+        p = thor_parse_digits(p, end, &w, &kept, &extra, &dropped);
+        q += extra;
+        int any = p > digits;
+        if (p < end && *p == '.') {
+            const char* fraction = ++p;
+            if (kept == 0) {
+                while (p < end && *p == '0') {
+                    p++;
+                }
+                q -= (int32_t)(p - fraction);
+            }
+            int before = kept;
+            p = thor_parse_digits(p, end, &w, &kept, &extra, &dropped);
+            q -= kept - before;
+            any = any || p > fraction;
+        }
+        if (!any) {
+            *value = 0;
+            return start;
+        }
+        if (p < end && (*p | 0x20) == 'e') {
+            const char* exponent = p + 1;
+            int exponentNegative = exponent < end && *exponent == '-';
+            exponent += exponent < end && (*exponent == '-' || *exponent == '+');
+            if (exponent < end && (unsigned)(*exponent - '0') < 10) {
+                int32_t e = 0;
+                for (; exponent < end && (unsigned)(*exponent - '0') < 10; exponent++) {
+                    e = e < 100000 ? e * 10 + (*exponent - '0') : e;
+                }
+                q += exponentNegative ? -e : e;
+                p = exponent;
+            }
+        }
+        if (w == 0) {
+            bits = 0;
+        } else {
+            bits = thor_float_from_decimal(w, q);
+            if (dropped && thor_float_from_decimal(w + 1, q) != bits) {
+                // The text may go on past end (a view), so strtof gets a copy
+                char small[64];
+                size_t length = (size_t)(p - start);
+                char* copy = length < sizeof(small) ? small : malloc(length + 1);
+                if (copy) {
+                    memcpy(copy, start, length);
+                    copy[length] = '\0';
+                    *value = strtof(copy, NULL);
+                } else {
+                    memcpy(value, &bits, sizeof(bits));
+                }
+                if (copy != small) {
+                    free(copy);
+                }
+                return p;
+            }
+        }
+    }
+    bits |= (uint32_t)negative << 31;
+    memcpy(value, &bits, sizeof(bits));
+    return p;
+}
+
+int thor_parse_int(thor_str text) {
+    const char* p = text.data;
+    const char* end = p + text.length;
+    while (p < end && thor_parse_space(*p)) {
+        p++;
+    }
+    long long value;
+    thor_scan_int(p, end, &value);
+    return value > INT_MAX ? INT_MAX : value < INT_MIN ? INT_MIN : (int)value;
+}
+
+float thor_parse_float(thor_str text) {
+    const char* p = text.data;
+    const char* end = p + text.length;
+    while (p < end && thor_parse_space(*p)) {
+        p++;
+    }
+    float value;
+    thor_scan_float(p, end, &value);
+    return value;
+}
+
+// Whitespace-separated numbers from standard input, read in large blocks with
+// read() rather than through stdio, so they do not mix with std.input. A token
+// is only parsed once it is followed by whitespace, the end of input, or
+// THOR_READ_TOKEN bytes; longer tokens are split.
+#if defined(_WIN32)
+#include <io.h>
+#define thor_read_fd(buffer, size) _read(0, buffer, (unsigned)(size))
+#else
+#include <unistd.h>
+#define thor_read_fd(buffer, size) read(0, buffer, size)
+#endif
+
+#define THOR_READ_BUFFER 65536
+#define THOR_READ_TOKEN 4096
+
+static char thor_read_buffer[THOR_READ_BUFFER + 8]; // zero padding after the data ends number parsing
+static size_t thor_read_start = 0;
+static size_t thor_read_end = 0;
+static int thor_read_eof = 0;
+
+static void thor_read_fill(void) {
+    memmove(thor_read_buffer, thor_read_buffer + thor_read_start, thor_read_end - thor_read_start);
+    thor_read_end -= thor_read_start;
+    thor_read_start = 0;
+    long count = (long)thor_read_fd(thor_read_buffer + thor_read_end, THOR_READ_BUFFER - thor_read_end);
+    if (count <= 0) {
+        thor_read_eof = 1;
+    } else {
+        thor_read_end += (size_t)count;
+    }
+    memset(thor_read_buffer + thor_read_end, 0, 8);
+}
+
+// The start of the next token, or NULL at the end of input
+static const char* thor_read_token(void) {
+    for (;;) {
+        while (thor_read_start < thor_read_end && thor_parse_space(thor_read_buffer[thor_read_start])) {
+            thor_read_start++;
+        }
+        if (thor_read_start < thor_read_end) {
+            size_t end = thor_read_start;
+            if (thor_read_eof || thor_read_end - end >= THOR_READ_TOKEN) {
+                return thor_read_buffer + thor_read_start;
+            }
+            while (end < thor_read_end && !thor_parse_space(thor_read_buffer[end])) {
+                end++;
+            }
+            if (end < thor_read_end) {
+                return thor_read_buffer + thor_read_start;
+            }
+        } else if (thor_read_eof) {
+            return NULL;
+        }
+        thor_read_fill();
+    }
+}
+
+// Consumes the token that a number was parsed from; the rest of it, if the
+// number did not take all of it, goes too
+static void thor_read_consume(const char* after) {
+    const char* end = thor_read_buffer + thor_read_end;
+    while (after < end && !thor_parse_space(*after)) {
+        after++;
+    }
+    thor_read_start = (size_t)(after - thor_read_buffer);
+}
+
+bool thor_has_next(void) {
+    return thor_read_token() != NULL;
+}
+
+int thor_read_int(void) {
+    const char* p = thor_read_token();
+    long long value = 0;
+    if (p) {
+        thor_read_consume(thor_scan_int(p, thor_read_buffer + thor_read_end, &value));
+    }
+    return value > INT_MAX ? INT_MAX : value < INT_MIN ? INT_MIN : (int)value;
+}
+
+float thor_read_float(void) {
+    const char* p = thor_read_token();
+    float value = 0;
+    if (p) {
+        thor_read_consume(thor_scan_float(p, thor_read_buffer + thor_read_end, &value));
+    }
+    return value;
+}
+)RUNTIME";
+
+// The std.fs module, emitted for programs that import it
+static const char* FS_RUNTIME = R"RUNTIME(// std.fs: files and mapped files, both named by small integer handles (indexes
+// into growable tables; -1 for a failure). Files are buffered in both
+// directions over plain file descriptors. A mapped file's contents are
+// returned in place, terminated by a zero page mapped after them.
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#define thor_fs_openfd(path, flags) _open(path, (flags) | _O_BINARY, 0666)
+#define thor_fs_readfd _read
+#define thor_fs_writefd _write
+#define thor_fs_closefd _close
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define thor_fs_openfd(path, flags) open(path, flags, 0666)
+#define thor_fs_readfd read
+#define thor_fs_writefd write
+#define thor_fs_closefd close
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
+
+#define THOR_FS_BUFFER 65536
+
+typedef struct {
+    int fd; // -1 for a free slot
+    int writing;
+    int eof;
+    char* buffer;
+    size_t start, end; // unread bytes, or bytes not written yet
+    char* line;        // a line that did not fit in the buffer
+    size_t lineCapacity;
+} thor_fs_file;
+
+typedef struct {
+    char* data; // NULL for a free slot; data[size] is 0
+    size_t size;
+    size_t length; // of the mapping, or 0 when data was read into memory
+    size_t cursor; // start of the next line
+    char* line;
+    size_t lineCapacity;
+} thor_fs_map;
+
+static thor_fs_file* thor_fs_files = NULL;
+static int thor_fs_file_count = 0;
+static thor_fs_map* thor_fs_maps = NULL;
+static int thor_fs_map_count = 0;
+
+static thor_fs_file* thor_fs_get(int file) {
+    return file >= 0 && file < thor_fs_file_count && thor_fs_files[file].fd >= 0 ? &thor_fs_files[file] : NULL;
+}
+
+static thor_fs_map* thor_fs_get_map(int map) {
+    return map >= 0 && map < thor_fs_map_count && thor_fs_maps[map].data ? &thor_fs_maps[map] : NULL;
+}
+
+// Makes room for at least `capacity` bytes in *buffer; 0 when out of memory
+static int thor_fs_reserve(char** buffer, size_t* capacity, size_t needed) {
+    if (needed <= *capacity) {
+        return 1;
+    }
+    size_t grown = *capacity ? *capacity : 256;
+    while (grown < needed) {
+        grown *= 2;
+    }
+    char* resized = (char*)realloc(*buffer, grown);
+    if (!resized) {
+        return 0;
+    }
+    *buffer = resized;
+    *capacity = grown;
+    return 1;
+}
+
+// mode "r" reads, "w" truncates and writes, "a" appends
+int thor_fs_open(const char* path, const char* mode) {
+    int flags;
+    if (strcmp(mode, "r") == 0) {
+        flags = O_RDONLY;
+    } else if (strcmp(mode, "w") == 0) {
+        flags = O_WRONLY | O_CREAT | O_TRUNC;
+    } else if (strcmp(mode, "a") == 0) {
+        flags = O_WRONLY | O_CREAT | O_APPEND;
+    } else {
+        return -1;
+    }
+    int file = 0;
+    while (file < thor_fs_file_count && thor_fs_files[file].fd >= 0) {
+        file++;
+    }
+    if (file == thor_fs_file_count) {
+        int count = thor_fs_file_count ? thor_fs_file_count * 2 : 8;
+        thor_fs_file* files = (thor_fs_file*)realloc(thor_fs_files, count * sizeof(thor_fs_file));
+        if (!files) {
+            return -1;
+        }
+        for (int i = thor_fs_file_count; i < count; i++) {
+            files[i].fd = -1;
+        }
+        thor_fs_files = files;
+        thor_fs_file_count = count;
+    }
+    char* buffer = (char*)malloc(THOR_FS_BUFFER);
+    int fd = buffer ? thor_fs_openfd(path, flags) : -1;
+    if (fd < 0) {
+        free(buffer);
+        return -1;
+    }
+    thor_fs_file* f = &thor_fs_files[file];
+    f->fd = fd;
+    f->writing = flags != O_RDONLY;
+    f->eof = 0;
+    f->buffer = buffer;
+    f->start = f->end = 0;
+    f->line = NULL;
+    f->lineCapacity = 0;
+    return file;
+}
+
+static int thor_fs_write_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        long written = (long)thor_fs_writefd(fd, data, (unsigned)(size < 0x40000000 ? size : 0x40000000));
+        if (written <= 0) {
+            return 0;
+        }
+        data += written;
+        size -= (size_t)written;
+    }
+    return 1;
+}
+
+bool thor_fs_flush(int file) {
+    thor_fs_file* f = thor_fs_get(file);
+    if (!f || !f->writing) {
+        return false;
+    }
+    int ok = thor_fs_write_all(f->fd, f->buffer + f->start, f->end - f->start);
+    f->start = f->end = 0;
+    return ok;
+}
+
+bool thor_fs_write(int file, const char* text) {
+    thor_fs_file* f = thor_fs_get(file);
+    if (!f || !f->writing) {
+        return false;
+    }
+    size_t size = strlen(text);
+    if (f->end + size > THOR_FS_BUFFER) {
+        if (!thor_fs_flush(file)) {
+            return false;
+        }
+        if (size >= THOR_FS_BUFFER) {
+            return thor_fs_write_all(f->fd, text, size);
+        }
+    }
+    memcpy(f->buffer + f->end, text, size);
+    f->end += size;
+    return true;
+}
+
+bool thor_fs_close(int file) {
+    thor_fs_file* f = thor_fs_get(file);
+    if (!f) {
+        return false;
+    }
+    bool ok = !f->writing || thor_fs_flush(file);
+    ok = thor_fs_closefd(f->fd) == 0 && ok;
+    free(f->buffer);
+    free(f->line);
+    f->fd = -1;
+    return ok;
+}
+
+// Reads more input after the unread bytes; 0 at the end of the file
+static int thor_fs_fill(thor_fs_file* f) {
+    if (f->eof) {
+        return 0;
+    }
+    if (f->start > 0) {
+        memmove(f->buffer, f->buffer + f->start, f->end - f->start);
+        f->end -= f->start;
+        f->start = 0;
+    }
+    long count = (long)thor_fs_readfd(f->fd, f->buffer + f->end, (unsigned)(THOR_FS_BUFFER - f->end));
+    if (count <= 0) {
+        f->eof = 1;
+        return 0;
+    }
+    f->end += (size_t)count;
+    return 1;
+}
+
+bool thor_fs_eof(int file) {
+    thor_fs_file* f = thor_fs_get(file);
+    if (!f || f->writing) {
+        return true;
+    }
+    return f->start == f->end && !thor_fs_fill(f);
+}
+
+// Copies up to `count` bytes to out; returns how many
+static size_t thor_fs_read_into(thor_fs_file* f, char* out, size_t count) {
+    size_t done = 0;
+    while (done < count && (f->start < f->end || thor_fs_fill(f))) {
+        size_t chunk = f->end - f->start < count - done ? f->end - f->start : count - done;
+        memcpy(out + done, f->buffer + f->start, chunk);
+        f->start += chunk;
+        done += chunk;
+    }
+    return done;
+}
+
+// The next line without its line ending, in the buffer or in f->line, or
+// NULL at the end of the file
+static const char* thor_fs_take_line(thor_fs_file* f, size_t* length) {
+    if (f->start == f->end && !thor_fs_fill(f)) {
+        return NULL;
+    }
+    size_t copied = 0; // bytes of the line already moved to f->line
+    for (;;) {
+        char* newline = (char*)memchr(f->buffer + f->start, '\n', f->end - f->start);
+        size_t chunk = (newline ? (size_t)(newline - f->buffer) : f->end) - f->start;
+        const char* line;
+        if (copied == 0 && (newline || f->eof)) {
+            line = f->buffer + f->start;
+        } else {
+            if (!thor_fs_reserve(&f->line, &f->lineCapacity, copied + chunk + 1)) {
+                return NULL;
+            }
+            memcpy(f->line + copied, f->buffer + f->start, chunk);
+            line = f->line;
+        }
+        copied += chunk;
+        f->start += chunk;
+        if (newline || !thor_fs_fill(f)) {
+            f->start += newline != NULL;
+            *length = copied - (copied > 0 && line[copied - 1] == '\r');
+            return line;
+        }
+    }
+}
+
+static thor_fs_file* thor_fs_get_reader(int file) {
+    thor_fs_file* f = thor_fs_get(file);
+    return f && !f->writing ? f : NULL;
+}
+
+char* thor_fs_read(int file, int count) {
+    thor_fs_file* f = thor_fs_get_reader(file);
+    size_t size = count > 0 ? (size_t)count : 0;
+    char* text = (char*)malloc(size + 1);
+    if (text) {
+        text[f ? thor_fs_read_into(f, text, size) : 0] = '\0';
+    }
+    return text;
+}
+
+char* thor_fs_read_line(int file) {
+    thor_fs_file* f = thor_fs_get_reader(file);
+    size_t length = 0;
+    const char* line = f ? thor_fs_take_line(f, &length) : NULL;
+    char* text = (char*)malloc(length + 1);
+    if (text) {
+        memcpy(text, line ? line : "", length);
+        text[length] = '\0';
+    }
+    return text;
+}
+
+int thor_fs_map_file(const char* path) {
+    int map = 0;
+    while (map < thor_fs_map_count && thor_fs_maps[map].data) {
+        map++;
+    }
+    if (map == thor_fs_map_count) {
+        int count = thor_fs_map_count ? thor_fs_map_count * 2 : 8;
+        thor_fs_map* maps = (thor_fs_map*)realloc(thor_fs_maps, count * sizeof(thor_fs_map));
+        if (!maps) {
+            return -1;
+        }
+        for (int i = thor_fs_map_count; i < count; i++) {
+            maps[i].data = NULL;
+        }
+        thor_fs_maps = maps;
+        thor_fs_map_count = count;
+    }
+    thor_fs_map* m = &thor_fs_maps[map];
+    int fd = thor_fs_openfd(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+#if defined(_WIN32)
+    // No mmap: the file is read into memory
+    long size = _lseek(fd, 0, SEEK_END);
+    char* data = size >= 0 && _lseek(fd, 0, SEEK_SET) == 0 ? (char*)malloc((size_t)size + 1) : NULL;
+    size_t done = 0;
+    while (data && done < (size_t)size) {
+        int count = _read(fd, data + done, (unsigned)((size_t)size - done));
+        if (count <= 0) {
+            break;
+        }
+        done += (size_t)count;
+    }
+    thor_fs_closefd(fd);
+    if (!data) {
+        return -1;
+    }
+    data[done] = '\0';
+    m->size = done;
+    m->length = 0;
+#else
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        thor_fs_closefd(fd);
+        return -1;
+    }
+    // The file is mapped over the start of a zeroed anonymous mapping at least
+    // a byte longer, so the contents are always followed by a 0
+    size_t size = (size_t)info.st_size;
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t length = (size + page) / page * page;
+    char* data = (char*)mmap(NULL, length, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data != (char*)MAP_FAILED && size > 0 &&
+        mmap(data, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(data, length);
+        data = (char*)MAP_FAILED;
+    }
+    thor_fs_closefd(fd);
+    if (data == (char*)MAP_FAILED) {
+        return -1;
+    }
+#ifdef MADV_SEQUENTIAL
+    madvise(data, length, MADV_SEQUENTIAL);
+#endif
+    m->size = size;
+    m->length = length;
+#endif
+    m->data = data;
+    m->cursor = 0;
+    m->line = NULL;
+    m->lineCapacity = 0;
+    return map;
+}
+
+char* thor_fs_contents(int map) {
+    thor_fs_map* m = thor_fs_get_map(map);
+    return m ? m->data : "";
+}
+
+bool thor_fs_next_line(int map) {
+    thor_fs_map* m = thor_fs_get_map(map);
+    if (!m || m->cursor >= m->size) {
+        return false;
+    }
+    const char* start = m->data + m->cursor;
+    const char* newline = (const char*)memchr(start, '\n', m->size - m->cursor);
+    size_t length = (newline ? (size_t)(newline - start) : m->size - m->cursor);
+    m->cursor += length + (newline != NULL);
+    length -= length > 0 && start[length - 1] == '\r';
+    if (!thor_fs_reserve(&m->line, &m->lineCapacity, length + 1)) {
+        return false;
+    }
+    memcpy(m->line, start, length);
+    m->line[length] = '\0';
+    return true;
+}
+
+char* thor_fs_line(int map) {
+    thor_fs_map* m = thor_fs_get_map(map);
+    return m && m->line ? m->line : "";
+}
+
+bool thor_fs_unmap(int map) {
+    thor_fs_map* m = thor_fs_get_map(map);
+    if (!m) {
+        return false;
+    }
+#if defined(_WIN32)
+    free(m->data);
+#else
+    munmap(m->data, m->length);
+#endif
+    free(m->line);
+    m->data = NULL;
+    return true;
+}
+
+#ifdef THOR_TRACK_ALLOCATIONS
+char* thor_fs_read_at(thor_alloc_site* site, int file, int count) {
+    thor_fs_file* f = thor_fs_get_reader(file);
+    size_t size = count > 0 ? (size_t)count : 0;
+    char* text = (char*)thor_alloc(site, size + 1);
+    if (text) {
+        text[f ? thor_fs_read_into(f, text, size) : 0] = '\0';
+    }
+    return text;
+}
+
+char* thor_fs_read_line_at(thor_alloc_site* site, int file) {
+    thor_fs_file* f = thor_fs_get_reader(file);
+    size_t length = 0;
+    const char* line = f ? thor_fs_take_line(f, &length) : NULL;
+    char* text = (char*)thor_alloc(site, length + 1);
+    if (text) {
+        memcpy(text, line ? line : "", length);
+        text[length] = '\0';
+    }
+    return text;
+}
+#endif
+)RUNTIME";
+
+// The str type: a view of part of a string, which generated code and the
+// runtime header both need before any builtin is declared
+static const char* STR_DECLARATIONS = R"(// str: a start and a length in a string that outlives the view. Views are
+// not terminated, so they are only read up to their length.
+typedef struct {
+    const char* data;
+    long long length;
+} thor_str;
+#define thor_str_literal(text) ((thor_str){ text, sizeof(text) - 1 })
+
+)";
+
+// The std operations on str views, emitted for programs that use str. None
+// allocates but std.copy, which makes a new string.
+static const char* STR_RUNTIME = R"RUNTIME(#include <limits.h>
+
+thor_str thor_str_of(const char* text) {
+    thor_str view = { text ? text : "", text ? (long long)strlen(text) : 0 };
+    return view;
+}
+
+// Count bytes from start, both clamped to the view
+thor_str thor_str_substr(thor_str view, int start, int count) {
+    long long first = start < 0 ? 0 : start > view.length ? view.length : start;
+    long long length = count < 0 ? 0 : count > view.length - first ? view.length - first : count;
+    thor_str part = { view.data + first, length };
+    return part;
+}
+
+static int thor_str_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+thor_str thor_str_trim(thor_str view) {
+    while (view.length > 0 && thor_str_space(view.data[0])) {
+        view.data++;
+        view.length--;
+    }
+    while (view.length > 0 && thor_str_space(view.data[view.length - 1])) {
+        view.length--;
+    }
+    return view;
+}
+
+// Offsets, lengths and counts are Thor ints; one that does not fit stops the
+// program rather than wrapping
+static int thor_str_int(long long value, const char* operation) {
+    if (value > INT_MAX) {
+        fprintf(stderr, "thor: %s: %lld does not fit in an int\n", operation, value);
+        exit(1);
+    }
+    return (int)value;
+}
+
+int thor_str_length(thor_str view) {
+    return thor_str_int(view.length, "std.length");
+}
+
+bool thor_str_empty(thor_str view) {
+    return view.length == 0;
+}
+
+bool thor_str_equals(thor_str a, thor_str b) {
+    return a.length == b.length && memcmp(a.data, b.data, (size_t)a.length) == 0;
+}
+
+char* thor_str_copy(thor_str view) {
+    char* text = malloc((size_t)view.length + 1);
+    if (text) {
+        memcpy(text, view.data, (size_t)view.length);
+        text[view.length] = '\0';
+    }
+    return text;
+}
+
+#ifdef THOR_TRACK_ALLOCATIONS
+char* thor_str_copy_at(thor_alloc_site* site, thor_str view) {
+    char* text = (char*)thor_alloc(site, (size_t)view.length + 1);
+    if (text) {
+        memcpy(text, view.data, (size_t)view.length);
+        text[view.length] = '\0';
+    }
+    return text;
+}
+#endif
+)RUNTIME";
+
+// The str operations that search, with the text kernels, emitted for programs
+// that call one of them. std.replace makes a new string.
+static const char* STR_SEARCH_RUNTIME = R"RUNTIME(// The first needle in the view, or NULL
+static const char* thor_str_search(thor_str view, thor_str needle) {
+    if (needle.length <= 1) {
+        if (needle.length == 0) {
+            return view.data;
+        }
+        return thor_text_kernels.find_byte(view.data, (size_t)view.length, needle.data[0]);
+    }
+    return thor_text_kernels.find(view.data, (size_t)view.length, needle.data, (size_t)needle.length);
+}
+
+// The offset of the first needle in the view, or -1
+int thor_str_find(thor_str view, thor_str needle) {
+    const char* at = thor_str_search(view, needle);
+    return at ? thor_str_int((long long)(at - view.data), "std.find") : -1;
+}
+
+bool thor_str_contains(thor_str view, thor_str needle) {
+    return thor_str_search(view, needle) != NULL;
+}
+
+// Occurrences that do not overlap an earlier one; none of an empty needle
+int thor_str_count(thor_str view, thor_str needle) {
+    size_t count = 0;
+    if (needle.length == 1) {
+        count = thor_text_kernels.count_byte(view.data, (size_t)view.length, needle.data[0]);
+    } else if (needle.length > 1) {
+        const char* end = view.data + view.length;
+        const char* at;
+        while ((at = thor_text_kernels.find(view.data, (size_t)(end - view.data), needle.data, (size_t)needle.length))) {
+            count++;
+            view.data = at + needle.length;
+        }
+    }
+    return thor_str_int((long long)count, "std.count");
+}
+
+// The field before the first separator in *rest, which moves past it; the
+// whole of *rest, leaving it empty, when there is no separator
+thor_str thor_str_split(thor_str* rest, thor_str separator) {
+    const char* found = separator.length > 0 ? thor_str_search(*rest, separator) : NULL;
+    thor_str field = *rest;
+    if (!found) {
+        rest->data += rest->length;
+        rest->length = 0;
+    } else {
+        long long at = (long long)(found - rest->data);
+        field.length = at;
+        rest->data += at + separator.length;
+        rest->length -= at + separator.length;
+    }
+    return field;
+}
+
+// The length of the view with each from (as thor_str_count finds them)
+// replaced by to, and the text itself when out is not NULL
+static size_t thor_str_replace_into(char* out, thor_str view, thor_str from, thor_str to) {
+    const char* end = view.data + view.length;
+    size_t length = 0;
+    const char* at;
+    while (from.length > 0 && (at = thor_str_search(view, from))) {
+        size_t before = (size_t)(at - view.data);
+        if (out) {
+            memcpy(out + length, view.data, before);
+            memcpy(out + length + before, to.data, (size_t)to.length);
+        }
+        length += before + (size_t)to.length;
+        view.data = at + from.length;
+        view.length = end - view.data;
+    }
+    if (out) {
+        memcpy(out + length, view.data, (size_t)view.length);
+        out[length + view.length] = '\0';
+    }
+    return length + (size_t)view.length;
+}
+
+char* thor_str_replace(thor_str view, thor_str from, thor_str to) {
+    char* text = malloc(thor_str_replace_into(NULL, view, from, to) + 1);
+    if (text) {
+        thor_str_replace_into(text, view, from, to);
+    }
+    return text;
+}
+
+#ifdef THOR_TRACK_ALLOCATIONS
+char* thor_str_replace_at(thor_alloc_site* site, thor_str view, thor_str from, thor_str to) {
+    char* text = (char*)thor_alloc(site, thor_str_replace_into(NULL, view, from, to) + 1);
+    if (text) {
+        thor_str_replace_into(text, view, from, to);
+    }
+    return text;
+}
+#endif
+)RUNTIME";
+
+// Hot reload support, compiled into the runtime only when THOR_HOT_RELOAD is defined
+static const char* HOT_RELOAD_DECLARATIONS = R"(#ifdef THOR_HOT_RELOAD
+typedef struct {
+    const char* name;
+    const char* library;
+    void* table;
+    const char* bind;
+    long long mtime;
+    int generation;
+} thor_hot_module;
+
+extern volatile int thor_hot_pending;
+void thor_hot_init(thor_hot_module* modules, int count);
+void thor_hot_apply(void);
+#define THOR_SAFEPOINT() do { if (thor_hot_pending) thor_hot_apply(); } while (0)
+#endif
+
+)";
+
+static const char* HOT_RELOAD_RUNTIME = R"(#ifdef THOR_HOT_RELOAD
+#include <dlfcn.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+volatile int thor_hot_pending = 0;
+static thor_hot_module* thor_hot_modules = NULL;
+static int thor_hot_module_count = 0;
+
+static long long thor_hot_mtime(const char* path) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        return -1;
+    }
+#ifdef __APPLE__
+    return (long long)st.st_mtimespec.tv_sec * 1000000000LL + st.st_mtimespec.tv_nsec;
+#else
+    return (long long)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+}
+
+static int thor_hot_load(thor_hot_module* module) {
+    // dlopen() hands back the cached handle for a path it has seen, so every
+    // generation is loaded from a private copy that is unlinked once mapped
+    char copy[4096];
+    snprintf(copy, sizeof(copy), "%s.%d.%d", module->library, (int)getpid(), module->generation + 1);
+    FILE* in = fopen(module->library, "rb");
+    if (!in) {
+        fprintf(stderr, "thor: cannot open module %s\n", module->library);
+        return 0;
+    }
+    FILE* out = fopen(copy, "wb");
+    if (!out) {
+        fclose(in);
+        return 0;
+    }
+    char buffer[65536];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        fwrite(buffer, 1, n, out);
+    }
+    fclose(in);
+    fclose(out);
+
+    void* handle = dlopen(copy, RTLD_NOW | RTLD_LOCAL);
+    unlink(copy);
+    if (!handle) {
+        fprintf(stderr, "thor: loading module %s failed: %s\n", module->name, dlerror());
+        return 0;
+    }
+    void (*bind)(void*) = (void (*)(void*))dlsym(handle, module->bind);
+    if (!bind) {
+        fprintf(stderr, "thor: module %s has no %s\n", module->name, module->bind);
+        dlclose(handle);
+        return 0;
+    }
+
+    // Older generations are never unloaded: frames and pointers into them may still be live
+    bind(module->table);
+    module->generation++;
+    return 1;
+}
+
+static void* thor_hot_watch(void* arg) {
+    (void)arg;
+    for (;;) {
+        usleep(200000);
+        for (int i = 0; i < thor_hot_module_count; i++) {
+            if (thor_hot_mtime(thor_hot_modules[i].library) != thor_hot_modules[i].mtime) {
+                thor_hot_pending = 1;
+                break;
+            }
+        }
+    }
+    return NULL;
+}
+
+void thor_hot_apply(void) {
+    thor_hot_pending = 0;
+    for (int i = 0; i < thor_hot_module_count; i++) {
+        thor_hot_module* module = &thor_hot_modules[i];
+        long long mtime = thor_hot_mtime(module->library);
+        if (mtime < 0 || mtime == module->mtime) {
+            continue;
+        }
+        module->mtime = mtime;
+        if (thor_hot_load(module)) {
+            fprintf(stderr, "thor: reloaded module %s (generation %d)\n", module->name, module->generation);
+        }
+    }
+}
+
+void thor_hot_init(thor_hot_module* modules, int count) {
+    thor_hot_modules = modules;
+    thor_hot_module_count = count;
+    for (int i = 0; i < count; i++) {
+        modules[i].mtime = thor_hot_mtime(modules[i].library);
+        if (!thor_hot_load(&modules[i])) {
+            exit(1);
+        }
+    }
+    pthread_t watcher;
+    if (pthread_create(&watcher, NULL, thor_hot_watch, NULL) == 0) {
+        pthread_detach(watcher);
+    }
+}
+#endif
+
+)";
+
+// Function-level instrumentation (thor --instrument), compiled in only when
+// THOR_INSTRUMENT is defined. Every generated function calls thor_prof_enter()
+// on entry and thor_prof_exit() before it returns; each thread keeps its own
+// call counts and inclusive/exclusive times, and the totals over all threads
+// are reported on stderr at exit and whenever the process gets SIGUSR1.
+static const char* PROFILE_DECLARATIONS = R"(#ifdef THOR_INSTRUMENT
+typedef struct {
+    const char* name; // Thor-level, e.g. "mathlib.add"
+    const char* file;
+    int line;
+    int id;           // assigned on the first call
+} thor_prof_site;
+
+void thor_prof_enter(thor_prof_site* site);
+void thor_prof_exit(void);
+#endif
+
+)";
+
+static const char* PROFILE_RUNTIME = R"RUNTIME(#ifdef THOR_INSTRUMENT
+#include <signal.h>
+#include <time.h>
+
+// Probes read the time stamp counter where there is one; reports convert ticks
+// to time by comparing the counter with the monotonic clock over the whole run
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define THOR_PROF_TSC 1
+#endif
+
+#ifdef _MSC_VER
+#define THOR_PROF_TLS __declspec(thread)
+#else
+#define THOR_PROF_TLS _Thread_local
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+static char thor_prof_lock_flag;
+#define THOR_PROF_LOCK() while (__atomic_test_and_set(&thor_prof_lock_flag, __ATOMIC_ACQUIRE)) {}
+#define THOR_PROF_UNLOCK() __atomic_clear(&thor_prof_lock_flag, __ATOMIC_RELEASE)
+#else
+// Without GCC-style atomics an instrumented program must stay single-threaded
+#define THOR_PROF_LOCK()
+#define THOR_PROF_UNLOCK()
+#endif
+
+#define THOR_PROF_MAX_SITES 4096
+
+typedef struct {
+    unsigned long long calls;
+    unsigned long long inclusive; // ticks, counted for outermost activations only
+    unsigned long long exclusive; // ticks, minus the time spent in callees
+    unsigned int active;          // activations on this thread's stack
+} thor_prof_counter;
+
+typedef struct {
+    int site;
+    unsigned long long start;
+    unsigned long long children;
+} thor_prof_frame;
+
+// Threads are never unlinked, so their counts outlive them
+typedef struct thor_prof_thread {
+    thor_prof_counter counters[THOR_PROF_MAX_SITES]; // [0] collects sites past the limit
+    thor_prof_frame* frames;
+    size_t depth;
+    size_t capacity;
+    struct thor_prof_thread* next;
+} thor_prof_thread;
+
+static thor_prof_site* thor_prof_sites[THOR_PROF_MAX_SITES];
+static int thor_prof_site_count = 0;
+static thor_prof_thread* thor_prof_threads = NULL;
+static THOR_PROF_TLS thor_prof_thread* thor_prof_self = NULL;
+static volatile sig_atomic_t thor_prof_dump_requested = 0;
+static unsigned long long thor_prof_start_ticks;
+static double thor_prof_start_ns;
+
+static double thor_prof_now_ns(void) {
+    struct timespec ts;
+#if defined(CLOCK_MONOTONIC_RAW)
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+#elif defined(CLOCK_MONOTONIC)
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+    timespec_get(&ts, TIME_UTC);
+#endif
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static unsigned long long thor_prof_ticks(void) {
+#ifdef THOR_PROF_TSC
+    return (unsigned long long)__rdtsc();
+#else
+    return (unsigned long long)thor_prof_now_ns();
+#endif
+}
+
+typedef struct {
+    int site;
+    unsigned long long calls;
+    unsigned long long inclusive;
+    unsigned long long exclusive;
+} thor_prof_row;
+
+static int thor_prof_by_exclusive(const void* a, const void* b) {
+    const thor_prof_row* x = (const thor_prof_row*)a;
+    const thor_prof_row* y = (const thor_prof_row*)b;
+    return x->exclusive < y->exclusive ? 1 : x->exclusive > y->exclusive ? -1 : 0;
+}
+
+static void thor_prof_report(void) {
+    double elapsed_ns = thor_prof_now_ns() - thor_prof_start_ns;
+    unsigned long long elapsed_ticks = thor_prof_ticks() - thor_prof_start_ticks;
+    double ms_per_tick = elapsed_ticks > 0 ? elapsed_ns / (double)elapsed_ticks / 1e6 : 1e-6;
+
+    // Counters of threads that are still running are read as they are
+    THOR_PROF_LOCK();
+    int count = thor_prof_site_count;
+    thor_prof_row* rows = (thor_prof_row*)calloc(count + 1, sizeof(thor_prof_row));
+    if (!rows) {
+        THOR_PROF_UNLOCK();
+        return;
+    }
+    for (int i = 1; i <= count; i++) {
+        rows[i - 1].site = i;
+    }
+    for (thor_prof_thread* thread = thor_prof_threads; thread; thread = thread->next) {
+        for (int i = 1; i <= count; i++) {
+            rows[i - 1].calls += thread->counters[i].calls;
+            rows[i - 1].inclusive += thread->counters[i].inclusive;
+            rows[i - 1].exclusive += thread->counters[i].exclusive;
+        }
+    }
+    THOR_PROF_UNLOCK();
+
+    qsort(rows, count, sizeof(thor_prof_row), thor_prof_by_exclusive);
+    unsigned long long total = 0;
+    for (int i = 0; i < count; i++) {
+        total += rows[i].exclusive;
+    }
+    fprintf(stderr, "\nthor: profile over %.3f ms, all threads, by exclusive time\n", elapsed_ns / 1e6);
+    fprintf(stderr, "%12s %12s %12s %7s  %s\n", "calls", "incl ms", "excl ms", "excl %", "function");
+    for (int i = 0; i < count; i++) {
+        if (rows[i].calls == 0) {
+            continue;
+        }
+        const thor_prof_site* site = thor_prof_sites[rows[i].site];
+        fprintf(stderr, "%12llu %12.3f %12.3f %6.1f%%  %s", rows[i].calls, rows[i].inclusive * ms_per_tick,
+                rows[i].exclusive * ms_per_tick, total ? 100.0 * rows[i].exclusive / total : 0.0, site->name);
+        if (site->file[0]) {
+            fprintf(stderr, " (%s:%d)", site->file, site->line);
+        }
+        fprintf(stderr, "\n");
+    }
+    fflush(stderr);
+    free(rows);
+}
+
+#ifdef SIGUSR1
+static void thor_prof_on_signal(int signal) {
+    (void)signal;
+    thor_prof_dump_requested = 1; // reported by the next probe, outside the handler
+}
+#endif
+
+static thor_prof_thread* thor_prof_attach(void) {
+    thor_prof_thread* self = (thor_prof_thread*)calloc(1, sizeof(thor_prof_thread));
+    if (!self) {
+        fprintf(stderr, "thor: out of memory for profile counters\n");
+        exit(1);
+    }
+    THOR_PROF_LOCK();
+    if (!thor_prof_threads) {
+        thor_prof_start_ns = thor_prof_now_ns();
+        thor_prof_start_ticks = thor_prof_ticks();
+        atexit(thor_prof_report);
+#ifdef SIGUSR1
+        signal(SIGUSR1, thor_prof_on_signal);
+#endif
+    }
+    self->next = thor_prof_threads;
+    thor_prof_threads = self;
+    THOR_PROF_UNLOCK();
+    thor_prof_self = self;
+    return self;
+}
+
+static void thor_prof_register(thor_prof_site* site) {
+    THOR_PROF_LOCK();
+    if (!site->id && thor_prof_site_count + 1 < THOR_PROF_MAX_SITES) {
+        thor_prof_sites[++thor_prof_site_count] = site;
+        site->id = thor_prof_site_count;
+    }
+    THOR_PROF_UNLOCK();
+}
+
+void thor_prof_enter(thor_prof_site* site) {
+    thor_prof_thread* self = thor_prof_self ? thor_prof_self : thor_prof_attach();
+    if (!site->id) {
+        thor_prof_register(site);
+    }
+    if (self->depth == self->capacity) {
+        self->capacity = self->capacity ? self->capacity * 2 : 64;
+        self->frames = (thor_prof_frame*)realloc(self->frames, self->capacity * sizeof(thor_prof_frame));
+        if (!self->frames) {
+            fprintf(stderr, "thor: out of memory for profile frames\n");
+            exit(1);
+        }
+    }
+    thor_prof_frame* frame = &self->frames[self->depth++];
+    frame->site = site->id;
+    frame->children = 0;
+    self->counters[site->id].active++;
+    frame->start = thor_prof_ticks(); // last, so the bookkeeping above is not timed
+}
+
+void thor_prof_exit(void) {
+    unsigned long long now = thor_prof_ticks();
+    thor_prof_thread* self = thor_prof_self;
+    thor_prof_frame* frame = &self->frames[--self->depth];
+    unsigned long long elapsed = now - frame->start;
+    thor_prof_counter* counter = &self->counters[frame->site];
+    counter->calls++;
+    counter->exclusive += elapsed > frame->children ? elapsed - frame->children : 0;
+    if (--counter->active == 0) {
+        counter->inclusive += elapsed; // recursive calls are inside the outermost one
+    }
+    if (self->depth > 0) {
+        self->frames[self->depth - 1].children += elapsed;
+    }
+    if (thor_prof_dump_requested) {
+        thor_prof_dump_requested = 0;
+        thor_prof_report();
+    }
+}
+#endif
+
+)RUNTIME";
+
+// Allocation tracking (thor --track-allocations), compiled in only when
+// THOR_TRACK_ALLOCATIONS is defined. Generated code calls the allocating
+// runtime helpers through their _at variants, passing the call site (Thor
+// function, file and line) they charge; calls to free() from Thor code go
+// through thor_alloc_free(). The _at variants of the number formatting, std.fs
+// and str helpers are part of those runtime sections, so they come and go with
+// them. Live blocks are kept in a table keyed by address, so frees are credited
+// to the site that allocated. At exit the program reports peak live bytes and
+// the sites that allocated most.
+static const char* ALLOCATION_DECLARATIONS = R"(#ifdef THOR_TRACK_ALLOCATIONS
+typedef struct thor_alloc_site {
+    const char* function; // Thor-level, e.g. "main.render"
+    const char* file;
+    int line;
+    int registered;
+    unsigned long long count;
+    unsigned long long bytes;
+    unsigned long long live; // bytes not freed yet
+    struct thor_alloc_site* next;
+} thor_alloc_site;
+
+// New runtime helpers that allocate take a site and allocate through thor_alloc()
+void* thor_alloc(thor_alloc_site* site, size_t size);
+void thor_alloc_free(void* pointer);
+char* thor_input_at(thor_alloc_site* site, const char* prompt);
+char* thor_format_string_at(thor_alloc_site* site, const char* format, ...);
+#endif
+
+)";
+
+static const char* ALLOCATION_RUNTIME = R"RUNTIME(#ifdef THOR_TRACK_ALLOCATIONS
+#include <stdint.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+static char thor_alloc_lock_flag;
+#define THOR_ALLOC_LOCK() while (__atomic_test_and_set(&thor_alloc_lock_flag, __ATOMIC_ACQUIRE)) {}
+#define THOR_ALLOC_UNLOCK() __atomic_clear(&thor_alloc_lock_flag, __ATOMIC_RELEASE)
+#else
+// Without GCC-style atomics a tracked program must stay single-threaded
+#define THOR_ALLOC_LOCK()
+#define THOR_ALLOC_UNLOCK()
+#endif
+
+#define THOR_ALLOC_TOP_SITES 20
+
+typedef struct {
+    void* pointer; // null for a free slot
+    size_t size;
+    thor_alloc_site* site;
+} thor_alloc_block;
+
+// Allocations made by the runtime on its own behalf
+static thor_alloc_site thor_alloc_runtime_site = { "(runtime)", "", 0, 0, 0, 0, 0, 0 };
+static thor_alloc_site* thor_alloc_sites = NULL;
+static thor_alloc_block* thor_alloc_blocks = NULL; // open addressing, linear probing
+static size_t thor_alloc_capacity = 0;              // a power of two
+static size_t thor_alloc_block_count = 0;
+static unsigned long long thor_alloc_count = 0;
+static unsigned long long thor_alloc_bytes = 0;
+static unsigned long long thor_alloc_live = 0;
+static unsigned long long thor_alloc_peak = 0;
+
+static size_t thor_alloc_slot(const void* pointer) {
+    return (size_t)((((uintptr_t)pointer >> 4) * 11400714819323198485ULL) >> 16) & (thor_alloc_capacity - 1);
+}
+
+static int thor_alloc_by_bytes(const void* a, const void* b) {
+    const thor_alloc_site* x = *(thor_alloc_site* const*)a;
+    const thor_alloc_site* y = *(thor_alloc_site* const*)b;
+    return x->bytes < y->bytes ? 1 : x->bytes > y->bytes ? -1 : 0;
+}
+
+static void thor_alloc_report(void) {
+    THOR_ALLOC_LOCK();
+    size_t count = 0;
+    for (thor_alloc_site* site = thor_alloc_sites; site; site = site->next) {
+        count++;
+    }
+    thor_alloc_site** sorted = (thor_alloc_site**)malloc((count + 1) * sizeof(thor_alloc_site*));
+    if (!sorted) {
+        THOR_ALLOC_UNLOCK();
+        return;
+    }
+    count = 0;
+    for (thor_alloc_site* site = thor_alloc_sites; site; site = site->next) {
+        sorted[count++] = site;
+    }
+    THOR_ALLOC_UNLOCK();
+
+    qsort(sorted, count, sizeof(thor_alloc_site*), thor_alloc_by_bytes);
+    fprintf(stderr, "\nthor: %llu allocations, %llu bytes; peak live %llu bytes, %llu bytes live at exit\n",
+            thor_alloc_count, thor_alloc_bytes, thor_alloc_peak, thor_alloc_live);
+    fprintf(stderr, "%12s %14s %14s  %s\n", "allocs", "bytes", "live bytes", "site");
+    for (size_t i = 0; i < count && i < THOR_ALLOC_TOP_SITES; i++) {
+        const thor_alloc_site* site = sorted[i];
+        fprintf(stderr, "%12llu %14llu %14llu  %s", site->count, site->bytes, site->live, site->function);
+        if (site->file[0]) {
+            fprintf(stderr, " (%s:%d)", site->file, site->line);
+        }
+        fprintf(stderr, "\n");
+    }
+    if (count > THOR_ALLOC_TOP_SITES) {
+        fprintf(stderr, "%12s and %zu more sites\n", "", count - THOR_ALLOC_TOP_SITES);
+    }
+    fflush(stderr);
+    free(sorted);
+}
+
+// Called with the lock held
+static int thor_alloc_grow(void) {
+    size_t old_capacity = thor_alloc_capacity;
+    thor_alloc_block* old_blocks = thor_alloc_blocks;
+    size_t capacity = old_capacity ? old_capacity * 2 : 1024;
+    thor_alloc_block* blocks = (thor_alloc_block*)calloc(capacity, sizeof(thor_alloc_block));
+    if (!blocks) {
+        return 0;
+    }
+    thor_alloc_blocks = blocks;
+    thor_alloc_capacity = capacity;
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_blocks[i].pointer) {
+            size_t slot = thor_alloc_slot(old_blocks[i].pointer);
+            while (blocks[slot].pointer) {
+                slot = (slot + 1) & (capacity - 1);
+            }
+            blocks[slot] = old_blocks[i];
+        }
+    }
+    free(old_blocks);
+    return 1;
+}
+
+void* thor_alloc(thor_alloc_site* site, size_t size) {
+    void* pointer = malloc(size);
+    if (!pointer) {
+        return NULL;
+    }
+    if (!site) {
+        site = &thor_alloc_runtime_site;
+    }
+    THOR_ALLOC_LOCK();
+    if (!thor_alloc_sites) {
+        atexit(thor_alloc_report);
+    }
+    if (!site->registered) {
+        site->registered = 1;
+        site->next = thor_alloc_sites;
+        thor_alloc_sites = site;
+    }
+    site->count++;
+    site->bytes += size;
+    thor_alloc_count++;
+    thor_alloc_bytes += size;
+    // A block the table has no room for is counted but never credited when freed
+    if ((thor_alloc_block_count + 1) * 2 <= thor_alloc_capacity || thor_alloc_grow()) {
+        size_t slot = thor_alloc_slot(pointer);
+        while (thor_alloc_blocks[slot].pointer) {
+            slot = (slot + 1) & (thor_alloc_capacity - 1);
+        }
+        thor_alloc_blocks[slot].pointer = pointer;
+        thor_alloc_blocks[slot].size = size;
+        thor_alloc_blocks[slot].site = site;
+        thor_alloc_block_count++;
+        site->live += size;
+        thor_alloc_live += size;
+        if (thor_alloc_live > thor_alloc_peak) {
+            thor_alloc_peak = thor_alloc_live;
+        }
+    }
+    THOR_ALLOC_UNLOCK();
+    return pointer;
+}
+
+void thor_alloc_free(void* pointer) {
+    if (!pointer) {
+        return;
+    }
+    THOR_ALLOC_LOCK();
+    if (thor_alloc_capacity > 0) {
+        size_t slot = thor_alloc_slot(pointer);
+        while (thor_alloc_blocks[slot].pointer && thor_alloc_blocks[slot].pointer != pointer) {
+            slot = (slot + 1) & (thor_alloc_capacity - 1);
+        }
+        if (thor_alloc_blocks[slot].pointer) {
+            thor_alloc_blocks[slot].site->live -= thor_alloc_blocks[slot].size;
+            thor_alloc_live -= thor_alloc_blocks[slot].size;
+            thor_alloc_block_count--;
+            // Shift later blocks of the probe sequence back into the hole
+            size_t hole = slot;
+            for (size_t next = (hole + 1) & (thor_alloc_capacity - 1); thor_alloc_blocks[next].pointer;
+                 next = (next + 1) & (thor_alloc_capacity - 1)) {
+                size_t home = thor_alloc_slot(thor_alloc_blocks[next].pointer);
+                if (((next - home) & (thor_alloc_capacity - 1)) >= ((next - hole) & (thor_alloc_capacity - 1))) {
+                    thor_alloc_blocks[hole] = thor_alloc_blocks[next];
+                    hole = next;
+                }
+            }
+            thor_alloc_blocks[hole].pointer = NULL;
+        }
+    }
+    THOR_ALLOC_UNLOCK();
+    free(pointer);
+}
+
+char* thor_input_at(thor_alloc_site* site, const char* prompt) {
+    printf("%s", prompt);
+    char* buffer = (char*)thor_alloc(site, 1024);
+    fgets(buffer, 1024, stdin);
+    // Remove newline
+    int len = strlen(buffer);
+    if (len > 0 && buffer[len-1] == '\n') {
+        buffer[len-1] = '\0';
+    }
+    return buffer;
+}
+
+char* thor_format_string_at(thor_alloc_site* site, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    char* buffer = (char*)thor_alloc(site, 1024);
+    vsnprintf(buffer, 1024, format, args);
+    va_end(args);
+    return buffer;
+}
+#endif
+
+)RUNTIME";
+
+// Sampling profiler, compiled into every program on Linux (x86-64 and AArch64)
+// built by a GCC-compatible compiler in its default (GNU) dialect, and switched
+// on at run time: THOR_PROFILE=<file> samples the stack on a CPU-time timer
+// (SIGPROF) and writes folded stacks to <file> at exit and whenever the process
+// gets SIGUSR2. Stacks are unwound
+// through frame pointers, which generated code is always compiled with. Thor
+// functions are placed in the section thor_text and named in the table
+// thor_symbols, so the handler can name every frame without a symbol table.
+static const char* SAMPLER_DECLARATIONS = R"(#if defined(__linux__) && defined(__GNUC__) && !defined(__STRICT_ANSI__) && \
+    (defined(__x86_64__) || defined(__aarch64__)) && !defined(THOR_NO_SAMPLER)
+#define THOR_SAMPLER 1
+typedef struct {
+    void (*address)(void);
+    const char* name; // Thor-level, e.g. "mathlib.add"
+} thor_sample_symbol;
+#define THOR_SAMPLED __attribute__((section("thor_text")))
+#define THOR_SAMPLE_SYMBOL(function, name) \
+    static const thor_sample_symbol thor_sample_symbol_##function \
+        __attribute__((used, section("thor_symbols"), aligned(sizeof(void*)))) = { (void (*)(void))function, name };
+#else
+#define THOR_SAMPLED
+#define THOR_SAMPLE_SYMBOL(function, name)
+#endif
+
+)";
+
+static const char* SAMPLER_RUNTIME = R"RUNTIME(#ifdef THOR_SAMPLER
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#define THOR_SAMPLE_DEPTH 64        // frames kept, nearest the leaf; deeper stacks get a [truncated] root
+#define THOR_SAMPLE_SLOTS 16384     // distinct stacks; samples of further ones are dropped
+#define THOR_SAMPLE_MAX_FRAME (1 << 20)
+
+// The linker provides these for sections whose names are C identifiers; they
+// stay null in programs without Thor functions
+extern const thor_sample_symbol __start_thor_symbols[] __attribute__((weak));
+extern const thor_sample_symbol __stop_thor_symbols[] __attribute__((weak));
+extern const char __stop_thor_text[] __attribute__((weak));
+
+typedef struct {
+    unsigned long long samples;
+    unsigned long long hash;
+    unsigned int depth;               // 0 while the slot is free
+    unsigned int frames[THOR_SAMPLE_DEPTH + 1]; // symbol indices, leaf first
+} thor_sample_stack;
+
+static uintptr_t* thor_sample_starts;   // sorted function addresses
+static const char** thor_sample_names;
+static unsigned int thor_sample_symbol_count;
+static unsigned int thor_sample_native;    // index of "[native]": code outside Thor functions
+static unsigned int thor_sample_truncated; // index of "[truncated]"
+static thor_sample_stack* thor_sample_stacks;
+static char thor_sample_path[4096];
+static char thor_sample_lock_flag;
+static volatile unsigned long long thor_sample_total;
+static volatile unsigned long long thor_sample_dropped;
+
+static unsigned int thor_sample_lookup(uintptr_t pc) {
+    unsigned int low = 0, high = thor_sample_symbol_count;
+    if (high == 0 || pc < thor_sample_starts[0] || pc >= (uintptr_t)__stop_thor_text) {
+        return thor_sample_native;
+    }
+    while (high - low > 1) {
+        unsigned int middle = low + (high - low) / 2;
+        if (thor_sample_starts[middle] <= pc) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+static void thor_sample_push(unsigned int* frames, unsigned int* depth, unsigned int symbol) {
+    // Runs of native frames (libc, the runtime) show as one
+    if (symbol == thor_sample_native && *depth > 0 && frames[*depth - 1] == thor_sample_native) {
+        return;
+    }
+    frames[(*depth)++] = symbol;
+}
+
+static int thor_sample_plausible(uintptr_t fp, uintptr_t low) {
+    return fp >= low && fp - low < THOR_SAMPLE_MAX_FRAME && fp % sizeof(uintptr_t) == 0;
+}
+
+// GCC gives leaf functions that need no stack no frame, whatever the flags, and
+// no function has one before its prologue has run. The caller is then found from
+// the return address (on top of the stack, or in the link register), which is
+// trusted only if it follows a direct call to the interrupted function.
+static uintptr_t thor_sample_leaf_return(const ucontext_t* uc, uintptr_t pc, uintptr_t sp) {
+    unsigned int symbol = thor_sample_lookup(pc);
+    if (symbol == thor_sample_native) {
+        return 0;
+    }
+    uintptr_t start = thor_sample_starts[symbol];
+#if defined(__x86_64__)
+    (void)uc;
+    uintptr_t ret = *(const uintptr_t*)sp;
+    if (thor_sample_lookup(ret - 1) == thor_sample_native || ret - 5 < thor_sample_starts[0]) {
+        return 0;
+    }
+    int32_t offset;
+    memcpy(&offset, (const void*)(ret - 4), sizeof(offset));
+    return *(const unsigned char*)(ret - 5) == 0xE8 && ret + offset == start ? ret : 0;
+#else
+    (void)sp;
+    uintptr_t ret = (uintptr_t)uc->uc_mcontext.regs[30];
+    if (thor_sample_lookup(ret - 1) == thor_sample_native || ret - 4 < thor_sample_starts[0]) {
+        return 0;
+    }
+    uint32_t instruction = *(const uint32_t*)(ret - 4);
+    int64_t offset = (int64_t)((int32_t)(instruction << 6) >> 6) * 4;
+    return (instruction & 0xFC000000u) == 0x94000000u && ret - 4 + offset == start ? ret : 0;
+#endif
+}
+
+// Only async-signal-safe work here: no allocation, no stdio, and no waiting
+// for the lock, which a report on this thread may hold
+static void thor_sample_on_timer(int signal, siginfo_t* info, void* context) {
+    (void)signal;
+    (void)info;
+    const ucontext_t* uc = (const ucontext_t*)context;
+#if defined(__x86_64__)
+    // REG_RIP, REG_RBP and REG_RSP, which need _GNU_SOURCE
+    uintptr_t pc = (uintptr_t)uc->uc_mcontext.gregs[16];
+    uintptr_t fp = (uintptr_t)uc->uc_mcontext.gregs[10];
+    uintptr_t low = (uintptr_t)uc->uc_mcontext.gregs[15];
+#else
+    uintptr_t pc = (uintptr_t)uc->uc_mcontext.pc;
+    uintptr_t fp = (uintptr_t)uc->uc_mcontext.regs[29];
+    uintptr_t low = (uintptr_t)uc->uc_mcontext.sp;
+#endif
+    unsigned int frames[THOR_SAMPLE_DEPTH + 1];
+    unsigned int depth = 0;
+    thor_sample_push(frames, &depth, thor_sample_lookup(pc));
+    uintptr_t caller = thor_sample_leaf_return(uc, pc, low);
+    if (caller && !(thor_sample_plausible(fp, low) && ((const uintptr_t*)fp)[1] == caller)) {
+        thor_sample_push(frames, &depth, thor_sample_lookup(caller - 1));
+    }
+
+    // Each frame holds the caller's frame pointer and then the return address.
+    // Code built without frame pointers may leave anything in the register, so
+    // the chain is followed only while it climbs the stack in plausible steps.
+    while (thor_sample_plausible(fp, low)) {
+        const uintptr_t* frame = (const uintptr_t*)fp;
+        if (frame[1] == 0) {
+            break;
+        }
+        if (depth == THOR_SAMPLE_DEPTH) {
+            frames[depth++] = thor_sample_truncated;
+            break;
+        }
+        thor_sample_push(frames, &depth, thor_sample_lookup(frame[1] - 1)); // the call, not what follows it
+        low = fp + 2 * sizeof(uintptr_t);
+        fp = frame[0];
+    }
+    // Frames below the outermost Thor function (libc's start-up code) say nothing
+    while (depth > 1 && frames[depth - 1] == thor_sample_native) {
+        depth--;
+    }
+
+    unsigned long long hash = 14695981039346656037ULL;
+    for (unsigned int i = 0; i < depth; i++) {
+        hash = (hash ^ frames[i]) * 1099511628211ULL;
+    }
+    if (__atomic_test_and_set(&thor_sample_lock_flag, __ATOMIC_ACQUIRE)) {
+        thor_sample_dropped++;
+        return;
+    }
+    thor_sample_total++;
+    for (unsigned int probe = 0; probe < 64; probe++) {
+        thor_sample_stack* slot = &thor_sample_stacks[(hash + probe) % THOR_SAMPLE_SLOTS];
+        if (slot->depth == 0) {
+            slot->hash = hash;
+            slot->depth = depth;
+            memcpy(slot->frames, frames, depth * sizeof(unsigned int));
+        } else if (slot->hash != hash || slot->depth != depth ||
+                   memcmp(slot->frames, frames, depth * sizeof(unsigned int)) != 0) {
+            continue;
+        }
+        slot->samples++;
+        __atomic_clear(&thor_sample_lock_flag, __ATOMIC_RELEASE);
+        return;
+    }
+    thor_sample_dropped++;
+    __atomic_clear(&thor_sample_lock_flag, __ATOMIC_RELEASE);
+}
+
+typedef struct {
+    int fd;
+    size_t used;
+    char buffer[4096];
+} thor_sample_writer;
+
+static void thor_sample_write(thor_sample_writer* out, const char* text, size_t length) {
+    while (length > 0) {
+        if (out->used == sizeof(out->buffer)) {
+            if (write(out->fd, out->buffer, out->used) < 0) {
+                return;
+            }
+            out->used = 0;
+        }
+        size_t chunk = sizeof(out->buffer) - out->used < length ? sizeof(out->buffer) - out->used : length;
+        memcpy(out->buffer + out->used, text, chunk);
+        out->used += chunk;
+        text += chunk;
+        length -= chunk;
+    }
+}
+
+// Rewrites the file with every stack sampled so far, root first, one per line:
+// "main.main;main.parse;[native] 42". Safe to call from a signal handler.
+static void thor_sample_report(void) {
+    int fd = open(thor_sample_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return;
+    }
+    thor_sample_writer out;
+    out.fd = fd;
+    out.used = 0;
+    while (__atomic_test_and_set(&thor_sample_lock_flag, __ATOMIC_ACQUIRE)) {
+    }
+    for (unsigned int i = 0; i < THOR_SAMPLE_SLOTS; i++) {
+        const thor_sample_stack* stack = &thor_sample_stacks[i];
+        if (stack->depth == 0) {
+            continue;
+        }
+        for (unsigned int j = stack->depth; j-- > 0;) {
+            const char* name = thor_sample_names[stack->frames[j]];
+            thor_sample_write(&out, name, strlen(name));
+            thor_sample_write(&out, j > 0 ? ";" : " ", 1);
+        }
+        char digits[24];
+        size_t length = 0;
+        unsigned long long samples = stack->samples;
+        do {
+            digits[sizeof(digits) - ++length] = (char)('0' + samples % 10);
+            samples /= 10;
+        } while (samples > 0);
+        thor_sample_write(&out, digits + sizeof(digits) - length, length);
+        thor_sample_write(&out, "\n", 1);
+    }
+    __atomic_clear(&thor_sample_lock_flag, __ATOMIC_RELEASE);
+    if (out.used > 0 && write(fd, out.buffer, out.used) < 0) {
+        out.used = 0;
+    }
+    close(fd);
+}
+
+static void thor_sample_on_request(int signal) {
+    (void)signal;
+    thor_sample_report();
+}
+
+static void thor_sample_stop(void) {
+    struct itimerval off;
+    memset(&off, 0, sizeof(off));
+    setitimer(ITIMER_PROF, &off, NULL);
+    // A report interrupted by a sample or a request on this thread would wait for itself
+    sigset_t blocked;
+    sigemptyset(&blocked);
+    sigaddset(&blocked, SIGPROF);
+    sigaddset(&blocked, SIGUSR2);
+    sigprocmask(SIG_BLOCK, &blocked, NULL);
+    thor_sample_report();
+    fprintf(stderr, "thor: %llu samples written to %s", thor_sample_total, thor_sample_path);
+    if (thor_sample_dropped > 0) {
+        fprintf(stderr, " (%llu dropped)", thor_sample_dropped);
+    }
+    fprintf(stderr, "\n");
+}
+
+static int thor_sample_by_address(const void* a, const void* b) {
+    uintptr_t x = (uintptr_t)((const thor_sample_symbol*)a)->address;
+    uintptr_t y = (uintptr_t)((const thor_sample_symbol*)b)->address;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+__attribute__((constructor)) static void thor_sample_start(void) {
+    const char* path = getenv("THOR_PROFILE");
+    if (!path || !path[0]) {
+        return;
+    }
+    if (strlen(path) >= sizeof(thor_sample_path)) {
+        fprintf(stderr, "thor: THOR_PROFILE path is too long; not profiling\n");
+        return;
+    }
+    strcpy(thor_sample_path, path);
+    const char* rate = getenv("THOR_PROFILE_HZ");
+    long hz = rate ? strtol(rate, NULL, 10) : 0;
+    if (hz <= 0 || hz > 100000) {
+        hz = 1000;
+    }
+
+    size_t count = __start_thor_symbols && __stop_thor_symbols ? (size_t)(__stop_thor_symbols - __start_thor_symbols) : 0;
+    thor_sample_symbol* sorted = (thor_sample_symbol*)malloc((count + 1) * sizeof(thor_sample_symbol));
+    thor_sample_starts = (uintptr_t*)malloc((count + 1) * sizeof(uintptr_t));
+    thor_sample_names = (const char**)malloc((count + 2) * sizeof(const char*));
+    thor_sample_stacks = (thor_sample_stack*)calloc(THOR_SAMPLE_SLOTS, sizeof(thor_sample_stack));
+    if (!sorted || !thor_sample_starts || !thor_sample_names || !thor_sample_stacks) {
+        fprintf(stderr, "thor: out of memory for the profiler; not profiling\n");
+        return;
+    }
+    if (count > 0) {
+        memcpy(sorted, __start_thor_symbols, count * sizeof(thor_sample_symbol));
+        qsort(sorted, count, sizeof(thor_sample_symbol), thor_sample_by_address);
+    }
+    for (size_t i = 0; i < count; i++) {
+        thor_sample_starts[i] = (uintptr_t)sorted[i].address;
+        thor_sample_names[i] = sorted[i].name;
+    }
+    free(sorted);
+    thor_sample_symbol_count = (unsigned int)count;
+    thor_sample_native = thor_sample_symbol_count;
+    thor_sample_truncated = thor_sample_symbol_count + 1;
+    thor_sample_names[thor_sample_native] = "[native]";
+    thor_sample_names[thor_sample_truncated] = "[truncated]";
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = thor_sample_on_timer;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaddset(&action.sa_mask, SIGUSR2);
+    sigaction(SIGPROF, &action, NULL);
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = thor_sample_on_request;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaddset(&action.sa_mask, SIGPROF);
+    sigaction(SIGUSR2, &action, NULL);
+
+    atexit(thor_sample_stop);
+    struct itimerval timer;
+    timer.it_interval.tv_sec = 1000000 / hz / 1000000;
+    timer.it_interval.tv_usec = 1000000 / hz % 1000000;
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_PROF, &timer, NULL);
+}
+#endif
+
+)RUNTIME";
+
+// Benchmark harness (thor bench), compiled in only when THOR_BENCHMARKS is
+// defined. Every bench block becomes a function that runs its body a given
+// number of times, and main() becomes the harness: for each bench it grows the
+// batch size until one batch takes the sample time, then times a number of
+// batches and reports nanoseconds per iteration for each. Variables declared
+// in a bench body are passed through THOR_BENCH_KEEP() at the end of every
+// iteration, so the C compiler cannot drop the work that computes them.
+static const char* BENCH_RUNTIME = R"RUNTIME(#ifdef THOR_BENCHMARKS
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+typedef struct {
+    const char* name;
+    void (*run)(long long iterations);
+} thor_bench;
+
+#if defined(__GNUC__) || defined(__clang__)
+#define THOR_BENCH_KEEP(value) __asm__ volatile("" : : "g"(value) : "memory")
+#else
+static void* volatile thor_bench_sink;
+#define THOR_BENCH_KEEP(value) (thor_bench_sink = (void*)&(value))
+#endif
+
+// Monotonic time in nanoseconds
+static double thor_bench_now(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER now;
+    if (!frequency.QuadPart) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    QueryPerformanceCounter(&now);
+    return (double)now.QuadPart * 1e9 / (double)frequency.QuadPart;
+#elif defined(CLOCK_MONOTONIC)
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+#else
+    return (double)clock() * (1e9 / CLOCKS_PER_SEC);
+#endif
+}
+
+static double thor_bench_time(const thor_bench* bench, long long iterations) {
+    double start = thor_bench_now();
+    bench->run(iterations);
+    return thor_bench_now() - start;
+}
+
+// Options: --samples <n>, --sample-time <microseconds>, --only <bench>
+// (repeatable) and --results <file>. Each bench is reported on one line:
+// its name, the iterations per sample, then every sample in ns per iteration.
+static int thor_bench_main(const thor_bench* benches, int count, int argc, char** argv) {
+    int samples = 100;
+    double sampleTime = 2e6;
+    FILE* results = stdout;
+    int only = 0;
+    int i;
+    for (i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--samples") == 0) {
+            samples = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "--sample-time") == 0) {
+            sampleTime = atof(argv[i + 1]) * 1e3;
+        } else if (strcmp(argv[i], "--only") == 0) {
+            only = 1;
+        } else if (strcmp(argv[i], "--results") == 0) {
+            results = fopen(argv[i + 1], "w");
+            if (!results) {
+                fprintf(stderr, "thor bench: cannot write %s\n", argv[i + 1]);
+                return 1;
+            }
+        }
+    }
+    if (samples < 1) {
+        samples = 1;
+    }
+
+    for (i = 0; i < count; i++) {
+        const thor_bench* bench = &benches[i];
+        long long iterations = 1;
+        double elapsed;
+        int selected = !only;
+        int j;
+        for (j = 1; j + 1 < argc; j += 2) {
+            if (strcmp(argv[j], "--only") == 0 && strcmp(argv[j + 1], bench->name) == 0) {
+                selected = 1;
+            }
+        }
+        if (!selected) {
+            continue;
+        }
+
+        // Calibrate; the first batch also warms caches and branch predictors
+        elapsed = thor_bench_time(bench, iterations);
+        while (elapsed < sampleTime && iterations < (1LL << 40)) {
+            double scale = elapsed > 0 ? sampleTime * 1.2 / elapsed : 100;
+            if (scale > 100) scale = 100;
+            if (scale < 2) scale = 2;
+            iterations = (long long)(iterations * scale);
+            elapsed = thor_bench_time(bench, iterations);
+        }
+
+        fprintf(results, "%s %lld", bench->name, iterations);
+        for (j = 0; j < samples; j++) {
+            fprintf(results, " %.9g", thor_bench_time(bench, iterations) / (double)iterations);
+        }
+        fprintf(results, "\n");
+        fflush(results);
+    }
+    if (results != stdout) {
+        fclose(results);
+    }
+    return 0;
+}
+#endif
+
+)RUNTIME";
+
+// `=` and the compound assignments (`+=`, `<<=`, ...), but not `==`, `!=`, `<=` or `>=`
+static bool isAssignmentOperator(const std::string& op) {
+    return !op.empty() && op.back() == '=' && op != "==" && op != "!=" && op != "<=" && op != ">=";
+}
+
+// Whether `(a inner b) outer c` may be written `a inner b outer c`: the same
+// operator, or operators that share a precedence level in both Thor and C
+static bool chainsWith(const std::string& inner, const std::string& outer) {
+    auto additive = [](const std::string& op) { return op == "+" || op == "-"; };
+    auto multiplicative = [](const std::string& op) { return op == "*" || op == "/" || op == "%"; };
+    return inner == outer || (additive(inner) && additive(outer)) ||
+           (multiplicative(inner) && multiplicative(outer));
+}
+
+// A string literal for a #line directive
+static std::string quotedPath(const std::string& path) {
+    std::string quoted = "\"";
+    for (char c : path) {
+        if (c == '\\' || c == '"') {
+            quoted += '\\';
+        }
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+// A C string literal with the text of a Thor string (whose escapes the lexer
+// has already resolved)
+static std::string quotedString(const std::string& text) {
+    static const char* const octal = "01234567";
+    std::string quoted = "\"";
+    for (char c : text) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        switch (c) {
+            case '\\': quoted += "\\\\"; break;
+            case '"': quoted += "\\\""; break;
+            case '\n': quoted += "\\n"; break;
+            case '\t': quoted += "\\t"; break;
+            case '\r': quoted += "\\r"; break;
+            default:
+                if (byte < 0x20 || byte == 0x7F) {
+                    quoted += { '\\', octal[byte >> 6], octal[(byte >> 3) & 7], octal[byte & 7] };
+                } else {
+                    quoted += c;
+                }
+        }
+    }
+    return quoted + "\"";
+}
 
 CodeGenerator::CodeGenerator() : indentLevel(0) {
     initializeBuiltinFunctions();
 }
 
+void CodeGenerator::setInstrumentation(bool enabled) {
+    instrument = enabled;
+}
+
+void CodeGenerator::setAllocationTracking(bool enabled) {
+    trackAllocations = enabled;
+}
+
+void CodeGenerator::setBenchmarks(bool enabled) {
+    benchmarks = enabled;
+}
+
+void CodeGenerator::setLineDirectives(const std::string& path, int first) {
+    generatedPath = path;
+    firstLine = first;
+}
+
+void CodeGenerator::mapLine(const Statement& stmt) {
+    // Statements that did not come from a file stay attributed to the generated code
+    if (!currentProgram || currentProgram->sourcePath.empty() || lineBase <= 0) {
+        unmapLines();
+        return;
+    }
+    const std::string& file = currentProgram->sourcePath;
+    int line = sourceLine(stmt);
+    if (mapped && outputLine + mappedOffset == line && mappedFile == file) {
+        return; // the C compiler's own line counting already lands on it
+    }
+    output << "#line " << line << " " << quotedPath(file) << "\n";
+    outputLine++;
+    mapped = true;
+    mappedFile = file;
+    mappedOffset = line - outputLine;
+}
+
+int CodeGenerator::sourceLine(const Statement& stmt) const {
+    return &stmt == topLevelStatement ? stmt.line : lineBase + stmt.line;
+}
+
+void CodeGenerator::unmapLines() {
+    if (!mapped) {
+        return;
+    }
+    output << "#line " << outputLine + 1 << " " << quotedPath(generatedPath) << "\n";
+    outputLine++;
+    mapped = false;
+}
+
 std::string CodeGenerator::generate(std::shared_ptr<Program> program, 
                                   const std::unordered_map<std::string, std::shared_ptr<Program>>& importedModules) {
     output.clear();
     output.str("");
     indentLevel = 0;
+    outputLine = firstLine;
+    mapped = false;
     modules = importedModules;
+    packageTypes.clear();
+    for (const auto& [moduleName, moduleProgram] : modules) {
+        addPackageTypes(moduleProgram);
+    }
     
+    if (instrument) {
+        writeLine("#define THOR_INSTRUMENT");
+    }
+    if (trackAllocations) {
+        writeLine("#define THOR_TRACK_ALLOCATIONS");
+    }
+    if (benchmarks) {
+        writeLine("#define THOR_BENCHMARKS");
+    }
+    unsigned sections = runtimeSections(*program);
+    for (const auto& [moduleName, moduleProgram] : modules) {
+        sections |= runtimeSections(*moduleProgram);
+    }
+    if (modules.count("std.fs")) {
+        sections |= RUNTIME_FS;
+    }
     generateIncludes();
-    generateBuiltinFunctions();
+    if (sections & (RUNTIME_FORMAT | RUNTIME_STR | RUNTIME_PARSE)) {
+        write(STR_DECLARATIONS);
+    }
+    if (trackAllocations) {
+        write(ALLOCATION_DECLARATIONS);
+    }
+    generateBuiltinFunctions(sections);
+    if (instrument) {
+        write(PROFILE_DECLARATIONS);
+        write(PROFILE_RUNTIME);
+    }
+    if (trackAllocations) {
+        write(ALLOCATION_RUNTIME);
+    }
+    write(SAMPLER_DECLARATIONS);
+    write(SAMPLER_RUNTIME);
+    if (benchmarks) {
+        write(BENCH_RUNTIME);
+    }
     
     // Generate code for all modules first
     for (const auto& [moduleName, moduleProgram] : modules) {
@@ -22,12 +3297,263 @@ std::string CodeGenerator::generate(std::shared_ptr<Program> program,
         writeLine();
     }
     
-    // Generate main program
+    // Generate main program
+    benchProgram = program.get();
+    generateProgram(program);
+    if (benchmarks) {
+        generateBenchMain(program);
+    }
+    benchProgram = nullptr;
+    
+    return output.str();
+}
+
+unsigned CodeGenerator::runtimeSections(const Program& program) {
+    // Conservative: every builtin a call names, every format expression and
+    // every str a function with a body declares counts, whether it runs or not
+    unsigned sections = 0;
+    auto declare = [&](const std::shared_ptr<Type>& type) {
+        for (const Type* part = type.get(); part; part = part->elementType.get()) {
+            if (part->kind == Type::STR_TYPE) {
+                sections |= RUNTIME_STR;
+            }
+        }
+    };
+    std::vector<const Statement*> statements;
+    std::vector<const Expression*> expressions;
+    for (const auto& stmt : program.statements) {
+        statements.push_back(stmt.get());
+    }
+    auto visit = [&](const std::shared_ptr<Expression>& expr) {
+        if (expr) expressions.push_back(expr.get());
+    };
+    auto visitStatement = [&](const std::shared_ptr<Statement>& stmt) {
+        if (stmt) statements.push_back(stmt.get());
+    };
+    while (!statements.empty()) {
+        const Statement* stmt = statements.back();
+        statements.pop_back();
+        if (auto exprStmt = dynamic_cast<const ExpressionStatement*>(stmt)) {
+            visit(exprStmt->expression);
+        } else if (auto varDecl = dynamic_cast<const VariableDeclaration*>(stmt)) {
+            declare(varDecl->type);
+            visit(varDecl->initializer);
+        } else if (auto constDecl = dynamic_cast<const ConstDeclaration*>(stmt)) {
+            declare(constDecl->type);
+            visit(constDecl->initializer);
+        } else if (auto block = dynamic_cast<const BlockStatement*>(stmt)) {
+            for (const auto& inner : block->statements) {
+                visitStatement(inner);
+            }
+        } else if (auto ifStmt = dynamic_cast<const IfStatement*>(stmt)) {
+            visit(ifStmt->condition);
+            visitStatement(ifStmt->thenBranch);
+            visitStatement(ifStmt->elseBranch);
+        } else if (auto whileStmt = dynamic_cast<const WhileStatement*>(stmt)) {
+            visit(whileStmt->condition);
+            visitStatement(whileStmt->body);
+        } else if (auto returnStmt = dynamic_cast<const ReturnStatement*>(stmt)) {
+            visit(returnStmt->value);
+        } else if (auto func = dynamic_cast<const FunctionDeclaration*>(stmt)) {
+            // Bodiless declarations, like those of the builtin modules, emit nothing
+            if (func->body) {
+                for (const auto& param : func->parameters) {
+                    declare(param.type);
+                }
+                declare(func->returnType);
+                visitStatement(func->body);
+            }
+        } else if (auto bench = dynamic_cast<const BenchDeclaration*>(stmt)) {
+            visitStatement(bench->body);
+        }
+    }
+    while (!expressions.empty()) {
+        const Expression* expr = expressions.back();
+        expressions.pop_back();
+        if (auto binary = dynamic_cast<const BinaryExpression*>(expr)) {
+            visit(binary->left);
+            visit(binary->right);
+        } else if (auto unary = dynamic_cast<const UnaryExpression*>(expr)) {
+            visit(unary->operand);
+        } else if (auto call = dynamic_cast<const CallExpression*>(expr)) {
+            auto member = std::dynamic_pointer_cast<MemberExpression>(call->callee);
+            auto package = member ? std::dynamic_pointer_cast<IdentifierExpression>(member->object) : nullptr;
+            if (package) {
+                auto builtin = builtinFunctions.find(package->name + "." + member->property);
+                if (builtin != builtinFunctions.end()) {
+                    auto found = builtinSections.find(builtin->second);
+                    sections |= found != builtinSections.end() ? found->second : 0;
+                }
+            }
+            visit(call->callee);
+            for (const auto& arg : call->arguments) {
+                visit(arg);
+            }
+        } else if (auto member = dynamic_cast<const MemberExpression*>(expr)) {
+            visit(member->object);
+        } else if (auto array = dynamic_cast<const ArrayExpression*>(expr)) {
+            for (const auto& element : array->elements) {
+                visit(element);
+            }
+        } else if (auto formatStr = dynamic_cast<const FormatStringExpression*>(expr)) {
+            sections |= RUNTIME_FORMAT;
+            for (const auto& arg : formatStr->arguments) {
+                visit(arg);
+            }
+        }
+    }
+    return sections;
+}
+
+std::string CodeGenerator::generateRuntimeHeader() {
+    output.clear();
+    output.str("");
+    indentLevel = 0;
+    
+    writeLine("#pragma once");
+    generateIncludes();
+    write(STR_DECLARATIONS);
+    write(ALLOCATION_DECLARATIONS);
+    generateBuiltinDeclarations(RUNTIME_ALL);
+    write(HOT_RELOAD_DECLARATIONS);
+    write(PROFILE_DECLARATIONS);
+    write(SAMPLER_DECLARATIONS);
+    
+    return output.str();
+}
+
+std::string CodeGenerator::generateRuntimeSource() {
+    output.clear();
+    output.str("");
+    indentLevel = 0;
+    
+    writeLine(std::string("#include \"") + RUNTIME_HEADER + "\"");
+    writeLine();
+    generateBuiltinFunctions(RUNTIME_ALL);
+    write(HOT_RELOAD_RUNTIME);
+    write(PROFILE_RUNTIME);
+    write(ALLOCATION_RUNTIME);
+    write(SAMPLER_RUNTIME);
+    
+    return output.str();
+}
+
+std::string CodeGenerator::generateModule(std::shared_ptr<Program> program,
+                                        const std::vector<std::shared_ptr<Program>>& dependencies) {
+    output.clear();
+    output.str("");
+    indentLevel = 0;
+    outputLine = firstLine;
+    mapped = false;
+    
+    writeLine(std::string("#include \"") + RUNTIME_HEADER + "\"");
+    writeLine();
+    
+    // Imported modules are compiled separately - only their declarations are needed here
+    packageTypes.clear();
+    for (const auto& dependency : dependencies) {
+        generateDeclarations(dependency);
+        addPackageTypes(dependency);
+    }
+    
+    generateProgram(program);
+    
+    return output.str();
+}
+
+void CodeGenerator::setHotPackages(const std::unordered_set<std::string>& packages) {
+    hotPackages = packages;
+}
+
+std::string CodeGenerator::packageName(std::shared_ptr<Program> program) {
+    return program->package ? program->package->name : "main";
+}
+
+std::string CodeGenerator::moduleTableName(const std::string& package) {
+    return "thor_mod_" + package;
+}
+
+std::string CodeGenerator::generateHotModule(std::shared_ptr<Program> program,
+                                           const std::vector<std::shared_ptr<Program>>& dependencies) {
+    std::string code = generateModule(program, dependencies);
+    output.clear();
+    output.str("");
+    
+    // The host calls this after every load to point its table at this generation's code
+    std::string package = packageName(program);
+    generateModuleTable(program);
+    writeLine("void thor_hot_bind_" + package + "(struct thor_module_" + package + "* table) {");
+    indentLevel++;
+    for (const auto& stmt : program->statements) {
+        auto funcDecl = std::dynamic_pointer_cast<FunctionDeclaration>(stmt);
+        if (funcDecl && funcDecl->body) {
+            writeLine("table->" + funcDecl->name + " = " + package + "_" + funcDecl->name + ";");
+        }
+    }
+    indentLevel--;
+    writeLine("}");
+    
+    return code + output.str();
+}
+
+std::string CodeGenerator::generateHotHost(std::shared_ptr<Program> program,
+                                         const std::vector<std::shared_ptr<Program>>& dependencies,
+                                         const std::vector<HotModule>& hotModules) {
+    output.clear();
+    output.str("");
+    indentLevel = 0;
+    outputLine = firstLine;
+    mapped = false;
+    
+    writeLine(std::string("#include \"") + RUNTIME_HEADER + "\"");
+    writeLine();
+    
+    // Every table lives in the host so it survives reloads of the modules that fill it
+    for (const auto& module : hotModules) {
+        generateModuleTable(module.program);
+        writeLine("struct thor_module_" + packageName(module.program) + " " +
+                  moduleTableName(packageName(module.program)) + ";");
+        writeLine();
+    }
+    
+    writeLine("static thor_hot_module thor_hot_modules_table[] = {");
+    indentLevel++;
+    for (const auto& module : hotModules) {
+        std::string package = packageName(module.program);
+        writeLine("{ \"" + package + "\", \"" + module.library + "\", &" + moduleTableName(package) +
+                  ", \"thor_hot_bind_" + package + "\", 0, 0 },");
+    }
+    if (hotModules.empty()) {
+        writeLine("{ 0, 0, 0, 0, 0, 0 }");
+    }
+    indentLevel--;
+    writeLine("};");
+    writeLine();
+    
+    packageTypes.clear();
+    for (const auto& dependency : dependencies) {
+        generateDeclarations(dependency);
+        addPackageTypes(dependency);
+    }
+    
+    emitSafepoints = true;
+    hotModuleCount = hotModules.size();
     generateProgram(program);
+    emitSafepoints = false;
     
     return output.str();
 }
 
+bool CodeGenerator::hasDefinitions(std::shared_ptr<Program> program) {
+    for (const auto& stmt : program->statements) {
+        auto funcDecl = std::dynamic_pointer_cast<FunctionDeclaration>(stmt);
+        if (!funcDecl || funcDecl->body) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void CodeGenerator::generateIncludes() {
     writeLine("#include <stdio.h>");
     writeLine("#include <stdlib.h>");
@@ -38,7 +3564,9 @@ void CodeGenerator::generateIncludes() {
 }
 
 void CodeGenerator::indent() {
-    for (int i = 0; i < indentLevel; i++) {
+    // Past MAX_INDENT levels lines are not indented further; otherwise deeply
+    // nested input would produce output quadratic in its size
+    for (int i = 0; i < std::min(indentLevel, MAX_INDENT); i++) {
         output << "    ";
     }
 }
@@ -46,16 +3574,90 @@ void CodeGenerator::indent() {
 void CodeGenerator::writeLine(const std::string& line) {
     if (!line.empty()) {
         indent();
-        output << line;
+        write(line);
     }
     output << "\n";
+    outputLine++;
 }
 
-void CodeGenerator::write(const std::string& text) {
+void CodeGenerator::write(std::string_view text) {
     output << text;
+    if (!generatedPath.empty()) {
+        outputLine += static_cast<int>(std::count(text.begin(), text.end(), '\n'));
+    }
+}
+
+void CodeGenerator::generateBuiltinDeclarations(unsigned sections) {
+    writeLine("char* thor_input(const char* prompt);");
+    writeLine("void thor_println(const char* str);");
+    writeLine("bool thor_string_equals(const char* a, const char* b);");
+    writeLine("char* thor_format_string(const char* format, ...);");
+    if (sections & RUNTIME_FORMAT) {
+        writeLine("char* thor_format_int(char* out, long long value);");
+        writeLine("char* thor_format_double(char* out, double value);");
+        writeLine("char* thor_format_float(char* out, float value);");
+        writeLine("size_t thor_format_length(const char* format, const char* types, va_list args);");
+        writeLine("char* thor_format_write(char* out, const char* format, const char* types, va_list args);");
+        writeLine("char* thor_format_values(const char* format, const char* types, ...);");
+    }
+    if (sections & RUNTIME_PARSE) {
+        writeLine("int thor_parse_int(thor_str text);");
+        writeLine("float thor_parse_float(thor_str text);");
+        writeLine("bool thor_has_next(void);");
+        writeLine("int thor_read_int(void);");
+        writeLine("float thor_read_float(void);");
+    }
+    if (sections & RUNTIME_FS) {
+        writeLine("int thor_fs_open(const char* path, const char* mode);");
+        writeLine("bool thor_fs_close(int file);");
+        writeLine("char* thor_fs_read(int file, int count);");
+        writeLine("char* thor_fs_read_line(int file);");
+        writeLine("bool thor_fs_eof(int file);");
+        writeLine("bool thor_fs_write(int file, const char* text);");
+        writeLine("bool thor_fs_flush(int file);");
+        writeLine("int thor_fs_map_file(const char* path);");
+        writeLine("char* thor_fs_contents(int map);");
+        writeLine("bool thor_fs_next_line(int map);");
+        writeLine("char* thor_fs_line(int map);");
+        writeLine("bool thor_fs_unmap(int map);");
+    }
+    if (sections & RUNTIME_STR) {
+        writeLine("thor_str thor_str_of(const char* text);");
+        writeLine("thor_str thor_str_substr(thor_str view, int start, int count);");
+        writeLine("thor_str thor_str_trim(thor_str view);");
+        writeLine("int thor_str_length(thor_str view);");
+        writeLine("bool thor_str_empty(thor_str view);");
+        writeLine("bool thor_str_equals(thor_str a, thor_str b);");
+        writeLine("char* thor_str_copy(thor_str view);");
+    }
+    if (sections & RUNTIME_TEXT) {
+        writeLine("int thor_str_find(thor_str view, thor_str needle);");
+        writeLine("bool thor_str_contains(thor_str view, thor_str needle);");
+        writeLine("int thor_str_count(thor_str view, thor_str needle);");
+        writeLine("thor_str thor_str_split(thor_str* rest, thor_str separator);");
+        writeLine("char* thor_str_replace(thor_str view, thor_str from, thor_str to);");
+    }
+    
+    // The _at variants that live with the sections above (see ALLOCATION_DECLARATIONS)
+    writeLine("#ifdef THOR_TRACK_ALLOCATIONS");
+    if (sections & RUNTIME_FORMAT) {
+        writeLine("char* thor_format_values_at(thor_alloc_site* site, const char* format, const char* types, ...);");
+    }
+    if (sections & RUNTIME_FS) {
+        writeLine("char* thor_fs_read_at(thor_alloc_site* site, int file, int count);");
+        writeLine("char* thor_fs_read_line_at(thor_alloc_site* site, int file);");
+    }
+    if (sections & RUNTIME_STR) {
+        writeLine("char* thor_str_copy_at(thor_alloc_site* site, thor_str view);");
+    }
+    if (sections & RUNTIME_TEXT) {
+        writeLine("char* thor_str_replace_at(thor_alloc_site* site, thor_str view, thor_str from, thor_str to);");
+    }
+    writeLine("#endif");
+    writeLine();
 }
 
-void CodeGenerator::generateBuiltinFunctions() {
+void CodeGenerator::generateBuiltinFunctions(unsigned sections) {
     // String input function
     writeLine("char* thor_input(const char* prompt) {");
     indentLevel++;
@@ -102,33 +3704,56 @@ void CodeGenerator::generateBuiltinFunctions() {
     indentLevel--;
     writeLine("}");
     writeLine();
+    
+    if (sections & RUNTIME_FORMAT) {
+        write(NUMBER_FORMAT_RUNTIME);
+        writeLine();
+    }
+    if (sections & RUNTIME_PARSE) {
+        write(NUMBER_PARSE_RUNTIME);
+        writeLine();
+    }
+    if (sections & RUNTIME_FS) {
+        write(FS_RUNTIME);
+        writeLine();
+    }
+    if (sections & RUNTIME_STR) {
+        write(STR_RUNTIME);
+        writeLine();
+    }
+    if (sections & RUNTIME_TEXT) {
+        write(TEXT_RUNTIME);
+        writeLine();
+        write(STR_SEARCH_RUNTIME);
+        writeLine();
+    }
 }
 
 void CodeGenerator::generateProgram(std::shared_ptr<Program> program) {
     currentProgram = program; // Set current program context
+    allocationSites.clear();
+    localTypes.clear();
+    programTypes.clear();
+    addDeclaredTypes(*program, programTypes, "");
+    if (trackAllocations) {
+        writeLine("extern thor_alloc_site " + allocationSiteTable() + "[];");
+    }
     
     // Generate forward declarations for functions
     for (auto& stmt : program->statements) {
         if (auto funcDecl = std::dynamic_pointer_cast<FunctionDeclaration>(stmt)) {
             // Skip built-in functions without bodies
-            if (!funcDecl->body) {
+            if (!funcDecl->body || (benchmarks && functionName(funcDecl) == "main")) {
                 continue;
             }
             
-            generateType(funcDecl->returnType);
-            write(" ");
-            if (program->package && program->package->name != "main") {
-                write(program->package->name + "_");
-            }
-            write(funcDecl->name + "(");
-            
-            for (size_t i = 0; i < funcDecl->parameters.size(); i++) {
-                if (i > 0) write(", ");
-                generateType(funcDecl->parameters[i].type);
-                write(" " + funcDecl->parameters[i].name);
+            generateFunctionSignature(funcDecl);
+            writeLine(";");
+            writeLine("THOR_SAMPLE_SYMBOL(" + functionName(funcDecl) + ", \"" + packageName(currentProgram) + "." +
+                      funcDecl->name + "\")");
+            if (instrument) {
+                generateProfileSite(funcDecl);
             }
-            
-            writeLine(");");
         }
     }
     
@@ -138,9 +3763,118 @@ void CodeGenerator::generateProgram(std::shared_ptr<Program> program) {
     
     // Generate function implementations
     for (auto& stmt : program->statements) {
+        topLevelStatement = stmt.get();
+        lineBase = stmt->line;
         generateStatement(stmt);
         writeLine();
     }
+    topLevelStatement = nullptr;
+    unmapLines();
+    
+    if (!allocationSites.empty()) {
+        writeLine("thor_alloc_site " + allocationSiteTable() + "[] = {");
+        indentLevel++;
+        for (const auto& site : allocationSites) {
+            writeLine(site);
+        }
+        indentLevel--;
+        writeLine("};");
+        writeLine();
+    }
+}
+
+void CodeGenerator::generateDeclarations(std::shared_ptr<Program> program) {
+    currentProgram = program;
+    bool hot = hotPackages.count(packageName(program)) > 0;
+    
+    if (hot) {
+        generateModuleTable(program);
+    }
+    
+    bool wroteAny = false;
+    for (auto& stmt : program->statements) {
+        if (auto funcDecl = std::dynamic_pointer_cast<FunctionDeclaration>(stmt)) {
+            if (!funcDecl->body || hot) {
+                continue;
+            }
+            generateFunctionSignature(funcDecl);
+            writeLine(";");
+            wroteAny = true;
+        } else if (auto constDecl = std::dynamic_pointer_cast<ConstDeclaration>(stmt)) {
+            if (hot) {
+                // A hot module's data is not linked into its importers; give each one its own copy
+                write("static const ");
+                generateType(constDecl->type);
+                write(" " + constDecl->name + " = ");
+                generateExpression(constDecl->initializer);
+                writeLine(";");
+            } else {
+                // File-scope const objects have external linkage in C
+                write("extern const ");
+                generateType(constDecl->type);
+                writeLine(" " + constDecl->name + ";");
+            }
+            wroteAny = true;
+        }
+    }
+    
+    if (wroteAny) {
+        writeLine();
+    }
+}
+
+void CodeGenerator::generateModuleTable(std::shared_ptr<Program> program) {
+    currentProgram = program;
+    std::string package = packageName(program);
+    
+    // Guarded, since both the host and importing modules may emit the same table type
+    writeLine("#ifndef THOR_MODULE_TABLE_" + package);
+    writeLine("#define THOR_MODULE_TABLE_" + package);
+    writeLine("struct thor_module_" + package + " {");
+    indentLevel++;
+    for (auto& stmt : program->statements) {
+        auto funcDecl = std::dynamic_pointer_cast<FunctionDeclaration>(stmt);
+        if (!funcDecl || !funcDecl->body) {
+            continue;
+        }
+        indent();
+        generateType(funcDecl->returnType);
+        write(" (*" + funcDecl->name + ")(");
+        for (size_t i = 0; i < funcDecl->parameters.size(); i++) {
+            if (i > 0) write(", ");
+            generateType(funcDecl->parameters[i].type);
+            write(" " + funcDecl->parameters[i].name);
+        }
+        writeLine(");");
+    }
+    indentLevel--;
+    writeLine("};");
+    writeLine("extern struct thor_module_" + package + " " + moduleTableName(package) + ";");
+    writeLine("#endif");
+    writeLine();
+}
+
+std::string CodeGenerator::functionName(std::shared_ptr<FunctionDeclaration> func) {
+    // Add module prefix for non-main functions
+    if (currentProgram && currentProgram->package && currentProgram->package->name != "main") {
+        return currentProgram->package->name + "_" + func->name;
+    }
+    return func->name;
+}
+
+void CodeGenerator::generateFunctionSignature(std::shared_ptr<FunctionDeclaration> func) {
+    generateType(func->returnType);
+    write(" ");
+    
+    write(functionName(func) + "(");
+    
+    for (size_t i = 0; i < func->parameters.size(); i++) {
+        if (i > 0) write(", ");
+        generateType(func->parameters[i].type);
+        write(" " + func->parameters[i].name);
+    }
+    
+    write(")");
 }
 
 void CodeGenerator::generateType(std::shared_ptr<Type> type) {
@@ -153,6 +3887,7 @@ std::string CodeGenerator::getCTypeName(std::shared_ptr<Type> type) {
         case Type::INTEGER_TYPE: return "int";
         case Type::FLOAT_TYPE: return "float";
         case Type::STRING_TYPE: return "char*";
+        case Type::STR_TYPE: return "thor_str";
         case Type::BOOLEAN_TYPE: return "bool";
         case Type::ARRAY_TYPE: 
             return getCTypeName(type->elementType) + "*";
@@ -162,7 +3897,35 @@ std::string CodeGenerator::getCTypeName(std::shared_ptr<Type> type) {
     }
 }
 
+void CodeGenerator::schedule(std::initializer_list<ExpressionTask> steps) {
+    expressionTasks.insert(expressionTasks.end(), std::rbegin(steps), std::rend(steps));
+}
+
+void CodeGenerator::scheduleExpressions(size_t mark) {
+    std::reverse(expressionTasks.begin() + mark, expressionTasks.end());
+}
+
+void CodeGenerator::scheduleStatements(size_t mark) {
+    std::reverse(statementTasks.begin() + mark, statementTasks.end());
+}
+
 void CodeGenerator::generateExpression(std::shared_ptr<Expression> expr) {
+    // Each step writes the text in front of a node's first operand and schedules
+    // the operands and the text between and after them
+    size_t base = expressionTasks.size();
+    expressionTasks.emplace_back(expr);
+    while (expressionTasks.size() > base) {
+        ExpressionTask task = std::move(expressionTasks.back());
+        expressionTasks.pop_back();
+        if (task.expression) {
+            generateExpressionStep(*task.expression, task.bare);
+        } else {
+            write(task.text);
+        }
+    }
+}
+
+void CodeGenerator::generateExpressionStep(const std::shared_ptr<Expression>& expr, bool bare) {
     if (auto literal = std::dynamic_pointer_cast<LiteralExpression>(expr)) {
         switch (literal->literalType) {
             case LiteralExpression::INTEGER:
@@ -172,7 +3935,7 @@ void CodeGenerator::generateExpression(std::shared_ptr<Expression> expr) {
                 write(literal->value);
                 break;
             case LiteralExpression::STRING:
-                write("\"" + literal->value + "\"");
+                write(quotedString(literal->value));
                 break;
             case LiteralExpression::BOOLEAN:
                 write(literal->value == "true" ? "true" : "false");
@@ -188,59 +3951,95 @@ void CodeGenerator::generateExpression(std::shared_ptr<Expression> expr) {
         }
     }
     else if (auto binary = std::dynamic_pointer_cast<BinaryExpression>(expr)) {
+        // Views compare by their text, either way round with a string
+        if ((binary->operator_ == "==" || binary->operator_ == "!=") &&
+            (formatType(binary->left) == 'v' || formatType(binary->right) == 'v')) {
+            static const std::shared_ptr<Type> view = Type::createStr();
+            const char* left = viewConversion(binary->left, view);
+            const char* right = viewConversion(binary->right, view);
+            write(binary->operator_ == "==" ? "thor_str_equals(" : "!thor_str_equals(");
+            schedule({ left ? left : "", binary->left, left ? ")" : "", ", ",
+                       right ? right : "", binary->right, right ? ")" : "", ")" });
+        }
         // Handle string equality specially
-        if (binary->operator_ == "==") {
+        else if (binary->operator_ == "==") {
             // Check if we're comparing strings
             write("thor_string_equals(");
-            generateExpression(binary->left);
-            write(", ");
-            generateExpression(binary->right);
-            write(")");
-        } else if (binary->operator_ == "=") {
-            // Handle assignment - check if left side is a reference parameter
+            schedule({ binary->left, ", ", binary->right, ")" });
+        } else if (isAssignmentOperator(binary->operator_)) {
+            // A string assigned to a str is viewed
+            const char* conversion = nullptr;
+            if (binary->operator_ == "=" && formatType(binary->left) == 'v') {
+                conversion = viewConversion(binary->right, Type::createStr());
+            }
+            // Handle assignment (plain or compound) - check if left side is a reference parameter
             if (auto identifier = std::dynamic_pointer_cast<IdentifierExpression>(binary->left)) {
                 if (referenceParameters.find(identifier->name) != referenceParameters.end()) {
                     // Assignment to reference parameter - dereference
-                    write("(*" + identifier->name + " = ");
-                    generateExpression(binary->right);
-                    write(")");
+                    write("(*" + identifier->name + " " + binary->operator_ + " ");
+                    schedule({ conversion ? conversion : "", binary->right, conversion ? "))" : ")" });
                     return;
                 }
             }
             // Regular assignment
             write("(");
-            generateExpression(binary->left);
-            write(" " + binary->operator_ + " ");
-            generateExpression(binary->right);
-            write(")");
+            schedule({ binary->left, " ", binary->operator_, " ",
+                       conversion ? conversion : "", binary->right, conversion ? "))" : ")" });
         } else {
-            write("(");
-            generateExpression(binary->left);
-            write(" " + binary->operator_ + " ");
-            generateExpression(binary->right);
-            write(")");
+            // Chains are written flat, a + b - c rather than ((a + b) - c): C
+            // groups them the same way, and C compilers handle long flat chains
+            // far better than deeply nested parentheses
+            auto left = std::dynamic_pointer_cast<BinaryExpression>(binary->left);
+            bool flatLeft = left && chainsWith(left->operator_, binary->operator_);
+            if (!bare) write("(");
+            schedule({ { binary->left, flatLeft }, " ", binary->operator_, " ", binary->right, bare ? "" : ")" });
         }
     }
     else if (auto unary = std::dynamic_pointer_cast<UnaryExpression>(expr)) {
         write("(" + unary->operator_);
-        generateExpression(unary->operand);
-        write(")");
+        schedule({ unary->operand, ")" });
     }
     else if (auto call = std::dynamic_pointer_cast<CallExpression>(expr)) {
+        std::vector<ExpressionTask>& steps = expressionTasks;
+        size_t mark = steps.size();
         if (auto member = std::dynamic_pointer_cast<MemberExpression>(call->callee)) {
             // Handle module function calls like std.println or math.add
             if (auto obj = std::dynamic_pointer_cast<IdentifierExpression>(member->object)) {
-                if (obj->name == "std") {
-                    if (member->property == "println") {
-                        write("thor_println(");
-                    } else if (member->property == "input") {
-                        write("thor_input(");
+                auto builtin = builtinFunctions.find(obj->name + "." + member->property);
+                if (builtin != builtinFunctions.end()) {
+                    if (trackAllocations && allocatingBuiltins.count(builtin->second)) {
+                        write(builtin->second + "_at(" + allocationSite() + (call->arguments.empty() ? "" : ", "));
+                    } else {
+                        write(builtin->second + "(");
                     }
+                } else if (hotPackages.count(obj->name)) {
+                    // Hot-reloadable module - call through its patchable table
+                    write(moduleTableName(obj->name) + "." + member->property + "(");
                 } else {
                     // Other module calls
                     write(obj->name + "_" + member->property + "(");
                 }
             }
+            
+            auto function = calleeType(*call);
+            for (size_t i = 0; i < call->arguments.size(); i++) {
+                if (i > 0) steps.emplace_back(", ");
+                auto parameter = function && i < function->parameterTypes.size() ? function->parameterTypes[i] : nullptr;
+                auto argIdentifier = std::dynamic_pointer_cast<IdentifierExpression>(call->arguments[i]);
+                if (parameter && parameter->kind == Type::REFERENCE_TYPE && argIdentifier) {
+                    // Passed by address, unless it already is one
+                    if (referenceParameters.find(argIdentifier->name) == referenceParameters.end()) {
+                        steps.emplace_back("&");
+                    }
+                    steps.emplace_back(argIdentifier->name);
+                } else if (const char* conversion = viewConversion(call->arguments[i], parameter)) {
+                    steps.emplace_back(conversion);
+                    steps.emplace_back(call->arguments[i]);
+                    steps.emplace_back(")");
+                } else {
+                    steps.emplace_back(call->arguments[i]);
+                }
+            }
         } else {
             // Check if this is a function with reference parameters
             bool hasReferenceParams = false;
@@ -250,48 +4049,55 @@ void CodeGenerator::generateExpression(std::shared_ptr<Expression> expr) {
                 // For now, hardcode known functions with reference parameters
                 hasReferenceParams = (functionName == "testRef" || functionName == "fromFingers");
             }
+            auto function = calleeType(*call);
             
-            generateExpression(call->callee);
-            write("(");
+            if (trackAllocations && functionName == "free") {
+                steps.emplace_back("thor_alloc_free"); // credits the site that allocated
+            } else {
+                steps.emplace_back(call->callee);
+            }
+            steps.emplace_back("(");
             
             for (size_t i = 0; i < call->arguments.size(); i++) {
-                if (i > 0) write(", ");
+                if (i > 0) steps.emplace_back(", ");
                 
                 if (hasReferenceParams) {
                     // For reference parameters, pass address of variables
                     if (auto argIdentifier = std::dynamic_pointer_cast<IdentifierExpression>(call->arguments[i])) {
-                        write("&" + argIdentifier->name);
+                        steps.emplace_back("&");
+                        steps.emplace_back(argIdentifier->name);
                     } else {
-                        generateExpression(call->arguments[i]);
+                        steps.emplace_back(call->arguments[i]);
                     }
+                } else if (const char* conversion = viewConversion(call->arguments[i],
+                               function && i < function->parameterTypes.size() ? function->parameterTypes[i] : nullptr)) {
+                    steps.emplace_back(conversion);
+                    steps.emplace_back(call->arguments[i]);
+                    steps.emplace_back(")");
                 } else {
-                    generateExpression(call->arguments[i]);
+                    steps.emplace_back(call->arguments[i]);
                 }
             }
-            write(")");
-            return;
-        }
-        
-        for (size_t i = 0; i < call->arguments.size(); i++) {
-            if (i > 0) write(", ");
-            generateExpression(call->arguments[i]);
         }
-        write(")");
+        steps.emplace_back(")");
+        scheduleExpressions(mark);
     }
     else if (auto member = std::dynamic_pointer_cast<MemberExpression>(expr)) {
-        generateExpression(member->object);
-        write("." + member->property);
+        schedule({ member->object, ".", member->property });
     }
     else if (auto formatStr = std::dynamic_pointer_cast<FormatStringExpression>(expr)) {
         generateFormatString(formatStr->format, formatStr->arguments);
     }
     else if (auto array = std::dynamic_pointer_cast<ArrayExpression>(expr)) {
         write("{");
+        std::vector<ExpressionTask>& steps = expressionTasks;
+        size_t mark = steps.size();
         for (size_t i = 0; i < array->elements.size(); i++) {
-            if (i > 0) write(", ");
-            generateExpression(array->elements[i]);
+            if (i > 0) steps.emplace_back(", ");
+            steps.emplace_back(array->elements[i]);
         }
-        write("}");
+        steps.emplace_back("}");
+        scheduleExpressions(mark);
     }
 }
 
@@ -349,8 +4155,194 @@ bool CodeGenerator::isStringExpression(std::shared_ptr<Expression> expr) {
     return false;
 }
 
-std::string CodeGenerator::generateFormatString(const std::string& format, 
-                                              const std::vector<std::shared_ptr<Expression>>& args) {
+void CodeGenerator::addDeclaredTypes(const Program& program,
+                                     std::unordered_map<std::string, std::shared_ptr<Type>>& types,
+                                     const std::string& prefix) {
+    for (const auto& stmt : program.statements) {
+        if (auto funcDecl = std::dynamic_pointer_cast<FunctionDeclaration>(stmt)) {
+            std::vector<std::shared_ptr<Type>> parameterTypes;
+            for (const auto& parameter : funcDecl->parameters) {
+                parameterTypes.push_back(parameter.type);
+            }
+            types[prefix + funcDecl->name + "()"] = Type::createFunction(parameterTypes, funcDecl->returnType);
+        } else if (auto constDecl = std::dynamic_pointer_cast<ConstDeclaration>(stmt)) {
+            types[prefix + constDecl->name] = constDecl->type;
+        }
+    }
+}
+
+void CodeGenerator::addPackageTypes(const std::shared_ptr<Program>& program) {
+    addDeclaredTypes(*program, packageTypes, packageName(program) + ".");
+}
+
+char CodeGenerator::formatType(const std::shared_ptr<Expression>& expr) {
+    // Walks the expression down to its operands: comparisons and logic give a
+    // bool, a format expression or call gives its declared type, and arithmetic
+    // takes C's usual conversions over the operand types it reaches. Float
+    // literals are C doubles.
+    bool arithmetic = false;
+    bool anyDouble = false, anyFloat = false;
+    char leaf = 0;
+    std::vector<const Expression*> pending{ expr.get() };
+    while (!pending.empty()) {
+        const Expression* node = pending.back();
+        pending.pop_back();
+        std::shared_ptr<Type> type;
+        char letter = 0;
+        if (auto literal = dynamic_cast<const LiteralExpression*>(node)) {
+            switch (literal->literalType) {
+                case LiteralExpression::INTEGER: letter = 'i'; break;
+                case LiteralExpression::FLOAT: letter = 'd'; break;
+                case LiteralExpression::STRING: letter = 's'; break;
+                case LiteralExpression::BOOLEAN: letter = 'b'; break;
+            }
+        } else if (auto identifier = dynamic_cast<const IdentifierExpression*>(node)) {
+            auto local = std::find_if(localTypes.rbegin(), localTypes.rend(),
+                                      [&](const auto& entry) { return entry.first == identifier->name; });
+            if (local != localTypes.rend()) {
+                type = local->second;
+            } else {
+                auto global = programTypes.find(identifier->name);
+                type = global != programTypes.end() ? global->second : nullptr;
+            }
+        } else if (auto binary = dynamic_cast<const BinaryExpression*>(node)) {
+            const std::string& op = binary->operator_;
+            if (op == "==" || op == "!=" || op == "<" || op == ">" || op == "<=" || op == ">=" ||
+                op == "&&" || op == "||") {
+                letter = 'b';
+            } else if (isAssignmentOperator(op)) {
+                pending.push_back(binary->left.get());
+                continue;
+            } else {
+                arithmetic = true;
+                pending.push_back(binary->left.get());
+                pending.push_back(binary->right.get());
+                continue;
+            }
+        } else if (auto unary = dynamic_cast<const UnaryExpression*>(node)) {
+            if (unary->operator_ == "!") {
+                letter = 'b';
+            } else {
+                arithmetic = true;
+                pending.push_back(unary->operand.get());
+                continue;
+            }
+        } else if (auto call = dynamic_cast<const CallExpression*>(node)) {
+            auto function = calleeType(*call);
+            type = function ? function->returnType : nullptr;
+        } else if (dynamic_cast<const FormatStringExpression*>(node)) {
+            letter = 's';
+        }
+        
+        if (type && type->kind == Type::REFERENCE_TYPE) {
+            type = type->elementType;
+        }
+        if (type) {
+            switch (type->kind) {
+                case Type::INTEGER_TYPE: letter = 'i'; break;
+                case Type::FLOAT_TYPE: letter = 'f'; break;
+                case Type::STRING_TYPE: letter = 's'; break;
+                case Type::STR_TYPE: letter = 'v'; break;
+                case Type::BOOLEAN_TYPE: letter = 'b'; break;
+                default: break;
+            }
+        }
+        if (letter == 0 || (arithmetic && (letter == 's' || letter == 'v'))) {
+            return 0;
+        }
+        leaf = letter;
+        anyDouble = anyDouble || letter == 'd';
+        anyFloat = anyFloat || letter == 'f';
+    }
+    if (!arithmetic) {
+        return leaf;
+    }
+    return anyDouble ? 'd' : anyFloat ? 'f' : 'i';
+}
+
+std::shared_ptr<Type> CodeGenerator::calleeType(const CallExpression& call) {
+    if (auto identifier = std::dynamic_pointer_cast<IdentifierExpression>(call.callee)) {
+        auto global = programTypes.find(identifier->name + "()");
+        return global != programTypes.end() ? global->second : nullptr;
+    }
+    if (auto member = std::dynamic_pointer_cast<MemberExpression>(call.callee)) {
+        if (auto package = std::dynamic_pointer_cast<IdentifierExpression>(member->object)) {
+            auto global = packageTypes.find(package->name + "." + member->property + "()");
+            return global != packageTypes.end() ? global->second : nullptr;
+        }
+    }
+    return nullptr;
+}
+
+const char* CodeGenerator::viewConversion(const std::shared_ptr<Expression>& expr, const std::shared_ptr<Type>& target) {
+    // A string goes where a str is expected as a view of all of it; a literal's
+    // length is known without counting
+    if (!target || target->kind != Type::STR_TYPE) {
+        return nullptr;
+    }
+    if (auto literal = std::dynamic_pointer_cast<LiteralExpression>(expr)) {
+        if (literal->literalType == LiteralExpression::STRING) {
+            return "thor_str_literal(";
+        }
+    }
+    return formatType(expr) == 's' ? "thor_str_of(" : nullptr;
+}
+
+void CodeGenerator::generateConverted(std::shared_ptr<Expression> expr, const std::shared_ptr<Type>& target) {
+    const char* conversion = viewConversion(expr, target);
+    if (conversion) {
+        write(conversion);
+    }
+    generateExpression(expr);
+    if (conversion) {
+        write(")");
+    }
+}
+
+void CodeGenerator::generateFormatString(const std::string& format, 
+                                       const std::vector<std::shared_ptr<Expression>>& args) {
+    // When every argument's type is known and the format has only %s (and %%),
+    // the arguments are formatted by type without going through printf:
+    // integers exactly, floats as the shortest text that reads back the same
+    std::string types;
+    size_t placeholders = 0;
+    bool typed = true;
+    for (size_t i = 0; i < format.size() && typed; i++) {
+        if (format[i] == '%') {
+            typed = i + 1 < format.size() && (format[i + 1] == 's' || format[i + 1] == '%');
+            placeholders += typed && format[i + 1] == 's';
+            i++;
+        }
+    }
+    typed = typed && placeholders == args.size();
+    for (size_t i = 0; i < args.size() && typed; i++) {
+        char letter = formatType(args[i]);
+        typed = letter != 0;
+        types += letter;
+    }
+    if (typed) {
+        if (trackAllocations) {
+            write("thor_format_values_at(" + allocationSite() + ", " + quotedString(format) + ", \"" + types + "\"");
+        } else {
+            write("thor_format_values(" + quotedString(format) + ", \"" + types + "\"");
+        }
+        std::vector<ExpressionTask>& steps = expressionTasks;
+        size_t mark = steps.size();
+        for (size_t i = 0; i < args.size(); i++) {
+            switch (types[i]) {
+                case 'i': steps.emplace_back(", (long long)("); break;
+                case 'd': case 'f': steps.emplace_back(", (double)("); break;
+                case 'b': steps.emplace_back(", (int)("); break;
+                default: steps.emplace_back(", ("); break;
+            }
+            steps.emplace_back(args[i]);
+            steps.emplace_back(")");
+        }
+        steps.emplace_back(")");
+        scheduleExpressions(mark);
+        return;
+    }
+    
     std::string result = format;
     
     // For each argument, determine the appropriate format specifier
@@ -361,7 +4353,9 @@ std::string CodeGenerator::generateFormatString(const std::string& format,
             std::string formatSpec;
             
             // Check if the argument is a literal
-            if (auto literal = std::dynamic_pointer_cast<LiteralExpression>(args[i])) {
+            if (formatType(args[i]) == 'v') {
+                formatSpec = "%s";
+            } else if (auto literal = std::dynamic_pointer_cast<LiteralExpression>(args[i])) {
                 if (literal->literalType == LiteralExpression::STRING || 
                     literal->literalType == LiteralExpression::BOOLEAN) {
                     formatSpec = "%s";
@@ -384,36 +4378,68 @@ std::string CodeGenerator::generateFormatString(const std::string& format,
         }
     }
     
-    write("thor_format_string(\"" + result + "\"");
+    if (trackAllocations) {
+        write("thor_format_string_at(" + allocationSite() + ", " + quotedString(result));
+    } else {
+        write("thor_format_string(" + quotedString(result));
+    }
+    std::vector<ExpressionTask>& steps = expressionTasks;
+    size_t mark = steps.size();
     for (size_t i = 0; i < args.size(); i++) {
-        write(", ");
+        steps.emplace_back(", ");
         
         // Handle different argument types appropriately
-        if (auto literal = std::dynamic_pointer_cast<LiteralExpression>(args[i])) {
+        if (formatType(args[i]) == 'v') {
+            // printf needs the text of a view terminated
+            steps.emplace_back("thor_str_copy(");
+            steps.emplace_back(args[i]);
+            steps.emplace_back(")");
+        } else if (auto literal = std::dynamic_pointer_cast<LiteralExpression>(args[i])) {
             if (literal->literalType == LiteralExpression::INTEGER || 
                 literal->literalType == LiteralExpression::FLOAT) {
-                write("(double)(");
-                generateExpression(args[i]);
-                write(")");
+                steps.emplace_back("(double)(");
+                steps.emplace_back(args[i]);
+                steps.emplace_back(")");
             } else {
-                generateExpression(args[i]);
+                steps.emplace_back(args[i]);
             }
         } else if (isStringExpression(args[i])) {
             // String expressions don't need casting
-            generateExpression(args[i]);
+            steps.emplace_back(args[i]);
         } else {
             // Numeric variables - cast to double
-            write("(double)(");
-            generateExpression(args[i]);
-            write(")");
+            steps.emplace_back("(double)(");
+            steps.emplace_back(args[i]);
+            steps.emplace_back(")");
         }
     }
-    write(")");
-    
-    return "";
+    steps.emplace_back(")");
+    scheduleExpressions(mark);
 }
 
 void CodeGenerator::generateStatement(std::shared_ptr<Statement> stmt) {
+    // Like generateExpression: a compound statement writes its opening line and
+    // schedules its nested statements with the lines and indentation around them
+    size_t base = statementTasks.size();
+    statementTasks.emplace_back(stmt);
+    while (statementTasks.size() > base) {
+        StatementTask task = statementTasks.back();
+        statementTasks.pop_back();
+        switch (task.kind) {
+            case StatementTask::STATEMENT: generateStatementStep(*task.statement); break;
+            case StatementTask::LINE: writeLine(task.line); break;
+            case StatementTask::INDENT: indentLevel++; break;
+            case StatementTask::DEDENT: indentLevel--; break;
+            case StatementTask::SCOPE: localTypes.resize(task.locals); break;
+        }
+    }
+}
+
+void CodeGenerator::generateStatementStep(const std::shared_ptr<Statement>& stmt) {
+    if (!generatedPath.empty()) {
+        mapLine(*stmt);
+    }
+    currentLine = sourceLine(*stmt);
     if (auto exprStmt = std::dynamic_pointer_cast<ExpressionStatement>(stmt)) {
         indent();
         generateExpression(exprStmt->expression);
@@ -425,26 +4451,29 @@ void CodeGenerator::generateStatement(std::shared_ptr<Statement> stmt) {
         write(" " + varDecl->name);
         if (varDecl->initializer) {
             write(" = ");
-            generateExpression(varDecl->initializer);
+            generateConverted(varDecl->initializer, varDecl->type);
         }
         writeLine(";");
+        localTypes.emplace_back(varDecl->name, varDecl->type);
     }
     else if (auto constDecl = std::dynamic_pointer_cast<ConstDeclaration>(stmt)) {
         indent();
         write("const ");
         generateType(constDecl->type);
         write(" " + constDecl->name + " = ");
-        generateExpression(constDecl->initializer);
+        generateConverted(constDecl->initializer, constDecl->type);
         writeLine(";");
     }
     else if (auto block = std::dynamic_pointer_cast<BlockStatement>(stmt)) {
         writeLine("{");
         indentLevel++;
-        for (auto& statement : block->statements) {
-            generateStatement(statement);
-        }
-        indentLevel--;
-        writeLine("}");
+        std::vector<StatementTask>& steps = statementTasks;
+        size_t mark = steps.size();
+        steps.insert(steps.end(), block->statements.begin(), block->statements.end());
+        steps.emplace_back(StatementTask::scope(localTypes.size()));
+        steps.emplace_back(StatementTask::DEDENT);
+        steps.emplace_back(StatementTask::LINE, "}");
+        scheduleStatements(mark);
     }
     else if (auto ifStmt = std::dynamic_pointer_cast<IfStatement>(stmt)) {
         indent();
@@ -452,15 +4481,18 @@ void CodeGenerator::generateStatement(std::shared_ptr<Statement> stmt) {
         generateExpression(ifStmt->condition);
         writeLine(") {");
         indentLevel++;
-        generateStatement(ifStmt->thenBranch);
-        indentLevel--;
+        std::vector<StatementTask>& steps = statementTasks;
+        size_t mark = steps.size();
+        steps.emplace_back(ifStmt->thenBranch);
+        steps.emplace_back(StatementTask::DEDENT);
         if (ifStmt->elseBranch) {
-            writeLine("} else {");
-            indentLevel++;
-            generateStatement(ifStmt->elseBranch);
-            indentLevel--;
+            steps.emplace_back(StatementTask::LINE, "} else {");
+            steps.emplace_back(StatementTask::INDENT);
+            steps.emplace_back(ifStmt->elseBranch);
+            steps.emplace_back(StatementTask::DEDENT);
         }
-        writeLine("}");
+        steps.emplace_back(StatementTask::LINE, "}");
+        scheduleStatements(mark);
     }
     else if (auto whileStmt = std::dynamic_pointer_cast<WhileStatement>(stmt)) {
         indent();
@@ -468,66 +4500,225 @@ void CodeGenerator::generateStatement(std::shared_ptr<Statement> stmt) {
         generateExpression(whileStmt->condition);
         writeLine(") {");
         indentLevel++;
-        generateStatement(whileStmt->body);
-        indentLevel--;
-        writeLine("}");
+        if (emitSafepoints) {
+            writeLine("THOR_SAFEPOINT();");
+        }
+        size_t mark = statementTasks.size();
+        statementTasks.emplace_back(whileStmt->body);
+        statementTasks.emplace_back(StatementTask::DEDENT);
+        statementTasks.emplace_back(StatementTask::LINE, "}");
+        scheduleStatements(mark);
     }
     else if (auto returnStmt = std::dynamic_pointer_cast<ReturnStatement>(stmt)) {
         indent();
+        if (instrument && currentFunction) {
+            // The exit probe runs after the returned value is computed
+            write("{ ");
+            if (returnStmt->value) {
+                bool isVoid = currentFunction->returnType->kind == Type::VOID_TYPE;
+                write(isVoid ? "" : getCTypeName(currentFunction->returnType) + " thor_result = ");
+                generateConverted(returnStmt->value, currentFunction->returnType);
+                write(isVoid ? "; thor_prof_exit(); return; }" : "; thor_prof_exit(); return thor_result; }");
+            } else {
+                write("thor_prof_exit(); return; }");
+            }
+            writeLine();
+            return;
+        }
         write("return");
         if (returnStmt->value) {
             write(" ");
-            generateExpression(returnStmt->value);
+            generateConverted(returnStmt->value, currentFunction ? currentFunction->returnType : nullptr);
         }
         writeLine(";");
     }
     else if (auto funcDecl = std::dynamic_pointer_cast<FunctionDeclaration>(stmt)) {
         generateFunction(funcDecl);
     }
+    else if (auto bench = std::dynamic_pointer_cast<BenchDeclaration>(stmt)) {
+        // Only the program being benchmarked has its benches compiled
+        if (benchmarks && currentProgram.get() == benchProgram) {
+            generateBench(bench);
+        }
+    }
 }
 
 void CodeGenerator::generateFunction(std::shared_ptr<FunctionDeclaration> func) {
-    // Skip functions without bodies (built-in functions)
-    if (!func->body) {
+    // Skip functions without bodies (built-in functions), and the program's
+    // own main() when the benchmark harness replaces it
+    if (!func->body || (benchmarks && functionName(func) == "main")) {
         return;
     }
     
     // Clear and populate reference parameters for this function
     referenceParameters.clear();
+    size_t locals = localTypes.size();
     for (const auto& param : func->parameters) {
         if (param.type->kind == Type::REFERENCE_TYPE) {
             referenceParameters.insert(param.name);
         }
+        localTypes.emplace_back(param.name, param.type);
     }
     
-    generateType(func->returnType);
-    write(" ");
+    write("THOR_SAMPLED ");
+    generateFunctionSignature(func);
+    writeLine(" {");
+    indentLevel++;
+    currentFunction = func.get();
+    if (instrument) {
+        writeLine("thor_prof_enter(&" + profileSiteName(func) + ");");
+    }
     
-    // Add module prefix for non-main functions
-    std::string functionName = func->name;
-    if (currentProgram && currentProgram->package && currentProgram->package->name != "main") {
-        functionName = currentProgram->package->name + "_" + functionName;
+    // The hot-reload host loads its modules before any Thor code runs
+    if (emitSafepoints && func->name == "main" && hotModuleCount > 0) {
+        writeLine("thor_hot_init(thor_hot_modules_table, " + std::to_string(hotModuleCount) + ");");
     }
-    write(functionName + "(");
     
-    for (size_t i = 0; i < func->parameters.size(); i++) {
-        if (i > 0) write(", ");
-        generateType(func->parameters[i].type);
-        write(" " + func->parameters[i].name);
+    for (auto& statement : func->body->statements) {
+        generateStatement(statement);
+    }
+    if (instrument) {
+        // Functions that end without a return statement leave here
+        if (func->body->statements.empty() ||
+            !std::dynamic_pointer_cast<ReturnStatement>(func->body->statements.back())) {
+            writeLine("thor_prof_exit();");
+        }
     }
+    currentFunction = nullptr;
+    localTypes.resize(locals);
     
-    writeLine(") {");
+    indentLevel--;
+    writeLine("}");
+}
+
+void CodeGenerator::generateBench(std::shared_ptr<BenchDeclaration> bench) {
+    referenceParameters.clear();
+    size_t locals = localTypes.size();
+    writeLine("static void thor_bench_" + bench->name + "(long long thor_iterations) {");
     indentLevel++;
-    
-    for (auto& statement : func->body->statements) {
+    writeLine("long long thor_iteration;");
+    writeLine("for (thor_iteration = 0; thor_iteration < thor_iterations; thor_iteration++) {");
+    indentLevel++;
+    for (auto& statement : bench->body->statements) {
         generateStatement(statement);
     }
+    for (auto& statement : bench->body->statements) {
+        if (auto varDecl = std::dynamic_pointer_cast<VariableDeclaration>(statement)) {
+            writeLine("THOR_BENCH_KEEP(" + varDecl->name + ");");
+        }
+    }
+    localTypes.resize(locals);
+    indentLevel--;
+    writeLine("}");
+    indentLevel--;
+    writeLine("}");
+}
+
+void CodeGenerator::generateBenchMain(std::shared_ptr<Program> program) {
+    std::set<std::string> names;
+    for (const auto& stmt : program->statements) {
+        if (auto bench = std::dynamic_pointer_cast<BenchDeclaration>(stmt)) {
+            if (!names.insert(bench->name).second) {
+                throw std::runtime_error("Duplicate benchmark: " + bench->name);
+            }
+        }
+    }
     
+    writeLine("static const thor_bench thor_benches[] = {");
+    indentLevel++;
+    for (const auto& name : names) {
+        writeLine("{ \"" + name + "\", thor_bench_" + name + " },");
+    }
+    if (names.empty()) {
+        writeLine("{ 0, 0 }");
+    }
+    indentLevel--;
+    writeLine("};");
+    writeLine();
+    writeLine("int main(int argc, char** argv) {");
+    indentLevel++;
+    writeLine("return thor_bench_main(thor_benches, " + std::to_string(names.size()) + ", argc, argv);");
     indentLevel--;
     writeLine("}");
 }
 
+std::string CodeGenerator::profileSiteName(std::shared_ptr<FunctionDeclaration> func) {
+    return "thor_site_" + packageName(currentProgram) + "_" + func->name;
+}
+
+void CodeGenerator::generateProfileSite(std::shared_ptr<FunctionDeclaration> func) {
+    // Sites are static, so each translation unit counts the functions it defines
+    std::string file = currentProgram->sourcePath.empty() ? "\"\"" : quotedPath(currentProgram->sourcePath);
+    writeLine("static thor_prof_site " + profileSiteName(func) + " = { \"" + packageName(currentProgram) + "." +
+              func->name + "\", " + file + ", " + std::to_string(func->line) + ", 0 };");
+}
+
+std::string CodeGenerator::allocationSiteTable() {
+    // Tables are extern, so every module's table needs its own name
+    return "thor_alloc_sites_" + packageName(currentProgram);
+}
+
+std::string CodeGenerator::allocationSite() {
+    std::string function = packageName(currentProgram) + "." + (currentFunction ? currentFunction->name : "");
+    std::string file = currentProgram->sourcePath.empty() ? "\"\"" : quotedPath(currentProgram->sourcePath);
+    allocationSites.push_back("{ \"" + function + "\", " + file + ", " + std::to_string(currentLine) + ", 0, 0, 0, 0, 0 },");
+    return "&" + allocationSiteTable() + "[" + std::to_string(allocationSites.size() - 1) + "]";
+}
+
 void CodeGenerator::initializeBuiltinFunctions() {
     builtinFunctions["std.println"] = "thor_println";
     builtinFunctions["std.input"] = "thor_input";
+    builtinFunctions["std.parse_int"] = "thor_parse_int";
+    builtinFunctions["std.parse_float"] = "thor_parse_float";
+    builtinFunctions["std.has_next"] = "thor_has_next";
+    builtinFunctions["std.read_int"] = "thor_read_int";
+    builtinFunctions["std.read_float"] = "thor_read_float";
+    builtinFunctions["std.substr"] = "thor_str_substr";
+    builtinFunctions["std.trim"] = "thor_str_trim";
+    builtinFunctions["std.find"] = "thor_str_find";
+    builtinFunctions["std.contains"] = "thor_str_contains";
+    builtinFunctions["std.count"] = "thor_str_count";
+    builtinFunctions["std.replace"] = "thor_str_replace";
+    builtinFunctions["std.split"] = "thor_str_split";
+    builtinFunctions["std.length"] = "thor_str_length";
+    builtinFunctions["std.empty"] = "thor_str_empty";
+    builtinFunctions["std.copy"] = "thor_str_copy";
+    builtinFunctions["fs.open"] = "thor_fs_open";
+    builtinFunctions["fs.close"] = "thor_fs_close";
+    builtinFunctions["fs.read"] = "thor_fs_read";
+    builtinFunctions["fs.read_line"] = "thor_fs_read_line";
+    builtinFunctions["fs.eof"] = "thor_fs_eof";
+    builtinFunctions["fs.write"] = "thor_fs_write";
+    builtinFunctions["fs.flush"] = "thor_fs_flush";
+    builtinFunctions["fs.map"] = "thor_fs_map_file";
+    builtinFunctions["fs.contents"] = "thor_fs_contents";
+    builtinFunctions["fs.next_line"] = "thor_fs_next_line";
+    builtinFunctions["fs.line"] = "thor_fs_line";
+    builtinFunctions["fs.unmap"] = "thor_fs_unmap";
+    
+    // Builtins that return new strings have _at variants (see setAllocationTracking)
+    allocatingBuiltins = { "thor_input", "thor_fs_read", "thor_fs_read_line", "thor_str_copy",
+                           "thor_str_replace" };
+    
+    // Runtime sections beyond the always-present helpers (see runtimeSections)
+    for (const char* function : { "thor_str_substr", "thor_str_trim", "thor_str_length", "thor_str_empty",
+                                  "thor_str_copy" }) {
+        builtinSections[function] = RUNTIME_STR;
+    }
+    for (const char* function : { "thor_str_find", "thor_str_contains", "thor_str_count", "thor_str_split",
+                                  "thor_str_replace" }) {
+        builtinSections[function] = RUNTIME_STR | RUNTIME_TEXT;
+    }
+    // Normally the std.fs import brings these in; calls name them all the same
+    for (const auto& [name, function] : builtinFunctions) {
+        if (name.compare(0, 3, "fs.") == 0) {
+            builtinSections[function] = RUNTIME_FS;
+        }
+    }
+    // Strings passed to these are viewed first
+    builtinSections["thor_parse_int"] = RUNTIME_PARSE | RUNTIME_STR;
+    builtinSections["thor_parse_float"] = RUNTIME_PARSE | RUNTIME_STR;
+    for (const char* function : { "thor_has_next", "thor_read_int", "thor_read_float" }) {
+        builtinSections[function] = RUNTIME_PARSE;
+    }
 }
\ No newline at end of file
@@ -0,0 +1,316 @@
+#include "Compiler.h"
+#include "CodeGenerator.h"
+#include "ImportProcessor.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <regex>
+
+#ifdef _WIN32
+#include <process.h>
+#define THOR_POPEN _popen
+#define THOR_PCLOSE _pclose
+#define THOR_GETPID _getpid
+#else
+#include <unistd.h>
+#define THOR_POPEN popen
+#define THOR_PCLOSE pclose
+#define THOR_GETPID getpid
+#endif
+
+namespace fs = std::filesystem;
+
+std::string Diagnostic::toString() const {
+    std::string text;
+    if (!file.empty()) {
+        text += file + ":";
+        if (line > 0) {
+            text += std::to_string(line) + ":" + std::to_string(column) + ":";
+        }
+        text += " ";
+    }
+    switch (severity) {
+        case ERROR: text += "error: "; break;
+        case WARNING: text += "warning: "; break;
+        case NOTE: text += "note: "; break;
+        case REMARK: text += "remark: "; break;
+    }
+    return text + message;
+}
+
+// Runs a shell command and collects what it prints to stdout and stderr
+static bool runCapturing(const std::string& command, std::string& output) {
+    FILE* pipe = THOR_POPEN((command + " 2>&1").c_str(), "r");
+    if (!pipe) {
+        return false;
+    }
+    char buffer[4096];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+        output.append(buffer, count);
+    }
+    return THOR_PCLOSE(pipe) == 0;
+}
+
+// Turns "file:line:column: error: message" lines from a C compiler into
+// diagnostics; returns whether any of them is an error. Optimization remarks
+// ("optimized:"/"missed:" from gcc, "remark:" from clang) become REMARKs.
+static bool parseCompilerOutput(const std::string& output, std::vector<Diagnostic>& diagnostics) {
+    bool errors = false;
+    static const std::regex located(
+        "^(.*?):([0-9]+):([0-9]+): (fatal error|error|warning|note|optimized|missed|remark): +(.*)$");
+    static const std::regex gccSymbol("([A-Za-z_][A-Za-z0-9_]*)/[0-9]+"); // "main/52" in remarks
+    size_t start = 0;
+    while (start < output.size()) {
+        size_t end = output.find('\n', start);
+        if (end == std::string::npos) {
+            end = output.size();
+        }
+        std::string line = output.substr(start, end - start);
+        start = end + 1;
+
+        std::smatch match;
+        if (!std::regex_match(line, match, located)) {
+            continue;
+        }
+        Diagnostic diagnostic;
+        std::string kind = match[4];
+        diagnostic.severity = kind == "warning" ? Diagnostic::WARNING
+                            : kind == "note" ? Diagnostic::NOTE
+                            : kind == "optimized" || kind == "missed" || kind == "remark" ? Diagnostic::REMARK
+                            : Diagnostic::ERROR;
+        diagnostic.file = match[1];
+        diagnostic.line = std::stoi(match[2]);
+        diagnostic.column = std::stoi(match[3]);
+        diagnostic.message = match[5];
+        if (kind == "optimized" || kind == "missed") {
+            diagnostic.message = kind + ": " + std::regex_replace(diagnostic.message, gccSymbol, "$1");
+        }
+        diagnostics.push_back(diagnostic);
+        errors |= diagnostic.severity == Diagnostic::ERROR;
+    }
+    return errors;
+}
+
+static bool hasErrors(const std::vector<Diagnostic>& diagnostics) {
+    for (const auto& diagnostic : diagnostics) {
+        if (diagnostic.severity == Diagnostic::ERROR) {
+            return true;
+        }
+    }
+    return false;
+}
+
+Compiler::Compiler() : Compiler(std::make_shared<DiskFileProvider>()) {}
+
+Compiler::Compiler(std::shared_ptr<FileProvider> files, std::vector<std::string> searchPaths)
+    : files(std::move(files)), searchPaths(std::move(searchPaths)) {}
+
+void Compiler::setCCompiler(const CCompiler& compiler) {
+    cCompiler = compiler;
+    cCompilerLocated = true;
+}
+
+std::shared_ptr<Program> Compiler::parse(const std::string& source, const std::string& path,
+                                         std::vector<Diagnostic>& diagnostics) {
+    try {
+        Lexer lexer(source);
+        Parser parser(lexer.tokenize());
+        auto program = parser.parse();
+        program->sourcePath = path;
+        return program;
+    } catch (const SyntaxError& e) {
+        diagnostics.push_back({ Diagnostic::ERROR, path, e.line, e.column, e.message });
+    } catch (const std::exception& e) {
+        diagnostics.push_back({ Diagnostic::ERROR, path, 0, 0, e.what() });
+    }
+    return nullptr;
+}
+
+std::shared_ptr<Program> Compiler::loadModule(const ModuleProvider& provider, const ImportDeclaration& import,
+                                              const std::string& importer, std::string& path,
+                                              std::vector<Diagnostic>& diagnostics) {
+    const std::string& module = import.module;
+    if (auto builtin = ImportProcessor::createBuiltinModule(module)) {
+        return builtin;
+    }
+
+    std::string source;
+    if (!provider.load(module, importer, path, source)) {
+        diagnostics.push_back({ Diagnostic::ERROR, importer, import.line, import.column, "Could not find module: " + module });
+        return nullptr;
+    }
+
+    auto cached = moduleCache.find(path);
+    if (cached != moduleCache.end() && cached->second.source == source) {
+        return cached->second.program;
+    }
+    auto program = parse(source, path, diagnostics);
+    if (program) {
+        moduleCache[path] = { std::move(source), program };
+    }
+    return program;
+}
+
+// Where C generated for `path` goes by default
+static std::string defaultGeneratedPath(const std::string& path) {
+    return fs::path(path).replace_extension(".c").string();
+}
+
+Compiler::Result Compiler::compileToC(const std::string& source, const std::string& path,
+                                      const std::string& generatedPath) {
+    return compile(source, path, generatedPath.empty() ? defaultGeneratedPath(path) : generatedPath);
+}
+
+Compiler::Result Compiler::compile(const std::string& source, const std::string& path, const std::string& generatedPath) {
+    Result result;
+    auto program = parse(source, path, result.diagnostics);
+    if (!program) {
+        return result;
+    }
+
+    // Without search paths, modules are found from the compiled file's own directory
+    std::shared_ptr<ModuleProvider> provider = modules;
+    if (!provider) {
+        std::string root = fs::path(path).parent_path().string();
+        provider = std::make_shared<SearchPathModuleProvider>(
+            files, searchPaths.empty() ? std::vector<std::string>{ root.empty() ? "." : root } : searchPaths);
+    }
+
+    // Load imports breadth-first; each module's imports are looked up next to it
+    std::unordered_map<std::string, std::shared_ptr<Program>> loaded;
+    std::vector<std::pair<std::shared_ptr<Program>, std::string>> pending = { { program, path } };
+    for (size_t i = 0; i < pending.size(); i++) {
+        auto importer = pending[i];
+        for (const auto& import : importer.first->imports) {
+            if (loaded.count(import->module)) {
+                continue;
+            }
+            std::string modulePath;
+            auto module = loadModule(*provider, *import, importer.second, modulePath, result.diagnostics);
+            loaded[import->module] = module;
+            if (module) {
+                pending.push_back({ module, modulePath });
+            }
+        }
+    }
+    if (hasErrors(result.diagnostics)) {
+        return result;
+    }
+
+    try {
+        CodeGenerator generator;
+        if (debugInfo || remarks) {
+            generator.setLineDirectives(generatedPath);
+        }
+        generator.setInstrumentation(instrument);
+        generator.setAllocationTracking(trackAllocations);
+        generator.setBenchmarks(benchmarks);
+        result.code = generator.generate(program, loaded);
+    } catch (const std::exception& e) {
+        result.diagnostics.push_back({ Diagnostic::ERROR, path, 0, 0, e.what() });
+        return result;
+    }
+    result.success = true;
+    return result;
+}
+
+Compiler::Result Compiler::compileFileToC(const std::string& path, const std::string& generatedPath) {
+    std::string source;
+    if (!files->read(path, source)) {
+        Result result;
+        result.diagnostics.push_back({ Diagnostic::ERROR, path, 0, 0, "Could not open input file" });
+        return result;
+    }
+    return compileToC(source, path, generatedPath);
+}
+
+Compiler::Result Compiler::compileToExecutable(const std::string& source, const std::string& executable,
+                                               const std::string& path) {
+    std::string generatedPath = defaultGeneratedPath(executable);
+    Result result = compileToC(source, path, generatedPath);
+    if (result.success) {
+        result.success = buildExecutable(result, executable, generatedPath);
+    }
+    return result;
+}
+
+Compiler::Result Compiler::compileFileToExecutable(const std::string& path, const std::string& executable) {
+    std::string generatedPath = defaultGeneratedPath(executable);
+    Result result = compileFileToC(path, generatedPath);
+    if (result.success) {
+        result.success = buildExecutable(result, executable, generatedPath);
+    }
+    return result;
+}
+
+bool Compiler::buildExecutable(Result& result, const std::string& executable, const std::string& generatedPath) {
+    if (!cCompilerLocated) {
+        cCompiler = CompilerLocator().locate();
+        cCompilerLocated = true;
+    }
+    if (cCompiler.empty()) {
+        result.diagnostics.push_back({ Diagnostic::ERROR, "", 0, 0,
+                                       "No C compiler found. Please install gcc, clang, or MinGW." });
+        return false;
+    }
+
+    // Otherwise each build gets its own temporary C file, so several Compilers can build at once
+    static std::atomic<unsigned> builds{ 0 };
+    std::error_code ec;
+    bool keep = debugInfo && !generatedPath.empty();
+    fs::path cFile = keep ? fs::path(generatedPath)
+                          : fs::temp_directory_path(ec) /
+                            ("thor_" + std::to_string(THOR_GETPID()) + "_" + std::to_string(builds++) + ".c");
+    {
+        std::ofstream out(cFile, std::ios::binary);
+        if (!out.is_open() || !(out << result.code)) {
+            result.diagnostics.push_back({ Diagnostic::ERROR, cFile.string(), 0, 0, "Could not write generated C" });
+            return false;
+        }
+    }
+
+    std::string command = cCompiler.command() + (debugInfo ? " -g" : "");
+    for (const auto& flag : cCompiler.frameFlags()) {
+        command += " " + flag;
+    }
+    if (remarks) {
+        for (const auto& flag : cCompiler.remarkFlags()) {
+            command += " \"" + flag + "\"";
+        }
+    }
+    for (const auto& flag : cFlags) {
+        command += " " + flag;
+    }
+    command += " \"" + cFile.string() + "\" -o \"" + executable + "\"";
+
+    std::string output;
+    bool ok = runCapturing(command, output);
+    if (!keep) {
+        fs::remove(cFile, ec);
+    }
+
+    size_t first = result.diagnostics.size();
+    bool errors = parseCompilerOutput(output, result.diagnostics);
+    // Only remarks that #line maps back to Thor source are kept; those about the
+    // runtime, system headers and other code with no Thor line are noise here
+    result.diagnostics.erase(std::remove_if(result.diagnostics.begin() + first, result.diagnostics.end(),
+                                            [&](const Diagnostic& diagnostic) {
+                                                return diagnostic.severity == Diagnostic::REMARK &&
+                                                       fs::path(diagnostic.file).extension() != ".thor";
+                                            }),
+                             result.diagnostics.end());
+    if (!errors && !ok) {
+        // Linker errors and the like have no position; pass the output on as is
+        while (!output.empty() && (output.back() == '\n' || output.back() == '\r')) {
+            output.pop_back();
+        }
+        result.diagnostics.push_back({ Diagnostic::ERROR, "", 0, 0,
+                                       output.empty() ? "Failed to compile with " + cCompiler.name : output });
+    }
+    return ok;
+}
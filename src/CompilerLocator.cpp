@@ -0,0 +1,298 @@
+#include "CompilerLocator.h"
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#ifdef _WIN32
+#include <process.h>
+#define THOR_POPEN _popen
+#define THOR_PCLOSE _pclose
+#define THOR_GETPID _getpid
+static const char* NULL_DEVICE = "NUL";
+static const char PATH_SEPARATOR = ';';
+#else
+#include <unistd.h>
+#define THOR_POPEN popen
+#define THOR_PCLOSE pclose
+#define THOR_GETPID getpid
+static const char* NULL_DEVICE = "/dev/null";
+static const char PATH_SEPARATOR = ':';
+#endif
+
+namespace fs = std::filesystem;
+
+// Flags worth knowing about when building generated code
+static const std::vector<std::string> PROBED_FLAGS = {
+    "-O2", "-O3", "-march=native", "-pipe", "-g", "-fno-omit-frame-pointer", "-mno-omit-leaf-frame-pointer"
+};
+
+bool CCompiler::supportsFlag(const std::string& flag) const {
+    for (const auto& supported : supportedFlags) {
+        if (supported == flag) return true;
+    }
+    return false;
+}
+
+std::vector<std::string> CCompiler::frameFlags() const {
+    std::vector<std::string> flags;
+    for (const char* flag : { "-fno-omit-frame-pointer", "-mno-omit-leaf-frame-pointer" }) {
+        if (supportsFlag(flag)) {
+            flags.push_back(flag);
+        }
+    }
+    return flags;
+}
+
+std::vector<std::string> CCompiler::remarkFlags() const {
+    // `cc` may be either; the version banner tells them apart
+    if (name.find("clang") != std::string::npos || version.find("clang") != std::string::npos) {
+        return { "-Rpass=loop-vectorize|inline", "-Rpass-missed=loop-vectorize|inline",
+                 "-Rpass-analysis=loop-vectorize" };
+    }
+    if (name.find("gcc") != std::string::npos || version.find("GCC") != std::string::npos ||
+        version.find("gcc") != std::string::npos) {
+        return { "-fopt-info-vec-inline-optimized-missed" };
+    }
+    return {};
+}
+
+std::string CCompiler::command() const {
+    return "\"" + path + "\"";
+}
+
+CompilerLocator::CompilerLocator() : CompilerLocator(defaultCacheFile()) {}
+
+CompilerLocator::CompilerLocator(const std::string& cacheFile) : cacheFile(cacheFile) {
+    loadCache();
+}
+
+std::string CompilerLocator::defaultCacheFile() {
+    fs::path base;
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME")) {
+        base = xdg;
+    } else if (const char* home = std::getenv("HOME")) {
+        base = fs::path(home) / ".cache";
+    } else if (const char* local = std::getenv("LOCALAPPDATA")) {
+        base = local;
+    } else {
+        base = fs::temp_directory_path();
+    }
+    return (base / "thor" / "compilers.cache").string();
+}
+
+std::string CompilerLocator::findInPath(const std::string& program) {
+    const char* pathEnv = std::getenv("PATH");
+    if (!pathEnv) return "";
+
+    std::vector<std::string> candidates = { program };
+#ifdef _WIN32
+    candidates.push_back(program + ".exe");
+#endif
+
+    std::stringstream dirs(pathEnv);
+    std::string dir;
+    while (std::getline(dirs, dir, PATH_SEPARATOR)) {
+        if (dir.empty()) dir = ".";
+        for (const auto& candidate : candidates) {
+            std::error_code ec;
+            fs::path full = fs::path(dir) / candidate;
+            if (!fs::is_regular_file(full, ec)) continue;
+#ifndef _WIN32
+            if (access(full.c_str(), X_OK) != 0) continue;
+#endif
+            return full.string();
+        }
+    }
+    return "";
+}
+
+CCompiler CompilerLocator::locate() {
+    std::vector<std::string> compilers = {
+        "gcc", "clang", "cc", "cl", "tcc", "mingw32-gcc"
+    };
+
+    for (const std::string& compiler : compilers) {
+        std::string path = findInPath(compiler);
+        if (!path.empty()) {
+            return describe(compiler, path);
+        }
+    }
+
+    // Try to find MinGW in common locations
+    std::vector<std::string> mingwPaths = {
+        "C:\\MinGW\\bin\\gcc.exe",
+        "C:\\MinGW64\\bin\\gcc.exe",
+        "C:\\msys64\\mingw64\\bin\\gcc.exe",
+        "C:\\msys64\\ucrt64\\bin\\gcc.exe",
+        "C:\\Program Files\\mingw-w64\\mingw64\\bin\\gcc.exe"
+    };
+
+    for (const std::string& path : mingwPaths) {
+        std::error_code ec;
+        if (fs::exists(path, ec)) {
+            return describe("gcc", path);
+        }
+    }
+
+    return CCompiler();
+}
+
+CCompiler CompilerLocator::describe(const std::string& name, const std::string& path) {
+    std::error_code ec;
+    long long mtime = fs::last_write_time(path, ec).time_since_epoch().count();
+
+    for (auto& entry : cached) {
+        if (entry.path == path) {
+            if (entry.mtime == mtime && entry.probedFlags == PROBED_FLAGS) {
+                return entry;
+            }
+            // Binary was upgraded, or this thor probes for more - re-probe in place
+            entry.name = name;
+            entry.mtime = mtime;
+            probe(entry);
+            saveCache();
+            return entry;
+        }
+    }
+
+    CCompiler compiler;
+    compiler.name = name;
+    compiler.path = path;
+    compiler.mtime = mtime;
+    probe(compiler);
+    cached.push_back(compiler);
+    saveCache();
+    return compiler;
+}
+
+void CompilerLocator::probe(CCompiler& compiler) const {
+    compiler.version.clear();
+    compiler.supportedFlags.clear();
+    compiler.probedFlags = PROBED_FLAGS;
+    compiler.supportsOpenMP = false;
+    compiler.supportsLTO = false;
+
+    // MSVC speaks a different flag dialect; nothing to probe
+    if (compiler.name == "cl") return;
+
+    std::string command = compiler.command() + " --version 2>&1";
+    if (FILE* pipe = THOR_POPEN(command.c_str(), "r")) {
+        char buffer[256];
+        if (fgets(buffer, sizeof(buffer), pipe)) {
+            compiler.version = buffer;
+            while (!compiler.version.empty() &&
+                   (compiler.version.back() == '\n' || compiler.version.back() == '\r')) {
+                compiler.version.pop_back();
+            }
+        }
+        THOR_PCLOSE(pipe);
+    }
+
+    for (const auto& flag : PROBED_FLAGS) {
+        if (tryFlag(compiler, flag)) {
+            compiler.supportedFlags.push_back(flag);
+        }
+    }
+    compiler.supportsOpenMP = tryFlag(compiler, "-fopenmp");
+    compiler.supportsLTO = tryFlag(compiler, "-flto");
+}
+
+bool CompilerLocator::tryFlag(const CCompiler& compiler, const std::string& flag) const {
+    std::error_code ec;
+    fs::path source = fs::temp_directory_path(ec) /
+                     ("thor_probe_" + std::to_string(THOR_GETPID()) + ".c");
+    {
+        std::ofstream out(source);
+        if (!out.is_open()) return false;
+        out << "int main(void) { return 0; }\n";
+    }
+
+    std::string command = compiler.command() + " " + flag + " \"" + source.string() +
+                          "\" -o " + NULL_DEVICE + " >" + NULL_DEVICE + " 2>&1";
+    bool ok = system(command.c_str()) == 0;
+    fs::remove(source, ec);
+    return ok;
+}
+
+void CompilerLocator::loadCache() {
+    std::ifstream file(cacheFile);
+    if (!file.is_open()) return;
+
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) continue;
+        std::string key = line.substr(0, eq);
+        std::string value = line.substr(eq + 1);
+
+        // Every record starts with its path
+        if (key == "path") {
+            cached.emplace_back();
+            cached.back().path = value;
+            continue;
+        }
+        if (cached.empty()) continue;
+
+        CCompiler& entry = cached.back();
+        if (key == "name") {
+            entry.name = value;
+        } else if (key == "mtime") {
+            entry.mtime = std::atoll(value.c_str());
+        } else if (key == "version") {
+            entry.version = value;
+        } else if (key == "openmp") {
+            entry.supportsOpenMP = value == "1";
+        } else if (key == "lto") {
+            entry.supportsLTO = value == "1";
+        } else if (key == "probed") {
+            std::stringstream flags(value);
+            std::string flag;
+            while (flags >> flag) {
+                entry.probedFlags.push_back(flag);
+            }
+        } else if (key == "flags") {
+            std::stringstream flags(value);
+            std::string flag;
+            while (flags >> flag) {
+                entry.supportedFlags.push_back(flag);
+            }
+        }
+    }
+}
+
+void CompilerLocator::saveCache() const {
+    std::error_code ec;
+    fs::create_directories(fs::path(cacheFile).parent_path(), ec);
+
+    // Write to a temporary file and rename so concurrent thor runs never see a torn cache
+    std::string tempFile = cacheFile + ".tmp" + std::to_string(THOR_GETPID());
+    {
+        std::ofstream file(tempFile);
+        if (!file.is_open()) return;
+
+        file << "# thor C compiler cache - regenerated when a compiler binary changes\n";
+        for (const auto& entry : cached) {
+            file << "path=" << entry.path << "\n";
+            file << "name=" << entry.name << "\n";
+            file << "mtime=" << entry.mtime << "\n";
+            file << "version=" << entry.version << "\n";
+            file << "openmp=" << (entry.supportsOpenMP ? 1 : 0) << "\n";
+            file << "lto=" << (entry.supportsLTO ? 1 : 0) << "\n";
+            file << "flags=";
+            for (size_t i = 0; i < entry.supportedFlags.size(); i++) {
+                if (i > 0) file << " ";
+                file << entry.supportedFlags[i];
+            }
+            file << "\n";
+            file << "probed=";
+            for (size_t i = 0; i < entry.probedFlags.size(); i++) {
+                if (i > 0) file << " ";
+                file << entry.probedFlags[i];
+            }
+            file << "\n\n";
+        }
+    }
+    fs::rename(tempFile, cacheFile, ec);
+}
@@ -0,0 +1,134 @@
+#include "FileWatcher.h"
+#include <chrono>
+#include <filesystem>
+#include <set>
+#include <thread>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+FileWatcher::FileWatcher() {
+#ifdef __linux__
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+}
+
+FileWatcher::~FileWatcher() {
+#ifdef __linux__
+    if (inotifyFd >= 0) {
+        close(inotifyFd);
+    }
+#endif
+}
+
+long long FileWatcher::modificationTime(const std::string& path) {
+    std::error_code ec;
+    auto time = fs::last_write_time(path, ec);
+    return ec ? -1 : static_cast<long long>(time.time_since_epoch().count());
+}
+
+void FileWatcher::watch(const std::vector<std::string>& paths) {
+    files.clear();
+    mtimes.clear();
+    for (const auto& path : paths) {
+        files.insert(path);
+        mtimes[path] = modificationTime(path);
+    }
+
+#ifdef __linux__
+    if (inotifyFd < 0) return;
+
+    std::set<std::string> wanted;
+    for (const auto& path : files) {
+        wanted.insert(fs::path(path).parent_path().string());
+    }
+
+    // Drop directories that no longer hold a watched file, then add new ones
+    for (auto it = directories.begin(); it != directories.end();) {
+        if (!wanted.count(it->second)) {
+            inotify_rm_watch(inotifyFd, it->first);
+            it = directories.erase(it);
+        } else {
+            wanted.erase(it->second);
+            ++it;
+        }
+    }
+    for (const auto& dir : wanted) {
+        int wd = inotify_add_watch(inotifyFd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+        if (wd >= 0) {
+            directories[wd] = dir;
+        }
+    }
+#endif
+}
+
+std::vector<std::string> FileWatcher::pollChanges() {
+    std::vector<std::string> changed;
+    for (auto& [path, mtime] : mtimes) {
+        long long current = modificationTime(path);
+        if (current != mtime) {
+            mtime = current;
+            changed.push_back(path);
+        }
+    }
+    return changed;
+}
+
+std::vector<std::string> FileWatcher::waitForChanges(int debounceMs) {
+    std::set<std::string> changed;
+
+#ifdef __linux__
+    if (inotifyFd >= 0) {
+        auto drain = [&](int timeoutMs) {
+            pollfd pfd = { inotifyFd, POLLIN, 0 };
+            if (poll(&pfd, 1, timeoutMs) <= 0) {
+                return false;
+            }
+
+            alignas(inotify_event) char buffer[16384];
+            ssize_t length;
+            while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+                for (char* ptr = buffer; ptr < buffer + length;) {
+                    auto* event = reinterpret_cast<inotify_event*>(ptr);
+                    auto dir = directories.find(event->wd);
+                    if (event->len > 0 && dir != directories.end()) {
+                        std::string path = (fs::path(dir->second) / event->name).string();
+                        if (files.count(path)) {
+                            changed.insert(path);
+                        }
+                    }
+                    ptr += sizeof(inotify_event) + event->len;
+                }
+            }
+            return true;
+        };
+
+        while (changed.empty()) {
+            drain(-1);
+        }
+        while (drain(debounceMs)) {}
+
+        for (const auto& path : changed) {
+            mtimes[path] = modificationTime(path);
+        }
+        return std::vector<std::string>(changed.begin(), changed.end());
+    }
+#endif
+
+    while (changed.empty()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        for (const auto& path : pollChanges()) {
+            changed.insert(path);
+        }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(debounceMs));
+    for (const auto& path : pollChanges()) {
+        changed.insert(path);
+    }
+    return std::vector<std::string>(changed.begin(), changed.end());
+}
@@ -1,9 +1,8 @@
 #include "ImportProcessor.h"
 #include "Lexer.h"
 #include "Parser.h"
-#include <filesystem>
+#include "SourceProviders.h"
 #include <fstream>
-#include <iostream>
 
 ImportProcessor::ImportProcessor() {
     // Add default search paths
@@ -11,10 +10,17 @@ ImportProcessor::ImportProcessor() {
     searchPaths.push_back("./example");
 }
 
+ImportProcessor::ImportProcessor(const std::vector<std::string>& searchPaths)
+    : searchPaths(searchPaths) {}
+
 void ImportProcessor::addSearchPath(const std::string& path) {
     searchPaths.push_back(path);
 }
 
+void ImportProcessor::addModule(const std::string& module, std::shared_ptr<Program> program) {
+    moduleCache[module] = program;
+}
+
 std::shared_ptr<Program> ImportProcessor::processImports(std::shared_ptr<Program> program) {
     // Load all imported modules
     for (auto& import : program->imports) {
@@ -25,32 +31,12 @@ std::shared_ptr<Program> ImportProcessor::processImports(std::shared_ptr<Program
 }
 
 std::string ImportProcessor::resolveModulePath(const std::string& module) const {
-    // Try to find the module file
-    for (const auto& searchPath : searchPaths) {
-        std::filesystem::path modulePath = std::filesystem::path(searchPath) / (module + ".thor");
-        if (std::filesystem::exists(modulePath)) {
-            return modulePath.string();
-        }
-        
-        // Also try with subdirectories
-        std::filesystem::path moduleSubPath = std::filesystem::path(searchPath) / module / (module + ".thor");
-        if (std::filesystem::exists(moduleSubPath)) {
-            return moduleSubPath.string();
-        }
-        
-        // Try looking for directory with same name containing files
-        std::filesystem::path moduleDir = std::filesystem::path(searchPath) / module;
-        if (std::filesystem::exists(moduleDir) && std::filesystem::is_directory(moduleDir)) {
-            // Look for any .thor files in the directory
-            for (const auto& entry : std::filesystem::directory_iterator(moduleDir)) {
-                if (entry.path().extension() == ".thor") {
-                    return entry.path().string();
-                }
-            }
-        }
+    SearchPathModuleProvider provider(std::make_shared<DiskFileProvider>(), searchPaths);
+    std::string path;
+    if (!provider.resolve(module, "", path)) {
+        throw std::runtime_error("Could not find module: " + module);
     }
-    
-    throw std::runtime_error("Could not find module: " + module);
+    return path;
 }
 
 std::shared_ptr<Program> ImportProcessor::loadModule(const std::string& module) {
@@ -60,6 +46,29 @@ std::shared_ptr<Program> ImportProcessor::loadModule(const std::string& module)
     }
     
     // Handle built-in modules
+    if (auto builtin = createBuiltinModule(module)) {
+        moduleCache[module] = builtin;
+        return builtin;
+    }
+    
+    try {
+        std::string filePath = resolveModulePath(module);
+        auto moduleProgram = parseModuleFile(filePath);
+        
+        // Cache the module
+        moduleCache[module] = moduleProgram;
+        
+        // Recursively load imports from this module
+        processImports(moduleProgram);
+        
+        return moduleProgram;
+        
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Error loading module '" + module + "': " + e.what());
+    }
+}
+
+std::shared_ptr<Program> ImportProcessor::createBuiltinModule(const std::string& module) {
     if (module == "std.io") {
         // Create a virtual std.io module
         auto stdProgram = std::make_shared<Program>();
@@ -79,45 +88,123 @@ std::shared_ptr<Program> ImportProcessor::loadModule(const std::string& module)
             "input", inputParams, Type::createString(), nullptr);
         stdProgram->statements.push_back(inputFunc);
         
-        moduleCache[module] = stdProgram;
-        std::cout << "Loaded built-in module: " << module << std::endl;
+        // Number parsing: from a string or view, and whitespace-separated from standard input
+        std::vector<Parameter> parseParams;
+        parseParams.emplace_back("text", Type::createStr());
+        stdProgram->statements.push_back(std::make_shared<FunctionDeclaration>(
+            "parse_int", parseParams, Type::createInt(), nullptr));
+        stdProgram->statements.push_back(std::make_shared<FunctionDeclaration>(
+            "parse_float", parseParams, Type::createFloat(), nullptr));
+        stdProgram->statements.push_back(std::make_shared<FunctionDeclaration>(
+            "has_next", std::vector<Parameter>(), Type::createBoolean(), nullptr));
+        stdProgram->statements.push_back(std::make_shared<FunctionDeclaration>(
+            "read_int", std::vector<Parameter>(), Type::createInt(), nullptr));
+        stdProgram->statements.push_back(std::make_shared<FunctionDeclaration>(
+            "read_float", std::vector<Parameter>(), Type::createFloat(), nullptr));
+        
+        // Views (str) into a string, which strings convert to where a str is
+        // expected; only copy and replace make new strings
+        auto add = [&](const std::string& name, std::vector<Parameter> params, std::shared_ptr<Type> returnType) {
+            stdProgram->statements.push_back(std::make_shared<FunctionDeclaration>(name, params, returnType, nullptr));
+        };
+        Parameter view("view", Type::createStr());
+        add("substr", { view, Parameter("start", Type::createInt()), Parameter("count", Type::createInt()) },
+            Type::createStr());
+        add("trim", { view }, Type::createStr());
+        Parameter needle("needle", Type::createStr());
+        add("find", { view, needle }, Type::createInt());
+        add("contains", { view, needle }, Type::createBoolean());
+        add("count", { view, needle }, Type::createInt());
+        add("split", { Parameter("rest", Type::createReference(Type::createStr())),
+                       Parameter("separator", Type::createStr()) }, Type::createStr());
+        add("length", { view }, Type::createInt());
+        add("empty", { view }, Type::createBoolean());
+        add("copy", { view }, Type::createString());
+        add("replace", { view, Parameter("from", Type::createStr()), Parameter("to", Type::createStr()) },
+            Type::createString());
+        
         return stdProgram;
     }
     
-    try {
-        std::string filePath = resolveModulePath(module);
+    if (module == "std.fs") {
+        // Files and mapped files, named by int handles (-1 for a failure)
+        auto fsProgram = std::make_shared<Program>();
+        fsProgram->package = std::make_shared<PackageDeclaration>("fs");
+        auto add = [&](const std::string& name, std::vector<Parameter> params, std::shared_ptr<Type> returnType) {
+            fsProgram->statements.push_back(std::make_shared<FunctionDeclaration>(name, params, returnType, nullptr));
+        };
+        Parameter path("path", Type::createString());
+        Parameter file("file", Type::createInt());
+        Parameter map("map", Type::createInt());
         
-        // Read file
-        std::ifstream file(filePath);
-        if (!file.is_open()) {
-            throw std::runtime_error("Could not open module file: " + filePath);
-        }
-        
-        std::string content((std::istreambuf_iterator<char>(file)),
-                           std::istreambuf_iterator<char>());
-        file.close();
-        
-        // Parse module
-        Lexer lexer(content);
-        auto tokens = lexer.tokenize();
-        
-        Parser parser(tokens);
-        auto moduleProgram = parser.parse();
+        add("open", { path, Parameter("mode", Type::createString()) }, Type::createInt());
+        add("close", { file }, Type::createBoolean());
+        add("read", { file, Parameter("count", Type::createInt()) }, Type::createString());
+        add("read_line", { file }, Type::createString());
+        add("eof", { file }, Type::createBoolean());
+        add("write", { file, Parameter("text", Type::createString()) }, Type::createBoolean());
+        add("flush", { file }, Type::createBoolean());
         
-        // Cache the module
-        moduleCache[module] = moduleProgram;
+        // The contents and the current line of a mapped file belong to the map
+        add("map", { path }, Type::createInt());
+        add("contents", { map }, Type::createString());
+        add("next_line", { map }, Type::createBoolean());
+        add("line", { map }, Type::createString());
+        add("unmap", { map }, Type::createBoolean());
         
-        // Recursively load imports from this module
-        processImports(moduleProgram);
-        
-        std::cout << "Loaded module: " << module << " from " << filePath << std::endl;
-        return moduleProgram;
-        
-    } catch (const std::exception& e) {
-        throw std::runtime_error("Error loading module '" + module + "': " + e.what());
+        return fsProgram;
+    }
+    
+    return nullptr;
+}
+
+std::shared_ptr<Program> ImportProcessor::parseModuleFile(const std::string& filePath) {
+    // Read file
+    std::ifstream file(filePath);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open module file: " + filePath);
     }
+    
+    std::string content((std::istreambuf_iterator<char>(file)),
+                       std::istreambuf_iterator<char>());
+    file.close();
+    
+    // Parse module
+    Lexer lexer(content);
+    auto tokens = lexer.tokenize();
+    
+    Parser parser(std::move(tokens));
+    auto program = parser.parse();
+    program->sourcePath = filePath;
+    return program;
 }
 
 std::unordered_map<std::string, std::shared_ptr<Program>> ImportProcessor::getLoadedModules() const {
     return moduleCache;
+}
+
+std::shared_ptr<Program> ImportProcessor::getModule(const std::string& module) const {
+    auto it = moduleCache.find(module);
+    return it != moduleCache.end() ? it->second : nullptr;
+}
+
+std::vector<std::string> ImportProcessor::getDependencies(std::shared_ptr<Program> program) const {
+    // Transitive imports of program, each listed after the modules it imports
+    std::vector<std::string> ordered;
+    std::unordered_set<std::string> visited;
+    collectDependencies(program, ordered, visited);
+    return ordered;
+}
+
+void ImportProcessor::collectDependencies(std::shared_ptr<Program> program, std::vector<std::string>& ordered,
+                                          std::unordered_set<std::string>& visited) const {
+    for (const auto& import : program->imports) {
+        if (!visited.insert(import->module).second) {
+            continue;
+        }
+        if (auto module = getModule(import->module)) {
+            collectDependencies(module, ordered, visited);
+        }
+        ordered.push_back(import->module);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,276 @@
+#include "IncrementalParser.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include <algorithm>
+#include <regex>
+#include <stdexcept>
+
+// Error messages name their line ("... at line N"); keep it right as lines shift
+static std::string shiftErrorLine(const std::string& error, int lineDelta) {
+    static const std::regex lineNumber("at line ([0-9]+)");
+    std::smatch match;
+    if (!std::regex_search(error, match, lineNumber)) {
+        return error;
+    }
+    return match.prefix().str() + "at line " + std::to_string(std::stoi(match[1]) + lineDelta) + match.suffix().str();
+}
+
+// Top-level declarations a segment can be reparsed from on its own
+static bool startsDeclaration(TokenType type) {
+    return type == TokenType::FUNC || type == TokenType::CONST || type == TokenType::BENCH;
+}
+
+IncrementalParser::IncrementalParser(const std::string& text) : source(text) {
+    reparse();
+}
+
+std::shared_ptr<Program> IncrementalParser::reparse() {
+    reparsedBytes = source.size();
+    valid = false;
+
+    Lexer lexer(source);
+    Parser parser(lexer.tokenize());
+    auto header = std::make_shared<Program>();
+    parser.parseHeader(*header);
+
+    std::vector<Segment> parsed;
+    parseSegments(parser, false, parsed, nullptr);
+
+    program = header;
+    segments = std::move(parsed);
+    rebuildProgram();
+    valid = true;
+    throwFirstError();
+    return program;
+}
+
+bool IncrementalParser::parseSegments(Parser& parser, bool region, std::vector<Segment>& out, bool* failedAtEnd) {
+    const TokenStream& tokens = parser.getTokens();
+    while (true) {
+        const Token& token = parser.nextTopLevelToken();
+        if (token.type == TokenType::EOF_TOKEN) {
+            return true;
+        }
+        if (region && (token.type == TokenType::PACKAGE || token.type == TokenType::IMPORT)) {
+            return false; // header declarations are only valid at the top of the file
+        }
+        Segment segment = { token.offset, tokens.line(token), tokens.column(token), nullptr, "", false };
+        segment.anchor = segment.column == 1 && startsDeclaration(token.type);
+        size_t start = parser.position();
+        try {
+            segment.statement = parser.parseTopLevelStatement();
+        } catch (const std::exception& e) {
+            if (!recoverErrors) {
+                throw;
+            }
+            segment.error = e.what();
+            if (failedAtEnd && tokens[parser.position()].type == TokenType::EOF_TOKEN) {
+                *failedAtEnd = true;
+            }
+            size_t next = start + 1;
+            while (next < tokens.size() && tokens[next].type != TokenType::EOF_TOKEN &&
+                   !(startsDeclaration(tokens[next].type) && tokens.column(tokens[next]) == 1)) {
+                next++;
+            }
+            parser.seek(next);
+        }
+        out.push_back(segment);
+    }
+}
+
+void IncrementalParser::throwFirstError() const {
+    for (const auto& segment : segments) {
+        if (!segment.error.empty()) {
+            throw std::runtime_error(segment.error);
+        }
+    }
+}
+
+bool IncrementalParser::firmBoundary(size_t next) const {
+    return segments[next].anchor && segments[next].error.empty() && segments[next - 1].error.empty();
+}
+
+bool IncrementalParser::reparseSegments(size_t first, size_t last, size_t removed, size_t inserted) {
+    // The region spans segments first..last; source already holds the new text
+    size_t begin = segments[first].offset;
+    while (true) {
+        bool toEnd = last + 1 == segments.size();
+        size_t end = toEnd ? source.size() : segments[last + 1].offset - removed + inserted;
+
+        // Lex to the end of the line after the region, so that a token or comment
+        // running across the region's end is caught instead of silently cut off
+        size_t sliceEnd = source.size();
+        if (!toEnd) {
+            size_t newline = source.find('\n', end);
+            sliceEnd = newline == std::string::npos ? source.size() : newline + 1;
+        }
+
+        TokenStream tokens;
+        try {
+            Lexer lexer(source.substr(begin, sliceEnd - begin), begin, segments[first].line, segments[first].column);
+            tokens = lexer.tokenize();
+        } catch (const std::exception&) {
+            return false;
+        }
+        reparsedBytes = sliceEnd - begin;
+
+        int nextLine = 0;
+        int nextColumn = 0;
+        if (!toEnd) {
+            auto boundary = std::find_if(tokens.begin(), tokens.end(), [end](const Token& token) {
+                return token.offset >= end;
+            });
+            if (boundary == tokens.end() || boundary->offset != end || boundary->type == TokenType::EOF_TOKEN) {
+                return false; // the next segment no longer starts where it used to
+            }
+            nextLine = tokens.line(*boundary);
+            nextColumn = tokens.column(*boundary);
+            tokens.truncate(boundary - tokens.begin(), static_cast<uint32_t>(end));
+        }
+
+        std::vector<Segment> replacement;
+        bool failedAtEnd = false;
+        try {
+            Parser parser(std::move(tokens));
+            if (!parseSegments(parser, true, replacement, &failedAtEnd)) {
+                return false;
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+
+        // A statement left open at the region's end may be closed by a stray
+        // bracket further down, as a full parse would do. Segments that parsed are
+        // balanced, so only an error segment can hold one: take the region up to
+        // the next error segment and the firm boundary after it, and try again.
+        if (failedAtEnd && !toEnd) {
+            size_t broken = last + 1;
+            while (broken < segments.size() && segments[broken].error.empty()) {
+                broken++;
+            }
+            if (broken < segments.size()) {
+                last = broken;
+                while (last + 1 < segments.size() && !firmBoundary(last + 1)) {
+                    last++;
+                }
+                continue;
+            }
+        }
+
+        // The region's tokens end at a synthetic EOF, so its errors would read
+        // "got ''" and may name other lines than a full parse's; leave broken
+        // text to the full parse and its diagnostics
+        if (std::any_of(replacement.begin(), replacement.end(),
+                        [](const Segment& segment) { return !segment.error.empty(); })) {
+            return false;
+        }
+
+        // Shift the positions of every segment after the region
+        if (!toEnd) {
+            const Segment& next = segments[last + 1];
+            int oldLine = next.line;
+            int lineDelta = nextLine - next.line;
+            int columnDelta = nextColumn - next.column;
+            for (size_t i = last + 1; i < segments.size(); i++) {
+                Segment& segment = segments[i];
+                if (segment.line == oldLine) {
+                    segment.column += columnDelta;
+                }
+                segment.line += lineDelta;
+                if (segment.statement) {
+                    // Nested statements are relative to this one and move with it
+                    segment.statement->line = segment.line;
+                    segment.statement->column = segment.column;
+                }
+                if (lineDelta != 0 && !segment.error.empty()) {
+                    segment.error = shiftErrorLine(segment.error, lineDelta);
+                }
+                segment.offset = segment.offset - removed + inserted;
+            }
+        }
+
+        segments.erase(segments.begin() + first, segments.begin() + last + 1);
+        segments.insert(segments.begin() + first, replacement.begin(), replacement.end());
+        return true;
+    }
+}
+
+void IncrementalParser::rebuildProgram() {
+    // A fresh Program per version, so readers holding the previous AST are
+    // unaffected (except that reused statements carry their new positions)
+    auto updated = std::make_shared<Program>();
+    if (program) {
+        updated->package = program->package;
+        updated->imports = program->imports;
+        updated->sourcePath = program->sourcePath;
+    }
+    updated->statements.reserve(segments.size());
+    for (const auto& segment : segments) {
+        if (segment.statement) {
+            updated->statements.push_back(segment.statement);
+        }
+    }
+    program = updated;
+}
+
+std::shared_ptr<Program> IncrementalParser::applyEdit(size_t offset, size_t length, const std::string& text) {
+    if (offset > source.size() || length > source.size() - offset) {
+        throw std::runtime_error("Edit range is outside the source text");
+    }
+    source.replace(offset, length, text);
+
+    if (!valid || segments.empty()) {
+        return reparse();
+    }
+
+    // First touched segment: the last one starting strictly before the edit, so
+    // that text typed right in front of a statement is lexed with its predecessor.
+    // Last touched segment: the last one starting at or before the edit's end.
+    auto after = std::lower_bound(segments.begin(), segments.end(), offset,
+        [](const Segment& segment, size_t position) { return segment.offset < position; });
+    if (after == segments.begin()) {
+        return reparse(); // the edit touches the package/import header
+    }
+    size_t first = static_cast<size_t>(after - segments.begin()) - 1;
+    auto beyond = std::upper_bound(segments.begin(), segments.end(), offset + length,
+        [](size_t position, const Segment& segment) { return position < segment.offset; });
+    size_t last = static_cast<size_t>(beyond - segments.begin()) - 1;
+
+    // Recovery splits broken text at guessed boundaries and may leave fragments
+    // of a declaration behind as statements of their own, so an edit is reparsed
+    // together with everything up to the nearest firm boundaries around it
+    if (recoverErrors) {
+        while (first > 0 && !firmBoundary(first)) {
+            first--;
+        }
+        while (last + 1 < segments.size() && !firmBoundary(last + 1)) {
+            last++;
+        }
+    }
+
+    if (!reparseSegments(first, last, length, text.size())) {
+        return reparse();
+    }
+    rebuildProgram();
+    throwFirstError();
+    return program;
+}
+
+std::shared_ptr<Program> IncrementalParser::update(const std::string& text) {
+    size_t prefix = 0;
+    size_t limit = std::min(source.size(), text.size());
+    while (prefix < limit && source[prefix] == text[prefix]) {
+        prefix++;
+    }
+    size_t suffix = 0;
+    while (suffix < limit - prefix &&
+           source[source.size() - 1 - suffix] == text[text.size() - 1 - suffix]) {
+        suffix++;
+    }
+    if (prefix == source.size() && prefix == text.size() && valid) {
+        reparsedBytes = 0;
+        throwFirstError();
+        return program;
+    }
+    return applyEdit(prefix, source.size() - prefix - suffix, text.substr(prefix, text.size() - prefix - suffix));
+}
@@ -0,0 +1,275 @@
+#include "Json.h"
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+Json::Json(bool value) : kind(BOOLEAN), boolean(value) {}
+Json::Json(int value) : kind(NUMBER), number(value) {}
+Json::Json(long long value) : kind(NUMBER), number(static_cast<double>(value)) {}
+Json::Json(size_t value) : kind(NUMBER), number(static_cast<double>(value)) {}
+Json::Json(double value) : kind(NUMBER), number(value) {}
+Json::Json(const char* value) : kind(STRING), text(value) {}
+Json::Json(const std::string& value) : kind(STRING), text(value) {}
+
+Json Json::array() {
+    Json value;
+    value.kind = ARRAY;
+    return value;
+}
+
+Json Json::object() {
+    Json value;
+    value.kind = OBJECT;
+    return value;
+}
+
+bool Json::has(const std::string& key) const {
+    for (const auto& existing : keys) {
+        if (existing == key) return true;
+    }
+    return false;
+}
+
+const Json& Json::operator[](const std::string& key) const {
+    static const Json null;
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (keys[i] == key) return items[i];
+    }
+    return null;
+}
+
+Json& Json::set(const std::string& key, const Json& value) {
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (keys[i] == key) {
+            items[i] = value;
+            return *this;
+        }
+    }
+    keys.push_back(key);
+    items.push_back(value);
+    return *this;
+}
+
+Json& Json::push(const Json& value) {
+    items.push_back(value);
+    return *this;
+}
+
+Json Json::parse(const std::string& source) {
+    size_t pos = 0;
+    Json value = parseValue(source, pos);
+    while (pos < source.size() && isspace(static_cast<unsigned char>(source[pos]))) pos++;
+    if (pos != source.size()) {
+        throw std::runtime_error("Trailing characters after JSON value");
+    }
+    return value;
+}
+
+static void skipSpace(const std::string& source, size_t& pos) {
+    while (pos < source.size() && isspace(static_cast<unsigned char>(source[pos]))) pos++;
+}
+
+static void appendUtf8(std::string& out, unsigned codepoint) {
+    if (codepoint < 0x80) {
+        out += static_cast<char>(codepoint);
+    } else if (codepoint < 0x800) {
+        out += static_cast<char>(0xC0 | (codepoint >> 6));
+        out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    } else if (codepoint < 0x10000) {
+        out += static_cast<char>(0xE0 | (codepoint >> 12));
+        out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (codepoint >> 18));
+        out += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    }
+}
+
+std::string Json::parseString(const std::string& source, size_t& pos) {
+    pos++; // opening quote
+    std::string out;
+    while (pos < source.size() && source[pos] != '"') {
+        char c = source[pos++];
+        if (c != '\\') {
+            out += c;
+            continue;
+        }
+        if (pos >= source.size()) break;
+        char escaped = source[pos++];
+        switch (escaped) {
+            case 'n': out += '\n'; break;
+            case 't': out += '\t'; break;
+            case 'r': out += '\r'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'u': {
+                if (pos + 4 > source.size()) throw std::runtime_error("Invalid JSON escape");
+                unsigned codepoint = std::stoul(source.substr(pos, 4), nullptr, 16);
+                pos += 4;
+                // Combine UTF-16 surrogate pairs
+                if (codepoint >= 0xD800 && codepoint < 0xDC00 && pos + 6 <= source.size() &&
+                    source[pos] == '\\' && source[pos + 1] == 'u') {
+                    unsigned low = std::stoul(source.substr(pos + 2, 4), nullptr, 16);
+                    codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                    pos += 6;
+                }
+                appendUtf8(out, codepoint);
+                break;
+            }
+            default: out += escaped; break;
+        }
+    }
+    if (pos >= source.size()) {
+        throw std::runtime_error("Unterminated JSON string");
+    }
+    pos++; // closing quote
+    return out;
+}
+
+Json Json::parseValue(const std::string& source, size_t& pos) {
+    skipSpace(source, pos);
+    if (pos >= source.size()) {
+        throw std::runtime_error("Unexpected end of JSON");
+    }
+
+    char c = source[pos];
+    if (c == '{') {
+        Json value = object();
+        pos++;
+        skipSpace(source, pos);
+        if (pos < source.size() && source[pos] == '}') {
+            pos++;
+            return value;
+        }
+        while (true) {
+            skipSpace(source, pos);
+            if (pos >= source.size() || source[pos] != '"') {
+                throw std::runtime_error("Expected JSON object key");
+            }
+            std::string key = parseString(source, pos);
+            skipSpace(source, pos);
+            if (pos >= source.size() || source[pos] != ':') {
+                throw std::runtime_error("Expected ':' in JSON object");
+            }
+            pos++;
+            value.keys.push_back(key);
+            value.items.push_back(parseValue(source, pos));
+            skipSpace(source, pos);
+            if (pos < source.size() && source[pos] == ',') {
+                pos++;
+            } else if (pos < source.size() && source[pos] == '}') {
+                pos++;
+                return value;
+            } else {
+                throw std::runtime_error("Expected ',' or '}' in JSON object");
+            }
+        }
+    }
+    if (c == '[') {
+        Json value = array();
+        pos++;
+        skipSpace(source, pos);
+        if (pos < source.size() && source[pos] == ']') {
+            pos++;
+            return value;
+        }
+        while (true) {
+            value.items.push_back(parseValue(source, pos));
+            skipSpace(source, pos);
+            if (pos < source.size() && source[pos] == ',') {
+                pos++;
+            } else if (pos < source.size() && source[pos] == ']') {
+                pos++;
+                return value;
+            } else {
+                throw std::runtime_error("Expected ',' or ']' in JSON array");
+            }
+        }
+    }
+    if (c == '"') {
+        return Json(parseString(source, pos));
+    }
+    if (source.compare(pos, 4, "true") == 0) {
+        pos += 4;
+        return Json(true);
+    }
+    if (source.compare(pos, 5, "false") == 0) {
+        pos += 5;
+        return Json(false);
+    }
+    if (source.compare(pos, 4, "null") == 0) {
+        pos += 4;
+        return Json();
+    }
+
+    size_t length = 0;
+    double number = std::stod(source.substr(pos, 32), &length);
+    pos += length;
+    return Json(number);
+}
+
+void Json::dumpTo(std::string& out) const {
+    switch (kind) {
+        case NULL_VALUE: out += "null"; break;
+        case BOOLEAN: out += boolean ? "true" : "false"; break;
+        case NUMBER: {
+            char buffer[32];
+            if (std::floor(number) == number && std::fabs(number) < 1e15) {
+                snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(number));
+            } else {
+                snprintf(buffer, sizeof(buffer), "%.17g", number);
+            }
+            out += buffer;
+            break;
+        }
+        case STRING: {
+            out += '"';
+            for (char c : text) {
+                switch (c) {
+                    case '"': out += "\\\""; break;
+                    case '\\': out += "\\\\"; break;
+                    case '\n': out += "\\n"; break;
+                    case '\r': out += "\\r"; break;
+                    case '\t': out += "\\t"; break;
+                    default:
+                        if (static_cast<unsigned char>(c) < 0x20) {
+                            char buffer[8];
+                            snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                            out += buffer;
+                        } else {
+                            out += c;
+                        }
+                }
+            }
+            out += '"';
+            break;
+        }
+        case ARRAY:
+            out += '[';
+            for (size_t i = 0; i < items.size(); i++) {
+                if (i > 0) out += ',';
+                items[i].dumpTo(out);
+            }
+            out += ']';
+            break;
+        case OBJECT:
+            out += '{';
+            for (size_t i = 0; i < items.size(); i++) {
+                if (i > 0) out += ',';
+                Json(keys[i]).dumpTo(out);
+                out += ':';
+                items[i].dumpTo(out);
+            }
+            out += '}';
+            break;
+    }
+}
+
+std::string Json::dump() const {
+    std::string out;
+    dumpTo(out);
+    return out;
+}
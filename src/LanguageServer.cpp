@@ -0,0 +1,889 @@
+#include "LanguageServer.h"
+#include "ImportProcessor.h"
+#include "Lexer.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <regex>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const auto DIAGNOSTICS_DELAY = std::chrono::milliseconds(120);
+
+// LSP CompletionItemKind values
+const int KIND_FUNCTION = 3;
+const int KIND_VARIABLE = 6;
+const int KIND_MODULE = 9;
+const int KIND_KEYWORD = 14;
+const int KIND_CONSTANT = 21;
+
+// LSP error codes
+const int METHOD_NOT_FOUND = -32601;
+const int INTERNAL_ERROR = -32603;
+const int PARSE_ERROR = -32700;
+const int REQUEST_CANCELLED = -32800;
+
+// Larger Content-Length headers are rejected rather than allocated
+const size_t MAX_MESSAGE_BYTES = size_t(1) << 28;
+
+const char* KEYWORDS[] = {
+    "package", "import", "func", "bench", "return", "if", "else", "while", "const",
+    "int", "float", "string", "str", "boolean", "void", "true", "false"
+};
+
+std::string canonical(const std::string& path) {
+    std::error_code ec;
+    fs::path result = fs::weakly_canonical(path, ec);
+    return ec ? path : result.string();
+}
+
+std::string typeName(std::shared_ptr<Type> type) {
+    if (!type) return "void";
+    switch (type->kind) {
+        case Type::VOID_TYPE: return "void";
+        case Type::INTEGER_TYPE: return "int";
+        case Type::FLOAT_TYPE: return "float";
+        case Type::STRING_TYPE: return "string";
+        case Type::STR_TYPE: return "str";
+        case Type::BOOLEAN_TYPE: return "boolean";
+        case Type::ARRAY_TYPE: return typeName(type->elementType) + "[]";
+        case Type::REFERENCE_TYPE: return typeName(type->elementType) + "&";
+        default: return "func";
+    }
+}
+
+std::string signature(const FunctionDeclaration& function) {
+    std::string text = "func " + function.name + "(";
+    for (size_t i = 0; i < function.parameters.size(); i++) {
+        if (i > 0) text += ", ";
+        text += typeName(function.parameters[i].type) + " " + function.parameters[i].name;
+    }
+    return text + ") -> " + typeName(function.returnType);
+}
+
+bool isTypeToken(TokenType type) {
+    return type == TokenType::INT || type == TokenType::FLOAT_TYPE || type == TokenType::STRING_TYPE ||
+           type == TokenType::STR_TYPE || type == TokenType::BOOLEAN_TYPE || type == TokenType::VOID_TYPE;
+}
+
+// Whether the identifier at tokens[i] is being declared: `int x`, `string& s`, `int[] xs`
+bool declares(const TokenStream& tokens, size_t i) {
+    if (i == 0) return false;
+    size_t j = i - 1;
+    if (tokens[j].type == TokenType::AMPERSAND && j > 0) j--;
+    if (tokens[j].type == TokenType::RIGHT_BRACKET && j >= 2 && tokens[j - 1].type == TokenType::LEFT_BRACKET) {
+        j -= 2;
+        return isTypeToken(tokens[j].type) || tokens[j].type == TokenType::IDENTIFIER;
+    }
+    return isTypeToken(tokens[j].type);
+}
+
+bool isWord(std::string_view text) {
+    return !text.empty() && (isalpha(static_cast<unsigned char>(text[0])) || text[0] == '_');
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// Protocol
+
+int LanguageServer::run() {
+    std::thread worker(&LanguageServer::analysisLoop, this);
+
+    std::string body;
+    while (readMessage(body)) {
+        Json message;
+        try {
+            message = Json::parse(body);
+        } catch (const std::exception&) {
+            respondError(Json(), PARSE_ERROR, "Invalid JSON");
+            continue;
+        }
+
+        std::string method = message["method"].asString();
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (method == "$/cancelRequest") {
+            // Handled here so it overtakes the queued request it refers to
+            cancelledRequests.insert(message["params"]["id"].dump());
+            continue;
+        }
+        queue.push_back(message);
+        queueReady.notify_one();
+        if (method == "exit") {
+            break;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        inputClosed = true;
+    }
+    queueReady.notify_one();
+    worker.join();
+    return shutdownRequested ? 0 : 1;
+}
+
+// The value of a Content-Length header, or false if it is not a byte count
+// the server accepts
+static bool parseContentLength(const std::string& value, size_t& length) {
+    const char* text = value.c_str();
+    while (*text == ' ' || *text == '\t') {
+        text++;
+    }
+    if (!std::isdigit(static_cast<unsigned char>(*text))) {
+        return false;
+    }
+    errno = 0;
+    char* end = nullptr;
+    unsigned long long parsed = std::strtoull(text, &end, 10);
+    while (*end == ' ' || *end == '\t') {
+        end++;
+    }
+    if (*end != '\0' || errno == ERANGE || parsed > MAX_MESSAGE_BYTES) {
+        return false;
+    }
+    length = static_cast<size_t>(parsed);
+    return true;
+}
+
+bool LanguageServer::readMessage(std::string& body) {
+    std::string line;
+    size_t length = 0;
+    while (true) {
+        bool sawHeader = false;
+        bool validLength = true;
+        length = 0;
+        while (std::getline(std::cin, line)) {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (line.empty()) {
+                if (sawHeader) break;
+                continue;
+            }
+            sawHeader = true;
+            if (line.compare(0, 15, "Content-Length:") == 0) {
+                validLength = parseContentLength(line.substr(15), length);
+            }
+        }
+        if (!sawHeader || !std::cin) {
+            return false;
+        }
+        if (validLength) {
+            break;
+        }
+        // Without its length the body cannot be told from the next headers; it
+        // is skipped along with them, up to the next blank line
+        respondError(Json(), PARSE_ERROR, "Invalid Content-Length header");
+    }
+    body.assign(length, '\0');
+    std::cin.read(&body[0], static_cast<std::streamsize>(length));
+    return static_cast<size_t>(std::cin.gcount()) == length;
+}
+
+void LanguageServer::send(const Json& message) {
+    std::string body = message.dump();
+    std::lock_guard<std::mutex> lock(outputMutex);
+    std::cout << "Content-Length: " << body.size() << "\r\n\r\n" << body;
+    std::cout.flush();
+}
+
+void LanguageServer::respond(const Json& id, const Json& result) {
+    Json message = Json::object();
+    message.set("jsonrpc", "2.0").set("id", id).set("result", result);
+    send(message);
+}
+
+void LanguageServer::respondError(const Json& id, int code, const std::string& text) {
+    Json error = Json::object();
+    error.set("code", code).set("message", text);
+    Json message = Json::object();
+    message.set("jsonrpc", "2.0").set("id", id).set("error", error);
+    send(message);
+}
+
+void LanguageServer::analysisLoop() {
+    while (true) {
+        Json message;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            while (queue.empty() && !inputClosed) {
+                if (staleDiagnostics.empty()) {
+                    queueReady.wait(lock);
+                } else if (std::chrono::steady_clock::now() < diagnosticsDue) {
+                    queueReady.wait_until(lock, diagnosticsDue);
+                } else {
+                    break;
+                }
+            }
+            if (queue.empty()) {
+                if (inputClosed) return;
+                lock.unlock();
+                publishDiagnostics();
+                continue;
+            }
+            message = queue.front();
+            queue.pop_front();
+            if (message.has("id") && cancelledRequests.erase(message["id"].dump())) {
+                lock.unlock();
+                respondError(message["id"], REQUEST_CANCELLED, "Request cancelled");
+                continue;
+            }
+        }
+        if (!handle(message)) {
+            return;
+        }
+    }
+}
+
+bool LanguageServer::handle(const Json& message) {
+    if (!message.has("method")) {
+        return true; // a response; this server sends no requests
+    }
+    std::string method = message["method"].asString();
+    const Json& params = message["params"];
+    const Json& id = message["id"];
+    bool isRequest = message.has("id");
+
+    try {
+        if (method == "initialize") {
+            if (params["rootUri"].isString()) {
+                rootPath = canonical(uriToPath(params["rootUri"].asString()));
+            } else if (params["rootPath"].isString()) {
+                rootPath = canonical(params["rootPath"].asString());
+            }
+            Json sync = Json::object();
+            sync.set("openClose", true).set("change", 2); // incremental
+            Json triggers = Json::array();
+            triggers.push(".");
+            Json completionOptions = Json::object();
+            completionOptions.set("triggerCharacters", triggers);
+            Json capabilities = Json::object();
+            capabilities.set("textDocumentSync", sync)
+                        .set("definitionProvider", true)
+                        .set("completionProvider", completionOptions);
+            Json info = Json::object();
+            info.set("name", "thor");
+            Json result = Json::object();
+            result.set("capabilities", capabilities).set("serverInfo", info);
+            respond(id, result);
+        } else if (method == "shutdown") {
+            shutdownRequested = true;
+            respond(id, Json());
+        } else if (method == "exit") {
+            return false;
+        } else if (method == "textDocument/didOpen") {
+            const Json& item = params["textDocument"];
+            std::string path = canonical(uriToPath(item["uri"].asString()));
+            Document& document = documents[path];
+            document.uri = item["uri"].asString();
+            document.path = path;
+            document.open = true;
+            setText(document, item["text"].asString());
+        } else if (method == "textDocument/didChange") {
+            if (Document* document = findDocument(params["textDocument"]["uri"].asString())) {
+                const Json& changes = params["contentChanges"];
+                for (size_t i = 0; i < changes.size(); i++) {
+                    applyChange(*document, changes[i]);
+                }
+                reindex(*document);
+                invalidate(document->path);
+            }
+        } else if (method == "textDocument/didClose") {
+            if (Document* document = findDocument(params["textDocument"]["uri"].asString())) {
+                document->open = false;
+                Json clear = Json::object();
+                clear.set("uri", document->uri).set("diagnostics", Json::array());
+                Json notification = Json::object();
+                notification.set("jsonrpc", "2.0").set("method", "textDocument/publishDiagnostics").set("params", clear);
+                send(notification);
+
+                // Importers see the file as it is on disk again
+                std::ifstream file(document->path);
+                setText(*document, std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>()));
+            }
+        } else if (method == "workspace/didChangeWatchedFiles") {
+            const Json& changes = params["changes"];
+            for (size_t i = 0; i < changes.size(); i++) {
+                Document* document = findDocument(changes[i]["uri"].asString());
+                if (document && !document->open) {
+                    std::ifstream file(document->path);
+                    setText(*document, std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>()));
+                }
+            }
+        } else if (method == "textDocument/definition") {
+            respond(id, definition(params));
+        } else if (method == "textDocument/completion") {
+            respond(id, completion(params));
+        } else if (isRequest) {
+            respondError(id, METHOD_NOT_FOUND, "Unsupported method: " + method);
+        }
+    } catch (const std::exception& e) {
+        if (isRequest) {
+            respondError(id, INTERNAL_ERROR, e.what());
+        }
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Project model
+
+LanguageServer::Document* LanguageServer::findDocument(const std::string& uri) {
+    auto it = documents.find(canonical(uriToPath(uri)));
+    return it != documents.end() ? &it->second : nullptr;
+}
+
+LanguageServer::Document& LanguageServer::loadDocument(const std::string& path) {
+    auto it = documents.find(path);
+    if (it != documents.end()) {
+        return it->second;
+    }
+    // Inserted before parsing, so import cycles find the document instead of recursing
+    Document& document = documents[path];
+    document.path = path;
+    document.uri = pathToUri(path);
+    std::ifstream file(path);
+    setText(document, std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>()));
+    return document;
+}
+
+void LanguageServer::setText(Document& document, const std::string& text) {
+    Json change = Json::object();
+    change.set("text", text);
+    applyChange(document, change);
+    reindex(document);
+    invalidate(document.path);
+}
+
+void LanguageServer::applyChange(Document& document, const Json& change) {
+    try {
+        if (change.has("range")) {
+            size_t begin = offsetAt(document, change["range"]["start"]);
+            size_t end = std::max(begin, offsetAt(document, change["range"]["end"]));
+            document.parser.applyEdit(begin, end - begin, change["text"].asString());
+        } else {
+            document.parser.update(change["text"].asString());
+        }
+        document.parseError.clear();
+    } catch (const std::exception& e) {
+        document.parseError = e.what();
+        std::smatch match;
+        static const std::regex lineNumber("at line ([0-9]+)");
+        document.parseErrorLine = std::regex_search(document.parseError, match, lineNumber)
+            ? std::max(0, std::stoi(match[1]) - 1) : 0;
+    }
+    computeLineStarts(document);
+}
+
+void LanguageServer::reindex(Document& document) {
+    if (!document.parser.isValid()) {
+        return; // the header does not parse: keep the index of the last text that did
+    }
+
+    // IncrementalParser reuses the nodes of untouched declarations, so only the
+    // statements between the common prefix and suffix with the last index changed
+    const auto& segments = document.parser.getSegments();
+    auto& indexed = document.indexed;
+    size_t prefix = 0;
+    while (prefix < indexed.size() && prefix < segments.size() && indexed[prefix] == segments[prefix].statement) {
+        prefix++;
+    }
+    size_t suffix = 0;
+    while (suffix < indexed.size() - prefix && suffix < segments.size() - prefix &&
+           indexed[indexed.size() - 1 - suffix] == segments[segments.size() - 1 - suffix].statement) {
+        suffix++;
+    }
+
+    for (size_t i = prefix; i < indexed.size() - suffix; i++) {
+        unindexStatement(document, indexed[i]);
+    }
+    std::vector<std::shared_ptr<Statement>> added;
+    for (size_t i = prefix; i < segments.size() - suffix; i++) {
+        indexStatement(document, i);
+        added.push_back(segments[i].statement);
+    }
+    indexed.erase(indexed.begin() + prefix, indexed.end() - suffix);
+    indexed.insert(indexed.begin() + prefix, added.begin(), added.end());
+
+    std::vector<std::string> imports;
+    for (const auto& import : document.parser.getProgram()->imports) {
+        imports.push_back(import->module);
+    }
+    if (imports != document.imports || document.resolvedImports.empty()) {
+        document.imports = imports;
+        resolveImports(document);
+    }
+}
+
+void LanguageServer::indexStatement(Document& document, size_t segment) {
+    const auto& statement = document.parser.getSegments()[segment].statement;
+    if (!statement) {
+        return; // error segment, reported by diagnostics()
+    }
+    if (auto function = std::dynamic_pointer_cast<FunctionDeclaration>(statement)) {
+        document.symbols[function->name] = { function->name, signature(*function), KIND_FUNCTION, statement };
+    } else if (auto constant = std::dynamic_pointer_cast<ConstDeclaration>(statement)) {
+        document.symbols[constant->name] = { constant->name, "const " + typeName(constant->type) + " " + constant->name,
+                                             KIND_CONSTANT, statement };
+    }
+    document.references[statement] = scanReferences(document, segment);
+}
+
+void LanguageServer::unindexStatement(Document& document, const std::shared_ptr<Statement>& statement) {
+    if (!statement) {
+        return;
+    }
+    std::string name;
+    if (auto function = std::dynamic_pointer_cast<FunctionDeclaration>(statement)) {
+        name = function->name;
+    } else if (auto constant = std::dynamic_pointer_cast<ConstDeclaration>(statement)) {
+        name = constant->name;
+    }
+    auto symbol = document.symbols.find(name);
+    if (symbol != document.symbols.end() && symbol->second.statement == statement) {
+        document.symbols.erase(symbol);
+    }
+    document.references.erase(statement);
+}
+
+void LanguageServer::resolveImports(Document& document) {
+    for (const auto& [module, path] : document.resolvedImports) {
+        importers[path].erase(document.path);
+    }
+    document.resolvedImports.clear();
+    document.qualifiers.clear();
+
+    std::vector<std::string> searchPaths;
+    if (!rootPath.empty()) {
+        searchPaths.push_back(rootPath);
+        searchPaths.push_back((fs::path(rootPath) / "example").string());
+    }
+    searchPaths.push_back(fs::path(document.path).parent_path().string());
+    ImportProcessor resolver(searchPaths);
+
+    std::vector<std::string> toLoad;
+    for (const auto& module : document.imports) {
+        if (auto builtin = ImportProcessor::createBuiltinModule(module)) {
+            std::string qualifier = builtin->package ? builtin->package->name : module;
+            auto& symbols = builtinModules[qualifier];
+            for (const auto& statement : builtin->statements) {
+                if (auto function = std::dynamic_pointer_cast<FunctionDeclaration>(statement)) {
+                    symbols[function->name] = { function->name, signature(*function), KIND_FUNCTION, statement };
+                }
+            }
+            document.resolvedImports[module] = module;
+            document.qualifiers[qualifier] = "";
+            continue;
+        }
+        std::string path;
+        try {
+            path = canonical(resolver.resolveModulePath(module));
+        } catch (const std::exception&) {
+            document.resolvedImports[module] = "";
+            continue;
+        }
+        document.resolvedImports[module] = path;
+        importers[path].insert(document.path);
+        toLoad.push_back(path);
+    }
+
+    for (const auto& path : toLoad) {
+        Document& module = loadDocument(path);
+        auto program = module.parser.getProgram();
+        std::string qualifier = program && program->package ? program->package->name
+                                                            : fs::path(path).stem().string();
+        document.qualifiers[qualifier] = path;
+    }
+}
+
+std::vector<LanguageServer::Reference> LanguageServer::scanReferences(const Document& document, size_t segment) const {
+    const auto& segments = document.parser.getSegments();
+    size_t begin = segments[segment].offset;
+    size_t end = segment + 1 < segments.size() ? segments[segment + 1].offset : document.parser.getSource().size();
+
+    std::vector<Reference> references;
+    auto tokens = lex(document, begin, end);
+    for (size_t i = 0; i + 2 < tokens.size(); i++) {
+        if (tokens[i].type == TokenType::IDENTIFIER && tokens[i + 1].type == TokenType::DOT &&
+            tokens[i + 2].type == TokenType::IDENTIFIER) {
+            references.push_back({ tokens.value(tokens[i]), tokens.value(tokens[i + 2]), tokens[i + 2].offset - begin });
+        }
+    }
+    return references;
+}
+
+void LanguageServer::invalidate(const std::string& path) {
+    staleDiagnostics.insert(path);
+    auto it = importers.find(path);
+    if (it != importers.end()) {
+        staleDiagnostics.insert(it->second.begin(), it->second.end());
+    }
+    diagnosticsDue = std::chrono::steady_clock::now() + DIAGNOSTICS_DELAY;
+}
+
+// ---------------------------------------------------------------------------
+// Positions (LSP lines and characters are 0-based; characters are counted in bytes)
+
+void LanguageServer::computeLineStarts(Document& document) {
+    const std::string& source = document.parser.getSource();
+    document.lineStarts.assign(1, 0);
+    const char* start = source.data();
+    const char* end = start + source.size();
+    for (const char* p = start; (p = static_cast<const char*>(memchr(p, '\n', end - p))) != nullptr; p++) {
+        document.lineStarts.push_back(static_cast<size_t>(p - start) + 1);
+    }
+}
+
+size_t LanguageServer::offsetAt(const Document& document, const Json& position) {
+    size_t size = document.parser.getSource().size();
+    size_t line = static_cast<size_t>(std::max(0LL, position["line"].asInt()));
+    if (line >= document.lineStarts.size()) {
+        return size;
+    }
+    size_t lineEnd = line + 1 < document.lineStarts.size() ? document.lineStarts[line + 1] - 1 : size;
+    size_t character = static_cast<size_t>(std::max(0LL, position["character"].asInt()));
+    return std::min(document.lineStarts[line] + character, lineEnd);
+}
+
+Json LanguageServer::positionAt(const Document& document, size_t offset) {
+    auto it = std::upper_bound(document.lineStarts.begin(), document.lineStarts.end(), offset);
+    size_t line = static_cast<size_t>(it - document.lineStarts.begin()) - 1;
+    Json position = Json::object();
+    position.set("line", line).set("character", offset - document.lineStarts[line]);
+    return position;
+}
+
+Json LanguageServer::rangeAt(const Document& document, size_t offset, size_t length) {
+    Json range = Json::object();
+    range.set("start", positionAt(document, offset)).set("end", positionAt(document, offset + length));
+    return range;
+}
+
+TokenStream LanguageServer::lex(const Document& document, size_t begin, size_t end) {
+    const std::string& source = document.parser.getSource();
+    end = std::min(end, source.size());
+    if (begin >= end) {
+        return {};
+    }
+    auto it = std::upper_bound(document.lineStarts.begin(), document.lineStarts.end(), begin);
+    size_t line = static_cast<size_t>(it - document.lineStarts.begin()) - 1;
+    try {
+        Lexer lexer(source.substr(begin, end - begin), begin, static_cast<int>(line) + 1,
+                    static_cast<int>(begin - document.lineStarts[line]) + 1);
+        return lexer.tokenize();
+    } catch (const std::exception&) {
+        return {};
+    }
+}
+
+size_t LanguageServer::segmentStart(const Document& document, size_t offset, size_t* next) {
+    const auto& segments = document.parser.getSegments();
+    const std::string& source = document.parser.getSource();
+    if (document.parser.isValid()) {
+        auto it = std::upper_bound(segments.begin(), segments.end(), offset,
+            [](size_t position, const IncrementalParser::Segment& segment) { return position < segment.offset; });
+        if (it != segments.begin()) {
+            if (next) *next = it != segments.end() ? it->offset : source.size();
+            return (it - 1)->offset;
+        }
+    }
+    // Header, or text that does not parse: fall back to the current line
+    auto line = std::upper_bound(document.lineStarts.begin(), document.lineStarts.end(), offset) - 1;
+    if (next) *next = line + 1 != document.lineStarts.end() ? *(line + 1) : source.size();
+    return *line;
+}
+
+// ---------------------------------------------------------------------------
+// Queries
+
+const std::unordered_map<std::string, LanguageServer::Symbol>* LanguageServer::moduleSymbols(
+    const Document& document, const std::string& qualifier, const Document** module) {
+    *module = nullptr;
+    auto it = document.qualifiers.find(qualifier);
+    if (it == document.qualifiers.end()) {
+        return nullptr;
+    }
+    if (it->second.empty()) {
+        auto builtin = builtinModules.find(qualifier);
+        return builtin != builtinModules.end() ? &builtin->second : nullptr;
+    }
+    auto found = documents.find(it->second);
+    if (found == documents.end()) {
+        return nullptr;
+    }
+    *module = &found->second;
+    return &found->second.symbols;
+}
+
+Json LanguageServer::symbolLocation(const Document& document, const Symbol& symbol) {
+    const auto& segments = document.parser.getSegments();
+    auto it = std::find_if(segments.begin(), segments.end(),
+        [&](const IncrementalParser::Segment& segment) { return segment.statement == symbol.statement; });
+    if (it == segments.end()) {
+        return Json();
+    }
+    size_t end;
+    size_t begin = segmentStart(document, it->offset, &end);
+    size_t offset = begin;
+    auto tokens = lex(document, begin, end);
+    for (const auto& token : tokens) {
+        if (token.type == TokenType::IDENTIFIER && tokens.text(token) == symbol.name) {
+            offset = token.offset;
+            break;
+        }
+    }
+    Json location = Json::object();
+    location.set("uri", document.uri).set("range", rangeAt(document, offset, symbol.name.size()));
+    return location;
+}
+
+Json LanguageServer::definition(const Json& params) {
+    Document* document = findDocument(params["textDocument"]["uri"].asString());
+    if (!document) {
+        return Json();
+    }
+    size_t cursor = offsetAt(*document, params["position"]);
+    size_t end;
+    size_t begin = segmentStart(*document, cursor, &end);
+    auto tokens = lex(*document, begin, end);
+
+    size_t k = 0;
+    while (k < tokens.size() && !(tokens[k].type == TokenType::IDENTIFIER && tokens[k].offset <= cursor &&
+                                  cursor <= tokens[k].offset + tokens[k].length)) {
+        k++;
+    }
+    if (k == tokens.size()) {
+        return Json();
+    }
+    std::string name = tokens.value(tokens[k]);
+
+    // qualifier.member
+    if (k >= 2 && tokens[k - 1].type == TokenType::DOT && tokens[k - 2].type == TokenType::IDENTIFIER) {
+        const Document* module;
+        auto symbols = moduleSymbols(*document, tokens.value(tokens[k - 2]), &module);
+        if (symbols && module) {
+            auto symbol = symbols->find(name);
+            if (symbol != symbols->end()) {
+                return symbolLocation(*module, symbol->second);
+            }
+        }
+        return Json();
+    }
+
+    // The qualifier itself jumps to the module's file
+    if (k + 1 < tokens.size() && tokens[k + 1].type == TokenType::DOT) {
+        auto qualifier = document->qualifiers.find(name);
+        if (qualifier != document->qualifiers.end() && !qualifier->second.empty()) {
+            Json location = Json::object();
+            location.set("uri", pathToUri(qualifier->second)).set("range", rangeAt(*document, 0, 0));
+            return location;
+        }
+    }
+
+    // Parameters and locals declared earlier in the same top-level statement
+    for (size_t j = k + 1; j-- > 0;) {
+        if (tokens[j].type == TokenType::IDENTIFIER && tokens.text(tokens[j]) == name && declares(tokens, j)) {
+            Json location = Json::object();
+            location.set("uri", document->uri).set("range", rangeAt(*document, tokens[j].offset, name.size()));
+            return location;
+        }
+    }
+
+    // Top-level declarations of this file, then of the modules it imports
+    auto symbol = document->symbols.find(name);
+    if (symbol != document->symbols.end()) {
+        return symbolLocation(*document, symbol->second);
+    }
+    for (const auto& [qualifier, path] : document->qualifiers) {
+        auto module = documents.find(path);
+        if (path.empty() || module == documents.end()) continue;
+        auto imported = module->second.symbols.find(name);
+        if (imported != module->second.symbols.end()) {
+            return symbolLocation(module->second, imported->second);
+        }
+    }
+    return Json();
+}
+
+Json LanguageServer::completion(const Json& params) {
+    Json items = Json::array();
+    Document* document = findDocument(params["textDocument"]["uri"].asString());
+    if (!document) {
+        return items;
+    }
+    size_t cursor = offsetAt(*document, params["position"]);
+    size_t lineStart = *(std::upper_bound(document->lineStarts.begin(), document->lineStarts.end(), cursor) - 1);
+    auto tokens = lex(*document, lineStart, cursor);
+    size_t count = tokens.size();
+    if (count > 0 && tokens[count - 1].type == TokenType::EOF_TOKEN) {
+        count--;
+    }
+
+    std::string prefix;
+    if (count > 0 && isWord(tokens.text(tokens[count - 1])) && tokens[count - 1].offset + tokens[count - 1].length == cursor) {
+        prefix = tokens.value(tokens[count - 1]);
+        count--;
+    }
+
+    std::unordered_set<std::string> seen;
+    auto add = [&](const std::string& label, int kind, const std::string& detail) {
+        if (label.compare(0, prefix.size(), prefix) != 0 || !seen.insert(label).second) {
+            return;
+        }
+        Json item = Json::object();
+        item.set("label", label).set("kind", kind);
+        if (!detail.empty()) {
+            item.set("detail", detail);
+        }
+        items.push(item);
+    };
+
+    // Members of a module after `qualifier.`
+    if (count >= 2 && tokens[count - 1].type == TokenType::DOT && tokens[count - 2].type == TokenType::IDENTIFIER) {
+        const Document* module;
+        if (auto symbols = moduleSymbols(*document, tokens.value(tokens[count - 2]), &module)) {
+            for (const auto& [name, symbol] : *symbols) {
+                add(name, symbol.kind, symbol.detail);
+            }
+        }
+        return items;
+    }
+
+    // Locals declared before the cursor in the enclosing top-level statement
+    size_t begin = segmentStart(*document, cursor);
+    auto scope = lex(*document, begin, cursor);
+    for (size_t i = 0; i < scope.size(); i++) {
+        if (scope[i].type == TokenType::IDENTIFIER && declares(scope, i)) {
+            add(scope.value(scope[i]), KIND_VARIABLE, "");
+        }
+    }
+    for (const auto& [name, symbol] : document->symbols) {
+        add(name, symbol.kind, symbol.detail);
+    }
+    for (const auto& [qualifier, path] : document->qualifiers) {
+        add(qualifier, KIND_MODULE, path.empty() ? "builtin module" : path);
+    }
+    for (const char* keyword : KEYWORDS) {
+        add(keyword, KIND_KEYWORD, "");
+    }
+    return items;
+}
+
+Json LanguageServer::diagnostics(const Document& document) {
+    Json list = Json::array();
+    auto add = [&](Json range, const std::string& message) {
+        Json diagnostic = Json::object();
+        diagnostic.set("range", range).set("severity", 1).set("source", "thor").set("message", message);
+        list.push(diagnostic);
+    };
+
+    auto addLine = [&](int errorLine, const std::string& message) {
+        size_t line = std::min(static_cast<size_t>(std::max(errorLine, 0)), document.lineStarts.size() - 1);
+        size_t begin = document.lineStarts[line];
+        size_t end = line + 1 < document.lineStarts.size() ? document.lineStarts[line + 1] - 1
+                                                           : document.parser.getSource().size();
+        add(rangeAt(document, begin, end - begin), message);
+    };
+
+    if (!document.parser.isValid()) {
+        addLine(document.parseErrorLine, document.parseError);
+        return list; // the index below describes older text
+    }
+
+    const auto& segments = document.parser.getSegments();
+    static const std::regex lineNumber("at line ([0-9]+)");
+    for (const auto& segment : segments) {
+        if (segment.error.empty()) continue;
+        std::smatch match;
+        int line = std::regex_search(segment.error, match, lineNumber) ? std::stoi(match[1]) - 1 : segment.line - 1;
+        addLine(line, segment.error);
+    }
+
+    size_t headerEnd = segments.empty() ? document.parser.getSource().size() : segments[0].offset;
+    auto header = lex(document, 0, headerEnd);
+    for (const auto& [module, path] : document.resolvedImports) {
+        if (!path.empty()) continue;
+        for (const auto& token : header) {
+            if (token.type == TokenType::STRING && header.value(token) == module) {
+                add(rangeAt(document, token.offset, module.size() + 2), "Could not find module: " + module);
+                break;
+            }
+        }
+    }
+
+    for (const auto& segment : segments) {
+        auto references = document.references.find(segment.statement);
+        if (references == document.references.end()) continue;
+        for (const auto& reference : references->second) {
+            const Document* module;
+            auto symbols = moduleSymbols(document, reference.qualifier, &module);
+            if (symbols && !symbols->count(reference.member)) {
+                add(rangeAt(document, segment.offset + reference.offset, reference.member.size()),
+                    "Module '" + reference.qualifier + "' has no member '" + reference.member + "'");
+            }
+        }
+    }
+    return list;
+}
+
+void LanguageServer::publishDiagnostics() {
+    while (!staleDiagnostics.empty()) {
+        {
+            // Newer edits make this round stale; it resumes once they are applied
+            std::lock_guard<std::mutex> lock(queueMutex);
+            if (!queue.empty()) return;
+        }
+        std::string path = *staleDiagnostics.begin();
+        staleDiagnostics.erase(staleDiagnostics.begin());
+        auto it = documents.find(path);
+        if (it == documents.end() || !it->second.open) continue;
+
+        Json params = Json::object();
+        params.set("uri", it->second.uri).set("diagnostics", diagnostics(it->second));
+        Json notification = Json::object();
+        notification.set("jsonrpc", "2.0").set("method", "textDocument/publishDiagnostics").set("params", params);
+        send(notification);
+    }
+}
+
+std::string LanguageServer::uriToPath(const std::string& uri) {
+    std::string path = uri.compare(0, 7, "file://") == 0 ? uri.substr(7) : uri;
+    std::string decoded;
+    for (size_t i = 0; i < path.size(); i++) {
+        if (path[i] == '%' && i + 2 < path.size()) {
+            decoded += static_cast<char>(std::stoi(path.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        } else {
+            decoded += path[i];
+        }
+    }
+    // file:///C:/dir -> C:/dir
+    if (decoded.size() > 2 && decoded[0] == '/' && decoded[2] == ':') {
+        decoded.erase(0, 1);
+    }
+    return decoded;
+}
+
+std::string LanguageServer::pathToUri(const std::string& path) {
+    std::string generic = fs::absolute(path).generic_string();
+    std::string uri = generic.empty() || generic[0] != '/' ? "file:///" : "file://";
+    for (unsigned char c : generic) {
+        if (isalnum(c) || strchr("-._~/:", c)) {
+            uri += static_cast<char>(c);
+        } else {
+            char buffer[4];
+            snprintf(buffer, sizeof(buffer), "%%%02X", c);
+            uri += buffer;
+        }
+    }
+    return uri;
+}
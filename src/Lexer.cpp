@@ -1,130 +1,287 @@
 #include "Lexer.h"
-#include <unordered_map>
+#include <cstring>
 #include <stdexcept>
 
-Lexer::Lexer(const std::string& source) 
-    : source(source), current(0), line(1), column(1) {}
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
-std::vector<Token> Lexer::tokenize() {
-    std::vector<Token> tokens;
+namespace {
+
+// Byte classes are tested a block at a time. Each test returns a bitmask with bit i
+// set when byte i of the block is in the class, so the end of a run is the lowest
+// set bit of the complement and line breaks are read straight off their own mask.
+#if defined(__AVX2__)
+
+struct Block {
+    static constexpr size_t WIDTH = 32;
+    __m256i bytes;
+
+    explicit Block(const char* p) : bytes(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))) {}
+    uint64_t equals(char c) const {
+        return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(c))));
+    }
+    // lo <= byte <= hi, as unsigned bytes: (byte - lo) <= (hi - lo)
+    uint64_t between(char lo, char hi) const {
+        __m256i offset = _mm256_sub_epi8(bytes, _mm256_set1_epi8(lo));
+        __m256i limit = _mm256_set1_epi8(static_cast<char>(hi - lo));
+        return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(offset, limit), limit)));
+    }
+};
+
+#elif defined(__SSE2__) || defined(_M_X64)
+
+struct Block {
+    static constexpr size_t WIDTH = 16;
+    __m128i bytes;
+
+    explicit Block(const char* p) : bytes(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) {}
+    uint64_t equals(char c) const {
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(c))));
+    }
+    uint64_t between(char lo, char hi) const {
+        __m128i offset = _mm_sub_epi8(bytes, _mm_set1_epi8(lo));
+        __m128i limit = _mm_set1_epi8(static_cast<char>(hi - lo));
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(offset, limit), limit)));
+    }
+};
+
+#else
+
+// SWAR: eight bytes in a 64-bit word. Tests set the high bit of matching bytes,
+// which are then gathered into the low eight bits
+struct Block {
+    static constexpr size_t WIDTH = 8;
+    static constexpr uint64_t ONES = 0x0101010101010101ULL;
+    static constexpr uint64_t HIGH = 0x8080808080808080ULL;
+    static constexpr uint64_t LOW = 0x7F7F7F7F7F7F7F7FULL;
+    uint64_t bytes;
+
+    explicit Block(const char* p) {
+        memcpy(&bytes, p, sizeof(bytes));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        bytes = __builtin_bswap64(bytes); // byte i of the block in bits 8i..8i+7
+#endif
+    }
+    static uint64_t gather(uint64_t high) {
+        return ((high >> 7) * 0x0102040810204080ULL) >> 56;
+    }
+    uint64_t equals(char c) const {
+        uint64_t diff = bytes ^ (ONES * static_cast<unsigned char>(c));
+        return gather(~(((diff & LOW) + LOW) | diff | LOW));
+    }
+    // Without borrows between bytes: (0x80 | b) - lo and (0x80 | hi) - b keep their
+    // high bit exactly when b >= lo and b <= hi. Non-ASCII bytes never match.
+    uint64_t between(char lo, char hi) const {
+        uint64_t low = bytes & LOW;
+        uint64_t atLeast = ((low | HIGH) - ONES * static_cast<unsigned char>(lo)) & HIGH;
+        uint64_t atMost = ((ONES * static_cast<unsigned char>(hi) | HIGH) - low) & HIGH;
+        return gather(atLeast & atMost & ~bytes & HIGH);
+    }
+};
+
+#endif
+
+constexpr uint64_t BLOCK_MASK = (1ULL << Block::WIDTH) - 1;
+
+inline unsigned lowestBit(uint64_t mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(mask));
+#endif
+}
+
+inline uint64_t below(unsigned bit) {
+    return (1ULL << bit) - 1;
+}
+
+// text.size() is already known to match, so this compiles to a few integer compares
+template <size_t N>
+inline bool spells(std::string_view text, const char (&keyword)[N]) {
+    return memcmp(text.data(), keyword, N - 1) == 0;
+}
+
+} // namespace
+
+Lexer::Lexer(const std::string& source) : current(0) {
+    stream.source = source;
+}
+
+Lexer::Lexer(const std::string& source, size_t baseOffset, int line, int column) : current(0) {
+    stream.source = source;
+    stream.baseOffset = baseOffset;
+    stream.firstLine = line;
+    stream.firstColumn = column;
+}
+
+TokenStream Lexer::tokenize() {
+    // Roughly one token per five bytes of typical source
+    stream.tokens.reserve(stream.source.size() / 5 + 1);
     
-    while (!isAtEnd()) {
-        Token token = nextToken();
+    std::vector<Token>& tokens = stream.tokens;
+    const char* data = stream.source.data(); // data[size] is '\0'
+    while (true) {
+        char c = data[current];
+        if (c <= ' ' || c == '/') {
+            skipBlanks();
+            if (isAtEnd()) {
+                break;
+            }
+        }
+        Token token = scanToken();
         if (token.type != TokenType::UNKNOWN) {
             tokens.push_back(token);
         }
     }
     
-    tokens.emplace_back(TokenType::EOF_TOKEN, "", line, column);
-    return tokens;
+    tokens.push_back(makeToken(TokenType::EOF_TOKEN, current));
+    return std::move(stream);
 }
 
 Token Lexer::nextToken() {
-    skipWhitespace();
-    
+    skipBlanks();
+    return scanToken();
+}
+
+void Lexer::skipBlanks() {
+    // Line breaks are not tokens; skipWhitespace() records them in the line table
+    while (true) {
+        skipWhitespace();
+        if (peek() == '/' && peek(1) == '/') {
+            skipComment();
+        } else {
+            break;
+        }
+    }
+}
+
+Token Lexer::makeToken(TokenType type, size_t start) const {
+    return { type, static_cast<uint32_t>(stream.baseOffset + start), static_cast<uint32_t>(current - start) };
+}
+
+Token Lexer::scanToken() {
+    size_t start = current;
     if (isAtEnd()) {
-        return Token(TokenType::EOF_TOKEN, "", line, column);
+        return makeToken(TokenType::EOF_TOKEN, start);
     }
     
-    int tokenLine = line;
-    int tokenColumn = column;
-    char c = advance();
+    // Identifiers and keywords are the most common tokens: test for them before the switch
+    char c = stream.source[current];
+    if (isAlpha(c)) {
+        return makeIdentifier();
+    }
+    current++; // not a line break, skipBlanks() consumed those
     
     switch (c) {
-        case '(': return Token(TokenType::LEFT_PAREN, "(", tokenLine, tokenColumn);
-        case ')': return Token(TokenType::RIGHT_PAREN, ")", tokenLine, tokenColumn);
-        case '{': return Token(TokenType::LEFT_BRACE, "{", tokenLine, tokenColumn);
-        case '}': return Token(TokenType::RIGHT_BRACE, "}", tokenLine, tokenColumn);
-        case '[': return Token(TokenType::LEFT_BRACKET, "[", tokenLine, tokenColumn);
-        case ']': return Token(TokenType::RIGHT_BRACKET, "]", tokenLine, tokenColumn);
-        case ';': return Token(TokenType::SEMICOLON, ";", tokenLine, tokenColumn);
-        case ',': return Token(TokenType::COMMA, ",", tokenLine, tokenColumn);
-        case '.': return Token(TokenType::DOT, ".", tokenLine, tokenColumn);
-        case ':': return Token(TokenType::COLON, ":", tokenLine, tokenColumn);
-        case '%': return Token(TokenType::PERCENT, "%", tokenLine, tokenColumn);
-        case '+': return Token(TokenType::PLUS, "+", tokenLine, tokenColumn);
-        case '*': return Token(TokenType::MULTIPLY, "*", tokenLine, tokenColumn);
-        case '/':
-            if (peek() == '/') {
-                skipComment();
-                return nextToken();
-            }
-            return Token(TokenType::DIVIDE, "/", tokenLine, tokenColumn);
+        case '(': return makeToken(TokenType::LEFT_PAREN, start);
+        case ')': return makeToken(TokenType::RIGHT_PAREN, start);
+        case '{': return makeToken(TokenType::LEFT_BRACE, start);
+        case '}': return makeToken(TokenType::RIGHT_BRACE, start);
+        case '[': return makeToken(TokenType::LEFT_BRACKET, start);
+        case ']': return makeToken(TokenType::RIGHT_BRACKET, start);
+        case ';': return makeToken(TokenType::SEMICOLON, start);
+        case ',': return makeToken(TokenType::COMMA, start);
+        case '.': return makeToken(TokenType::DOT, start);
+        case ':': return makeToken(TokenType::COLON, start);
+        case '%': return makeToken(match('=') ? TokenType::PERCENT_ASSIGN : TokenType::PERCENT, start);
+        case '+': return makeToken(match('=') ? TokenType::PLUS_ASSIGN : TokenType::PLUS, start);
+        case '*': return makeToken(match('=') ? TokenType::MULTIPLY_ASSIGN : TokenType::MULTIPLY, start);
+        case '/': return makeToken(match('=') ? TokenType::DIVIDE_ASSIGN : TokenType::DIVIDE, start);
+        case '^': return makeToken(match('=') ? TokenType::CARET_ASSIGN : TokenType::CARET, start);
+        case '~': return makeToken(TokenType::TILDE, start);
         case '-':
-            if (peek() == '>') {
-                advance();
-                return Token(TokenType::ARROW, "->", tokenLine, tokenColumn);
-            }
-            return Token(TokenType::MINUS, "-", tokenLine, tokenColumn);
-        case '=':
-            if (peek() == '=') {
-                advance();
-                return Token(TokenType::EQUAL, "==", tokenLine, tokenColumn);
-            }
-            return Token(TokenType::ASSIGN, "=", tokenLine, tokenColumn);
-        case '!':
-            if (peek() == '=') {
-                advance();
-                return Token(TokenType::NOT_EQUAL, "!=", tokenLine, tokenColumn);
-            }
-            return Token(TokenType::NOT, "!", tokenLine, tokenColumn);
-        case '<': return Token(TokenType::LESS_THAN, "<", tokenLine, tokenColumn);
-        case '>': return Token(TokenType::GREATER_THAN, ">", tokenLine, tokenColumn);
+            if (match('>')) return makeToken(TokenType::ARROW, start);
+            return makeToken(match('=') ? TokenType::MINUS_ASSIGN : TokenType::MINUS, start);
+        case '=': return makeToken(match('=') ? TokenType::EQUAL : TokenType::ASSIGN, start);
+        case '!': return makeToken(match('=') ? TokenType::NOT_EQUAL : TokenType::NOT, start);
+        case '<':
+            if (match('<')) return makeToken(match('=') ? TokenType::SHIFT_LEFT_ASSIGN : TokenType::SHIFT_LEFT, start);
+            return makeToken(match('=') ? TokenType::LESS_EQUAL : TokenType::LESS_THAN, start);
+        case '>':
+            if (match('>')) return makeToken(match('=') ? TokenType::SHIFT_RIGHT_ASSIGN : TokenType::SHIFT_RIGHT, start);
+            return makeToken(match('=') ? TokenType::GREATER_EQUAL : TokenType::GREATER_THAN, start);
         case '&':
-            if (peek() == '&') {
-                advance();
-                return Token(TokenType::AND, "&&", tokenLine, tokenColumn);
-            }
-            return Token(TokenType::AMPERSAND, "&", tokenLine, tokenColumn);
+            if (match('&')) return makeToken(TokenType::AND, start);
+            return makeToken(match('=') ? TokenType::AMPERSAND_ASSIGN : TokenType::AMPERSAND, start);
         case '|':
-            if (peek() == '|') {
-                advance();
-                return Token(TokenType::OR, "||", tokenLine, tokenColumn);
-            }
-            break;
+            if (match('|')) return makeToken(TokenType::OR, start);
+            return makeToken(match('=') ? TokenType::PIPE_ASSIGN : TokenType::PIPE, start);
         case '"':
-            current--; column--; // Back up to include quote
+            current--; // Back up to include quote
             return makeString();
-        case '\n':
-            return Token(TokenType::NEWLINE, "\n", tokenLine, tokenColumn);
         default:
             if (isDigit(c)) {
-                current--; column--; // Back up to include digit
+                current--; // Back up to include digit
                 return makeNumber();
             }
-            if (isAlpha(c)) {
-                current--; column--; // Back up to include character
-                return makeIdentifier();
-            }
             break;
     }
     
-    return Token(TokenType::UNKNOWN, std::string(1, c), tokenLine, tokenColumn);
+    return makeToken(TokenType::UNKNOWN, start);
 }
 
 char Lexer::peek(int offset) const {
     size_t index = current + offset;
-    if (index >= source.length()) return '\0';
-    return source[index];
+    if (index >= stream.source.length()) return '\0';
+    return stream.source[index];
+}
+
+bool Lexer::match(char expected) {
+    if (isAtEnd() || stream.source[current] != expected) return false;
+    current++;
+    return true;
 }
 
 char Lexer::advance() {
     if (isAtEnd()) return '\0';
     
-    char c = source[current++];
+    char c = stream.source[current++];
     if (c == '\n') {
-        line++;
-        column = 1;
-    } else {
-        column++;
+        stream.lineStarts.push_back(static_cast<uint32_t>(stream.baseOffset + current));
     }
     return c;
 }
 
+void Lexer::recordLineBreaks(size_t at, uint64_t newlines) {
+    for (; newlines; newlines &= newlines - 1) {
+        stream.lineStarts.push_back(static_cast<uint32_t>(stream.baseOffset + at + lowestBit(newlines) + 1));
+    }
+}
+
 void Lexer::skipWhitespace() {
+    const char* data = stream.source.data();
+    size_t size = stream.source.size();
+    // Most tokens are adjacent or one space apart; settle those without a block
+    if (current < size && data[current] > ' ') {
+        return;
+    }
+    if (current + 1 < size && data[current] == ' ' && data[current + 1] > ' ') {
+        current++;
+        return;
+    }
+    while (current + Block::WIDTH <= size) {
+        Block block(data + current);
+        uint64_t newlines = block.equals('\n');
+        uint64_t blank = newlines | block.equals(' ') | block.equals('\t') | block.equals('\r');
+        uint64_t stop = ~blank & BLOCK_MASK;
+        if (stop) {
+            unsigned run = lowestBit(stop);
+            recordLineBreaks(current, newlines & below(run));
+            current += run;
+            return;
+        }
+        recordLineBreaks(current, newlines);
+        current += Block::WIDTH;
+    }
     while (!isAtEnd()) {
         char c = peek();
-        if (c == ' ' || c == '\r' || c == '\t') {
+        if (c == ' ' || c == '\r' || c == '\t' || c == '\n') {
             advance();
         } else {
             break;
@@ -133,79 +290,104 @@ void Lexer::skipWhitespace() {
 }
 
 void Lexer::skipComment() {
-    // Skip // comment
-    while (!isAtEnd() && peek() != '\n') {
-        advance();
-    }
+    // Skip // comment, up to the line break that skipWhitespace() records
+    // (memchr is already vectorized by the C library)
+    const char* data = stream.source.data();
+    const void* newline = memchr(data + current, '\n', stream.source.size() - current);
+    current = newline ? static_cast<const char*>(newline) - data : stream.source.size();
 }
 
 Token Lexer::makeString() {
-    int tokenLine = line;
-    int tokenColumn = column;
+    size_t start = current;
+    int tokenLine = stream.firstLine + static_cast<int>(stream.lineStarts.size());
+    int tokenColumn = stream.column(stream.baseOffset + start);
     
     advance(); // consume opening quote
-    std::string value;
     
-    while (!isAtEnd() && peek() != '"') {
-        if (peek() == '\\') {
-            advance(); // consume backslash
-            if (!isAtEnd()) {
-                char escaped = advance();
-                switch (escaped) {
-                    case 'n': value += '\n'; break;
-                    case 't': value += '\t'; break;
-                    case 'r': value += '\r'; break;
-                    case '\\': value += '\\'; break;
-                    case '"': value += '"'; break;
-                    default: value += escaped; break;
-                }
+    // Escapes are resolved by TokenStream::value() when the parser needs the text;
+    // here only the closing quote matters, skipping escaped characters
+    const char* data = stream.source.data();
+    size_t size = stream.source.size();
+    while (true) {
+        if (current + Block::WIDTH <= size) {
+            Block block(data + current);
+            uint64_t newlines = block.equals('\n');
+            uint64_t stop = block.equals('"') | block.equals('\\');
+            if (!stop) {
+                recordLineBreaks(current, newlines);
+                current += Block::WIDTH;
+                continue;
             }
+            unsigned run = lowestBit(stop);
+            recordLineBreaks(current, newlines & below(run));
+            current += run;
         } else {
-            value += advance();
+            while (!isAtEnd() && peek() != '"' && peek() != '\\') {
+                advance();
+            }
+            if (isAtEnd()) {
+                break;
+            }
         }
+        if (peek() == '"') {
+            break;
+        }
+        advance(); // consume backslash
+        advance(); // and the escaped character
     }
     
     if (isAtEnd()) {
-        throw std::runtime_error("Unterminated string at line " + std::to_string(tokenLine));
+        throw SyntaxError("Unterminated string", tokenLine, tokenColumn);
     }
     
     advance(); // consume closing quote
-    return Token(TokenType::STRING, value, tokenLine, tokenColumn);
+    return makeToken(TokenType::STRING, start);
 }
 
 Token Lexer::makeNumber() {
-    int tokenLine = line;
-    int tokenColumn = column;
-    std::string value;
+    size_t start = current;
     bool isFloat = false;
     
     while (!isAtEnd() && isDigit(peek())) {
-        value += advance();
+        advance();
     }
     
     // Check for decimal point
     if (!isAtEnd() && peek() == '.' && isDigit(peek(1))) {
         isFloat = true;
-        value += advance(); // consume '.'
+        advance(); // consume '.'
         while (!isAtEnd() && isDigit(peek())) {
-            value += advance();
+            advance();
         }
     }
     
-    return Token(isFloat ? TokenType::FLOAT : TokenType::INTEGER, value, tokenLine, tokenColumn);
+    return makeToken(isFloat ? TokenType::FLOAT : TokenType::INTEGER, start);
 }
 
 Token Lexer::makeIdentifier() {
-    int tokenLine = line;
-    int tokenColumn = column;
-    std::string value;
+    size_t start = current;
+    const char* data = stream.source.data();
+    size_t size = stream.source.size();
     
-    while (!isAtEnd() && isAlphaNumeric(peek())) {
-        value += advance();
+    while (true) {
+        if (current + Block::WIDTH > size) {
+            while (!isAtEnd() && isAlphaNumeric(peek())) {
+                current++;
+            }
+            break;
+        }
+        Block block(data + current);
+        uint64_t word = block.between('a', 'z') | block.between('A', 'Z') | block.between('0', '9') | block.equals('_');
+        uint64_t stop = ~word & BLOCK_MASK;
+        if (stop) {
+            current += lowestBit(stop);
+            break;
+        }
+        current += Block::WIDTH;
     }
     
-    TokenType type = getKeywordType(value);
-    return Token(type, value, tokenLine, tokenColumn);
+    TokenType type = getKeywordType(std::string_view(data + start, current - start));
+    return makeToken(type, start);
 }
 
 bool Lexer::isAlpha(char c) const {
@@ -220,29 +402,42 @@ bool Lexer::isAlphaNumeric(char c) const {
     return isAlpha(c) || isDigit(c);
 }
 
-TokenType Lexer::getKeywordType(const std::string& text) const {
-    static const std::unordered_map<std::string, TokenType> keywords = {
-        {"package", TokenType::PACKAGE},
-        {"import", TokenType::IMPORT},
-        {"func", TokenType::FUNC},
-        {"return", TokenType::RETURN},
-        {"if", TokenType::IF},
-        {"else", TokenType::ELSE},
-        {"while", TokenType::WHILE},
-        {"const", TokenType::CONST},
-        {"int", TokenType::INT},
-        {"float", TokenType::FLOAT_TYPE},
-        {"string", TokenType::STRING_TYPE},
-        {"boolean", TokenType::BOOLEAN_TYPE},
-        {"void", TokenType::VOID_TYPE},
-        {"true", TokenType::TRUE_VALUE},
-        {"false", TokenType::FALSE_VALUE}
-    };
-    
-    auto it = keywords.find(text);
-    return (it != keywords.end()) ? it->second : TokenType::IDENTIFIER;
+TokenType Lexer::getKeywordType(std::string_view text) const {
+    // By length first, so most identifiers are ruled out without comparing text
+    switch (text.size()) {
+        case 2:
+            if (spells(text, "if")) return TokenType::IF;
+            break;
+        case 3:
+            if (spells(text, "int")) return TokenType::INT;
+            if (spells(text, "str")) return TokenType::STR_TYPE;
+            break;
+        case 4:
+            if (spells(text, "func")) return TokenType::FUNC;
+            if (spells(text, "else")) return TokenType::ELSE;
+            if (spells(text, "void")) return TokenType::VOID_TYPE;
+            if (spells(text, "true")) return TokenType::TRUE_VALUE;
+            break;
+        case 5:
+            if (spells(text, "while")) return TokenType::WHILE;
+            if (spells(text, "bench")) return TokenType::BENCH;
+            if (spells(text, "const")) return TokenType::CONST;
+            if (spells(text, "float")) return TokenType::FLOAT_TYPE;
+            if (spells(text, "false")) return TokenType::FALSE_VALUE;
+            break;
+        case 6:
+            if (spells(text, "return")) return TokenType::RETURN;
+            if (spells(text, "import")) return TokenType::IMPORT;
+            if (spells(text, "string")) return TokenType::STRING_TYPE;
+            break;
+        case 7:
+            if (spells(text, "package")) return TokenType::PACKAGE;
+            if (spells(text, "boolean")) return TokenType::BOOLEAN_TYPE;
+            break;
+    }
+    return TokenType::IDENTIFIER;
 }
 
 bool Lexer::isAtEnd() const {
-    return current >= source.length();
+    return current >= stream.source.length();
 }
\ No newline at end of file
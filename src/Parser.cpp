@@ -1,40 +1,48 @@
 #include "Parser.h"
+#include <array>
 #include <stdexcept>
 #include <iostream>
 
-Parser::Parser(std::vector<Token> tokens) : tokens(tokens), current(0) {}
+Parser::Parser(TokenStream tokens) : tokens(std::move(tokens)), current(0) {}
 
 std::shared_ptr<Program> Parser::parse() {
     auto program = std::make_shared<Program>();
+    parseHeader(*program);
     
-    // Skip newlines at the beginning
-    while (match({TokenType::NEWLINE})) {}
+    // Parse top-level statements
+    while (auto statement = parseTopLevelStatement()) {
+        program->statements.push_back(statement);
+    }
     
+    return program;
+}
+
+void Parser::parseHeader(Program& program) {
     // Parse package declaration
     if (check(TokenType::PACKAGE)) {
-        program->package = parsePackageDeclaration();
-        while (match({TokenType::NEWLINE})) {}
+        const Token& start = peek();
+        program.package = parsePackageDeclaration();
+        program.package->line = tokens.line(start);
+        program.package->column = tokens.column(start);
     }
     
     // Parse imports
     while (check(TokenType::IMPORT)) {
-        program->imports.push_back(parseImportDeclaration());
-        while (match({TokenType::NEWLINE})) {}
+        const Token& start = peek();
+        program.imports.push_back(parseImportDeclaration());
+        program.imports.back()->line = tokens.line(start);
+        program.imports.back()->column = tokens.column(start);
     }
-    
-    // Parse top-level statements
-    while (!isAtEnd()) {
-        if (match({TokenType::NEWLINE})) {
-            continue;
-        }
-        program->statements.push_back(parseStatement());
-        while (match({TokenType::NEWLINE})) {}
+}
+
+std::shared_ptr<Statement> Parser::parseTopLevelStatement() {
+    if (isAtEnd()) {
+        return nullptr;
     }
-    
-    return program;
+    return parseStatement();
 }
 
-Token& Parser::peek(int offset) {
+const Token& Parser::peek(int offset) const {
     size_t index = current + offset;
     if (index >= tokens.size()) {
         return tokens.back(); // Return EOF token
@@ -42,14 +50,14 @@ Token& Parser::peek(int offset) {
     return tokens[index];
 }
 
-Token& Parser::advance() {
+const Token& Parser::advance() {
     if (!isAtEnd()) current++;
     return peek(-1);
 }
 
-bool Parser::check(TokenType type) {
-    if (isAtEnd()) return false;
-    return peek().type == type;
+bool Parser::check(TokenType type) const {
+    // The stream always ends with EOF_TOKEN, so current never runs past it
+    return tokens[current].type == type && type != TokenType::EOF_TOKEN;
 }
 
 bool Parser::match(std::initializer_list<TokenType> types) {
@@ -63,7 +71,7 @@ bool Parser::match(std::initializer_list<TokenType> types) {
 }
 
 bool Parser::isAtEnd() const {
-    return current >= tokens.size() || tokens[current].type == TokenType::EOF_TOKEN;
+    return tokens[current].type == TokenType::EOF_TOKEN;
 }
 
 void Parser::consume(TokenType type, const std::string& message) {
@@ -72,9 +80,8 @@ void Parser::consume(TokenType type, const std::string& message) {
         return;
     }
     
-    Token& token = peek();
-    throw std::runtime_error(message + " at line " + std::to_string(token.line) + 
-                           ", got '" + token.value + "'");
+    const Token& token = peek();
+    throw SyntaxError(message, tokens.line(token), tokens.column(token), ", got '" + value(token) + "'");
 }
 
 std::shared_ptr<Type> Parser::parseType() {
@@ -88,11 +95,14 @@ std::shared_ptr<Type> Parser::parseType() {
         baseType = Type::createFloat();
     } else if (match({TokenType::STRING_TYPE})) {
         baseType = Type::createString();
+    } else if (match({TokenType::STR_TYPE})) {
+        baseType = Type::createStr();
     } else if (match({TokenType::BOOLEAN_TYPE})) {
         baseType = Type::createBoolean();
     } else if (check(TokenType::IDENTIFIER)) {
         // For array types like "string[]"
-        std::string typeName = advance().value;
+        const Token& name = advance();
+        std::string typeName = value(name);
         if (match({TokenType::LEFT_BRACKET})) {
             consume(TokenType::RIGHT_BRACKET, "Expected ']' after '['");
             if (typeName == "string") {
@@ -104,14 +114,15 @@ std::shared_ptr<Type> Parser::parseType() {
             } else if (typeName == "boolean") {
                 baseType = Type::createArray(Type::createBoolean());
             } else {
-                throw std::runtime_error("Unknown array type: " + typeName);
+                throw SyntaxError("Unknown array type: " + typeName, tokens.line(name), tokens.column(name));
             }
         } else {
             // Handle other custom types if needed
-            throw std::runtime_error("Unknown type: " + typeName);
+            throw SyntaxError("Unknown type: " + typeName, tokens.line(name), tokens.column(name));
         }
     } else {
-        throw std::runtime_error("Expected type");
+        const Token& token = peek();
+        throw SyntaxError("Expected type", tokens.line(token), tokens.column(token), ", got '" + value(token) + "'");
     }
     
     // Handle reference modifier
@@ -122,212 +133,329 @@ std::shared_ptr<Type> Parser::parseType() {
     return baseType;
 }
 
-std::shared_ptr<Expression> Parser::parseExpression() {
-    return parseAssignment();
-}
+namespace {
 
-std::shared_ptr<Expression> Parser::parseAssignment() {
-    auto expr = parseLogicalOr();
-    
-    if (match({TokenType::ASSIGN})) {
-        std::string op = peek(-1).value;
-        auto value = parseAssignment();
-        return std::make_shared<BinaryExpression>(expr, op, value);
-    }
-    
-    return expr;
-}
+// How tightly a token binds as a binary operator; tokens that are not one have
+// precedence 0. Assignments are the loosest and group to the right; the rest
+// follow Go: bitwise operators share the levels of the arithmetic ones, so
+// `x & 1 == 0` compares (x & 1).
+struct BinaryOperator {
+    uint8_t precedence = 0;
+    bool rightAssociative = false;
+};
 
-std::shared_ptr<Expression> Parser::parseLogicalOr() {
-    auto expr = parseLogicalAnd();
-    
-    while (match({TokenType::OR})) {
-        std::string op = peek(-1).value;
-        auto right = parseLogicalAnd();
-        expr = std::make_shared<BinaryExpression>(expr, op, right);
-    }
-    
-    return expr;
-}
+constexpr uint8_t ASSIGNMENT_PRECEDENCE = 1;
 
-std::shared_ptr<Expression> Parser::parseLogicalAnd() {
-    auto expr = parseEquality();
-    
-    while (match({TokenType::AND})) {
-        std::string op = peek(-1).value;
-        auto right = parseEquality();
-        expr = std::make_shared<BinaryExpression>(expr, op, right);
-    }
-    
-    return expr;
+constexpr std::array<BinaryOperator, static_cast<size_t>(TokenType::COUNT)> makeBinaryOperators() {
+    std::array<BinaryOperator, static_cast<size_t>(TokenType::COUNT)> table{};
+    auto set = [&table](TokenType type, uint8_t precedence) {
+        table[static_cast<size_t>(type)] = { precedence, precedence == ASSIGNMENT_PRECEDENCE };
+    };
+    for (TokenType type : { TokenType::ASSIGN, TokenType::PLUS_ASSIGN, TokenType::MINUS_ASSIGN,
+                            TokenType::MULTIPLY_ASSIGN, TokenType::DIVIDE_ASSIGN, TokenType::PERCENT_ASSIGN,
+                            TokenType::AMPERSAND_ASSIGN, TokenType::PIPE_ASSIGN, TokenType::CARET_ASSIGN,
+                            TokenType::SHIFT_LEFT_ASSIGN, TokenType::SHIFT_RIGHT_ASSIGN }) {
+        set(type, ASSIGNMENT_PRECEDENCE);
+    }
+    set(TokenType::OR, 2);
+    set(TokenType::AND, 3);
+    for (TokenType type : { TokenType::EQUAL, TokenType::NOT_EQUAL, TokenType::LESS_THAN,
+                            TokenType::LESS_EQUAL, TokenType::GREATER_THAN, TokenType::GREATER_EQUAL }) {
+        set(type, 4);
+    }
+    for (TokenType type : { TokenType::PLUS, TokenType::MINUS, TokenType::PIPE, TokenType::CARET }) {
+        set(type, 5);
+    }
+    for (TokenType type : { TokenType::MULTIPLY, TokenType::DIVIDE, TokenType::PERCENT,
+                            TokenType::SHIFT_LEFT, TokenType::SHIFT_RIGHT, TokenType::AMPERSAND }) {
+        set(type, 6);
+    }
+    return table;
 }
 
-std::shared_ptr<Expression> Parser::parseEquality() {
-    auto expr = parseComparison();
-    
-    while (match({TokenType::EQUAL, TokenType::NOT_EQUAL})) {
-        std::string op = peek(-1).value;
-        auto right = parseComparison();
-        expr = std::make_shared<BinaryExpression>(expr, op, right);
-    }
-    
-    return expr;
-}
+constexpr auto binaryOperators = makeBinaryOperators();
 
-std::shared_ptr<Expression> Parser::parseComparison() {
-    auto expr = parseTerm();
-    
-    while (match({TokenType::GREATER_THAN, TokenType::LESS_THAN})) {
-        std::string op = peek(-1).value;
-        auto right = parseTerm();
-        expr = std::make_shared<BinaryExpression>(expr, op, right);
-    }
-    
-    return expr;
-}
-
-std::shared_ptr<Expression> Parser::parseTerm() {
-    auto expr = parseFactor();
-    
-    while (match({TokenType::MINUS, TokenType::PLUS})) {
-        std::string op = peek(-1).value;
-        auto right = parseFactor();
-        expr = std::make_shared<BinaryExpression>(expr, op, right);
-    }
-    
-    return expr;
-}
-
-std::shared_ptr<Expression> Parser::parseFactor() {
-    auto expr = parseUnary();
-    
-    while (match({TokenType::DIVIDE, TokenType::MULTIPLY, TokenType::MODULO})) {
-        std::string op = peek(-1).value;
-        auto right = parseUnary();
-        expr = std::make_shared<BinaryExpression>(expr, op, right);
-    }
-    
-    return expr;
-}
-
-std::shared_ptr<Expression> Parser::parseUnary() {
-    if (match({TokenType::NOT, TokenType::MINUS})) {
-        std::string op = peek(-1).value;
-        auto right = parseUnary();
-        return std::make_shared<UnaryExpression>(op, right);
-    }
-    
-    return parseCall();
-}
+} // namespace
 
-std::shared_ptr<Expression> Parser::parseCall() {
-    auto expr = parsePrimary();
+// Operator-precedence parsing with an explicit stack: prefix operators and
+// opening brackets push frames until an operand is read, then each following
+// binary operator first folds the frames that bind at least as tightly, and a
+// closing bracket completes the frame that opened it
+std::shared_ptr<Expression> Parser::parseExpression() {
+    std::vector<ExpressionFrame>& frames = expressionFrames;
+    frames.clear();
     
     while (true) {
-        if (match({TokenType::LEFT_PAREN})) {
-            std::vector<std::shared_ptr<Expression>> arguments;
+        // Operand: open frames up to the next literal or identifier
+        std::shared_ptr<Expression> operand;
+        const Token token = peek();
+        switch (token.type) {
+            case TokenType::NOT:
+            case TokenType::MINUS:
+            case TokenType::TILDE:
+                advance();
+                frames.push_back({ ExpressionFrame::PREFIX, token, 0, nullptr });
+                continue;
+            
+            case TokenType::LEFT_PAREN:
+                advance();
+                frames.push_back({ ExpressionFrame::GROUP, token, 0, nullptr });
+                continue;
             
-            if (!check(TokenType::RIGHT_PAREN)) {
-                do {
-                    arguments.push_back(parseExpression());
-                } while (match({TokenType::COMMA}));
+            case TokenType::LEFT_BRACKET:
+                advance();
+                operand = std::make_shared<ArrayExpression>(std::vector<std::shared_ptr<Expression>>());
+                if (!check(TokenType::RIGHT_BRACKET)) {
+                    frames.push_back({ ExpressionFrame::ARRAY, token, 0, operand });
+                    continue;
+                }
+                advance();
+                break;
+            
+            case TokenType::STRING: {
+                std::string text = value(advance());
+                
+                // Check if this is a format string (contains % followed by [)
+                if (!check(TokenType::PERCENT)) {
+                    operand = std::make_shared<LiteralExpression>(text, LiteralExpression::STRING);
+                    break;
+                }
+                advance(); // consume %
+                consume(TokenType::LEFT_BRACKET, "Expected '[' after '%'");
+                operand = std::make_shared<FormatStringExpression>(text, std::vector<std::shared_ptr<Expression>>());
+                if (!check(TokenType::RIGHT_BRACKET)) {
+                    frames.push_back({ ExpressionFrame::FORMAT, token, 0, operand });
+                    continue;
+                }
+                advance();
+                break;
             }
             
-            consume(TokenType::RIGHT_PAREN, "Expected ')' after arguments");
-            expr = std::make_shared<CallExpression>(expr, arguments);
-        } else if (match({TokenType::DOT})) {
-            consume(TokenType::IDENTIFIER, "Expected property name after '.'");
-            std::string property = peek(-1).value;
-            expr = std::make_shared<MemberExpression>(expr, property);
-        } else {
-            break;
+            default:
+                operand = parsePrimary();
+                break;
+        }
+        
+        // Operator: extend the operand with calls and member accesses, fold the
+        // frames it completes, and stop at the next binary operator or separator
+        bool nextOperand = false;
+        while (!nextOperand) {
+            if (match({TokenType::LEFT_PAREN})) {
+                auto call = std::make_shared<CallExpression>(operand, std::vector<std::shared_ptr<Expression>>());
+                if (!check(TokenType::RIGHT_PAREN)) {
+                    frames.push_back({ ExpressionFrame::CALL, peek(-1), 0, call });
+                    break;
+                }
+                advance();
+                operand = call;
+                continue;
+            }
+            if (match({TokenType::DOT})) {
+                consume(TokenType::IDENTIFIER, "Expected property name after '.'");
+                operand = std::make_shared<MemberExpression>(operand, value(peek(-1)));
+                continue;
+            }
+            
+            const BinaryOperator& op = binaryOperators[static_cast<size_t>(peek().type)];
+            while (!frames.empty()) {
+                ExpressionFrame& frame = frames.back();
+                if (frame.kind == ExpressionFrame::PREFIX) {
+                    operand = std::make_shared<UnaryExpression>(value(frame.op), operand);
+                } else if (frame.kind == ExpressionFrame::BINARY &&
+                           (frame.precedence > op.precedence ||
+                            (frame.precedence == op.precedence && !op.rightAssociative))) {
+                    operand = std::make_shared<BinaryExpression>(frame.node, value(frame.op), operand);
+                } else {
+                    break;
+                }
+                frames.pop_back();
+            }
+            
+            if (op.precedence > 0) {
+                frames.push_back({ ExpressionFrame::BINARY, advance(), op.precedence, operand });
+                break;
+            }
+            if (frames.empty()) {
+                return operand;
+            }
+            
+            // A separator: the operand completes the innermost open bracket
+            ExpressionFrame& frame = frames.back();
+            switch (frame.kind) {
+                case ExpressionFrame::GROUP:
+                    consume(TokenType::RIGHT_PAREN, "Expected ')' after expression");
+                    break;
+                
+                case ExpressionFrame::CALL:
+                    static_cast<CallExpression&>(*frame.node).arguments.push_back(operand);
+                    nextOperand = match({TokenType::COMMA});
+                    if (!nextOperand) {
+                        consume(TokenType::RIGHT_PAREN, "Expected ')' after arguments");
+                    }
+                    break;
+                
+                case ExpressionFrame::ARRAY:
+                    static_cast<ArrayExpression&>(*frame.node).elements.push_back(operand);
+                    nextOperand = match({TokenType::COMMA});
+                    if (!nextOperand) {
+                        consume(TokenType::RIGHT_BRACKET, "Expected ']' after array elements");
+                    }
+                    break;
+                
+                case ExpressionFrame::FORMAT:
+                    static_cast<FormatStringExpression&>(*frame.node).arguments.push_back(operand);
+                    nextOperand = match({TokenType::COMMA});
+                    if (!nextOperand) {
+                        consume(TokenType::RIGHT_BRACKET, "Expected ']' after format arguments");
+                    }
+                    break;
+                
+                default:
+                    break;
+            }
+            if (!nextOperand) {
+                if (frame.node) {
+                    operand = frame.node;
+                }
+                frames.pop_back();
+            }
         }
     }
-    
-    return expr;
 }
 
 std::shared_ptr<Expression> Parser::parsePrimary() {
-    if (match({TokenType::TRUE_VALUE})) {
-        return std::make_shared<LiteralExpression>("true", LiteralExpression::BOOLEAN);
-    }
-    
-    if (match({TokenType::FALSE_VALUE})) {
-        return std::make_shared<LiteralExpression>("false", LiteralExpression::BOOLEAN);
-    }
-    
-    if (match({TokenType::INTEGER})) {
-        return std::make_shared<LiteralExpression>(peek(-1).value, LiteralExpression::INTEGER);
-    }
-    
-    if (match({TokenType::FLOAT})) {
-        return std::make_shared<LiteralExpression>(peek(-1).value, LiteralExpression::FLOAT);
+    const Token& token = peek();
+    switch (token.type) {
+        case TokenType::TRUE_VALUE:
+            advance();
+            return std::make_shared<LiteralExpression>("true", LiteralExpression::BOOLEAN);
+        
+        case TokenType::FALSE_VALUE:
+            advance();
+            return std::make_shared<LiteralExpression>("false", LiteralExpression::BOOLEAN);
+        
+        case TokenType::INTEGER:
+            return std::make_shared<LiteralExpression>(value(advance()), LiteralExpression::INTEGER);
+        
+        case TokenType::FLOAT:
+            return std::make_shared<LiteralExpression>(value(advance()), LiteralExpression::FLOAT);
+        
+        case TokenType::IDENTIFIER:
+            return std::make_shared<IdentifierExpression>(value(advance()));
+        
+        default:
+            throw SyntaxError("Unexpected token '" + value(token) + "'", tokens.line(token), tokens.column(token));
     }
+}
+
+// Compound statements (blocks, if, while, functions) push frames that collect
+// their nested statements; a simple statement, or the end of a block, completes
+// the innermost frame, which may complete the one around it in turn
+std::shared_ptr<Statement> Parser::parseStatement() {
+    std::vector<StatementFrame>& frames = statementFrames;
+    frames.clear();
+    
+    // Nested statements are positioned relative to the top-level one (see Statement)
+    int baseLine = 0;
+    int baseColumn;
+    tokens.position(peek().offset, lineCursor, baseLine, baseColumn);
+    auto locate = [&](Statement& statement, const Token& token) {
+        tokens.position(token.offset, lineCursor, statement.line, statement.column);
+        statement.line -= baseLine;
+    };
     
-    if (match({TokenType::STRING})) {
-        std::string value = peek(-1).value;
-        
-        // Check if this is a format string (contains % followed by [)
-        if (check(TokenType::PERCENT)) {
-            advance(); // consume %
-            consume(TokenType::LEFT_BRACKET, "Expected '[' after '%'");
-            
-            std::vector<std::shared_ptr<Expression>> args;
-            if (!check(TokenType::RIGHT_BRACKET)) {
-                do {
-                    args.push_back(parseExpression());
-                } while (match({TokenType::COMMA}));
+    while (true) {
+        std::shared_ptr<Statement> statement;
+        Token start = peek();
+        if (!frames.empty() && frames.back().kind == StatementFrame::BLOCK &&
+            (check(TokenType::RIGHT_BRACE) || isAtEnd())) {
+            // The innermost block ends here
+        } else if (check(TokenType::FUNC)) {
+            frames.push_back({ StatementFrame::FUNCTION, parseFunctionHeader() });
+            locate(*frames.back().node, start);
+            Token brace = peek();
+            consume(TokenType::LEFT_BRACE, "Expected '{'");
+            frames.push_back({ StatementFrame::BLOCK, std::make_shared<BlockStatement>(std::vector<std::shared_ptr<Statement>>()) });
+            locate(*frames.back().node, brace);
+            continue;
+        } else if (check(TokenType::BENCH)) {
+            if (!frames.empty()) {
+                throw SyntaxError("Benchmarks are only allowed at the top level", tokens.line(start), tokens.column(start));
             }
-            
-            consume(TokenType::RIGHT_BRACKET, "Expected ']' after format arguments");
-            return std::make_shared<FormatStringExpression>(value, args);
+            advance();
+            consume(TokenType::IDENTIFIER, "Expected benchmark name");
+            std::string name = value(peek(-1));
+            frames.push_back({ StatementFrame::BENCH, std::make_shared<BenchDeclaration>(name, nullptr) });
+            locate(*frames.back().node, start);
+            Token brace = peek();
+            consume(TokenType::LEFT_BRACE, "Expected '{' after benchmark name");
+            frames.push_back({ StatementFrame::BLOCK, std::make_shared<BlockStatement>(std::vector<std::shared_ptr<Statement>>()) });
+            locate(*frames.back().node, brace);
+            continue;
+        } else if (match({TokenType::LEFT_BRACE})) {
+            frames.push_back({ StatementFrame::BLOCK, std::make_shared<BlockStatement>(std::vector<std::shared_ptr<Statement>>()) });
+            locate(*frames.back().node, start);
+            continue;
+        } else if (match({TokenType::IF})) {
+            consume(TokenType::LEFT_PAREN, "Expected '(' after 'if'");
+            auto condition = parseExpression();
+            consume(TokenType::RIGHT_PAREN, "Expected ')' after if condition");
+            frames.push_back({ StatementFrame::IF, std::make_shared<IfStatement>(condition, nullptr) });
+            locate(*frames.back().node, start);
+            continue;
+        } else if (match({TokenType::WHILE})) {
+            consume(TokenType::LEFT_PAREN, "Expected '(' after 'while'");
+            auto condition = parseExpression();
+            consume(TokenType::RIGHT_PAREN, "Expected ')' after while condition");
+            frames.push_back({ StatementFrame::WHILE, std::make_shared<WhileStatement>(condition, nullptr) });
+            locate(*frames.back().node, start);
+            continue;
+        } else {
+            statement = parseSimpleStatement();
+            locate(*statement, start);
         }
         
-        return std::make_shared<LiteralExpression>(value, LiteralExpression::STRING);
-    }
-    
-    if (match({TokenType::IDENTIFIER})) {
-        return std::make_shared<IdentifierExpression>(peek(-1).value);
-    }
-    
-    if (match({TokenType::LEFT_PAREN})) {
-        auto expr = parseExpression();
-        consume(TokenType::RIGHT_PAREN, "Expected ')' after expression");
-        return expr;
-    }
-    
-    if (match({TokenType::LEFT_BRACKET})) {
-        std::vector<std::shared_ptr<Expression>> elements;
-        if (!check(TokenType::RIGHT_BRACKET)) {
-            do {
-                elements.push_back(parseExpression());
-            } while (match({TokenType::COMMA}));
+        // Attach the finished statement to the frames waiting for it
+        while (true) {
+            if (frames.empty()) {
+                if (statement) {
+                    statement->line += baseLine;
+                }
+                return statement;
+            }
+            StatementFrame& frame = frames.back();
+            if (frame.kind == StatementFrame::BLOCK) {
+                if (statement) {
+                    static_cast<BlockStatement&>(*frame.node).statements.push_back(statement);
+                }
+                if (!check(TokenType::RIGHT_BRACE) && !isAtEnd()) {
+                    break; // parse the block's next statement
+                }
+                consume(TokenType::RIGHT_BRACE, "Expected '}'");
+            } else if (frame.kind == StatementFrame::IF) {
+                auto& ifStatement = static_cast<IfStatement&>(*frame.node);
+                if (!ifStatement.thenBranch) {
+                    ifStatement.thenBranch = statement;
+                    if (match({TokenType::ELSE})) {
+                        break; // parse the else branch
+                    }
+                } else {
+                    ifStatement.elseBranch = statement;
+                }
+            } else if (frame.kind == StatementFrame::WHILE) {
+                static_cast<WhileStatement&>(*frame.node).body = statement;
+            } else if (frame.kind == StatementFrame::FUNCTION) {
+                static_cast<FunctionDeclaration&>(*frame.node).body = std::static_pointer_cast<BlockStatement>(statement);
+            } else {
+                static_cast<BenchDeclaration&>(*frame.node).body = std::static_pointer_cast<BlockStatement>(statement);
+            }
+            statement = frame.node;
+            frames.pop_back();
         }
-        consume(TokenType::RIGHT_BRACKET, "Expected ']' after array elements");
-        return std::make_shared<ArrayExpression>(elements);
     }
-    
-    Token& token = peek();
-    throw std::runtime_error("Unexpected token '" + token.value + "' at line " + std::to_string(token.line));
 }
 
-std::shared_ptr<Statement> Parser::parseStatement() {
-    if (check(TokenType::FUNC)) {
-        return parseFunctionDeclaration();
-    }
-    
-    if (check(TokenType::LEFT_BRACE)) {
-        return parseBlock();
-    }
-    
-    if (match({TokenType::IF})) {
-        return parseIfStatement();
-    }
-    
-    if (match({TokenType::WHILE})) {
-        return parseWhileStatement();
-    }
-    
+std::shared_ptr<Statement> Parser::parseSimpleStatement() {
     if (match({TokenType::RETURN})) {
         return parseReturnStatement();
     }
@@ -338,7 +466,8 @@ std::shared_ptr<Statement> Parser::parseStatement() {
     }
     
     // Check for variable declaration - type followed by identifier
-    if (check(TokenType::INT) || check(TokenType::FLOAT_TYPE) || check(TokenType::STRING_TYPE) || check(TokenType::BOOLEAN_TYPE)) {
+    if (check(TokenType::INT) || check(TokenType::FLOAT_TYPE) || check(TokenType::STRING_TYPE) ||
+        check(TokenType::STR_TYPE) || check(TokenType::BOOLEAN_TYPE)) {
         return parseVariableDeclaration();
     }
     
@@ -354,7 +483,7 @@ std::shared_ptr<Statement> Parser::parseExpressionStatement() {
 std::shared_ptr<VariableDeclaration> Parser::parseVariableDeclaration() {
     std::shared_ptr<Type> type = parseType();
     consume(TokenType::IDENTIFIER, "Expected variable name");
-    std::string name = peek(-1).value;
+    std::string name = value(peek(-1));
     
     std::shared_ptr<Expression> initializer = nullptr;
     if (match({TokenType::ASSIGN})) {
@@ -368,7 +497,7 @@ std::shared_ptr<VariableDeclaration> Parser::parseVariableDeclaration() {
 std::shared_ptr<ConstDeclaration> Parser::parseConstDeclaration() {
     std::shared_ptr<Type> type = parseType();
     consume(TokenType::IDENTIFIER, "Expected constant name");
-    std::string name = peek(-1).value;
+    std::string name = value(peek(-1));
     
     consume(TokenType::ASSIGN, "Expected '=' after constant name");
     std::shared_ptr<Expression> initializer = parseExpression();
@@ -377,49 +506,6 @@ std::shared_ptr<ConstDeclaration> Parser::parseConstDeclaration() {
     return std::make_shared<ConstDeclaration>(name, type, initializer);
 }
 
-std::shared_ptr<BlockStatement> Parser::parseBlock() {
-    consume(TokenType::LEFT_BRACE, "Expected '{'");
-    
-    std::vector<std::shared_ptr<Statement>> statements;
-    while (!check(TokenType::RIGHT_BRACE) && !isAtEnd()) {
-        if (match({TokenType::NEWLINE})) {
-            continue;
-        }
-        statements.push_back(parseStatement());
-        while (match({TokenType::NEWLINE})) {}
-    }
-    
-    consume(TokenType::RIGHT_BRACE, "Expected '}'");
-    return std::make_shared<BlockStatement>(statements);
-}
-
-std::shared_ptr<IfStatement> Parser::parseIfStatement() {
-    consume(TokenType::LEFT_PAREN, "Expected '(' after 'if'");
-    auto condition = parseExpression();
-    consume(TokenType::RIGHT_PAREN, "Expected ')' after if condition");
-    
-    auto thenBranch = parseStatement();
-    std::shared_ptr<Statement> elseBranch = nullptr;
-    
-    // Skip newlines before else
-    while (match({TokenType::NEWLINE})) {}
-    
-    if (match({TokenType::ELSE})) {
-        elseBranch = parseStatement();
-    }
-    
-    return std::make_shared<IfStatement>(condition, thenBranch, elseBranch);
-}
-
-std::shared_ptr<WhileStatement> Parser::parseWhileStatement() {
-    consume(TokenType::LEFT_PAREN, "Expected '(' after 'while'");
-    auto condition = parseExpression();
-    consume(TokenType::RIGHT_PAREN, "Expected ')' after while condition");
-    
-    auto body = parseStatement();
-    return std::make_shared<WhileStatement>(condition, body);
-}
-
 std::shared_ptr<ReturnStatement> Parser::parseReturnStatement() {
     std::shared_ptr<Expression> value = nullptr;
     
@@ -431,10 +517,10 @@ std::shared_ptr<ReturnStatement> Parser::parseReturnStatement() {
     return std::make_shared<ReturnStatement>(value);
 }
 
-std::shared_ptr<FunctionDeclaration> Parser::parseFunctionDeclaration() {
+std::shared_ptr<FunctionDeclaration> Parser::parseFunctionHeader() {
     consume(TokenType::FUNC, "Expected 'func'");
     consume(TokenType::IDENTIFIER, "Expected function name");
-    std::string name = peek(-1).value;
+    std::string name = value(peek(-1));
     
     consume(TokenType::LEFT_PAREN, "Expected '(' after function name");
     
@@ -445,7 +531,7 @@ std::shared_ptr<FunctionDeclaration> Parser::parseFunctionDeclaration() {
             std::shared_ptr<Type> paramType = parseType();
             
             consume(TokenType::IDENTIFIER, "Expected parameter name");
-            std::string paramName = peek(-1).value;
+            std::string paramName = value(peek(-1));
             parameters.emplace_back(paramName, paramType);
         } while (match({TokenType::COMMA}));
     }
@@ -454,15 +540,13 @@ std::shared_ptr<FunctionDeclaration> Parser::parseFunctionDeclaration() {
     consume(TokenType::ARROW, "Expected '->' after parameter list");
     
     auto returnType = parseType();
-    auto body = parseBlock();
-    
-    return std::make_shared<FunctionDeclaration>(name, parameters, returnType, body);
+    return std::make_shared<FunctionDeclaration>(name, parameters, returnType, nullptr);
 }
 
 std::shared_ptr<PackageDeclaration> Parser::parsePackageDeclaration() {
     consume(TokenType::PACKAGE, "Expected 'package'");
     consume(TokenType::IDENTIFIER, "Expected package name");
-    std::string name = peek(-1).value;
+    std::string name = value(peek(-1));
     consume(TokenType::SEMICOLON, "Expected ';' after package declaration");
     
     return std::make_shared<PackageDeclaration>(name);
@@ -471,7 +555,7 @@ std::shared_ptr<PackageDeclaration> Parser::parsePackageDeclaration() {
 std::shared_ptr<ImportDeclaration> Parser::parseImportDeclaration() {
     consume(TokenType::IMPORT, "Expected 'import'");
     consume(TokenType::STRING, "Expected module name");
-    std::string module = peek(-1).value;
+    std::string module = value(peek(-1));
     consume(TokenType::SEMICOLON, "Expected ';' after import declaration");
     
     return std::make_shared<ImportDeclaration>(module);
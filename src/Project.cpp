@@ -0,0 +1,204 @@
+#include "Project.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+const char* Project::MANIFEST_NAME = "thor.project";
+
+static std::string trim(const std::string& text) {
+    size_t start = text.find_first_not_of(" \t\r");
+    if (start == std::string::npos) return "";
+    size_t end = text.find_last_not_of(" \t\r");
+    return text.substr(start, end - start + 1);
+}
+
+// Lists may be separated by commas, whitespace, or both
+static std::vector<std::string> splitList(const std::string& value) {
+    std::vector<std::string> items;
+    std::string normalized = value;
+    for (char& c : normalized) {
+        if (c == ',') c = ' ';
+    }
+    std::stringstream stream(normalized);
+    std::string item;
+    while (stream >> item) {
+        items.push_back(item);
+    }
+    return items;
+}
+
+static std::string resolvePath(const std::string& root, const std::string& path) {
+    fs::path p(path);
+    if (p.is_absolute()) return p.string();
+    return (fs::path(root) / p).lexically_normal().string();
+}
+
+static std::vector<std::string> defaultProfileFlags(const std::string& name) {
+    if (name == "debug") return {"-g", "-O0"};
+    if (name == "release") return {"-O2"};
+    return {};
+}
+
+Project Project::load(const std::string& manifestPath) {
+    std::ifstream file(manifestPath);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open project manifest: " + manifestPath);
+    }
+
+    Project project;
+    fs::path manifestDir = fs::path(manifestPath).parent_path();
+    project.root = manifestDir.empty() ? "." : manifestDir.string();
+    project.name = fs::path(project.root).filename().string();
+    project.outputDir = resolvePath(project.root, project.outputDir);
+
+    for (const char* builtin : {"debug", "release"}) {
+        project.profiles[builtin] = {builtin, defaultProfileFlags(builtin), {}};
+    }
+
+    std::string section;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line = line.substr(0, comment);
+        }
+        line = trim(line);
+        if (line.empty()) continue;
+
+        auto error = [&](const std::string& message) {
+            return std::runtime_error(manifestPath + ":" + std::to_string(lineNumber) + ": " + message);
+        };
+
+        if (line.front() == '[') {
+            if (line.back() != ']') {
+                throw error("Expected ']' to close section header");
+            }
+            section = trim(line.substr(1, line.size() - 2));
+            if (section.rfind("target.", 0) == 0) {
+                BuildTarget target;
+                target.name = section.substr(7);
+                if (project.findTarget(target.name)) {
+                    throw error("Duplicate target '" + target.name + "'");
+                }
+                project.targets.push_back(target);
+            } else if (section.rfind("profile.", 0) == 0) {
+                std::string profile = section.substr(8);
+                // An explicit section replaces the built-in defaults
+                project.profiles[profile] = {profile, {}, {}};
+            } else if (section != "project") {
+                throw error("Unknown section '" + section + "'");
+            }
+            continue;
+        }
+
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) {
+            throw error("Expected 'key = value'");
+        }
+        std::string key = trim(line.substr(0, eq));
+        std::string value = trim(line.substr(eq + 1));
+
+        if (section == "project") {
+            if (key == "name") {
+                project.name = value;
+            } else if (key == "roots") {
+                for (const auto& root : splitList(value)) {
+                    project.moduleRoots.push_back(resolvePath(project.root, root));
+                }
+            } else if (key == "cflags") {
+                project.cflags = splitList(value);
+            } else if (key == "ldflags") {
+                project.ldflags = splitList(value);
+            } else if (key == "output") {
+                project.outputDir = resolvePath(project.root, value);
+            } else {
+                throw error("Unknown project key '" + key + "'");
+            }
+        } else if (section.rfind("profile.", 0) == 0) {
+            BuildProfile& profile = project.profiles[section.substr(8)];
+            if (key == "cflags") {
+                profile.cflags = splitList(value);
+            } else if (key == "ldflags") {
+                profile.ldflags = splitList(value);
+            } else {
+                throw error("Unknown profile key '" + key + "'");
+            }
+        } else if (section.rfind("target.", 0) == 0) {
+            BuildTarget& target = project.targets.back();
+            if (key == "entry") {
+                target.entry = resolvePath(project.root, value);
+            } else if (key == "cflags") {
+                target.cflags = splitList(value);
+            } else if (key == "ldflags") {
+                target.ldflags = splitList(value);
+            } else if (key == "libs") {
+                target.libs = splitList(value);
+            } else if (key == "libpaths") {
+                for (const auto& path : splitList(value)) {
+                    target.libPaths.push_back(resolvePath(project.root, path));
+                }
+            } else {
+                throw error("Unknown target key '" + key + "'");
+            }
+        } else {
+            throw error("Key '" + key + "' outside of a section");
+        }
+    }
+
+    if (project.moduleRoots.empty()) {
+        project.moduleRoots.push_back(project.root);
+    }
+    for (const auto& target : project.targets) {
+        if (target.entry.empty()) {
+            throw std::runtime_error(manifestPath + ": target '" + target.name + "' has no entry");
+        }
+    }
+    return project;
+}
+
+Project Project::fromInputs(const std::vector<std::string>& inputs) {
+    Project project;
+
+    for (const char* builtin : {"debug", "release"}) {
+        project.profiles[builtin] = {builtin, defaultProfileFlags(builtin), {}};
+    }
+
+    for (const auto& input : inputs) {
+        BuildTarget target;
+        target.name = fs::path(input).stem().string();
+        target.entry = input;
+        if (project.findTarget(target.name)) {
+            throw std::runtime_error("Duplicate target name '" + target.name + "'");
+        }
+        project.targets.push_back(target);
+
+        // Modules next to each entry point are importable, as in single-file mode
+        fs::path inputPath(input);
+        std::string dir = inputPath.has_parent_path() ? inputPath.parent_path().string() : ".";
+        bool known = false;
+        for (const auto& root : project.moduleRoots) {
+            known = known || root == dir;
+        }
+        if (!known) {
+            project.moduleRoots.push_back(dir);
+        }
+    }
+    return project;
+}
+
+const BuildProfile* Project::findProfile(const std::string& profile) const {
+    auto it = profiles.find(profile);
+    return it != profiles.end() ? &it->second : nullptr;
+}
+
+const BuildTarget* Project::findTarget(const std::string& target) const {
+    for (const auto& candidate : targets) {
+        if (candidate.name == target) return &candidate;
+    }
+    return nullptr;
+}
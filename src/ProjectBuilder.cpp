@@ -0,0 +1,602 @@
+#include "ProjectBuilder.h"
+#include "CodeGenerator.h"
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+// Rough per-task cost model in milliseconds, used only to rank the critical path
+static double parseCost(size_t bytes) { return 0.1 + bytes / 20000.0; }
+static double codegenCost(size_t bytes) { return 0.1 + bytes / 50000.0; }
+static double compileCost(size_t bytes) { return 20.0 + bytes / 2000.0; }
+static const double LINK_COST = 30.0;
+
+// Generated code follows the "// thor cflags:" stamp line in every C file
+static const int GENERATED_FIRST_LINE = 2;
+
+static std::string joinFlags(const std::vector<std::string>& flags) {
+    std::string joined;
+    for (const auto& flag : flags) {
+        joined += " " + flag;
+    }
+    return joined;
+}
+
+// Builds with debug info (-g, -g3, -ggdb, ...) map the generated C back to Thor lines
+static bool hasDebugInfo(const std::vector<std::string>& flags) {
+    for (const auto& flag : flags) {
+        if (flag.rfind("-g", 0) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+ProjectBuilder::ProjectBuilder(const Project& project, const BuildOptions& options)
+    : project(project), options(options), importProcessor(project.moduleRoots) {}
+
+std::string ProjectBuilder::buildDir() const {
+    fs::path dir(project.outputDir);
+    if (!options.profile.empty()) {
+        dir /= options.profile;
+    }
+    if (options.hotReload) {
+        dir /= "hot";
+    }
+    return dir.string();
+}
+
+std::string ProjectBuilder::objectDir() const {
+    return (fs::path(buildDir()) / "obj").string();
+}
+
+std::string ProjectBuilder::objectName(const std::string& module) const {
+    // Module names such as "std.io" or "lib/util" are not valid file stems
+    std::string name = module;
+    for (char& c : name) {
+        if (!isalnum(static_cast<unsigned char>(c)) && c != '_') {
+            c = '_';
+        }
+    }
+    return "mod_" + name;
+}
+
+std::vector<std::string> ProjectBuilder::commonFlags() const {
+    std::vector<std::string> flags = project.cflags;
+    if (const BuildProfile* profile = project.findProfile(options.profile)) {
+        flags.insert(flags.end(), profile->cflags.begin(), profile->cflags.end());
+    }
+    return flags;
+}
+
+std::vector<std::shared_ptr<Program>> ProjectBuilder::directDependencies(std::shared_ptr<Program> program) {
+    std::vector<std::shared_ptr<Program>> dependencies;
+    for (const auto& import : program->imports) {
+        if (auto module = importProcessor.getModule(import->module)) {
+            dependencies.push_back(module);
+        }
+    }
+    return dependencies;
+}
+
+bool ProjectBuilder::writeIfChanged(const std::string& path, const std::string& content) const {
+    std::ifstream existing(path, std::ios::binary);
+    if (existing.is_open()) {
+        std::string current((std::istreambuf_iterator<char>(existing)),
+                            std::istreambuf_iterator<char>());
+        if (current == content) {
+            return false;
+        }
+    }
+    existing.close();
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open()) {
+        throw std::runtime_error("Could not create output file: " + path);
+    }
+    out << content;
+    return true;
+}
+
+bool ProjectBuilder::isStale(const std::string& target, const std::vector<std::string>& inputs) const {
+    std::error_code ec;
+    auto targetTime = fs::last_write_time(target, ec);
+    if (ec) return true;
+
+    for (const auto& input : inputs) {
+        if (fs::last_write_time(input, ec) > targetTime || ec) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ProjectBuilder::runCommand(const std::string& command) {
+    log("Running: " + command);
+    return system(command.c_str()) == 0;
+}
+
+void ProjectBuilder::log(const std::string& message) {
+    std::lock_guard<std::mutex> lock(outputMutex);
+    std::cout << message << std::endl;
+}
+
+bool ProjectBuilder::build() {
+    return prepare() && parseAll() && compileAndLink();
+}
+
+bool ProjectBuilder::prepare() {
+    entries.clear();
+    for (const auto& target : project.targets) {
+        bool selected = options.targets.empty();
+        for (const auto& name : options.targets) {
+            selected = selected || name == target.name;
+        }
+        if (selected) {
+            entries.push_back({&target, nullptr, {}, 0});
+        }
+    }
+    for (const auto& name : options.targets) {
+        if (!project.findTarget(name)) {
+            std::cerr << "Error: Unknown target '" << name << "'" << std::endl;
+            return false;
+        }
+    }
+    if (!options.profile.empty() && !project.findProfile(options.profile)) {
+        std::cerr << "Error: Unknown profile '" << options.profile << "'" << std::endl;
+        return false;
+    }
+    if (entries.empty()) {
+        std::cerr << "Error: Nothing to build" << std::endl;
+        return false;
+    }
+
+    CompilerLocator locator;
+    compiler = locator.locate();
+    if (compiler.empty()) {
+        std::cerr << "Error: No C compiler found. Please install gcc, clang, or MinGW." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool ProjectBuilder::parseAll() {
+    requestedModules.clear();
+    parseFailed = false;
+    TaskScheduler scheduler(options.jobs);
+
+    for (auto& entry : entries) {
+        std::error_code ec;
+        size_t size = fs::file_size(entry.target->entry, ec);
+        Entry* slot = &entry;
+        scheduler.addTask("parse " + entry.target->entry, parseCost(size), [this, slot, &scheduler]() {
+            return parseEntry(scheduler, *slot);
+        });
+    }
+
+    if (!scheduler.run()) {
+        parseFailed = true;
+        return false;
+    }
+
+    for (auto& entry : entries) {
+        entry.dependencies = importProcessor.getDependencies(entry.program);
+    }
+    return true;
+}
+
+bool ProjectBuilder::parseEntry(TaskScheduler& scheduler, Entry& entry) {
+    try {
+        entry.program = parseFile(entry.target->entry, entry.sourceSize);
+    } catch (const std::exception& e) {
+        log("Error: " + entry.target->entry + ": " + e.what());
+        return false;
+    }
+    requestImports(scheduler, entry.program);
+    return true;
+}
+
+std::shared_ptr<Program> ProjectBuilder::parseFile(const std::string& path, size_t& size) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open input file: " + path);
+    }
+    std::string content((std::istreambuf_iterator<char>(file)),
+                       std::istreambuf_iterator<char>());
+    size = content.size();
+
+    // Files seen before are diffed against their last text, so a rebuild only
+    // re-lexes and re-parses the top-level declarations that were edited
+    std::string key = canonicalPath(path);
+    IncrementalParser* document;
+    bool known;
+    {
+        std::lock_guard<std::mutex> lock(modulesMutex);
+        known = documents.count(key) > 0;
+        document = &documents[key];
+    }
+    if (!known) {
+        *document = IncrementalParser(content);
+    } else {
+        document->update(content);
+    }
+    auto program = document->getProgram();
+    program->sourcePath = key;
+    return program;
+}
+
+void ProjectBuilder::requestImports(TaskScheduler& scheduler, std::shared_ptr<Program> program) {
+    // Each module is parsed by whichever task first discovers the import
+    for (const auto& import : program->imports) {
+        std::string module = import->module;
+        {
+            std::lock_guard<std::mutex> lock(modulesMutex);
+            if (!requestedModules.insert(module).second) {
+                continue;
+            }
+        }
+        scheduler.spawn("parse " + module, parseCost(0), [this, &scheduler, module]() {
+            return parseModule(scheduler, module);
+        });
+    }
+}
+
+bool ProjectBuilder::parseModule(TaskScheduler& scheduler, const std::string& module) {
+    std::shared_ptr<Program> program = ImportProcessor::createBuiltinModule(module);
+    std::string filePath;
+    size_t size = 0;
+
+    if (!program) {
+        try {
+            {
+                std::lock_guard<std::mutex> lock(modulesMutex);
+                filePath = importProcessor.resolveModulePath(module);
+            }
+            program = parseFile(filePath, size);
+        } catch (const std::exception& e) {
+            log("Error loading module '" + module + "': " + e.what());
+            return false;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(modulesMutex);
+        importProcessor.addModule(module, program);
+        moduleSizes[module] = size;
+        if (!filePath.empty()) {
+            modulePaths[module] = canonicalPath(filePath);
+        }
+    }
+    requestImports(scheduler, program);
+    return true;
+}
+
+bool ProjectBuilder::compileAndLink() {
+    fs::path objDir(objectDir());
+    fs::create_directories(objDir);
+
+    std::string runtimeHeader = (objDir / CodeGenerator::RUNTIME_HEADER).string();
+    std::string runtimeSource = (objDir / "thor_runtime.c").string();
+    std::string runtimeObject = (objDir / "thor_runtime.o").string();
+
+    // Frame pointers come first, so a project that turns them off explicitly still can
+    std::vector<std::string> sharedFlags = compiler.frameFlags();
+    for (const auto& flag : commonFlags()) {
+        sharedFlags.push_back(flag);
+    }
+    if (options.hotReload) {
+        sharedFlags.push_back("-DTHOR_HOT_RELOAD");
+    }
+    if (options.instrument) {
+        sharedFlags.push_back("-DTHOR_INSTRUMENT");
+    }
+    if (options.trackAllocations) {
+        sharedFlags.push_back("-DTHOR_TRACK_ALLOCATIONS");
+    }
+    std::string sharedFlagLine = joinFlags(sharedFlags);
+    bool sharedDebugInfo = hasDebugInfo(sharedFlags);
+
+    // In hot-reload builds every packaged module is compiled into its own shared object
+    std::unordered_set<std::string> hotPackages;
+    if (options.hotReload) {
+        for (const auto& entry : entries) {
+            for (const auto& module : entry.dependencies) {
+                auto program = importProcessor.getModule(module);
+                std::string package = CodeGenerator::packageName(program);
+                if (package != "main" && CodeGenerator::hasDefinitions(program)) {
+                    hotPackages.insert(package);
+                }
+            }
+        }
+    }
+    bool instrument = options.instrument;
+    bool trackAllocations = options.trackAllocations;
+    auto isHot = [&](std::shared_ptr<Program> program) {
+        return hotPackages.count(CodeGenerator::packageName(program)) > 0;
+    };
+
+    // The header is written up front since every compile depends on it
+    {
+        CodeGenerator generator;
+        writeIfChanged(runtimeHeader, generator.generateRuntimeHeader());
+    }
+
+    TaskScheduler scheduler(options.jobs);
+
+    // Adds codegen -> compile for one translation unit; returns the compile task
+    auto addUnit = [&](const std::string& key, const std::string& label, const std::string& source,
+                       const std::string& object, const std::string& flagLine, size_t sourceSize,
+                       std::function<std::string()> generate, bool sharedLibrary = false) {
+        bool clean = incremental && !dirtyUnits.count(key) && fs::exists(source);
+        auto codegen = scheduler.addTask("codegen " + label, clean ? 0.0 : codegenCost(sourceSize),
+            [this, source, flagLine, generate, clean]() {
+                if (clean) {
+                    return true;
+                }
+                try {
+                    // Flags are stamped into the source so that changing them forces a recompile
+                    writeIfChanged(source, "// thor cflags:" + flagLine + "\n" + generate());
+                } catch (const std::exception& e) {
+                    log(std::string("Error: ") + e.what());
+                    return false;
+                }
+                return true;
+            });
+        auto compile = scheduler.addTask("compile " + label, compileCost(sourceSize),
+            [this, source, object, flagLine, runtimeHeader, sharedLibrary]() {
+                if (!isStale(object, {source, runtimeHeader})) {
+                    return true;
+                }
+                if (!sharedLibrary) {
+                    return runCommand(compiler.command() + flagLine + " -c \"" + source + "\" -o \"" + object + "\"");
+                }
+                // Publish with a rename so a running host never loads a half-written library
+                std::string temporary = object + ".tmp";
+                if (!runCommand(compiler.command() + flagLine + " -fPIC -shared -Wl,-Bsymbolic \"" + source +
+                                "\" -o \"" + temporary + "\"")) {
+                    return false;
+                }
+                std::error_code ec;
+                fs::rename(temporary, object, ec);
+                return !ec;
+            });
+        scheduler.addDependency(codegen, compile);
+        return compile;
+    };
+
+    auto runtimeCompile = addUnit("runtime", "runtime", runtimeSource, runtimeObject, sharedFlagLine, 4096, []() {
+        CodeGenerator generator;
+        return generator.generateRuntimeSource();
+    });
+
+    std::unordered_map<std::string, TaskScheduler::TaskId> moduleCompiles;
+    std::unordered_map<std::string, std::string> moduleObjects;
+    std::vector<CodeGenerator::HotModule> hotModules;
+    for (const auto& entry : entries) {
+        for (const auto& module : entry.dependencies) {
+            if (moduleObjects.count(module)) continue;
+
+            auto program = importProcessor.getModule(module);
+            if (!CodeGenerator::hasDefinitions(program)) {
+                moduleObjects[module] = "";
+                continue;
+            }
+            std::string source = (objDir / (objectName(module) + ".c")).string();
+            std::string mappedSource = sharedDebugInfo ? source : "";
+            auto dependencies = directDependencies(program);
+            if (isHot(program)) {
+                // Loaded at run time by the host rather than linked into it
+                std::string library = fs::absolute(objDir / ("lib" + objectName(module) + ".so")).string();
+                hotModules.push_back({program, library});
+                moduleObjects[module] = "";
+                moduleCompiles[module] = addUnit("module:" + module, module, source, library, sharedFlagLine,
+                    moduleSizes[module], [program, dependencies, hotPackages, mappedSource, instrument, trackAllocations]() {
+                        CodeGenerator generator;
+                        generator.setHotPackages(hotPackages);
+                        generator.setInstrumentation(instrument);
+                        generator.setAllocationTracking(trackAllocations);
+                        generator.setLineDirectives(mappedSource, GENERATED_FIRST_LINE);
+                        return generator.generateHotModule(program, dependencies);
+                    }, true);
+                continue;
+            }
+            moduleObjects[module] = (objDir / (objectName(module) + ".o")).string();
+            moduleCompiles[module] = addUnit("module:" + module, module, source, moduleObjects[module], sharedFlagLine,
+                moduleSizes[module], [program, dependencies, hotPackages, mappedSource, instrument, trackAllocations]() {
+                    CodeGenerator generator;
+                    generator.setHotPackages(hotPackages);
+                    generator.setInstrumentation(instrument);
+                    generator.setAllocationTracking(trackAllocations);
+                    generator.setLineDirectives(mappedSource, GENERATED_FIRST_LINE);
+                    return generator.generateModule(program, dependencies);
+                });
+        }
+    }
+
+    for (const auto& entry : entries) {
+        const BuildTarget& target = *entry.target;
+        std::string source = (objDir / ("bin_" + target.name + ".c")).string();
+        std::string object = (objDir / ("bin_" + target.name + ".o")).string();
+        std::string flagLine = sharedFlagLine + joinFlags(target.cflags);
+        std::string mappedSource = sharedDebugInfo || hasDebugInfo(target.cflags) ? source : "";
+        auto program = entry.program;
+        auto dependencies = directDependencies(program);
+        // Each target only loads the hot modules it actually imports
+        std::vector<CodeGenerator::HotModule> targetHotModules;
+        for (const auto& hotModule : hotModules) {
+            for (const auto& module : entry.dependencies) {
+                if (importProcessor.getModule(module) == hotModule.program) {
+                    targetHotModules.push_back(hotModule);
+                    break;
+                }
+            }
+        }
+        bool hotHost = options.hotReload;
+        auto entryCompile = addUnit("target:" + target.name, target.name, source, object, flagLine, entry.sourceSize,
+            [program, dependencies, hotPackages, targetHotModules, hotHost, mappedSource, instrument, trackAllocations]() {
+                CodeGenerator generator;
+                generator.setHotPackages(hotPackages);
+                generator.setInstrumentation(instrument);
+                generator.setAllocationTracking(trackAllocations);
+                generator.setLineDirectives(mappedSource, GENERATED_FIRST_LINE);
+                if (hotHost) {
+                    return generator.generateHotHost(program, dependencies, targetHotModules);
+                }
+                return generator.generateModule(program, dependencies);
+            });
+
+        std::vector<std::string> objects = { object, runtimeObject };
+        for (const auto& module : entry.dependencies) {
+            if (!moduleObjects[module].empty()) {
+                objects.push_back(moduleObjects[module]);
+            }
+        }
+
+        std::vector<std::string> linkFlags = project.ldflags;
+        if (const BuildProfile* profile = project.findProfile(options.profile)) {
+            linkFlags.insert(linkFlags.end(), profile->ldflags.begin(), profile->ldflags.end());
+        }
+        linkFlags.insert(linkFlags.end(), target.ldflags.begin(), target.ldflags.end());
+        if (options.hotReload) {
+            // Hot modules resolve runtime functions and tables against the host's symbols
+            linkFlags.insert(linkFlags.end(), {"-rdynamic", "-ldl", "-pthread"});
+        }
+        for (const auto& path : target.libPaths) {
+            linkFlags.push_back("-L\"" + path + "\"");
+        }
+        for (const auto& lib : target.libs) {
+            linkFlags.push_back("-l" + lib);
+        }
+
+        std::string executable = (fs::path(buildDir()) / (target.name + ".exe")).string();
+        std::string command = compiler.command() + sharedFlagLine;
+        for (const auto& objectFile : objects) {
+            command += " \"" + objectFile + "\"";
+        }
+        command += " -o \"" + executable + "\"" + joinFlags(linkFlags);
+
+        auto link = scheduler.addTask("link " + target.name, LINK_COST, [this, command, executable, objects]() {
+            if (!isStale(executable, objects)) {
+                return true;
+            }
+            if (!runCommand(command)) {
+                return false;
+            }
+            log("Successfully compiled to executable: " + executable);
+            return true;
+        });
+        scheduler.addDependency(entryCompile, link);
+        scheduler.addDependency(runtimeCompile, link);
+        for (const auto& module : entry.dependencies) {
+            auto it = moduleCompiles.find(module);
+            if (it != moduleCompiles.end()) {
+                scheduler.addDependency(it->second, link);
+            }
+        }
+    }
+
+    log("Building " + std::to_string(entries.size()) + " targets (" +
+        std::to_string(moduleCompiles.size()) + " shared modules)" +
+        (options.profile.empty() ? "" : " with profile '" + options.profile + "'") + "...");
+    if (!scheduler.run()) {
+        std::cerr << "Error: Build failed" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool ProjectBuilder::rebuild(const std::vector<std::string>& changedFiles) {
+    std::unordered_set<std::string> changed;
+    for (const auto& file : changedFiles) {
+        changed.insert(canonicalPath(file));
+    }
+
+    if (compiler.empty()) {
+        return false;
+    }
+    if (parseFailed) {
+        // The previous parse left modules missing; rebuilding the module graph is the only safe option
+        incremental = false;
+        return parseAll() && compileAndLink();
+    }
+
+    incremental = true;
+    dirtyUnits.clear();
+
+    // Re-parse only what changed; newly added imports are discovered and parsed as usual
+    TaskScheduler scheduler(options.jobs);
+    std::unordered_set<std::string> changedModules;
+    for (const auto& [module, path] : modulePaths) {
+        if (changed.count(path)) {
+            changedModules.insert(module);
+            dirtyUnits.insert("module:" + module);
+            std::string name = module;
+            scheduler.addTask("parse " + module, parseCost(moduleSizes[module]), [this, &scheduler, name]() {
+                return parseModule(scheduler, name);
+            });
+        }
+    }
+    for (auto& entry : entries) {
+        if (changed.count(canonicalPath(entry.target->entry))) {
+            dirtyUnits.insert("target:" + entry.target->name);
+            Entry* slot = &entry;
+            scheduler.addTask("parse " + entry.target->entry, parseCost(entry.sourceSize), [this, slot, &scheduler]() {
+                return parseEntry(scheduler, *slot);
+            });
+        }
+    }
+    if (dirtyUnits.empty()) {
+        return true;
+    }
+    if (!scheduler.run()) {
+        parseFailed = true;
+        return false;
+    }
+
+    // Importers embed the changed modules' declarations, so their C must be regenerated too
+    for (const auto& [module, program] : importProcessor.getLoadedModules()) {
+        for (const auto& import : program->imports) {
+            if (changedModules.count(import->module)) {
+                dirtyUnits.insert("module:" + module);
+            }
+        }
+    }
+    for (auto& entry : entries) {
+        for (const auto& import : entry.program->imports) {
+            if (changedModules.count(import->module)) {
+                dirtyUnits.insert("target:" + entry.target->name);
+            }
+        }
+        entry.dependencies = importProcessor.getDependencies(entry.program);
+    }
+
+    return compileAndLink();
+}
+
+std::vector<std::string> ProjectBuilder::sourceFiles() {
+    std::vector<std::string> files;
+    for (const auto& entry : entries) {
+        files.push_back(canonicalPath(entry.target->entry));
+    }
+    std::lock_guard<std::mutex> lock(modulesMutex);
+    for (const auto& [module, path] : modulePaths) {
+        files.push_back(path);
+    }
+    return files;
+}
+
+std::vector<std::string> ProjectBuilder::executables() const {
+    std::vector<std::string> files;
+    for (const auto& entry : entries) {
+        files.push_back((fs::path(buildDir()) / (entry.target->name + ".exe")).string());
+    }
+    return files;
+}
+
+std::string ProjectBuilder::canonicalPath(const std::string& path) {
+    std::error_code ec;
+    fs::path canonical = fs::weakly_canonical(path, ec);
+    return ec ? path : canonical.string();
+}
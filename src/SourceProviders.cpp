@@ -0,0 +1,113 @@
+#include "SourceProviders.h"
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+bool DiskFileProvider::read(const std::string& path, std::string& contents) const {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+    contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+bool DiskFileProvider::isFile(const std::string& path) const {
+    std::error_code ec;
+    return fs::is_regular_file(path, ec);
+}
+
+std::vector<std::string> DiskFileProvider::list(const std::string& directory) const {
+    std::vector<std::string> paths;
+    std::error_code ec;
+    for (fs::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->is_regular_file(ec)) {
+            paths.push_back(it->path().string());
+        }
+    }
+    return paths;
+}
+
+std::string MemoryFileProvider::normalize(const std::string& path) {
+    return fs::path(path).lexically_normal().generic_string();
+}
+
+void MemoryFileProvider::add(const std::string& path, const std::string& contents) {
+    files[normalize(path)] = contents;
+}
+
+void MemoryFileProvider::remove(const std::string& path) {
+    files.erase(normalize(path));
+}
+
+bool MemoryFileProvider::read(const std::string& path, std::string& contents) const {
+    auto it = files.find(normalize(path));
+    if (it == files.end()) {
+        return false;
+    }
+    contents = it->second;
+    return true;
+}
+
+bool MemoryFileProvider::isFile(const std::string& path) const {
+    return files.count(normalize(path)) != 0;
+}
+
+std::vector<std::string> MemoryFileProvider::list(const std::string& directory) const {
+    std::string prefix = normalize(directory);
+    if (prefix == ".") {
+        prefix.clear();
+    } else if (!prefix.empty() && prefix.back() != '/') {
+        prefix += '/';
+    }
+
+    std::vector<std::string> paths;
+    for (auto it = files.lower_bound(prefix); it != files.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it) {
+        if (it->first.find('/', prefix.size()) == std::string::npos) {
+            paths.push_back(it->first);
+        }
+    }
+    return paths;
+}
+
+SearchPathModuleProvider::SearchPathModuleProvider(std::shared_ptr<FileProvider> files,
+                                                   const std::vector<std::string>& searchPaths)
+    : files(std::move(files)), searchPaths(searchPaths) {}
+
+bool SearchPathModuleProvider::resolve(const std::string& module, const std::string& importer, std::string& path) const {
+    std::vector<std::string> directories = searchPaths;
+    fs::path importerPath(importer);
+    if (importerPath.has_parent_path()) {
+        directories.push_back(importerPath.parent_path().string());
+    }
+
+    for (const auto& directory : directories) {
+        fs::path modulePath = fs::path(directory) / (module + ".thor");
+        if (files->isFile(modulePath.string())) {
+            path = modulePath.string();
+            return true;
+        }
+
+        // Also try with subdirectories
+        fs::path moduleSubPath = fs::path(directory) / module / (module + ".thor");
+        if (files->isFile(moduleSubPath.string())) {
+            path = moduleSubPath.string();
+            return true;
+        }
+
+        // Or any .thor file in a directory named after the module
+        for (const auto& file : files->list((fs::path(directory) / module).string())) {
+            if (fs::path(file).extension() == ".thor") {
+                path = file;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool SearchPathModuleProvider::load(const std::string& module, const std::string& importer,
+                                    std::string& path, std::string& source) const {
+    return resolve(module, importer, path) && files->read(path, source);
+}
@@ -0,0 +1,248 @@
+#include "TaskScheduler.h"
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+// Worker index of the calling thread, or -1 outside the pool
+static thread_local int currentWorker = -1;
+
+TaskScheduler::TaskScheduler(unsigned threads) : threadCount(threads) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned i = 0; i < threadCount; i++) {
+        queues.push_back(std::make_unique<WorkerQueue>());
+    }
+}
+
+TaskScheduler::Task& TaskScheduler::task(TaskId id) {
+    std::lock_guard<std::mutex> lock(tasksMutex);
+    return *tasks[id];
+}
+
+const std::string& TaskScheduler::taskName(TaskId id) {
+    return task(id).name;
+}
+
+size_t TaskScheduler::size() {
+    std::lock_guard<std::mutex> lock(tasksMutex);
+    return tasks.size();
+}
+
+TaskScheduler::TaskId TaskScheduler::addTask(const std::string& name, double cost, std::function<bool()> work) {
+    if (running) {
+        throw std::runtime_error("Cannot add task '" + name + "' to a running scheduler; use spawn()");
+    }
+    auto newTask = std::make_unique<Task>();
+    newTask->name = name;
+    newTask->cost = cost;
+    newTask->work = std::move(work);
+    tasks.push_back(std::move(newTask));
+    return tasks.size() - 1;
+}
+
+void TaskScheduler::addDependency(TaskId before, TaskId after) {
+    if (running) {
+        throw std::runtime_error("Cannot add dependencies to a running scheduler");
+    }
+    tasks[before]->successors.push_back(after);
+    tasks[after]->predecessors++;
+}
+
+TaskScheduler::TaskId TaskScheduler::spawn(const std::string& name, double cost, std::function<bool()> work) {
+    if (!running) {
+        return addTask(name, cost, std::move(work));
+    }
+
+    auto newTask = std::make_unique<Task>();
+    newTask->name = name;
+    newTask->cost = cost;
+    newTask->rank = cost;
+    newTask->work = std::move(work);
+
+    TaskId id;
+    {
+        std::lock_guard<std::mutex> lock(tasksMutex);
+        tasks.push_back(std::move(newTask));
+        id = tasks.size() - 1;
+    }
+    unfinished++;
+
+    // Keep spawned work local to the spawning worker; idle workers will steal it
+    unsigned worker = currentWorker >= 0 ? static_cast<unsigned>(currentWorker) : nextQueue++ % threadCount;
+    push(worker, id);
+    return id;
+}
+
+void TaskScheduler::computeRanks() {
+    // Reverse topological order: a task's rank is its cost plus the highest rank among its successors
+    std::vector<size_t> pendingSuccessors(tasks.size());
+    std::vector<std::vector<TaskId>> predecessors(tasks.size());
+    std::vector<TaskId> order;
+    for (TaskId id = 0; id < tasks.size(); id++) {
+        pendingSuccessors[id] = tasks[id]->successors.size();
+        if (pendingSuccessors[id] == 0) {
+            order.push_back(id);
+        }
+        for (TaskId successor : tasks[id]->successors) {
+            predecessors[successor].push_back(id);
+        }
+    }
+
+    for (size_t i = 0; i < order.size(); i++) {
+        Task& current = *tasks[order[i]];
+        double best = 0;
+        for (TaskId successor : current.successors) {
+            best = std::max(best, tasks[successor]->rank);
+        }
+        current.rank = current.cost + best;
+
+        for (TaskId predecessor : predecessors[order[i]]) {
+            if (--pendingSuccessors[predecessor] == 0) {
+                order.push_back(predecessor);
+            }
+        }
+    }
+
+    if (order.size() != tasks.size()) {
+        throw std::runtime_error("Cycle detected in build graph");
+    }
+}
+
+void TaskScheduler::push(unsigned worker, TaskId id) {
+    double rank = task(id).rank;
+    {
+        WorkerQueue& queue = *queues[worker];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.heap.emplace_back(rank, id);
+        std::push_heap(queue.heap.begin(), queue.heap.end());
+    }
+    {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        ready++;
+    }
+    idle.notify_one();
+}
+
+bool TaskScheduler::pop(unsigned worker, TaskId& id) {
+    WorkerQueue& queue = *queues[worker];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.heap.empty()) {
+        return false;
+    }
+    std::pop_heap(queue.heap.begin(), queue.heap.end());
+    id = queue.heap.back().second;
+    queue.heap.pop_back();
+    ready--;
+    return true;
+}
+
+bool TaskScheduler::steal(unsigned thief, TaskId& id) {
+    // Take the most critical task from whichever victim holds the highest-ranked one
+    unsigned victim = thief;
+    double bestRank = -1;
+    for (unsigned i = 1; i < threadCount; i++) {
+        unsigned candidate = (thief + i) % threadCount;
+        WorkerQueue& queue = *queues[candidate];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.heap.empty() && queue.heap.front().first > bestRank) {
+            bestRank = queue.heap.front().first;
+            victim = candidate;
+        }
+    }
+    if (victim == thief) {
+        return false;
+    }
+    return pop(victim, id);
+}
+
+void TaskScheduler::execute(unsigned worker, TaskId id) {
+    Task& current = task(id);
+    bool succeeded = false;
+    if (!current.poisoned) {
+        try {
+            succeeded = current.work ? current.work() : true;
+        } catch (...) {
+            succeeded = false;
+        }
+    }
+    finish(worker, id, succeeded);
+}
+
+void TaskScheduler::finish(unsigned worker, TaskId id, bool succeeded) {
+    Task& current = task(id);
+    current.failed = !succeeded;
+    if (!succeeded) {
+        anyFailed = true;
+    }
+
+    // Dependents of a failed task still pass through the queues so every task
+    // completes exactly once, but they are poisoned and never run their work
+    for (TaskId successor : current.successors) {
+        Task& next = task(successor);
+        if (!succeeded) {
+            next.poisoned = true;
+        }
+        if (--next.remaining == 0) {
+            push(worker, successor);
+        }
+    }
+
+    if (--unfinished == 0) {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        idle.notify_all();
+    }
+}
+
+void TaskScheduler::workerLoop(unsigned worker) {
+    currentWorker = static_cast<int>(worker);
+    while (true) {
+        TaskId id;
+        if (pop(worker, id) || steal(worker, id)) {
+            execute(worker, id);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(idleMutex);
+        if (unfinished == 0) {
+            break;
+        }
+        // A short timeout covers the window between a failed steal and a concurrent push
+        idle.wait_for(lock, std::chrono::milliseconds(5), [this]() {
+            return ready > 0 || unfinished == 0;
+        });
+    }
+    currentWorker = -1;
+}
+
+bool TaskScheduler::run() {
+    computeRanks();
+
+    running = true;
+    anyFailed = false;
+    unfinished = tasks.size();
+
+    // Seed the roots round-robin so workers start with their own queues
+    unsigned seed = 0;
+    for (TaskId id = 0; id < tasks.size(); id++) {
+        tasks[id]->remaining = tasks[id]->predecessors;
+        if (tasks[id]->predecessors == 0) {
+            push(seed++ % threadCount, id);
+        }
+    }
+
+    if (unfinished > 0) {
+        std::vector<std::thread> pool;
+        for (unsigned i = 1; i < threadCount; i++) {
+            pool.emplace_back(&TaskScheduler::workerLoop, this, i);
+        }
+        workerLoop(0);
+        for (auto& thread : pool) {
+            thread.join();
+        }
+    }
+
+    running = false;
+    return !anyFailed;
+}
@@ -1,2 +1,57 @@
 #include "Token.h"
-// Token implementation is header-only, all logic is in Token.h
\ No newline at end of file
+#include <algorithm>
+
+void TokenStream::truncate(size_t index, uint32_t offset) {
+    tokens.resize(std::min(index, tokens.size()));
+    tokens.push_back({ TokenType::EOF_TOKEN, offset, 0 });
+}
+
+std::string TokenStream::value(const Token& token) const {
+    std::string_view raw = text(token);
+    if (token.type != TokenType::STRING) {
+        return std::string(raw);
+    }
+
+    std::string value;
+    value.reserve(raw.size());
+    for (size_t i = 1; i + 1 < raw.size(); i++) {
+        if (raw[i] != '\\' || i + 2 >= raw.size()) {
+            value += raw[i];
+            continue;
+        }
+        char escaped = raw[++i];
+        switch (escaped) {
+            case 'n': value += '\n'; break;
+            case 't': value += '\t'; break;
+            case 'r': value += '\r'; break;
+            default: value += escaped; break;
+        }
+    }
+    return value;
+}
+
+int TokenStream::line(size_t offset) const {
+    auto it = std::upper_bound(lineStarts.begin(), lineStarts.end(), offset);
+    return firstLine + static_cast<int>(it - lineStarts.begin());
+}
+
+int TokenStream::column(size_t offset) const {
+    auto it = std::upper_bound(lineStarts.begin(), lineStarts.end(), offset);
+    if (it == lineStarts.begin()) {
+        return firstColumn + static_cast<int>(offset - baseOffset);
+    }
+    return static_cast<int>(offset - *(it - 1)) + 1;
+}
+
+void TokenStream::position(size_t offset, size_t& cursor, int& line, int& column) const {
+    // cursor = number of line starts at or before offset
+    while (cursor < lineStarts.size() && lineStarts[cursor] <= offset) {
+        cursor++;
+    }
+    while (cursor > 0 && lineStarts[cursor - 1] > offset) {
+        cursor--;
+    }
+    line = firstLine + static_cast<int>(cursor);
+    column = cursor == 0 ? firstColumn + static_cast<int>(offset - baseOffset)
+                         : static_cast<int>(offset - lineStarts[cursor - 1]) + 1;
+}
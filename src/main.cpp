@@ -2,58 +2,275 @@
 #include <fstream>
 #include <filesystem>
 #include <cstdlib>
-#include "Lexer.h"
-#include "Parser.h"
-#include "ImportProcessor.h"
-#include "CodeGenerator.h"
+#include <limits>
+#include <stdexcept>
+#include "Compiler.h"
+#include "CompilerLocator.h"
+#include "ProjectBuilder.h"
+#include "BenchRunner.h"
+#include "FileWatcher.h"
+#include "LanguageServer.h"
+#include <chrono>
+#include <map>
+#include <set>
 
-std::string findCCompiler() {
-    std::vector<std::string> compilers = {
-        "gcc", "clang", "cl", "tcc", "mingw32-gcc"
-    };
+bool compileWithCCompiler(const CCompiler& compiler, const std::string& sourceFile, const std::string& outputFile,
+                          bool debugInfo) {
+    std::string command = compiler.command() + (debugInfo ? " -g" : "");
+    for (const auto& flag : compiler.frameFlags()) {
+        command += " " + flag;
+    }
+    command += " \"" + sourceFile + "\" -o \"" + outputFile + "\"";
+    std::cout << "Running: " << command << std::endl;
     
-    for (const std::string& compiler : compilers) {
-        // Try to run the compiler with --version to see if it exists
-        std::string command = compiler + " --version >nul 2>&1";
-        if (system(command.c_str()) == 0) {
-            return compiler;
+    int result = system(command.c_str());
+    return result == 0;
+}
+
+// Prints the optimizer's remarks under the Thor lines they are about, then
+// any other diagnostics from the C compiler
+void printRemarks(const std::vector<Diagnostic>& diagnostics) {
+    std::map<std::pair<std::string, int>, std::set<std::pair<int, std::string>>> remarks;
+    for (const auto& diagnostic : diagnostics) {
+        if (diagnostic.severity == Diagnostic::REMARK) {
+            remarks[{ diagnostic.file, diagnostic.line }].insert({ diagnostic.column, diagnostic.message });
+        } else {
+            std::cerr << diagnostic.toString() << std::endl;
         }
     }
+    if (remarks.empty()) {
+        std::cout << "No optimization remarks" << std::endl;
+        return;
+    }
     
-    // Try to find MinGW in common locations
-    std::vector<std::string> mingwPaths = {
-        "C:\\MinGW\\bin\\gcc.exe",
-        "C:\\MinGW64\\bin\\gcc.exe",
-        "C:\\msys64\\mingw64\\bin\\gcc.exe",
-        "C:\\msys64\\ucrt64\\bin\\gcc.exe",
-        "C:\\Program Files\\mingw-w64\\mingw64\\bin\\gcc.exe"
-    };
-    
-    for (const std::string& path : mingwPaths) {
-        if (std::filesystem::exists(path)) {
-            return "\"" + path + "\""; // Quote path in case of spaces
+    std::map<std::string, std::vector<std::string>> sources;
+    for (const auto& [location, messages] : remarks) {
+        const auto& [file, line] = location;
+        if (!sources.count(file)) {
+            std::ifstream in(file);
+            std::string text;
+            while (std::getline(in, text)) {
+                sources[file].push_back(text);
+            }
+        }
+        const auto& lines = sources[file];
+        std::string text = line > 0 && line <= static_cast<int>(lines.size()) ? lines[line - 1] : "";
+        text.erase(0, std::min(text.find_first_not_of(" \t"), text.size()));
+        std::cout << file << ":" << line << ": " << text << std::endl;
+        for (const auto& [column, message] : messages) {
+            std::cout << "    " << line << ":" << column << " " << message << std::endl;
         }
     }
-    
-    return "";
-}
-
-bool compileWithCCompiler(const std::string& compiler, const std::string& sourceFile, const std::string& outputFile) {
-    std::string command = compiler + " \"" + sourceFile + "\" -o \"" + outputFile + "\"";
-    std::cout << "Running: " << command << std::endl;
-    
-    int result = system(command.c_str());
-    return result == 0;
 }
 
 void printUsage() {
     std::cout << "Usage: thor <input_file.thor> [output_file.c] [options]\n";
+    std::cout << "       thor build [a.thor b.thor ...] [build options]\n";
+    std::cout << "       thor bench [a.thor b.thor ...] [bench options]\n";
+    std::cout << "       thor lsp         - Run the language server on stdin/stdout\n";
     std::cout << "  input_file.thor  - Thor source file to compile\n";
     std::cout << "  output_file.c    - Output C file (optional, defaults to input name with .c extension)\n";
     std::cout << "\nOptions:\n";
     std::cout << "  --no-compile     - Only generate C code, don't compile to executable\n";
     std::cout << "  --keep-c         - Keep the generated C file after compilation\n";
+    std::cout << "  -g, --debug      - Build with debug info mapped to .thor lines (#line directives); keeps the C file\n";
+    std::cout << "  --instrument     - Count calls and time every function; the program reports at exit or on SIGUSR1\n";
+    std::cout << "  --track-allocations - Charge runtime allocations to their call sites; the program reports at exit\n";
+    std::cout << "  --remarks        - Build with -O2 and show what the C compiler vectorized and inlined, by Thor line\n";
+    std::cout << "  --watch          - Rebuild whenever the input or one of its imports changes\n";
+    std::cout << "  --run            - With --watch, run the executable after every successful build\n";
     std::cout << "  --help           - Show this help message\n";
+    std::cout << "\nBuild options (without input files, targets come from ./" << Project::MANIFEST_NAME << "):\n";
+    std::cout << "  --manifest <file> - Project manifest to build\n";
+    std::cout << "  --profile <name> - Build profile from the manifest (built in: debug, release)\n";
+    std::cout << "  --target <name>  - Only build the named target (repeatable)\n";
+    std::cout << "  -o <dir>         - Output directory for executables and objects (default: thor-out)\n";
+    std::cout << "  -j <jobs>        - Number of parallel C compiler jobs (default: hardware threads)\n";
+    std::cout << "  --watch, --run   - As above, for every target\n";
+    std::cout << "  --hot            - Build packaged modules as shared objects the running program reloads\n";
+    std::cout << "  --instrument     - As above, for every target\n";
+    std::cout << "  --track-allocations - As above, for every target\n";
+    std::cout << "\nBench options (without input files, every .thor file below . with bench blocks):\n";
+    std::cout << "  --filter <text>  - Only run benches whose file:name contains the text (repeatable)\n";
+    std::cout << "  --samples <n>    - Timed batches per bench (default: 100)\n";
+    std::cout << "  --sample-time <us> - Time each batch should take, in microseconds (default: 2000)\n";
+    std::cout << "  --baseline <file> - Compare against saved results; regressions make thor exit with 1\n";
+    std::cout << "  --threshold <pct> - Median slowdown that counts as a regression (default: 5)\n";
+    std::cout << "  --save <file>    - Save the results as JSON, for use as a baseline\n";
+    std::cout << "  -o <dir>         - Output directory for the harness executables (default: thor-out)\n";
+}
+
+int runWatch(const Project& project, const BuildOptions& options, bool runAfterBuild) {
+    ProjectBuilder builder(project, options);
+    FileWatcher watcher;
+    
+    auto runExecutables = [&]() {
+        for (const auto& executable : builder.executables()) {
+            std::cout << "------------------------------" << std::endl;
+            system(("\"" + executable + "\"").c_str());
+            std::cout << "------------------------------" << std::endl;
+        }
+    };
+    
+    if (builder.build() && runAfterBuild) {
+        runExecutables();
+    }
+    
+    while (true) {
+        auto files = builder.sourceFiles();
+        if (files.empty()) {
+            return 1;
+        }
+        watcher.watch(files);
+        std::cout << "Watching " << files.size() << " files for changes (Ctrl+C to stop)..." << std::endl;
+        
+        auto changed = watcher.waitForChanges();
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& file : changed) {
+            std::cout << "Changed: " << file << std::endl;
+        }
+        
+        bool ok = builder.rebuild(changed);
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        std::cout << (ok ? "Rebuilt" : "Build failed") << " in " << elapsed << " ms" << std::endl;
+        
+        if (ok && runAfterBuild) {
+            runExecutables();
+        }
+    }
+}
+
+// A job count: a positive integer, digits only
+static unsigned parseJobs(const std::string& text) {
+    if (text.empty() || text.find_first_not_of("0123456789") != std::string::npos) {
+        throw std::invalid_argument(text);
+    }
+    unsigned long jobs = std::stoul(text);
+    if (jobs == 0 || jobs > std::numeric_limits<unsigned>::max()) {
+        throw std::out_of_range(text);
+    }
+    return static_cast<unsigned>(jobs);
+}
+
+int runBuild(int argc, char* argv[]) {
+    BuildOptions options;
+    std::vector<std::string> inputs;
+    std::string manifest;
+    std::string outputDir;
+    bool watch = false;
+    bool runAfterBuild = false;
+    
+    try {
+        for (int i = 2; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--watch") {
+                watch = true;
+            } else if (arg == "--run") {
+                runAfterBuild = true;
+            } else if (arg == "--hot") {
+                options.hotReload = true;
+            } else if (arg == "--instrument") {
+                options.instrument = true;
+            } else if (arg == "--track-allocations") {
+                options.trackAllocations = true;
+            } else if ((arg == "-o" || arg == "--out-dir") && i + 1 < argc) {
+                outputDir = argv[++i];
+            } else if (arg == "-j" && i + 1 < argc) {
+                options.jobs = parseJobs(argv[++i]);
+            } else if (arg.rfind("-j", 0) == 0 && arg.size() > 2) {
+                options.jobs = parseJobs(arg.substr(2));
+            } else if (arg == "--manifest" && i + 1 < argc) {
+                manifest = argv[++i];
+            } else if (arg == "--profile" && i + 1 < argc) {
+                options.profile = argv[++i];
+            } else if (arg == "--target" && i + 1 < argc) {
+                options.targets.push_back(argv[++i]);
+            } else if (arg.find("-") == 0) {
+                std::cerr << "Error: Unknown build option: " << arg << std::endl;
+                return 1;
+            } else {
+                inputs.push_back(arg);
+            }
+        }
+    } catch (const std::exception&) {
+        std::cerr << "Error: Invalid number in build options (-j takes a positive integer)" << std::endl;
+        return 1;
+    }
+    
+    try {
+        Project project;
+        if (!inputs.empty()) {
+            project = Project::fromInputs(inputs);
+        } else {
+            if (manifest.empty()) {
+                manifest = Project::MANIFEST_NAME;
+            }
+            if (!std::filesystem::exists(manifest)) {
+                std::cerr << "Error: No input files and no " << Project::MANIFEST_NAME << " found" << std::endl;
+                printUsage();
+                return 1;
+            }
+            project = Project::load(manifest);
+        }
+        if (!outputDir.empty()) {
+            project.outputDir = outputDir;
+        }
+        
+        if (watch) {
+            return runWatch(project, options, runAfterBuild);
+        }
+        
+        ProjectBuilder builder(project, options);
+        return builder.build() ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+int runBench(int argc, char* argv[]) {
+    BenchOptions options;
+    std::vector<std::string> inputs;
+    
+    try {
+        for (int i = 2; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--filter" && i + 1 < argc) {
+                options.filters.push_back(argv[++i]);
+            } else if (arg == "--samples" && i + 1 < argc) {
+                options.samples = std::stoi(argv[++i]);
+            } else if (arg == "--sample-time" && i + 1 < argc) {
+                options.sampleTime = std::stod(argv[++i]);
+            } else if (arg == "--baseline" && i + 1 < argc) {
+                options.baseline = argv[++i];
+            } else if (arg == "--threshold" && i + 1 < argc) {
+                options.threshold = std::stod(argv[++i]) / 100;
+            } else if (arg == "--save" && i + 1 < argc) {
+                options.save = argv[++i];
+            } else if ((arg == "-o" || arg == "--out-dir") && i + 1 < argc) {
+                options.outputDir = argv[++i];
+            } else if (arg.find("-") == 0) {
+                std::cerr << "Error: Unknown bench option: " << arg << std::endl;
+                return 1;
+            } else {
+                inputs.push_back(arg);
+            }
+        }
+    } catch (const std::exception&) {
+        std::cerr << "Error: Invalid number in bench options" << std::endl;
+        return 1;
+    }
+    
+    if (inputs.empty()) {
+        inputs = BenchRunner::discover(".", options.outputDir);
+        if (inputs.empty()) {
+            std::cerr << "Error: No .thor files with bench blocks found" << std::endl;
+            return 1;
+        }
+    }
+    BenchRunner runner(options);
+    return runner.run(inputs);
 }
 
 int main(int argc, char* argv[])
@@ -71,24 +288,77 @@ int main(int argc, char* argv[])
         }
     }
     
+    if (std::string(argv[1]) == "build") {
+        return runBuild(argc, argv);
+    }
+    if (std::string(argv[1]) == "bench") {
+        return runBench(argc, argv);
+    }
+    if (std::string(argv[1]) == "lsp") {
+        LanguageServer server;
+        return server.run();
+    }
+    
     std::string inputFile = argv[1];
     std::string outputFile;
     bool compileExecutable = true;
     bool keepCFile = false;
+    bool debugInfo = false;
+    bool instrument = false;
+    bool trackAllocations = false;
+    bool remarks = false;
+    bool watch = false;
+    bool runAfterBuild = false;
     
     // Parse command line arguments
     for (int i = 2; i < argc; i++) {
         std::string arg = argv[i];
-        if (arg == "--no-compile") {
+        if (arg == "--watch") {
+            watch = true;
+        } else if (arg == "--run") {
+            runAfterBuild = true;
+        } else if (arg == "--no-compile") {
             compileExecutable = false;
         } else if (arg == "--keep-c") {
             keepCFile = true;
+        } else if (arg == "--instrument") {
+            instrument = true;
+        } else if (arg == "--track-allocations") {
+            trackAllocations = true;
+        } else if (arg == "--remarks") {
+            remarks = true;
+        } else if (arg == "-g" || arg == "--debug") {
+            // Debuggers and profilers show the C around unmapped code, so keep it
+            debugInfo = true;
+            keepCFile = true;
         } else if (outputFile.empty() && arg.find("--") != 0) {
             // This is the output file argument
             outputFile = arg;
         }
     }
     
+    if (watch) {
+        // Watch mode keeps per-module objects around, so it builds like `thor build`,
+        // with the C flags a one-shot build of the same command line would use
+        try {
+            Project project = Project::fromInputs({inputFile});
+            if (debugInfo) {
+                project.cflags.push_back("-g");
+            }
+            if (remarks) {
+                project.cflags.push_back("-O2");
+                std::cerr << "Note: --watch builds with -O2 but does not report remarks" << std::endl;
+            }
+            BuildOptions options;
+            options.instrument = instrument;
+            options.trackAllocations = trackAllocations;
+            return runWatch(project, options, runAfterBuild);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    
     if (outputFile.empty()) {
         // Generate output filename
         std::filesystem::path path(inputFile);
@@ -97,41 +367,25 @@ int main(int argc, char* argv[])
     }
     
     try {
-        // Read input file
-        std::ifstream file(inputFile);
-        if (!file.is_open()) {
-            std::cerr << "Error: Could not open input file: " << inputFile << std::endl;
-            return 1;
-        }
-        
-        std::string content((std::istreambuf_iterator<char>(file)),
-                           std::istreambuf_iterator<char>());
-        file.close();
-        
         std::cout << "Compiling " << inputFile << " to " << outputFile << "..." << std::endl;
         
-        // Lexical analysis
-        Lexer lexer(content);
-        auto tokens = lexer.tokenize();
-        
-        // Syntax analysis
-        Parser parser(tokens);
-        auto program = parser.parse();
-        
-        // Process imports
-        ImportProcessor importProcessor;
-        // Add directory of input file to search paths
-        std::filesystem::path inputPath(inputFile);
-        if (inputPath.has_parent_path()) {
-            importProcessor.addSearchPath(inputPath.parent_path().string());
+        Compiler thorCompiler;
+        thorCompiler.setDebugInfo(debugInfo);
+        thorCompiler.setInstrumentation(instrument);
+        thorCompiler.setAllocationTracking(trackAllocations);
+        if (remarks) {
+            // Remarks describe an optimized build
+            thorCompiler.setRemarks(true);
+            thorCompiler.setCFlags({ "-O2" });
         }
-        
-        program = importProcessor.processImports(program);
-        auto loadedModules = importProcessor.getLoadedModules();
-        
-        // Code generation
-        CodeGenerator generator;
-        std::string generatedCode = generator.generate(program, loadedModules);
+        Compiler::Result result = thorCompiler.compileFileToC(inputFile, outputFile);
+        for (const auto& diagnostic : result.diagnostics) {
+            std::cerr << diagnostic.toString() << std::endl;
+        }
+        if (!result.success) {
+            return 1;
+        }
+        const std::string& generatedCode = result.code;
         
         // Write output file
         std::ofstream outFile(outputFile);
@@ -147,20 +401,31 @@ int main(int argc, char* argv[])
         
         // Automatically compile to executable if requested
         if (compileExecutable) {
-            std::string compiler = findCCompiler();
+            CompilerLocator locator;
+            CCompiler compiler = locator.locate();
             if (compiler.empty()) {
                 std::cout << "Warning: No C compiler found. Please install gcc, clang, or MinGW." << std::endl;
                 std::cout << "To manually compile: gcc " << outputFile << " -o " 
                          << std::filesystem::path(outputFile).stem().string() << std::endl;
             } else {
-                std::cout << "Found C compiler: " << compiler << std::endl;
+                std::cout << "Found C compiler: " << compiler.name << " (" << compiler.path << ")" << std::endl;
                 
                 // Generate executable name
                 std::filesystem::path execPath(outputFile);
                 execPath.replace_extension(".exe");
                 std::string execFile = execPath.string();
                 
-                if (compileWithCCompiler(compiler, outputFile, execFile)) {
+                bool built;
+                if (remarks) {
+                    // The library build collects the C compiler's remarks as diagnostics
+                    size_t first = result.diagnostics.size();
+                    thorCompiler.setCCompiler(compiler);
+                    built = thorCompiler.buildExecutable(result, execFile, outputFile);
+                    printRemarks({ result.diagnostics.begin() + first, result.diagnostics.end() });
+                } else {
+                    built = compileWithCCompiler(compiler, outputFile, execFile, debugInfo);
+                }
+                if (built) {
                     std::cout << "Successfully compiled to executable: " << execFile << std::endl;
                     
                     // Delete the C file unless user wants to keep it
@@ -176,8 +441,8 @@ int main(int argc, char* argv[])
                     
                     std::cout << "To run: " << execFile << std::endl;
                 } else {
-                    std::cout << "Error: Failed to compile with " << compiler << std::endl;
-                    std::cout << "To manually compile: " << compiler << " " << outputFile 
+                    std::cout << "Error: Failed to compile with " << compiler.name << std::endl;
+                    std::cout << "To manually compile: " << compiler.name << " " << outputFile 
                              << " -o " << std::filesystem::path(outputFile).stem().string() << std::endl;
                     std::cout << "C file preserved for manual compilation." << std::endl;
                 }